@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <future>
+#include <deque>
+#include <mutex>
+
+#include "CG/MeshData.h"
+#include "CG/MeshGLInfo.h"
+#include "CG/OBJFile.h"
+#include "CG/ThreadPool.h"
+
+namespace cg
+{
+	// Loads meshes on worker threads and uploads them to the GPU in small steps on the render thread.
+	//
+	// USAGE
+	// loadOBJ / loadMesh                 // from any thread, returns immediately
+	// processUploads(budget) every frame // render thread, calls the upload callbacks
+	class AssetLoader
+	{
+	public:
+		// Result of a load, nullptr if loading failed
+		using MeshFuture = std::shared_future<std::shared_ptr<const MeshData>>;
+
+		// Called on the render thread (from processUploads) once the mesh can be drawn
+		using UploadCallback = std::function<void(std::shared_ptr<const MeshData> mesh, std::shared_ptr<MeshGLInfo> meshInfo)>;
+
+		// Fills the mesh, returns false on failure. Runs on a worker thread.
+		using LoadFunction = std::function<bool(MeshData* mesh)>;
+
+		// 0 uses all hardware threads
+		explicit AssetLoader(unsigned int threads = 0);
+		~AssetLoader();
+
+		// Parses the file on a worker thread. If <onUploaded> is set the mesh is queued for upload afterwards.
+		MeshFuture loadOBJ(const std::string& path, float scale = 1.0f, UploadCallback onUploaded = nullptr, const OBJLoadOptions& options = OBJLoadOptions());
+
+		// Runs <load> on a worker thread. If <onUploaded> is set the mesh is queued for upload afterwards with <layout>.
+		MeshFuture loadMesh(LoadFunction load, UploadCallback onUploaded = nullptr, VertexLayout layout = VertexLayout::INTERLEAVED);
+
+		// Queues an already loaded mesh for upload, can be called from any thread.
+		// The mesh is converted to <layout> on the calling thread, only the GL calls are left to processUploads.
+		// A null <mesh> uploads nothing, <onUploaded> is called with nullptr once the uploads queued before it are done.
+		void queueUpload(std::shared_ptr<const MeshData> mesh, UploadCallback onUploaded, VertexLayout layout = VertexLayout::INTERLEAVED);
+
+		// Uploads queued meshes until <budgetMs> milliseconds are used up.
+		// Big meshes are split over several frames. Must be called on the thread that owns the GL context.
+		// Returns the number of meshes that still wait for their upload.
+		size_t processUploads(double budgetMs);
+
+	private:
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader(AssetLoader&&) = delete;
+
+		AssetLoader& operator=(const AssetLoader&) = delete;
+		AssetLoader& operator=(AssetLoader&&) = delete;
+
+		struct UploadJob
+		{
+			std::shared_ptr<const MeshData> mesh;
+			UploadCallback onUploaded;
+
+			// Prepared by queueUpload, gets its buffers in the first step
+			std::shared_ptr<MeshGLInfo> meshInfo;
+			std::vector<MeshGLInfo::BufferUpload> uploads;
+			bool allocated = false;
+
+			// Progress: current buffer and byte offset in it
+			size_t buffer = 0;
+			size_t offset = 0;
+		};
+
+		// Does a small amount of work on <job>, returns true when the job is finished
+		bool uploadStep(UploadJob* job);
+
+	private:
+		// Filled by the workers
+		std::deque<UploadJob> m_queuedUploads;
+		std::mutex m_queueMutex;
+
+		// Only used by the render thread
+		std::deque<UploadJob> m_activeUploads;
+
+		// Destroyed first so no worker touches the queues after they are gone
+		ThreadPool m_pool;
+	};
+}
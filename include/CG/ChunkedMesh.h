@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <fstream>
+#include <glm/glm.hpp>
+
+#include "CG/MeshData.h"
+#include "CG/MappedFile.h"
+
+namespace cg
+{
+	// Mesh split into chunks (".cgmc"), written by OBJFile::convert for meshes that do not fit into memory.
+	// Every chunk has its own vertices and 16-bit indices, so a chunk can be read and uploaded on its own.
+	// The submeshes are ranges of chunks: SubMesh::indexOffset is the first chunk and SubMesh::indexCount the number of chunks.
+	class ChunkedMesh
+	{
+	public:
+		// Chunks always fit 16-bit indices
+		static const size_t MAX_CHUNK_VERTICES = MeshData::MAX_SHORT_INDEX_VERTICES;
+		static const size_t MAX_CHUNK_TRIANGLES = 1 << 17;
+
+		// One chunk, the arrays point into the mapped file
+		struct Chunk
+		{
+			uint32_t subMesh = 0;
+			size_t vertexCount = 0;
+			size_t indexCount = 0;
+
+			glm::vec3 boundsMin = glm::vec3(0.0f);
+			glm::vec3 boundsMax = glm::vec3(0.0f);
+
+			const glm::vec3* positions = nullptr;
+			const glm::vec3* normals = nullptr;
+
+			// nullptr if the mesh has no texture coordinates
+			const glm::vec2* texcoords = nullptr;
+
+			const GLushort* indices = nullptr;
+		};
+
+		ChunkedMesh() = default;
+
+		// "dir/model.obj" -> "dir/model.cgmc"
+		static std::string getChunkedPath(const std::string& sourcePath);
+
+		// Maps the file, returns false if it is missing or broken
+		bool open(const std::string& path);
+		void close();
+
+		bool isOpen() const { return m_file.isOpen(); }
+		bool hasTexcoords() const { return m_hasTexcoords; }
+
+		size_t getChunkCount() const { return m_chunks.size(); }
+		const Chunk& getChunk(size_t chunk) const { return m_chunks[chunk]; }
+
+		// Sums over all chunks, vertices on the border of two chunks are in both
+		uint64_t getVertexCount() const { return m_vertexCount; }
+		uint64_t getIndexCount() const { return m_indexCount; }
+
+		const glm::vec3& getBoundsMin() const { return m_boundsMin; }
+		const glm::vec3& getBoundsMax() const { return m_boundsMax; }
+
+		const std::vector<Material>& getMaterials() const { return m_materials; }
+		const std::vector<SubMesh>& getSubMeshes() const { return m_subMeshes; }
+
+		// Copies all chunks into one mesh with index ranges as submeshes, only for meshes that fit into memory
+		void toMeshData(MeshData* meshData) const;
+
+	private:
+		ChunkedMesh(const ChunkedMesh&) = delete;
+		ChunkedMesh(ChunkedMesh&&) = delete;
+
+		ChunkedMesh& operator=(const ChunkedMesh&) = delete;
+		ChunkedMesh& operator=(ChunkedMesh&&) = delete;
+
+	private:
+		MappedFile m_file;
+
+		bool m_hasTexcoords = false;
+		std::vector<Chunk> m_chunks;
+		uint64_t m_vertexCount = 0;
+		uint64_t m_indexCount = 0;
+
+		glm::vec3 m_boundsMin = glm::vec3(0.0f);
+		glm::vec3 m_boundsMax = glm::vec3(0.0f);
+
+		std::vector<Material> m_materials;
+		std::vector<SubMesh> m_subMeshes;
+	};
+
+	// Writes a ChunkedMesh one chunk at a time, only the small chunk table is kept in memory
+	class ChunkedMeshWriter
+	{
+	public:
+		ChunkedMeshWriter() = default;
+		~ChunkedMeshWriter();
+
+		bool open(const std::string& path, bool hasTexcoords);
+
+		// <subMesh> is an index into the submeshes passed to finish(). <texcoords> is ignored without texture coordinates.
+		bool addChunk(uint32_t subMesh, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+			const std::vector<glm::vec2>& texcoords, const std::vector<GLushort>& indices);
+
+		// Sorts the submeshes by material, writes the tables and moves the file into place.
+		// Only SubMesh::name and SubMesh::material of <subMeshes> are used.
+		bool finish(const std::vector<Material>& materials, const std::vector<SubMesh>& subMeshes);
+
+		size_t getChunkCount() const { return m_chunks.size(); }
+
+	private:
+		ChunkedMeshWriter(const ChunkedMeshWriter&) = delete;
+		ChunkedMeshWriter(ChunkedMeshWriter&&) = delete;
+
+		ChunkedMeshWriter& operator=(const ChunkedMeshWriter&) = delete;
+		ChunkedMeshWriter& operator=(ChunkedMeshWriter&&) = delete;
+
+		void align();
+
+	private:
+		struct ChunkEntry
+		{
+			uint64_t offset;
+			uint32_t subMesh;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+		};
+
+		std::string m_path;
+		std::string m_tempPath;
+		std::ofstream m_file;
+		uint64_t m_offset = 0;
+		bool m_hasTexcoords = false;
+
+		std::vector<ChunkEntry> m_chunks;
+	};
+}
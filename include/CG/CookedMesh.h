@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "CG/MeshData.h"
+#include "CG/MeshGLInfo.h"
+#include "CG/MappedFile.h"
+
+namespace cg
+{
+	// GPU ready mesh file (".cgm") written offline by cg_cook.
+	// Every stream is stored in its GPU format, so loading is a memory mapping and one glBufferData per stream.
+	//
+	// Streams:
+	// POSITION  4 x GL_UNSIGNED_SHORT, normalized to the bounding box (see getPositionTransform)
+	// NORMAL    GL_INT_2_10_10_10_REV, normalized
+	// COLOR     4 x GL_UNSIGNED_BYTE, normalized
+	// NORMAL and COLOR are empty if the attribute is the same for every vertex (see getConstantNormal)
+	// INDEX     GL_UNSIGNED_SHORT or GL_UNSIGNED_INT (see getIndexType)
+	class CookedMesh
+	{
+	public:
+		enum Stream
+		{
+			POSITION,
+			NORMAL,
+			COLOR,
+			INDEX,
+			STREAM_COUNT
+		};
+
+		// Data of one stream, points into the mapped file
+		struct StreamView
+		{
+			VertexAttribFormat format;
+			const void* data = nullptr;
+			size_t size = 0;
+		};
+
+		CookedMesh() = default;
+
+		// "dir/model.obj" -> "dir/model.cgm"
+		static std::string getCookedPath(const std::string& sourcePath);
+
+		// Quantizes <meshData> and writes it to <path>. The mesh should be welded and optimized before.
+		// <sources> are the files it was cooked from, e.g. the OBJ file and its material libraries, their sizes and
+		// modification times are stored (see isUpToDate).
+		static bool write(const std::string& path, const MeshData& meshData, const std::vector<std::string>& sources = {});
+
+		// Maps the file, returns false if it is missing or broken
+		bool open(const std::string& path);
+		void close();
+
+		bool isOpen() const { return m_file.isOpen(); }
+
+		size_t getVertexCount() const { return m_vertexCount; }
+		size_t getIndexCount() const { return m_indexCount; }
+		GLenum getIndexType() const { return m_indexType; }
+		GLenum getDrawMode() const { return m_drawMode; }
+
+		const glm::vec3& getBoundsMin() const { return m_boundsMin; }
+		const glm::vec3& getBoundsMax() const { return m_boundsMax; }
+		const glm::vec3& getSphereCenter() const { return m_sphereCenter; }
+		float getSphereRadius() const { return m_sphereRadius; }
+
+		// Maps the normalized positions of the POSITION stream back to model space
+		glm::mat4 getPositionTransform() const;
+
+		// Of every vertex if the NORMAL or COLOR stream is empty
+		const glm::vec3& getConstantNormal() const { return m_constantNormal; }
+		const glm::vec3& getConstantColor() const { return m_constantColor; }
+
+		StreamView getStream(Stream stream) const { return m_streams[stream]; }
+
+		// See MeshData::subMeshes, bounds are in model space
+		const std::vector<Material>& getMaterials() const { return m_materials; }
+		const std::vector<SubMesh>& getSubMeshes() const { return m_subMeshes; }
+
+		// Size of the whole file in bytes
+		size_t getFileSize() const { return m_file.size(); }
+
+		// The files write was given with the directory of the cooked file in front
+		const std::vector<std::string>& getSources() const { return m_sources; }
+
+		// False once one of the sources has changed, appeared or disappeared since the mesh was cooked
+		bool isUpToDate() const { return m_upToDate; }
+
+	private:
+		CookedMesh(const CookedMesh&) = delete;
+		CookedMesh(CookedMesh&&) = delete;
+
+		CookedMesh& operator=(const CookedMesh&) = delete;
+		CookedMesh& operator=(CookedMesh&&) = delete;
+
+	private:
+		MappedFile m_file;
+
+		size_t m_vertexCount = 0;
+		size_t m_indexCount = 0;
+		GLenum m_indexType = GL_UNSIGNED_INT;
+		GLenum m_drawMode = GL_TRIANGLES;
+
+		glm::vec3 m_boundsMin = glm::vec3(0.0f);
+		glm::vec3 m_boundsMax = glm::vec3(0.0f);
+		glm::vec3 m_sphereCenter = glm::vec3(0.0f);
+		float m_sphereRadius = 0.0f;
+
+		// Dequantization: position = offset + normalized * scale
+		glm::vec3 m_positionOffset = glm::vec3(0.0f);
+		glm::vec3 m_positionScale = glm::vec3(1.0f);
+
+		glm::vec3 m_constantNormal = glm::vec3(0.0f, 0.0f, 1.0f);
+		glm::vec3 m_constantColor = glm::vec3(1.0f);
+
+		StreamView m_streams[STREAM_COUNT];
+
+		std::vector<Material> m_materials;
+		std::vector<SubMesh> m_subMeshes;
+
+		std::vector<std::string> m_sources;
+		bool m_upToDate = false;
+	};
+}
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+
+namespace cg
+{
+	// File that is removed when the object is destroyed
+	class TempFile
+	{
+	public:
+		explicit TempFile(std::string path) : m_path(std::move(path)) {}
+
+		~TempFile()
+		{
+			std::error_code ec;
+			std::filesystem::remove(m_path, ec);
+		}
+
+		const std::string& getPath() const { return m_path; }
+
+	private:
+		TempFile(const TempFile&) = delete;
+		TempFile(TempFile&&) = delete;
+
+		TempFile& operator=(const TempFile&) = delete;
+		TempFile& operator=(TempFile&&) = delete;
+
+	private:
+		std::string m_path;
+	};
+
+	// Buffered sequential output of a trivially copyable record type
+	template <typename T>
+	class RecordWriter
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "records are written as raw bytes");
+
+	public:
+		RecordWriter(const std::string& path, size_t bufferBytes)
+			: m_file(path, std::ios::binary | std::ios::trunc)
+		{
+			m_buffer.reserve(std::max<size_t>(1, bufferBytes / sizeof(T)));
+		}
+
+		~RecordWriter()
+		{
+			close();
+		}
+
+		bool write(const T& record)
+		{
+			m_buffer.push_back(record);
+			m_count++;
+			return m_buffer.size() < m_buffer.capacity() || flush();
+		}
+
+		bool write(const T* records, size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (!write(records[i]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Returns false if anything could not be written
+		bool close()
+		{
+			if (m_file.is_open())
+			{
+				flush();
+				m_file.close();
+			}
+			return !m_file.fail();
+		}
+
+		uint64_t getCount() const { return m_count; }
+
+	private:
+		RecordWriter(const RecordWriter&) = delete;
+		RecordWriter(RecordWriter&&) = delete;
+
+		RecordWriter& operator=(const RecordWriter&) = delete;
+		RecordWriter& operator=(RecordWriter&&) = delete;
+
+		bool flush()
+		{
+			m_file.write((const char*)m_buffer.data(), m_buffer.size() * sizeof(T));
+			m_buffer.clear();
+			return m_file.good();
+		}
+
+	private:
+		std::ofstream m_file;
+		std::vector<T> m_buffer;
+		uint64_t m_count = 0;
+	};
+
+	// Buffered sequential input of a file written by RecordWriter
+	template <typename T>
+	class RecordReader
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "records are read as raw bytes");
+
+	public:
+		RecordReader(const std::string& path, size_t bufferBytes)
+			: m_file(path, std::ios::binary)
+		{
+			m_buffer.resize(std::max<size_t>(1, bufferBytes / sizeof(T)));
+		}
+
+		bool isOpen() const { return m_file.is_open(); }
+
+		// Returns false at the end of the file
+		bool next(T* record)
+		{
+			if (m_position == m_size && !fill())
+			{
+				return false;
+			}
+			*record = m_buffer[m_position++];
+			return true;
+		}
+
+		// A file that ends inside a record is broken
+		bool isBroken() const { return m_broken; }
+
+	private:
+		RecordReader(const RecordReader&) = delete;
+		RecordReader(RecordReader&&) = delete;
+
+		RecordReader& operator=(const RecordReader&) = delete;
+		RecordReader& operator=(RecordReader&&) = delete;
+
+		bool fill()
+		{
+			if (!m_file.is_open())
+			{
+				return false;
+			}
+			m_file.read((char*)m_buffer.data(), m_buffer.size() * sizeof(T));
+			size_t bytes = (size_t)m_file.gcount();
+			m_broken |= bytes % sizeof(T) != 0;
+			m_size = bytes / sizeof(T);
+			m_position = 0;
+			return m_size > 0;
+		}
+
+	private:
+		std::ifstream m_file;
+		std::vector<T> m_buffer;
+		size_t m_size = 0;
+		size_t m_position = 0;
+		bool m_broken = false;
+	};
+
+	// Sorts more records than fit into memory. Records are collected up to <memoryLimit> bytes, sorted and written
+	// to temporary files ("runs") next to <tempPath>. finish() merges the runs and next() returns all records in order.
+	// Nothing is written if all records fit into memory. The memory use never exceeds <memoryLimit>.
+	template <typename T, typename Less = std::less<T>>
+	class ExternalSorter
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "records are written as raw bytes");
+
+	public:
+		ExternalSorter(std::string tempPath, size_t memoryLimit, Less less = Less())
+			: m_tempPath(std::move(tempPath))
+			, m_memoryLimit(std::max(memoryLimit, MIN_READ_BUFFER * 2))
+			, m_less(less)
+		{
+		}
+
+		~ExternalSorter()
+		{
+			m_readers.clear();
+			for (const std::string& run : m_runs)
+			{
+				std::error_code ec;
+				std::filesystem::remove(run, ec);
+			}
+		}
+
+		// Returns false if a run could not be written
+		bool push(const T& record)
+		{
+			if (m_buffer.capacity() == 0)
+			{
+				m_buffer.reserve(m_memoryLimit / sizeof(T));
+			}
+			m_buffer.push_back(record);
+			m_count++;
+			return m_buffer.size() < m_buffer.capacity() || spill();
+		}
+
+		// Called once after the last push, returns false if the runs could not be written or merged
+		bool finish()
+		{
+			if (m_runs.empty())
+			{
+				std::sort(m_buffer.begin(), m_buffer.end(), m_less);
+				return true;
+			}
+
+			if (!m_buffer.empty() && !spill())
+			{
+				return false;
+			}
+			m_buffer = std::vector<T>();
+
+			// Merge groups of runs until all remaining ones can be open at the same time
+			while (m_runs.size() > getMaxFanIn())
+			{
+				std::vector<std::string> runs;
+				for (size_t first = 0; first < m_runs.size(); first += getMaxFanIn())
+				{
+					size_t last = std::min(m_runs.size(), first + getMaxFanIn());
+					std::vector<std::string> group(m_runs.begin() + first, m_runs.begin() + last);
+					runs.push_back(nextRunPath());
+					if (!mergeRuns(group, runs.back()))
+					{
+						return false;
+					}
+				}
+				m_runs = std::move(runs);
+			}
+
+			return openReaders(m_runs);
+		}
+
+		// Next record in sorted order, false after the last one
+		bool next(T* record)
+		{
+			if (m_runs.empty())
+			{
+				if (m_position == m_buffer.size())
+				{
+					return false;
+				}
+				*record = m_buffer[m_position++];
+				return true;
+			}
+			return nextMerged(record);
+		}
+
+		uint64_t size() const { return m_count; }
+
+		// Bytes written to runs, including the ones of the merge passes
+		uint64_t getSpilledBytes() const { return m_spilledBytes; }
+
+	private:
+		ExternalSorter(const ExternalSorter&) = delete;
+		ExternalSorter(ExternalSorter&&) = delete;
+
+		ExternalSorter& operator=(const ExternalSorter&) = delete;
+		ExternalSorter& operator=(ExternalSorter&&) = delete;
+
+		// Smallest read buffer of a run while merging, smaller ones make the merge seek too much
+		static constexpr size_t MIN_READ_BUFFER = 64 << 10;
+
+		// Open runs are file handles, several sorters run at the same time
+		static constexpr size_t MAX_FAN_IN = 64;
+
+		struct HeapEntry
+		{
+			T record;
+			size_t reader;
+		};
+
+		size_t getMaxFanIn() const
+		{
+			return std::clamp<size_t>(m_memoryLimit / MIN_READ_BUFFER, 2, MAX_FAN_IN);
+		}
+
+		std::string nextRunPath()
+		{
+			return m_tempPath + ".run" + std::to_string(m_nextRun++);
+		}
+
+		bool spill()
+		{
+			std::sort(m_buffer.begin(), m_buffer.end(), m_less);
+
+			m_runs.push_back(nextRunPath());
+			std::ofstream file(m_runs.back(), std::ios::binary | std::ios::trunc);
+			file.write((const char*)m_buffer.data(), m_buffer.size() * sizeof(T));
+			m_spilledBytes += m_buffer.size() * sizeof(T);
+			m_buffer.clear();
+			return file.good();
+		}
+
+		bool openReaders(const std::vector<std::string>& runs)
+		{
+			m_readers.clear();
+			m_heap = decltype(m_heap)(HeapGreater{ m_less });
+
+			size_t bufferBytes = m_memoryLimit / runs.size();
+			for (const std::string& run : runs)
+			{
+				m_readers.push_back(std::make_unique<RecordReader<T>>(run, bufferBytes));
+				if (!m_readers.back()->isOpen())
+				{
+					return false;
+				}
+
+				HeapEntry entry;
+				entry.reader = m_readers.size() - 1;
+				if (m_readers.back()->next(&entry.record))
+				{
+					m_heap.push(entry);
+				}
+			}
+			return true;
+		}
+
+		bool nextMerged(T* record)
+		{
+			if (m_heap.empty())
+			{
+				return false;
+			}
+
+			HeapEntry entry = m_heap.top();
+			m_heap.pop();
+			*record = entry.record;
+
+			if (m_readers[entry.reader]->next(&entry.record))
+			{
+				m_heap.push(entry);
+			}
+			return true;
+		}
+
+		bool mergeRuns(const std::vector<std::string>& runs, const std::string& output)
+		{
+			// Half of the memory reads, the other half writes
+			m_memoryLimit /= 2;
+			bool opened = openReaders(runs);
+			m_memoryLimit *= 2;
+
+			RecordWriter<T> writer(output, m_memoryLimit / 2);
+			T record;
+			while (opened && nextMerged(&record))
+			{
+				writer.write(record);
+			}
+			m_spilledBytes += writer.getCount() * sizeof(T);
+
+			bool written = writer.close();
+			m_readers.clear();
+			for (const std::string& run : runs)
+			{
+				std::error_code ec;
+				std::filesystem::remove(run, ec);
+			}
+			return opened && written;
+		}
+
+		// std::priority_queue puts the largest element on top
+		struct HeapGreater
+		{
+			Less less;
+
+			bool operator()(const HeapEntry& a, const HeapEntry& b) const
+			{
+				return less(b.record, a.record);
+			}
+		};
+
+	private:
+		std::string m_tempPath;
+		size_t m_memoryLimit;
+		Less m_less;
+
+		std::vector<T> m_buffer;
+		size_t m_position = 0;
+		uint64_t m_count = 0;
+
+		std::vector<std::string> m_runs;
+		size_t m_nextRun = 0;
+		uint64_t m_spilledBytes = 0;
+
+		std::vector<std::unique_ptr<RecordReader<T>>> m_readers;
+		std::priority_queue<HeapEntry, std::vector<HeapEntry>, HeapGreater> m_heap{ HeapGreater{ m_less } };
+	};
+}
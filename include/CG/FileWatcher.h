@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace cg
+{
+	// Reports files that have been written or replaced, without blocking.
+	// Uses inotify on Linux, on other platforms nothing is ever reported.
+	//
+	// USAGE
+	// watch(path) for every file
+	// poll() every frame // returns the changed files
+	class FileWatcher
+	{
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		bool isSupported() const { return m_fd >= 0; }
+
+		// Starts watching <path>. The directory is watched, so editors that save by replacing the file are noticed too.
+		bool watch(const std::string& path);
+
+		// Files that changed since the last call, as they were passed to watch(). Every file is listed at most once.
+		std::vector<std::string> poll();
+
+	private:
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher(FileWatcher&&) = delete;
+
+		FileWatcher& operator=(const FileWatcher&) = delete;
+		FileWatcher& operator=(FileWatcher&&) = delete;
+
+	private:
+		int m_fd = -1;
+
+		// Watch descriptor -> absolute directory
+		std::unordered_map<int, std::string> m_directories;
+
+		// Absolute file path -> paths that were passed to watch()
+		std::unordered_map<std::string, std::vector<std::string>> m_files;
+	};
+}
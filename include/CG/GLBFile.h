@@ -0,0 +1,114 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "CG/MeshData.h"
+#include "CG/MeshGLInfo.h"
+#include "CG/MappedFile.h"
+
+namespace cg
+{
+	class Object;
+	class GLSLProgram;
+
+	// Binary glTF 2.0 file (".glb"). The file is mapped and the accessors point straight into its binary chunk,
+	// so the vertex and index data is uploaded with one glBufferData per accessor without being copied first.
+	//
+	// Supported: triangles, lines and points, 8-, 16- and 32-bit indices, all component types of KHR_mesh_quantization
+	// (normalized or not), interleaved buffer views, node hierarchies with matrix or TRS transforms.
+	// Not supported: external or embedded (data URI) buffers, sparse accessors, textures, skins and animations.
+	class GLBFile
+	{
+	public:
+		// Range of one accessor in the mapped file. <format> describes an element, the range starts at the first
+		// element and ends after the last one. Empty if the primitive does not have the attribute.
+		struct AccessorView
+		{
+			VertexAttribFormat format;
+			const void* data = nullptr;
+			size_t size = 0;
+			size_t count = 0;
+
+			bool isEmpty() const { return data == nullptr; }
+		};
+
+		struct Primitive
+		{
+			AccessorView position;
+			AccessorView normal;
+			AccessorView color;
+
+			// GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT in format.type, empty if the primitive is not indexed
+			AccessorView index;
+
+			GLenum drawMode = GL_TRIANGLES;
+
+			// Index into getMaterials() or SubMesh::NO_MATERIAL
+			uint32_t material = SubMesh::NO_MATERIAL;
+
+			// Of the positions as stored, quantized positions are mapped to model space by the node transforms
+			glm::vec3 boundsMin = glm::vec3(0.0f);
+			glm::vec3 boundsMax = glm::vec3(0.0f);
+		};
+
+		struct Mesh
+		{
+			std::string name;
+			std::vector<Primitive> primitives;
+		};
+
+		struct Node
+		{
+			std::string name;
+
+			// Relative to the parent
+			glm::mat4 transform = glm::mat4(1.0f);
+
+			// Index into getMeshes() or -1
+			int mesh = -1;
+			std::vector<size_t> children;
+		};
+
+		GLBFile() = default;
+
+		// Maps the file and reads its JSON chunk, returns false if it is missing or not a supported glTF file
+		bool open(const std::string& path);
+		void close();
+
+		bool isOpen() const { return m_file.isOpen(); }
+
+		const std::vector<Mesh>& getMeshes() const { return m_meshes; }
+		const std::vector<Node>& getNodes() const { return m_nodes; }
+		const std::vector<Material>& getMaterials() const { return m_materials; }
+
+		// Nodes of the default scene
+		const std::vector<size_t>& getRootNodes() const { return m_rootNodes; }
+
+		// Uploads every mesh once and builds one Object per node of the default scene, with the glTF node
+		// hierarchy as children of the returned object. Meshes used by several nodes share their MeshGLInfo,
+		// primitives after the first one of a mesh are children of the node object.
+		// The file can be closed afterwards.
+		std::shared_ptr<Object> createObjects(GLSLProgram* shader) const;
+
+	private:
+		GLBFile(const GLBFile&) = delete;
+		GLBFile(GLBFile&&) = delete;
+
+		GLBFile& operator=(const GLBFile&) = delete;
+		GLBFile& operator=(GLBFile&&) = delete;
+
+		// Reads the JSON chunk of the mapped file, <error> says why it failed
+		bool read(std::string* error);
+
+	private:
+		MappedFile m_file;
+
+		std::vector<Mesh> m_meshes;
+		std::vector<Node> m_nodes;
+		std::vector<Material> m_materials;
+		std::vector<size_t> m_rootNodes;
+	};
+}
@@ -56,6 +56,7 @@ namespace cg
 		
 		bool linked;                 // not-linked (still compiling) or linked
 		bool verbose;                // simple error handling: output to console
+		unsigned int revision;       // counts swap(), users of the program compare it to notice a reload
 
 	public:
 		GLSLProgram(bool verbose = true); // simple error handling: output to console
@@ -69,6 +70,9 @@ namespace cg
 		std::string log(void) const; // error log
 		int  getHandle(void) const;  // program id/handle
 		bool isLinked(void) const;   // still COMPILATION or already LINKED 
+		unsigned int getRevision(void) const;
+
+		void swap(GLSLProgram& other); // exchange the compiled programs, e.g. to replace a program with a reloaded one in place
 
 		void bindAttribLocation(GLuint location, const char* name);   // location -> attrib in
 		void bindFragDataLocation(GLuint location, const char* name); //             fragData out -> location
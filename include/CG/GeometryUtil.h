@@ -4,7 +4,20 @@
 
 namespace cg::GeometryUtil
 {
-	void generateSphereModel(cg::MeshData* model, uint8_t n, float radius, const glm::vec3& color = { 1.0f, 1.0f, 0.0f });
+	// <optimize> reorders the triangles and vertices for the vertex cache with MeshOptimizer::optimize.
+	// The faces are generated row by row, which reuses few vertices before they leave the cache.
+	void generateSphereModel(cg::MeshData* model, uint8_t n, float radius, const glm::vec3& color = { 1.0f, 1.0f, 0.0f }, bool optimize = false);
+
+	// Largest <subdivisions> of generateIcosphereModel, the vertices still fit 32-bit indices
+	static const uint32_t MAX_ICOSPHERE_SUBDIVISIONS = 20000;
+
+	// Sphere from an icosahedron whose edges are split into <subdivisions> segments: 20 * subdivisions^2 triangles and
+	// 10 * subdivisions^2 + 2 vertices. Every vertex is shared by all triangles around it and all triangles face outwards.
+	// The points are placed along great circles, so the triangles keep about the same area and shape everywhere.
+	// The 20 faces are filled on <threads> threads (0 uses all hardware threads) once they are large enough.
+	// <optimize> works like in generateSphereModel. Returns false if <subdivisions> is 0 or too large.
+	bool generateIcosphereModel(cg::MeshData* model, uint32_t subdivisions, float radius, const glm::vec3& color = { 1.0f, 1.0f, 0.0f },
+		bool optimize = false, unsigned int threads = 1);
 	void generateOriginModel(cg::MeshData* model);
 	void generateLineModel(cg::MeshData* model, float length, const glm::vec3& dir = { 0.0f, 1.0f, 0.0f }, const glm::vec3& color = { 1.0f, 0.0f, 0.0f }, const glm::vec3& center = { 0.0f, 0.0f, 0.0f });
 	void generateNormalDisplayObj(cg::MeshData* model, const cg::MeshData* modelWithNormals, float normalLength = 0.1f, const glm::vec3& color = { 0.0f, 1.0f, 1.0f });
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <future>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+#include "CG/AssetLoader.h"
+#include "CG/FileWatcher.h"
+#include "CG/MeshGLInfo.h"
+#include "CG/ThreadPool.h"
+
+namespace cg
+{
+	// Reloads meshes and shaders when their files change on disk.
+	// Meshes are parsed and uploaded by the AssetLoader, then swapped into the MeshGLInfo every Object shares (MeshGLInfo::swap).
+	// Shaders are read on a worker thread and replace the program behind ShaderManager::getShader in place.
+	// Objects notice the swap and only rebuild their own VAO (Object::isVAOOutdated).
+	//
+	// USAGE
+	// watchOBJ / watchMesh / watchShader // render thread
+	// update() every frame               // render thread
+	class HotReloader
+	{
+	public:
+		// Called on the render thread after the reloaded mesh has been swapped in
+		using ReloadCallback = std::function<void(std::shared_ptr<const MeshData> mesh)>;
+
+		explicit HotReloader(AssetLoader& loader);
+		~HotReloader();
+
+		bool isSupported() const { return m_watcher.isSupported(); }
+
+		// Loads <path> into <meshInfo> again whenever it or one of its material libraries changes, with the same arguments as OBJFile::load.
+		// <materialLibraries> are the ones of the first load (OBJLoadStats::materialLibraries), libraries added later are watched after the next reload.
+		void watchOBJ(const std::string& path, std::shared_ptr<MeshGLInfo> meshInfo, float scale = 1.0f, ReloadCallback onReloaded = nullptr,
+			const OBJLoadOptions& options = OBJLoadOptions(), const std::vector<std::string>& materialLibraries = {});
+
+		// Runs <load> on a worker thread whenever <path> changes and swaps the result into <meshInfo>.
+		// Nothing happens if <meshInfo> has been released in the meantime.
+		void watchMesh(const std::string& path, std::shared_ptr<MeshGLInfo> meshInfo, AssetLoader::LoadFunction load, ReloadCallback onReloaded = nullptr);
+
+		// Compiles the shader <name> of the ShaderManager again whenever one of its files changes
+		void watchShader(const std::string& name);
+
+		// Starts reloads for changed files and relinks shaders whose sources have been read.
+		// Must be called on the thread that owns the GL context.
+		void update();
+
+	private:
+		HotReloader(const HotReloader&) = delete;
+		HotReloader(HotReloader&&) = delete;
+
+		HotReloader& operator=(const HotReloader&) = delete;
+		HotReloader& operator=(HotReloader&&) = delete;
+
+		// Files a mesh is read from besides the watched one, written by the load on a worker thread
+		struct Dependencies
+		{
+			std::mutex mutex;
+			std::vector<std::string> paths;
+		};
+
+		struct WatchedMesh
+		{
+			std::weak_ptr<MeshGLInfo> meshInfo;
+			AssetLoader::LoadFunction load;
+			ReloadCallback onReloaded;
+
+			// Number of reloads started, only the newest one is swapped in
+			unsigned int requested = 0;
+
+			// Set for OBJ files, their material libraries. Files that are no longer used stay watched.
+			std::shared_ptr<Dependencies> dependencies;
+			std::vector<std::string> watchedDependencies;
+		};
+
+		struct PendingShader
+		{
+			std::string name;
+
+			// Contents of the shader files, empty if one could not be read
+			std::future<std::vector<std::string>> sources;
+		};
+
+		std::shared_ptr<WatchedMesh> addMesh(const std::string& path, std::shared_ptr<MeshGLInfo> meshInfo, AssetLoader::LoadFunction load, ReloadCallback onReloaded);
+		void watchDependencies(const std::shared_ptr<WatchedMesh>& mesh);
+		void reloadMesh(const std::shared_ptr<WatchedMesh>& mesh);
+		void reloadShader(const std::string& name);
+
+	private:
+		AssetLoader& m_loader;
+		FileWatcher m_watcher;
+
+		// File -> what it is loaded into
+		std::unordered_multimap<std::string, std::shared_ptr<WatchedMesh>> m_meshes;
+		std::unordered_multimap<std::string, std::string> m_shaders;
+
+		// Shaders whose sources are being read, in the order the reads were started
+		std::vector<PendingShader> m_pendingShaders;
+
+		// Reads shader sources, destroyed first so no read outlives the rest
+		ThreadPool m_pool;
+	};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace cg
+{
+	// Read-only memory mapping of a whole file.
+	// The mapping stays valid until close() is called or the object is destroyed.
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		bool open(const std::string& path);
+		void close();
+
+		bool isOpen() const { return m_open; }
+		const char* data() const { return m_data; }
+		size_t size() const { return m_size; }
+		std::string_view view() const { return std::string_view(m_data, m_size); }
+
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) = delete;
+
+	private:
+		const char* m_data = nullptr;
+		size_t m_size = 0;
+		bool m_open = false;
+
+#ifdef _WIN32
+		void* m_fileHandle = nullptr;
+		void* m_mappingHandle = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory_resource>
+#include <mutex>
+#include <cstddef>
+
+namespace cg
+{
+	// Monotonic memory for the temporaries of a mesh import, used through std::pmr containers.
+	// Allocations bump a pointer through large blocks and reset() gives everything back at once. Deallocating the
+	// latest allocation returns its memory. Large buffers freed out of order, like the old buffers of a growing vector,
+	// are remembered and reused by later allocations that fit, smaller ones are left until the next reset().
+	//
+	// The blocks are kept: reset() merges them into one block as large as the most memory in use since the last
+	// reset, so loading files of about the same size again does not allocate from the heap at all.
+	// release() frees the memory.
+	// Allocations are thread safe.
+	class MeshArena : public std::pmr::memory_resource
+	{
+	public:
+		// Size of the first block, later blocks double
+		static const size_t MIN_BLOCK_SIZE = 1 << 20;
+
+		// Smallest freed buffer that is reused, and how many are remembered at most
+		static const size_t MIN_FREE_SIZE = 4096;
+		static const size_t MAX_FREE_RANGES = 32;
+
+		MeshArena() = default;
+		~MeshArena();
+
+		// Makes all memory available again. Containers that use the arena have to be destroyed before.
+		void reset();
+
+		// Frees all blocks
+		void release();
+
+		// Since the last reset
+		size_t getAllocationCount() const { return m_allocations; }
+		size_t getHeapAllocationCount() const { return m_heapAllocations; }
+		size_t getUsedBytes() const { return m_used; }
+
+		// Size of all blocks
+		size_t getCapacity() const { return m_capacity; }
+
+	private:
+		MeshArena(const MeshArena&) = delete;
+		MeshArena(MeshArena&&) = delete;
+
+		MeshArena& operator=(const MeshArena&) = delete;
+		MeshArena& operator=(MeshArena&&) = delete;
+
+		struct Block
+		{
+			Block* next;
+			size_t size;
+		};
+
+		struct FreeRange
+		{
+			char* begin;
+			char* end;
+		};
+
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		// Adds a block with at least <bytes> free bytes and makes it the current one
+		void addBlock(size_t bytes);
+
+		// Takes <bytes> from a free range, nullptr if none is large enough
+		void* allocateFreed(size_t bytes, size_t alignment);
+		void addFreed(char* begin, char* end);
+
+	private:
+		std::mutex m_mutex;
+
+		// Current block first
+		Block* m_blocks = nullptr;
+		char* m_top = nullptr;
+		char* m_end = nullptr;
+
+		FreeRange m_freeRanges[MAX_FREE_RANGES];
+		size_t m_freeRangeCount = 0;
+
+		size_t m_capacity = 0;
+		size_t m_used = 0;
+
+		// Bytes taken from the blocks by bumping <m_top>, and the most since the last reset
+		size_t m_consumed = 0;
+		size_t m_peakConsumed = 0;
+		size_t m_allocations = 0;
+		size_t m_heapAllocations = 0;
+	};
+}
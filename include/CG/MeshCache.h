@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "CG/MeshData.h"
+
+namespace cg
+{
+	// Identifies the source a cached mesh was built from.
+	// A cache file is only used if all of these match.
+	struct MeshCacheKey
+	{
+		uint64_t sourceSize = 0;
+		int64_t sourceTime = 0;
+		float scale = 1.0f;
+
+		// Loader settings that change the result
+		uint32_t options = 0;
+	};
+
+	// Binary copy of a finished MeshData (".cgmesh"), stored next to the file it was loaded from.
+	// The arrays are stored exactly as they are in memory so loading is a plain copy out of a memory mapping,
+	// or compressed with MeshCodec, which is about half the size but decodes slower than the plain copy from the page cache.
+	class MeshCache
+	{
+	public:
+		static std::string getCachePath(const std::string& sourcePath);
+		static bool makeKey(const std::string& sourcePath, float scale, MeshCacheKey* key);
+
+		// Returns false if there is no cache file or if it is outdated or broken.
+		// <dependencies> gets the files besides the source that write was given, with the directory of <cachePath> in front.
+		static bool read(const std::string& cachePath, const MeshCacheKey& key, MeshData* meshData, std::vector<std::string>* dependencies = nullptr);
+
+		// <dependencies> are other files the mesh was built from, e.g. material libraries, that may or may not exist. Their sizes and
+		// modification times are stored, read treats the cache as outdated once one of them changes, appears or disappears.
+		static bool write(const std::string& cachePath, const MeshCacheKey& key, const MeshData& meshData, bool compress = false,
+			const std::vector<std::string>& dependencies = {});
+
+		// Binary layout of MeshData::materials and MeshData::subMeshes, also used by CookedMesh
+		static void writeSubMeshes(std::ostream& file, const std::vector<Material>& materials, const std::vector<SubMesh>& subMeshes);
+		static size_t getSubMeshesSize(const std::vector<Material>& materials, const std::vector<SubMesh>& subMeshes);
+
+		// Returns false if <size> bytes at <data> are not exactly one table as written by writeSubMeshes
+		static bool readSubMeshes(const char* data, size_t size, std::vector<Material>* materials, std::vector<SubMesh>* subMeshes);
+
+		// Sizes and modification times of <paths>, stored relative to <directory>, the one of the file the table is written to.
+		// Files that do not exist are stored as missing. Also used by CookedMesh.
+		static void writeDependencies(std::ostream& file, const std::string& directory, const std::vector<std::string>& paths);
+		static size_t getDependenciesSize(const std::string& directory, const std::vector<std::string>& paths);
+
+		// Returns false if <size> bytes at <data> are not exactly one table as written by writeDependencies.
+		// <paths> gets the files with <directory> in front, <upToDate> tells if all of them are unchanged.
+		static bool readDependencies(const char* data, size_t size, const std::string& directory, std::vector<std::string>* paths, bool* upToDate);
+	};
+}
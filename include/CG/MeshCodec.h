@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glad/glad.h>
+
+namespace cg::MeshCodec
+{
+	// Indices: difference to the previous index, zigzag and LEB128 varint.
+	// Compresses best after MeshOptimizer::optimizeVertexCache, which keeps neighbouring indices close together.
+	// The encoded bytes are appended to <out>.
+	void encodeIndices(const GLuint* indices, size_t count, std::vector<uint8_t>* out);
+
+	// Returns false unless <size> bytes are exactly <count> encoded indices
+	bool decodeIndices(const uint8_t* data, size_t size, GLuint* indices, size_t count);
+
+	// Vertex streams of <count> elements of <stride> bytes, <stride> must be a multiple of 4 (e.g. glm::vec3).
+	// Every 32 bit word is replaced by its zigzag difference to the same word of the previous element,
+	// the bytes are split into planes (byte 0 of every word, byte 1 of every word, ...) and every group
+	// of 16 bytes of a plane is bit packed with 0, 2, 4 or 8 bits per byte.
+	// Returns false if <stride> is not supported. The encoded bytes are appended to <out>.
+	bool encodeVertices(const void* vertices, size_t count, size_t stride, std::vector<uint8_t>* out);
+
+	// Returns false unless <size> bytes are exactly <count> encoded elements
+	bool decodeVertices(const uint8_t* data, size_t size, void* vertices, size_t count, size_t stride);
+}
@@ -1,26 +1,183 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <cstdint>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 namespace cg
 {
+	// Surface parameters of a part of a mesh, usually from an MTL file.
+	// The defaults are the ones used for objects without material.
+	struct Material
+	{
+		std::string name;
+
+		glm::vec3 ambient = glm::vec3(0.1f, 0.1f, 0.1f);   // Ka
+		glm::vec3 diffuse = glm::vec3(0.8f, 0.1f, 0.1f);   // Kd
+		glm::vec3 specular = glm::vec3(1.0f, 1.0f, 1.0f);  // Ks
+		float shininess = 8.0f;                            // Ns
+	};
+
+	// Range of MeshData::indices that belongs to one group/object and one material
+	struct SubMesh
+	{
+		// The object color is used instead of a material
+		static const uint32_t NO_MATERIAL = ~0u;
+
+		// Group or object name
+		std::string name;
+
+		// Index into MeshData::materials or NO_MATERIAL
+		uint32_t material = NO_MATERIAL;
+
+		uint32_t indexOffset = 0;
+		uint32_t indexCount = 0;
+
+		glm::vec3 boundsMin = glm::vec3(0.0f);
+		glm::vec3 boundsMax = glm::vec3(0.0f);
+	};
+
+	// Cluster of up to about a hundred neighbouring triangles, see MeshletBuilder.
+	// Culled on its own against the view frustum and against the view direction.
+	struct Meshlet
+	{
+		// Range of MeshData::indices, inside one submesh
+		uint32_t indexOffset = 0;
+		uint32_t indexCount = 0;
+
+		// Bounding sphere of the triangles
+		glm::vec3 center = glm::vec3(0.0f);
+		float radius = 0.0f;
+
+		// Every triangle normal lies within the cone around <coneAxis>. <coneCutoff> is the sine of the angle of the cone
+		// plus 90 degrees, the cluster faces away from an eye e if dot(center - e, coneAxis) > coneCutoff * |center - e| + radius.
+		// 1 if the normals spread too far for that or the mesh is not closed.
+		glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		float coneCutoff = 1.0f;
+	};
+
 	struct MeshData
 	{
 		std::vector<glm::vec3> vertices;
 		std::vector<glm::vec3> colors;
-		std::vector<GLushort> indices;
+		std::vector<GLuint> indices;
 		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> texcoords;
+
+		// Attributes that are the same for every vertex are not stored per vertex. While <colors> or <normals> is empty,
+		// every vertex has <constantColor> or <constantNormal>, MeshGLInfo sets them without a buffer.
+		glm::vec3 constantColor = glm::vec3(0.8f, 0.1f, 0.1f);
+		glm::vec3 constantNormal = glm::vec3(0.0f, 0.0f, 1.0f);
+
+		// Optional, sorted by material so ranges with the same material are drawn back to back.
+		// Empty if the mesh is drawn as a whole.
+		std::vector<Material> materials;
+		std::vector<SubMesh> subMeshes;
 
+		// Optional, sorted by index offset and cover the triangles of GL_TRIANGLES meshes one after the other.
+		// Only valid for the triangle order MeshletBuilder::buildMeshlets left, anything that reorders the indices clears them.
+		std::vector<Meshlet> meshlets;
+
+		// GL_TRIANGLES, GL_LINES, or GL_TRIANGLE_STRIP with the strips one after the other, separated by RESTART_INDEX
+		// (see MeshOptimizer::convertToStrips). Submeshes of strip meshes hold whole strips.
 		GLenum drawMode = GL_TRIANGLES;
 
+		// Type of the GPU index buffer, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+		// <indices> are always 32-bit on the CPU side, they are narrowed on upload.
+		GLenum indexType = GL_UNSIGNED_INT;
+
+		// Largest vertex count that still fits 16-bit indices.
+		// 0xFFFF is left out so it stays free as primitive restart index.
+		static const size_t MAX_SHORT_INDEX_VERTICES = 0xFFFF;
+
+		// Ends a strip in <indices>, narrowed to 0xFFFF along with 16-bit indices
+		static const GLuint RESTART_INDEX = 0xFFFFFFFF;
+
+		// Picks the smallest index type that can address all vertices
+		void updateIndexType()
+		{
+			indexType = vertices.size() <= MAX_SHORT_INDEX_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		}
+
+		size_t getIndexSize() const
+		{
+			return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		}
+
+		// Triangles that are drawn, strips and lists alike
+		size_t getTriangleCount() const
+		{
+			if (drawMode == GL_TRIANGLES)
+			{
+				return indices.size() / 3;
+			}
+			if (drawMode != GL_TRIANGLE_STRIP)
+			{
+				return 0;
+			}
+
+			size_t count = 0;
+			size_t stripLength = 0;
+			for (GLuint index : indices)
+			{
+				if (index == RESTART_INDEX)
+				{
+					stripLength = 0;
+				}
+				else if (++stripLength >= 3)
+				{
+					count++;
+				}
+			}
+			return count;
+		}
+
+		glm::vec3 getColor(size_t vertex) const { return colors.empty() ? constantColor : colors[vertex]; }
+		glm::vec3 getNormal(size_t vertex) const { return normals.empty() ? constantNormal : normals[vertex]; }
+
+		// Replaces per-vertex colors and normals that are all the same with the constant
+		void collapseConstantAttributes()
+		{
+			collapse(&colors, &constantColor);
+			collapse(&normals, &constantNormal);
+		}
+
+		// Back to an empty GL_TRIANGLES mesh
 		void clearAll()
 		{
 			vertices.clear();
 			colors.clear();
 			normals.clear();
 			indices.clear();
+			texcoords.clear();
+			materials.clear();
+			subMeshes.clear();
+			meshlets.clear();
+			constantColor = glm::vec3(0.8f, 0.1f, 0.1f);
+			constantNormal = glm::vec3(0.0f, 0.0f, 1.0f);
+			drawMode = GL_TRIANGLES;
+			indexType = GL_UNSIGNED_INT;
+		}
+
+	private:
+		static void collapse(std::vector<glm::vec3>* values, glm::vec3* constant)
+		{
+			if (values->empty())
+			{
+				return;
+			}
+			for (const glm::vec3& value : *values)
+			{
+				if (value != values->front())
+				{
+					return;
+				}
+			}
+			*constant = values->front();
+			values->clear();
+			values->shrink_to_fit();
 		}
 	};
 }
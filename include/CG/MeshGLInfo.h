@@ -1,27 +1,133 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "CG/MeshData.h"
+#include "CG/VertexFormat.h"
 
 namespace cg
 {
+	class CookedMesh;
+	class GLBFile;
+
+	// How the vertex attributes of a mesh are laid out on the GPU
+	enum class VertexLayout
+	{
+		// One buffer, the attributes of a vertex next to each other (MeshGLInfo::InterleavedFormat).
+		// A vertex is fetched from one place instead of three.
+		INTERLEAVED,
+
+		// A buffer per attribute. Passes that only read the positions, like a depth pre-pass, fetch nothing else.
+		SPLIT,
+
+		// Interleaved like INTERLEAVED but 16 instead of 36 bytes per vertex (MeshGLInfo::QuantizedFormat).
+		// Positions are 16 bit over the bounding box, the position transform maps them back.
+		QUANTIZED
+	};
+
 	class MeshGLInfo
 	{
     public:
+        // Layout of VertexLayout::INTERLEAVED, constant attributes are left out
+        using InterleavedFormat = VertexFormat<Pos3f, Normal3f, Color3f>;
+
+        // Layout of VertexLayout::QUANTIZED, constant attributes are left out
+        using QuantizedFormat = VertexFormat<PosQ16, NormalQ10, Color4ub>;
+
+        // Without buffers, generate and createBuffers only create the ones that get data
         MeshGLInfo();
         ~MeshGLInfo();
 
+        // All three are the same buffer unless the layout is split, the formats have the stride and the offsets
         GLuint getPositionBufferID() const { return m_positionBuffer; }
-        GLuint getColorBufferID() const { return m_colorBuffer; }
-        GLuint getNormalBufferID() const { return m_normalBuffer; }
+        // 0 for constant attributes
+        GLuint getColorBufferID() const { return m_colorConstant ? 0 : m_layout != VertexLayout::SPLIT ? m_positionBuffer : m_colorBuffer; }
+        GLuint getNormalBufferID() const { return m_normalConstant ? 0 : m_layout != VertexLayout::SPLIT ? m_positionBuffer : m_normalBuffer; }
         GLuint getIndexBufferID() const { return m_indexBuffer; }
         GLuint getIndexBufferSize() const { return m_drawAmount; }
         GLenum getDrawMode() const { return m_drawMode; }
+        GLenum getIndexType() const { return m_indexType; }
+        VertexLayout getVertexLayout() const { return m_layout; }
+
+        // Size of one vertex summed over all attribute buffers
+        size_t getVertexSize() const;
+
+        // Separates the strips of GL_TRIANGLE_STRIP meshes, the largest value of the index type like MeshData::RESTART_INDEX after narrowing
+        GLuint getRestartIndex() const { return m_indexType == GL_UNSIGNED_SHORT ? 0xFFFF : MeshData::RESTART_INDEX; }
+
+        const VertexAttribFormat& getPositionFormat() const { return m_positionFormat; }
+        const VertexAttribFormat& getColorFormat() const { return m_colorFormat; }
+        const VertexAttribFormat& getNormalFormat() const { return m_normalFormat; }
+
+        // Attributes that are the same for every vertex have no buffer, the value is set with glVertexAttrib3f
+        // (see VertexArrayObject::setConstantAttrib). Saves 12 bytes per vertex for meshes without vertex colors.
+        bool isColorConstant() const { return m_colorConstant; }
+        bool isNormalConstant() const { return m_normalConstant; }
+        const glm::vec3& getConstantColor() const { return m_constantColor; }
+        const glm::vec3& getConstantNormal() const { return m_constantNormal; }
+
+        // Maps the stored positions to model space, identity unless the positions are quantized
+        const glm::mat4& getPositionTransform() const { return m_positionTransform; }
+
+        // Index ranges sorted by material, empty if the mesh is drawn as a whole (see MeshData::subMeshes)
+        const std::vector<Material>& getMaterials() const { return m_materials; }
+        const std::vector<SubMesh>& getSubMeshes() const { return m_subMeshes; }
+
+        // Clusters of triangles that are culled one by one, empty if the mesh has none (see MeshData::meshlets)
+        const std::vector<Meshlet>& getMeshlets() const { return m_meshlets; }
+
+        // Counts swap(), users of the buffers compare it to notice a reload
+        unsigned int getRevision() const { return m_revision; }
 
-        static std::shared_ptr<MeshGLInfo> generate(const MeshData& meshData);
+        // Exchanges buffers and layout with <other>, e.g. to replace a mesh with a reloaded one in place.
+        // Everyone that shares this MeshGLInfo draws the new mesh, the old buffers are deleted with <other>.
+        void swap(MeshGLInfo& other);
+
+        // Which buffer of a MeshGLInfo an upload is for
+        enum class BufferSlot
+        {
+            POSITION, // all attributes if interleaved
+            COLOR,
+            NORMAL,
+            INDEX
+        };
+
+        // Content of one GL buffer that still has to be written with glBufferSubData
+        struct BufferUpload
+        {
+            GLenum target;
+            BufferSlot slot;
+            GLuint buffer; // 0 until the buffers are created
+            const void* data;
+            size_t size;
+
+            // Set if the data had to be converted, <data> points into it
+            std::shared_ptr<const void> storage;
+        };
+
+        static std::shared_ptr<MeshGLInfo> generate(const MeshData& meshData, VertexLayout layout = VertexLayout::INTERLEAVED);
+
+        // Uploads the streams of a cooked mesh as they are, always VertexLayout::SPLIT, one glBufferData per stream.
+        // <scale> is folded into the position transform.
+        static std::shared_ptr<MeshGLInfo> generate(const CookedMesh& cookedMesh, float scale = 1.0f);
+
+        // Uploads the accessors of one glTF primitive straight from the mapped file.
+        // Missing normals and colors are filled with constants, 8-bit indices are widened to 16-bit.
+        static std::shared_ptr<MeshGLInfo> generate(const GLBFile& file, size_t mesh, size_t primitive);
+
+        // Converts <meshData> to <layout> without touching GL, so big meshes can be interleaved, quantized and narrowed
+        // on a worker thread. <uploads> receives the data for every buffer, it points into <meshData> or into its own storage.
+        // The result has no buffers until createBuffers is called on the render thread.
+        static std::shared_ptr<MeshGLInfo> prepare(const MeshData& meshData, std::vector<BufferUpload>* uploads,
+            VertexLayout layout = VertexLayout::INTERLEAVED);
+
+        // Creates the buffers of a prepared mesh with their final size but does not fill them, sets the buffer of every upload.
+        // The mesh must not be drawn before all uploads have been written.
+        void createBuffers(std::vector<BufferUpload>* uploads);
 
     private:
         MeshGLInfo(const MeshGLInfo&) = delete;
@@ -30,15 +136,41 @@ namespace cg
         MeshGLInfo& operator=(const MeshGLInfo&) = delete;
         MeshGLInfo& operator=(MeshGLInfo&&) = delete;
 
+        // Creates the buffer of <slot> on first use
+        GLuint genBuffer(BufferSlot slot);
+
+        // Takes the layout, the attribute formats, the constant attributes and the draw ranges of <meshData> in <layout>
+        // and lists the buffers together with the data they get
+        void listBuffers(const MeshData& meshData, VertexLayout layout, std::vector<BufferUpload>* uploads);
+
     private:
-        GLuint m_positionBuffer; // ID of vertex-buffer: position
-        GLuint m_colorBuffer;    // ID of vertex-buffer: color
-        GLuint m_normalBuffer;   // ID of vertex-buffer: normal
+        GLuint m_positionBuffer = 0; // ID of vertex-buffer: position, or all attributes if interleaved
+        GLuint m_colorBuffer = 0;    // ID of vertex-buffer: color
+        GLuint m_normalBuffer = 0;   // ID of vertex-buffer: normal
 
-        GLuint m_indexBuffer;    // ID of index-buffer
+        GLuint m_indexBuffer = 0;    // ID of index-buffer
 
         GLenum m_drawMode = GL_TRIANGLES;
+        GLenum m_indexType = GL_UNSIGNED_INT; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+        VertexLayout m_layout = VertexLayout::SPLIT;
+
+        VertexAttribFormat m_positionFormat;
+        VertexAttribFormat m_colorFormat;
+        VertexAttribFormat m_normalFormat;
+
+        bool m_colorConstant = false;
+        bool m_normalConstant = false;
+        glm::vec3 m_constantColor = glm::vec3(1.0f);
+        glm::vec3 m_constantNormal = glm::vec3(0.0f, 0.0f, 1.0f);
+
+        glm::mat4 m_positionTransform = glm::mat4(1.0f);
+
+        std::vector<Material> m_materials;
+        std::vector<SubMesh> m_subMeshes;
+        std::vector<Meshlet> m_meshlets;
 
         GLuint m_drawAmount = 0; // How many elements to draw (used in draw call)
+
+        unsigned int m_revision = 0;
 	};
 }
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#include "CG/MeshData.h"
+#include "CG/OBJFile.h"
+
+namespace cg
+{
+	enum class MeshFormat
+	{
+		UNKNOWN,
+		OBJ,
+		PLY,
+		STL,
+		GLB
+	};
+
+	// Loads a mesh file of any supported format, the format is detected from the content and not from the file name.
+	//
+	// OBJ  text, see OBJFile
+	// PLY  binary little or big endian. Reads positions, normals and colors of the "vertex" element and
+	//      the "vertex_indices" list of the "face" element, polygons are split into triangle fans.
+	// STL  binary. Corners with the same position are welded into one vertex, which is split again along edges sharper
+	//      than about 40 degrees so they keep a normal per side.
+	// GLB  detected, but drawn through GLBFile because its buffers are uploaded without a MeshData
+	//
+	// Missing normals of PLY and STL files are calculated from the faces.
+	class MeshImporter
+	{
+	public:
+		// Format of the file that starts with <data>, <size> is the size of the whole file.
+		// Anything that is not one of the binary formats is taken for OBJ text.
+		static MeshFormat detectFormat(const char* data, size_t size);
+
+		// UNKNOWN if the file cannot be read
+		static MeshFormat detectFormat(const std::string& path);
+
+		static const char* getFormatName(MeshFormat format);
+
+		// OBJ files are passed on to OBJFile::load with <options>.
+		// The binary formats only use <options.stats>, <options.arena>, <options.optimize>, <options.overdrawThreshold>, <options.strips> and <options.meshlets> and are never cached, they load about as fast as the cache.
+		static bool load(const std::string& path, MeshData* meshData, float scale = 1.0f, const OBJLoadOptions& options = OBJLoadOptions());
+	};
+}
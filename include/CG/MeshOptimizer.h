@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <memory_resource>
+
+#include "CG/MeshData.h"
+
+namespace cg::MeshOptimizer
+{
+	// Size of the post-transform vertex cache that is optimized for
+	static const unsigned int DEFAULT_CACHE_SIZE = 16;
+
+	// How much worse than the vertex cache order the ACMR of optimizeOverdraw may get
+	static const float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+	// Width and height of the depth buffer of analyzeOverdraw
+	static const int OVERDRAW_GRID_SIZE = 256;
+
+	// Simulated FIFO post-transform cache, see analyzeVertexCache
+	struct VertexCacheStats
+	{
+		// Cache misses, each one is a vertex shader invocation
+		size_t transformedVertices = 0;
+
+		// Average cache miss ratio, transformed vertices per triangle. 3 without any reuse, 0.5 at best on large regular meshes.
+		float acmr = 0.0f;
+
+		// Average transformed vertex ratio, transformed vertices per vertex. 1 is ideal.
+		float atvr = 0.0f;
+	};
+
+	// Software rasterization of a mesh, see analyzeOverdraw
+	struct OverdrawStats
+	{
+		// Pixels the mesh covers and fragments that passed the depth test, summed over all views
+		size_t coveredPixels = 0;
+		size_t shadedPixels = 0;
+
+		// Shaded fragments per covered pixel, 1 is ideal
+		float overdraw = 0.0f;
+	};
+
+	// The temporaries of every function come from <memory>, a MeshArena lets an import and its optimization share
+	// one block of memory instead of going to the heap.
+
+	// Reorders the triangles of an indexed triangle list so that vertices are reused while they are still in the post-transform cache.
+	// Uses Tipsify (Sander, Nehab, Barczak 2007), linear in the number of triangles.
+	void optimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE,
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+	void optimizeVertexCache(GLuint* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE,
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Optimizes every submesh of <mesh> on its own so the ranges stay intact, or the whole mesh if it has none.
+	// Only GL_TRIANGLES meshes are changed.
+	void optimizeVertexCache(MeshData* mesh, unsigned int cacheSize = DEFAULT_CACHE_SIZE, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Sorts the triangles of an optimizeVertexCache order against overdraw (Sander, Nehab, Barczak 2007).
+	// The order is cut into clusters where the cache starts over anyway, and further wherever the ACMR of a cluster on its
+	// own stays below <threshold> times the ACMR of the part it was cut from. The clusters are drawn from the outside in,
+	// by how far they face away from the centre of the mesh, so the depth test rejects most of what lies behind them.
+	void optimizeOverdraw(GLuint* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount, float threshold = DEFAULT_OVERDRAW_THRESHOLD,
+		unsigned int cacheSize = DEFAULT_CACHE_SIZE, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Sorts inside every submesh, the centre is the one of the whole mesh. Only GL_TRIANGLES meshes are changed.
+	void optimizeOverdraw(MeshData* mesh, float threshold = DEFAULT_OVERDRAW_THRESHOLD, unsigned int cacheSize = DEFAULT_CACHE_SIZE,
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Reorders the vertices of <mesh> in the order the indices first use them, so vertex fetches walk through memory.
+	// Vertices no index refers to are removed. Run it after optimizeVertexCache.
+	void optimizeVertexFetch(MeshData* mesh, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Puts the triangles of every meshlet of <mesh> back into vertex cache order and then the vertices into the order they are
+	// first used (optimizeVertexFetch). The meshlets keep their ranges, bounds and cones. Only GL_TRIANGLES meshes are changed.
+	void optimizeMeshlets(MeshData* mesh, unsigned int cacheSize = DEFAULT_CACHE_SIZE, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Stitches an indexed triangle list into triangle strips that follow the triangle order, separated by MeshData::RESTART_INDEX.
+	// Run it after optimizeVertexCache: neighbours are only looked for among the next few triangles, so the cache order is mostly kept.
+	// Degenerate triangles are dropped. Writes at most getStripIndexBound(<indexCount>) indices to <strips> and returns their number.
+	size_t convertToStrips(const GLuint* indices, size_t indexCount, GLuint* strips);
+
+	// Each triangle on its own, three corners and a restart
+	inline size_t getStripIndexBound(size_t indexCount)
+	{
+		return indexCount / 3 * 4;
+	}
+
+	// Converts a GL_TRIANGLES mesh into a GL_TRIANGLE_STRIP one, every submesh on its own
+	void convertToStrips(MeshData* mesh, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// optimizeVertexCache, optimizeOverdraw if <overdrawThreshold> is not 0, and optimizeVertexFetch.
+	// Fills <before> and <after> with analyzeVertexCache if they are set.
+	void optimize(MeshData* mesh, VertexCacheStats* before = nullptr, VertexCacheStats* after = nullptr, unsigned int cacheSize = DEFAULT_CACHE_SIZE,
+		float overdrawThreshold = 0.0f, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Runs the index order through a FIFO cache of <cacheSize> vertices, the model most GPUs come close to.
+	VertexCacheStats analyzeVertexCache(const GLuint* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE,
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Every submesh starts with an empty cache, as it is drawn with a call of its own. Strip meshes are counted per triangle as well.
+	VertexCacheStats analyzeVertexCache(const MeshData& mesh, unsigned int cacheSize = DEFAULT_CACHE_SIZE,
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Rasterizes the triangles in their order into a depth buffer of OVERDRAW_GRID_SIZE pixels square, once from each of
+	// the six axis directions, without face culling like the viewer. The mesh fills the grid.
+	OverdrawStats analyzeOverdraw(const GLuint* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount,
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+	OverdrawStats analyzeOverdraw(const MeshData& mesh, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+}
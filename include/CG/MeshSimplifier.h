@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <memory_resource>
+
+#include "CG/MeshData.h"
+
+namespace cg::MeshSimplifier
+{
+	// Settings of buildLODChain
+	struct LODOptions
+	{
+		// Triangles of a level relative to the level before it
+		float ratio = 0.5f;
+
+		// Levels after the mesh itself
+		unsigned int maxLevels = 4;
+
+		// Largest error of a level relative to the bounding radius of the mesh, the chain ends before a level that would need more
+		float maxError = 0.05f;
+
+		// The chain ends before a level with fewer triangles
+		size_t minTriangles = 64;
+	};
+
+	// One level of a LOD chain
+	struct LODLevel
+	{
+		MeshData mesh;
+
+		// How far the surface has moved from the original one, in model units (see simplify)
+		float error = 0.0f;
+	};
+
+	// Removes triangles from a GL_TRIANGLES mesh by collapsing edges in the order of their quadric error (Garland, Heckbert 1997)
+	// until at most <targetTriangles> are left or the next collapse would cost more than <maxError>.
+	//
+	// A vertex is moved onto a neighbour, so the remaining vertices keep their positions and attributes and only the indices change.
+	// Vertices that differ only in their index are merged first. Vertices on an open border, and vertices that share their position
+	// with others of different normals, colors or texture coordinates, never move. Collapses that would flip a triangle or pinch
+	// the surface are skipped. The triangles stay in their order, submesh ranges are shrunk to the triangles that are left.
+	// Vertices that are no longer used stay in the mesh, MeshOptimizer::optimizeVertexFetch drops them.
+	//
+	// Returns the error of the result: the largest area weighted RMS distance of a moved vertex to the planes of the original
+	// triangles around it, in model units. 0 if nothing has been removed. Other draw modes are left as they are.
+	float simplify(MeshData* mesh, size_t targetTriangles, float maxError = std::numeric_limits<float>::max(),
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Simplified versions of <mesh> with fewer and fewer triangles, each one simplified from <mesh> itself so the errors do not add up.
+	// The levels are optimized for the vertex cache and have their unused vertices removed. Empty for meshes that are not GL_TRIANGLES.
+	std::vector<LODLevel> buildLODChain(const MeshData& mesh, const LODOptions& options = LODOptions(),
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+}
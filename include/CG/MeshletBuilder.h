@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include <memory_resource>
+
+#include "CG/MeshData.h"
+
+namespace cg::MeshletBuilder
+{
+	// Limits of one meshlet, the sizes mesh shaders are usually given
+	static const size_t DEFAULT_MAX_VERTICES = 64;
+	static const size_t DEFAULT_MAX_TRIANGLES = 124;
+
+	// Groups the triangles of every submesh of a GL_TRIANGLES mesh into meshlets and reorders them so each meshlet is one range
+	// of MeshData::indices, and fills MeshData::meshlets. A meshlet starts at the first triangle left in the current order and grows
+	// over the triangles around it (corners with the same position count as one), preferring triangles that need the fewest new
+	// vertices and whose normals stay close to the others, so the cones stay narrow. Run it after MeshOptimizer::optimize, the
+	// meshlets follow its order. Their triangles and the vertices are then reordered again with MeshOptimizer::optimizeMeshlets.
+	// The normal cones follow the vertex normals where they disagree with the winding of a triangle, the winding is only used for
+	// meshes without normals. Meshes with border edges get no cones, both sides of their triangles are drawn and the back side
+	// can be seen through the border. Other draw modes get no meshlets.
+	void buildMeshlets(MeshData* mesh, size_t maxVertices = DEFAULT_MAX_VERTICES, size_t maxTriangles = DEFAULT_MAX_TRIANGLES,
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// Planes of the view frustum of <mvp>, in the space <mvp> takes to clip space. Normals point inside and have unit length.
+	void getFrustumPlanes(const glm::mat4& mvp, glm::vec4 planes[6]);
+
+	// True if <meshlet> lies completely outside one of <planes> or faces away from <eye>, both in the space of the mesh
+	bool isMeshletCulled(const Meshlet& meshlet, const glm::vec4 planes[6], const glm::vec3& eye);
+}
@@ -1,14 +1,153 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <functional>
 
 #include "CG/MeshData.h"
+#include "CG/MeshOptimizer.h"
 
 namespace cg
 {
+	class MeshArena;
+
+	// What happened while loading a file, filled if OBJLoadOptions::stats is set
+	struct OBJLoadStats
+	{
+		// Mesh came from the binary cache, only <vertices>, <triangles> and <materialLibraries> are set
+		bool fromCache = false;
+
+		// Files of the "mtllib" statements next to the OBJ file, also the ones that could not be opened
+		std::vector<std::string> materialLibraries;
+
+		// Elements in the file
+		size_t positions = 0;
+		size_t texcoords = 0;
+		size_t normals = 0;
+		size_t faces = 0;
+
+		// Face corners that were welded into vertices
+		size_t corners = 0;
+
+		// Result
+		size_t vertices = 0;
+		size_t triangles = 0;
+
+		// Vertices that share their position with another vertex because they differ in normal or texture coordinate
+		size_t splitVertices = 0;
+		// Corners that reuse the vertex of an earlier corner
+		size_t mergedCorners = 0;
+		// Positions that no face refers to, they are not part of the mesh
+		size_t unusedPositions = 0;
+
+		// Group/material ranges and the materials they use, see MeshData::subMeshes
+		size_t subMeshes = 0;
+		size_t materials = 0;
+
+		// Temporaries of the parse allocated from the arena, and the blocks the arena took from the heap for them
+		size_t arenaAllocations = 0;
+		size_t heapAllocations = 0;
+
+		// Simulated vertex cache of the file order and of the optimized order, set if OBJLoadOptions::optimize reordered the mesh
+		MeshOptimizer::VertexCacheStats cacheBefore;
+		MeshOptimizer::VertexCacheStats cacheAfter;
+
+		// Why the load failed, empty on success
+		std::string error;
+	};
+
+	struct OBJLoadOptions
+	{
+		// Number of threads used to parse a single file, 0 uses all hardware threads.
+		// The file is split at line boundaries, small files are always parsed on one thread.
+		unsigned int threads = 1;
+
+		// Read the finished mesh from a binary cache next to the file if it is up to date,
+		// otherwise parse the file and write the cache (see MeshCache)
+		bool useCache = true;
+
+		// Load texture coordinates into MeshData::texcoords.
+		// Vertices are welded on (position, texcoord, normal), without texture coordinates only on (position, normal).
+		bool loadTexcoords = false;
+
+		// Reorder triangles and vertices with MeshOptimizer::optimize after the parse, the cache holds the optimized mesh.
+		// Costs about a tenth of the parse time and saves vertex shader invocations on every draw.
+		bool optimize = false;
+
+		// With <optimize>, also sort the triangles against overdraw (MeshOptimizer::optimizeOverdraw), which pays off for
+		// expensive fragment shaders. The ACMR may get up to this many times worse, e.g. MeshOptimizer::DEFAULT_OVERDRAW_THRESHOLD.
+		// 0 keeps the vertex cache order.
+		float overdrawThreshold = 0.0f;
+
+		// With <optimize>, draw the mesh as triangle strips joined by restart indices (MeshOptimizer::convertToStrips).
+		// Cuts the index buffer by about a third, the optimized order is kept.
+		bool strips = false;
+
+		// With <optimize>, group the triangles into meshlets (MeshletBuilder::buildMeshlets) that Scene culls one by one.
+		// Not combined with <strips>, which wins.
+		bool meshlets = false;
+
+		// Memory for the temporaries of the parse, reset at the start of every parse. Every parse uses an arena of
+		// its own if it is not set. With the same arena for one load after the other only the MeshData allocates,
+		// and not even that if the MeshData is reused. The arena must not be used by two loads at the same time.
+		MeshArena* arena = nullptr;
+
+		// Receives statistics about the load if set
+		OBJLoadStats* stats = nullptr;
+	};
+
+	// Settings of OBJFile::convert
+	struct OBJConvertOptions
+	{
+		// Upper bound of the memory used by the conversion in bytes, whatever the size of the file.
+		// Everything that does not fit is spilled to temporary files.
+		size_t memoryLimit = (size_t)256 << 20;
+
+		// Directory of the temporary files, the system one if empty.
+		// Needs several times the size of the mesh data, not of the text.
+		std::string tempDirectory;
+
+		// Load texture coordinates, see OBJLoadOptions::loadTexcoords
+		bool loadTexcoords = false;
+
+		// Receives statistics about the conversion if set
+		OBJLoadStats* stats = nullptr;
+	};
+
+	// One file of a batch load
+	struct OBJLoadRequest
+	{
+		std::string path;
+		float scale = 1.0f;
+	};
+
+	struct OBJLoadResult
+	{
+		bool success = false;
+		MeshData mesh;
+
+		// Always filled, <stats.error> tells why a file failed
+		OBJLoadStats stats;
+	};
+
 	class OBJFile
 	{
 	public:
+		// Called on a worker thread as soon as file <index> of a batch is done.
+		// It may move the mesh out of <result>.
+		using LoadCallback = std::function<void(size_t index, OBJLoadResult& result)>;
+
 		static bool load(const std::string& path, MeshData* meshData, float scale = 1.0f);
+		static bool load(const std::string& path, MeshData* meshData, float scale, const OBJLoadOptions& options);
+
+		// Converts an OBJ file that may be larger than memory into a ChunkedMesh at <outputPath>.
+		// The file is parsed in pieces, vertices are welded with an external sort. Unlike load(), faces can only
+		// refer to vertices that are defined before them and a material library has to come before its materials.
+		static bool convert(const std::string& path, const std::string& outputPath, float scale, const OBJConvertOptions& options);
+
+		// Loads all <requests> at the same time on a pool of <threads> threads (0 uses all hardware threads).
+		// Results are in the order of <requests>, a failed file does not stop the others.
+		// <options.stats> and <options.arena> are ignored, every result has its own stats and every file its own arena.
+		static std::vector<OBJLoadResult> loadAll(const std::vector<OBJLoadRequest>& requests, const OBJLoadOptions& options = OBJLoadOptions(), unsigned int threads = 0, const LoadCallback& onLoaded = nullptr);
 	};
-}
\ No newline at end of file
+}
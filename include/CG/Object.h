@@ -15,16 +15,42 @@ namespace cg
 	class Object
 	{
 	public:
+		// A simplified version of the mesh, see MeshSimplifier::buildLODChain
+		struct LOD
+		{
+			std::shared_ptr<MeshGLInfo> meshInfo;
+
+			// How far its surface is from the one of the mesh, in model units
+			float error = 0.0f;
+		};
+
 		Object(const std::string& debugName = "Object");
 		~Object();
 
 		void setShader(GLSLProgram* shader);
 		void setMesh(const MeshData& mesh);
+		// Also drops the LODs of the old mesh
+		void setMeshInfo(std::shared_ptr<MeshGLInfo> meshInfo);
+
+		// Versions of the mesh for drawing it from further away, with growing error. Level 0 is the mesh itself, level i is <lods[i - 1]>.
+		void setLODs(std::vector<LOD> lods);
+		size_t getLODCount() const { return m_lods.size() + 1; }
+		float getLODError(size_t level) const { return level == 0 ? 0.0f : m_lods[level - 1].error; }
 
-		VertexArrayObject& getVAO() { return m_vao; }
+		// The VAO and the mesh getters below refer to <level> until another one is selected
+		void selectLOD(size_t level) { m_selectedLOD = std::min(level, m_lodVAOs.size()); }
+		size_t getSelectedLOD() const { return m_selectedLOD; }
+
+		VertexArrayObject& getVAO() { return m_selectedLOD == 0 ? m_vao : *m_lodVAOs[m_selectedLOD - 1]; }
 		GLSLProgram* getShader() const { return m_shader; }
-		unsigned int getIndexBufferSize() const { return m_meshInfo->getIndexBufferSize(); }
-		GLenum getDrawMode() const { return m_meshInfo->getDrawMode(); }
+		unsigned int getIndexBufferSize() const { return getSelectedMeshInfo().getIndexBufferSize(); }
+		GLenum getDrawMode() const { return getSelectedMeshInfo().getDrawMode(); }
+		GLenum getIndexType() const { return getSelectedMeshInfo().getIndexType(); }
+		GLuint getRestartIndex() const { return getSelectedMeshInfo().getRestartIndex(); }
+		const glm::mat4& getPositionTransform() const { return getSelectedMeshInfo().getPositionTransform(); }
+		const std::vector<Material>& getMaterials() const { return getSelectedMeshInfo().getMaterials(); }
+		const std::vector<SubMesh>& getSubMeshes() const { return getSelectedMeshInfo().getSubMeshes(); }
+		const std::vector<Meshlet>& getMeshlets() const { return getSelectedMeshInfo().getMeshlets(); }
 
 		void addChild(std::shared_ptr<Object> obj) { m_children.push_back(obj); }
 		bool hasChild(std::shared_ptr<Object> obj) { return std::find(m_children.begin(), m_children.end(), obj) != m_children.end(); }
@@ -40,6 +66,9 @@ namespace cg
 
 		void updateVAO();
 
+		// True if the mesh or the shader have been swapped for reloaded ones since the VAO was built
+		bool isVAOOutdated() const;
+
 		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
 
 		// Relative rotation in degrees
@@ -47,6 +76,10 @@ namespace cg
 
 		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
 
+		// Applied before position, rotation and scale. Unlike <scale> it applies to the children as well,
+		// e.g. the transform of a glTF node.
+		glm::mat4 localTransform = glm::mat4(1.0f);
+
 	private:
 		Object(const Object&) = delete;
 		Object(Object&&) = delete;
@@ -54,6 +87,8 @@ namespace cg
 		Object& operator=(const Object&) = delete;
 		Object& operator=(Object&&) = delete;
 
+		const MeshGLInfo& getSelectedMeshInfo() const { return m_selectedLOD == 0 ? *m_meshInfo : *m_lods[m_selectedLOD - 1].meshInfo; }
+
 	private:
 		GLSLProgram* m_shader = nullptr;
 		std::shared_ptr<MeshGLInfo> m_meshInfo = nullptr;
@@ -63,6 +98,15 @@ namespace cg
 		// If the VAO is not set (0), the object won't be rendered
 		VertexArrayObject m_vao;
 
+		// One VAO per LOD, built together with <m_vao>
+		std::vector<LOD> m_lods;
+		std::vector<std::unique_ptr<VertexArrayObject>> m_lodVAOs;
+		size_t m_selectedLOD = 0;
+
+		// Revisions of the mesh info and the shader the VAO was built with
+		unsigned int m_meshRevision = 0;
+		unsigned int m_shaderRevision = 0;
+
 		std::vector< std::shared_ptr<Object>> m_children;
 
 		std::string m_debugName;
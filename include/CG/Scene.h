@@ -24,11 +24,27 @@ namespace cg
 		void setUseViewLight(bool b) { m_useViewLight = b; }
 		bool getUseViewLight() const { return m_useViewLight; }
 
+		// Objects are drawn with the coarsest LOD whose error covers at most this many pixels on screen
+		void setLODThreshold(float pixels) { m_lodThreshold = pixels; }
+		float getLODThreshold() const { return m_lodThreshold; }
+
+		// Skip the meshlets of a mesh that are outside the view frustum or face away from the camera (see MeshletBuilder).
+		// Back faces are not culled otherwise, so only meshlets of closed meshes have cones that can face away.
+		void setMeshletCulling(bool b) { m_meshletCulling = b; }
+		bool getMeshletCulling() const { return m_meshletCulling; }
+
+		// Triangles drawn by the last renderScene, after LOD selection and culling
+		size_t getDrawnTriangles() const { return m_drawnTriangles; }
+
 	private:
 		std::vector<std::shared_ptr<Object>> m_objects;
 		Camera m_camera;
 
 		glm::vec3 m_globalDirLight = glm::vec3(0.0f, 1.0f, 0.0f);
 		bool m_useViewLight = false;
+
+		float m_lodThreshold = 1.0f;
+		bool m_meshletCulling = true;
+		size_t m_drawnTriangles = 0;
 	};
 }
\ No newline at end of file
@@ -4,14 +4,26 @@
 
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 namespace cg
 {
 	class ShaderManager
 	{
 	public:
+		using ShaderFiles = std::vector<std::pair<std::string, GLSLShader::GLSLShaderType>>;
+
 		static bool loadShader(const std::string& name, std::initializer_list<std::pair<std::string, GLSLShader::GLSLShaderType>> list);
 		static GLSLProgram* getShader(const std::string& name);
 		static int getShaderID(const std::string& name);
+
+		static std::vector<std::string> getShaderNames();
+
+		// Files that <name> was loaded from
+		static const ShaderFiles& getShaderFiles(const std::string& name);
+
+		// Builds <name> again from <sources>, the contents of getShaderFiles(name) in the same order.
+		// The new program replaces the old one in place, so getShader() pointers stay valid. On failure the old program is kept.
+		static bool reloadShader(const std::string& name, const std::vector<std::string>& sources);
 	};
 }
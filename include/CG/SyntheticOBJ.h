@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace cg::SyntheticOBJ
+{
+	enum class FaceShape
+	{
+		TRIANGLES,
+		QUADS
+	};
+
+	// How the face corners refer to the vertex data
+	enum class VertexForm
+	{
+		POSITION,                 // f 1 2 3
+		POSITION_NORMAL,          // f 1//1 2//2 3//3
+		POSITION_TEXCOORD_NORMAL  // f 1/1/1 2/2/2 3/3/3
+	};
+
+	struct Options
+	{
+		size_t faces = 10000;
+		FaceShape shape = FaceShape::TRIANGLES;
+		VertexForm form = VertexForm::POSITION_NORMAL;
+
+		// The same seed always gives the same mesh
+		uint32_t seed = 1;
+	};
+
+	const char* getShapeName(FaceShape shape);
+	const char* getFormName(VertexForm form);
+
+	// File name that identifies <options>, e.g. "synthetic1_quads_v-vt-vn_1000000_s1.obj"
+	std::string getFileName(const Options& options);
+
+	// Writes a bumpy grid surface with exactly <options.faces> faces to <path>.
+	// The file is written in pieces, so the memory use does not depend on the number of faces.
+	bool write(const std::string& path, const Options& options);
+}
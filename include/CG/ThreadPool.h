@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace cg
+{
+	// Fixed number of worker threads that run submitted tasks in submission order.
+	// The destructor finishes all queued tasks before it returns.
+	class ThreadPool
+	{
+	public:
+		// 0 uses all hardware threads
+		explicit ThreadPool(unsigned int threads = 0);
+		~ThreadPool();
+
+		unsigned int getThreadCount() const { return (unsigned int)m_threads.size(); }
+
+		template <typename Fn>
+		std::future<std::invoke_result_t<Fn>> submit(Fn fn)
+		{
+			using Result = std::invoke_result_t<Fn>;
+
+			// std::function needs a copyable target, packaged_task is move-only
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+			std::future<Result> future = task->get_future();
+			enqueue([task]() { (*task)(); });
+			return future;
+		}
+
+	private:
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) = delete;
+
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) = delete;
+
+		void enqueue(std::function<void()> task);
+		void workerMain();
+
+	private:
+		std::vector<std::thread> m_threads;
+		std::deque<std::function<void()>> m_tasks;
+
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		bool m_stop = false;
+	};
+}
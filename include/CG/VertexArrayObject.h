@@ -1,8 +1,14 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "CG/GLSLProgram.h"
+#include "CG/MeshGLInfo.h"
+#include "CG/VertexFormat.h"
 
 namespace cg
 {
@@ -19,8 +25,31 @@ namespace cg
 
 		bool bindShaderAttribVec3f(GLuint buffer, GLSLProgram* shader, const std::string& attribName);
 
+		// Binds <buffer> with the layout <format>, integer formats are converted to float by the GPU
+		bool bindShaderAttrib(GLuint buffer, GLSLProgram* shader, const std::string& attribName, const VertexAttribFormat& format);
+
+		// Binds every attribute of the interleaved <buffer> to the shader input of the same name.
+		// Attributes the shader does not have are skipped, false if there were any.
+		template <typename Format>
+		bool bindVertexFormat(GLuint buffer, GLSLProgram* shader)
+		{
+			bool bound = true;
+			for (size_t i = 0; i < Format::ATTRIBUTE_COUNT; ++i)
+			{
+				bound &= bindShaderAttrib(buffer, shader, Format::NAMES[i], Format::FORMATS[i]);
+			}
+			return bound;
+		}
+
 		bool bindIndexBuffer(GLuint buffer);
 
+		// Feeds <value> to every vertex instead of a buffer (see MeshGLInfo::isColorConstant).
+		// False if the shader does not have the attribute, it is skipped then.
+		bool setConstantAttrib(GLSLProgram* shader, const std::string& attribName, const glm::vec3& value);
+
+		// Generic attribute values are context state and not part of the VAO, call after binding it for every draw
+		void applyConstantAttribs() const;
+
 	private:
 		VertexArrayObject(const VertexArrayObject&) = delete;
 		VertexArrayObject(VertexArrayObject&&) = delete;
@@ -30,5 +59,7 @@ namespace cg
 
 	private:
 		GLuint m_vao = 0;
+
+		std::vector<std::pair<GLint, glm::vec3>> m_constantAttribs;
 	};
 }
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+
+#include "CG/MeshData.h"
+
+namespace cg
+{
+	// Layout of one vertex attribute in its buffer, as passed to glVertexAttribPointer
+	struct VertexAttribFormat
+	{
+		GLint components = 3;
+		GLenum type = GL_FLOAT;
+		GLboolean normalized = GL_FALSE;
+
+		// Bytes from one element to the next, 0 if the elements are tightly packed
+		GLsizei stride = 0;
+
+		// Bytes from the start of the buffer to the first element
+		size_t offset = 0;
+	};
+
+	// Maps <value> from [-1, 1] to a signed normalized integer with <bits> bits
+	inline uint32_t packSnorm(float value, int bits)
+	{
+		float max = float((1 << (bits - 1)) - 1);
+		int32_t i = (int32_t)std::lround(std::clamp(value, -1.0f, 1.0f) * max);
+		return (uint32_t)i & ((1u << bits) - 1);
+	}
+
+	// Layout of GL_INT_2_10_10_10_REV, w is 0
+	inline uint32_t packNormal(const glm::vec3& normal)
+	{
+		return packSnorm(normal.x, 10) | (packSnorm(normal.y, 10) << 10) | (packSnorm(normal.z, 10) << 20);
+	}
+
+	inline uint8_t packUnorm8(float value)
+	{
+		return (uint8_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+	}
+
+	inline uint16_t packUnorm16(float value)
+	{
+		return (uint16_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f);
+	}
+
+	// Positions stored in [0, 1] over a box, model space is offset + stored * scale
+	struct PositionQuantization
+	{
+		glm::vec3 offset = glm::vec3(0.0f);
+		glm::vec3 scale = glm::vec3(1.0f);
+
+		// The bounding box of <mesh>
+		static PositionQuantization fit(const MeshData& mesh)
+		{
+			PositionQuantization quantization;
+			if (mesh.vertices.empty())
+			{
+				return quantization;
+			}
+
+			glm::vec3 min = mesh.vertices[0];
+			glm::vec3 max = mesh.vertices[0];
+			for (const glm::vec3& v : mesh.vertices)
+			{
+				min = glm::min(min, v);
+				max = glm::max(max, v);
+			}
+			quantization.offset = min;
+			quantization.scale = max - min;
+			return quantization;
+		}
+
+		glm::vec3 quantize(const glm::vec3& position) const
+		{
+			glm::vec3 t;
+			for (int c = 0; c < 3; ++c)
+			{
+				t[c] = scale[c] > 0.0f ? (position[c] - offset[c]) / scale[c] : 0.0f;
+			}
+			return t;
+		}
+
+		// Dequantizes in the vertex shader when it is folded into the model matrix
+		glm::mat4 getTransform() const
+		{
+			return glm::scale(glm::translate(glm::mat4(1.0f), offset), scale);
+		}
+	};
+
+	// Attributes of a VertexFormat. Each one names the shader input it feeds and reads its value from a MeshData,
+	// constant attributes are repeated for every vertex. Only quantized positions use the PositionQuantization.
+	struct Pos3f
+	{
+		using Type = glm::vec3;
+		static constexpr const char* NAME = "position";
+		static constexpr VertexAttribFormat FORMAT = { 3, GL_FLOAT, GL_FALSE };
+
+		static Type get(const MeshData& mesh, size_t vertex, const PositionQuantization&) { return mesh.vertices[vertex]; }
+	};
+
+	struct Normal3f
+	{
+		using Type = glm::vec3;
+		static constexpr const char* NAME = "normal";
+		static constexpr VertexAttribFormat FORMAT = { 3, GL_FLOAT, GL_FALSE };
+
+		static Type get(const MeshData& mesh, size_t vertex, const PositionQuantization&) { return mesh.getNormal(vertex); }
+	};
+
+	struct Color3f
+	{
+		using Type = glm::vec3;
+		static constexpr const char* NAME = "color";
+		static constexpr VertexAttribFormat FORMAT = { 3, GL_FLOAT, GL_FALSE };
+
+		static Type get(const MeshData& mesh, size_t vertex, const PositionQuantization&) { return mesh.getColor(vertex); }
+	};
+
+	// 16 bit per axis over the PositionQuantization box, the fourth component pads the vertex to 8 bytes
+	struct PosQ16
+	{
+		using Type = std::array<uint16_t, 4>;
+		static constexpr const char* NAME = "position";
+		static constexpr VertexAttribFormat FORMAT = { 4, GL_UNSIGNED_SHORT, GL_TRUE };
+
+		static Type get(const MeshData& mesh, size_t vertex, const PositionQuantization& quantization)
+		{
+			glm::vec3 t = quantization.quantize(mesh.vertices[vertex]);
+			return { packUnorm16(t.x), packUnorm16(t.y), packUnorm16(t.z), 0 };
+		}
+	};
+
+	// 10 bit per axis, the shader still normalizes after interpolation
+	struct NormalQ10
+	{
+		using Type = uint32_t;
+		static constexpr const char* NAME = "normal";
+		static constexpr VertexAttribFormat FORMAT = { 4, GL_INT_2_10_10_10_REV, GL_TRUE };
+
+		static Type get(const MeshData& mesh, size_t vertex, const PositionQuantization&) { return packNormal(mesh.getNormal(vertex)); }
+	};
+
+	struct Color4ub
+	{
+		using Type = std::array<uint8_t, 4>;
+		static constexpr const char* NAME = "color";
+		static constexpr VertexAttribFormat FORMAT = { 4, GL_UNSIGNED_BYTE, GL_TRUE };
+
+		static Type get(const MeshData& mesh, size_t vertex, const PositionQuantization&)
+		{
+			glm::vec3 color = mesh.getColor(vertex);
+			return { packUnorm8(color.x), packUnorm8(color.y), packUnorm8(color.z), 255 };
+		}
+	};
+
+	// Interleaved layout of <Attributes> in this order, e.g. VertexFormat<Pos3f, Normal3f, Color3f>.
+	// Stride and offsets are known at compile time. interleave() packs a MeshData into one buffer with this layout
+	// and VertexArrayObject::bindVertexFormat sets up a VAO for it.
+	template <typename... Attributes>
+	struct VertexFormat
+	{
+		static constexpr size_t ATTRIBUTE_COUNT = sizeof...(Attributes);
+		static constexpr size_t STRIDE = (sizeof(typename Attributes::Type) + ...);
+
+	private:
+		static constexpr std::array<VertexAttribFormat, ATTRIBUTE_COUNT> makeFormats()
+		{
+			std::array<VertexAttribFormat, ATTRIBUTE_COUNT> formats = { Attributes::FORMAT... };
+			const size_t sizes[] = { sizeof(typename Attributes::Type)... };
+
+			size_t offset = 0;
+			for (size_t i = 0; i < ATTRIBUTE_COUNT; ++i)
+			{
+				formats[i].stride = (GLsizei)STRIDE;
+				formats[i].offset = offset;
+				offset += sizes[i];
+			}
+			return formats;
+		}
+
+		template <typename Attribute>
+		static void write(const MeshData& mesh, size_t vertex, const PositionQuantization& quantization, unsigned char** out)
+		{
+			typename Attribute::Type value = Attribute::get(mesh, vertex, quantization);
+			std::memcpy(*out, &value, sizeof(value));
+			*out += sizeof(value);
+		}
+
+	public:
+		// Shader inputs and their formats in the interleaved buffer
+		static constexpr std::array<const char*, ATTRIBUTE_COUNT> NAMES = { Attributes::NAME... };
+		static constexpr std::array<VertexAttribFormat, ATTRIBUTE_COUNT> FORMATS = makeFormats();
+
+		// Format of <Attribute> in the interleaved buffer, the default format if it is not part of it
+		template <typename Attribute>
+		static constexpr VertexAttribFormat getFormat()
+		{
+			constexpr bool matches[] = { std::is_same_v<Attribute, Attributes>... };
+			for (size_t i = 0; i < ATTRIBUTE_COUNT; ++i)
+			{
+				if (matches[i])
+				{
+					return FORMATS[i];
+				}
+			}
+			return VertexAttribFormat();
+		}
+
+		// Vertex buffer of <mesh> in this layout, quantized positions are stored relative to <quantization>
+		static std::vector<unsigned char> interleave(const MeshData& mesh, const PositionQuantization& quantization = PositionQuantization())
+		{
+			std::vector<unsigned char> data(mesh.vertices.size() * STRIDE);
+			unsigned char* out = data.data();
+			for (size_t v = 0; v < mesh.vertices.size(); ++v)
+			{
+				(write<Attributes>(mesh, v, quantization, &out), ...);
+			}
+			return data;
+		}
+	};
+}
@@ -0,0 +1,136 @@
+#include "CG/AssetLoader.h"
+
+#include <chrono>
+#include <algorithm>
+
+namespace cg
+{
+	// Largest piece of a buffer that is uploaded in one go
+	static const size_t UPLOAD_SLICE_SIZE = 256 * 1024;
+
+	AssetLoader::AssetLoader(unsigned int threads)
+		: m_pool(threads)
+	{
+
+	}
+
+	AssetLoader::~AssetLoader()
+	{
+
+	}
+
+	AssetLoader::MeshFuture AssetLoader::loadOBJ(const std::string& path, float scale, UploadCallback onUploaded, const OBJLoadOptions& options)
+	{
+		return loadMesh([path, scale, options](MeshData* mesh)
+		{
+			return OBJFile::load(path, mesh, scale, options);
+		}, std::move(onUploaded));
+	}
+
+	AssetLoader::MeshFuture AssetLoader::loadMesh(LoadFunction load, UploadCallback onUploaded, VertexLayout layout)
+	{
+		return m_pool.submit([this, load = std::move(load), onUploaded = std::move(onUploaded), layout]() -> std::shared_ptr<const MeshData>
+		{
+			auto mesh = std::make_shared<MeshData>();
+			if (!load(mesh.get()))
+			{
+				return nullptr;
+			}
+
+			if (onUploaded)
+			{
+				queueUpload(mesh, onUploaded, layout);
+			}
+			return mesh;
+		}).share();
+	}
+
+	void AssetLoader::queueUpload(std::shared_ptr<const MeshData> mesh, UploadCallback onUploaded, VertexLayout layout)
+	{
+		UploadJob job;
+		job.mesh = std::move(mesh);
+		job.onUploaded = std::move(onUploaded);
+
+		// Convert here so the render thread only has to copy
+		if (job.mesh != nullptr)
+		{
+			job.meshInfo = MeshGLInfo::prepare(*job.mesh, &job.uploads, layout);
+		}
+
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_queuedUploads.push_back(std::move(job));
+	}
+
+	size_t AssetLoader::processUploads(double budgetMs)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			std::move(m_queuedUploads.begin(), m_queuedUploads.end(), std::back_inserter(m_activeUploads));
+			m_queuedUploads.clear();
+		}
+
+		// Always make some progress, even with a tiny budget
+		while (!m_activeUploads.empty())
+		{
+			UploadJob& job = m_activeUploads.front();
+			if (uploadStep(&job))
+			{
+				// Remove the job before the callback in case the callback queues another upload
+				UploadJob finished = std::move(job);
+				m_activeUploads.pop_front();
+
+				if (finished.onUploaded)
+				{
+					finished.onUploaded(finished.mesh, finished.meshInfo);
+				}
+			}
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			if (elapsed.count() >= budgetMs)
+			{
+				break;
+			}
+		}
+
+		return m_activeUploads.size();
+	}
+
+	bool AssetLoader::uploadStep(UploadJob* job)
+	{
+		if (job->mesh == nullptr)
+		{
+			return true;
+		}
+
+		if (!job->allocated)
+		{
+			// Create the buffers, they are filled in the next steps
+			job->meshInfo->createBuffers(&job->uploads);
+			job->allocated = true;
+			return job->uploads.empty();
+		}
+
+		const MeshGLInfo::BufferUpload& upload = job->uploads[job->buffer];
+		size_t size = std::min(UPLOAD_SLICE_SIZE, upload.size - job->offset);
+
+		if (size > 0)
+		{
+			glBindBuffer(upload.target, upload.buffer);
+			glBufferSubData(upload.target, job->offset, size, (const char*)upload.data + job->offset);
+			glBindBuffer(upload.target, 0);
+		}
+
+		job->offset += size;
+		if (job->offset == upload.size)
+		{
+			// Free converted data right away instead of all of it at the end
+			job->uploads[job->buffer].storage.reset();
+			job->buffer++;
+			job->offset = 0;
+		}
+
+		return job->buffer == job->uploads.size();
+	}
+}
@@ -0,0 +1,419 @@
+#include "CG/ChunkedMesh.h"
+#include "CG/MeshCache.h"
+
+#include <iostream>
+#include <filesystem>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+
+namespace cg
+{
+	// Increase whenever the layout of the file changes
+	static const uint32_t CHUNKED_VERSION = 1;
+	static const char CHUNKED_MAGIC[4] = { 'C', 'G', 'C', 'H' };
+
+	// Chunks start at a multiple of this
+	static const uint64_t CHUNK_ALIGNMENT = 16;
+
+	struct ChunkedMeshHeader
+	{
+		char magic[4];
+		uint32_t version;
+
+		uint32_t hasTexcoords;
+		uint32_t chunkCount;
+
+		uint64_t vertexCount;
+		uint64_t indexCount;
+
+		float boundsMin[3];
+		float boundsMax[3];
+
+		// Array of ChunkRecord
+		uint64_t chunkTableOffset;
+
+		// Materials and submeshes, in the layout of MeshCache::writeSubMeshes
+		uint64_t subMeshTableOffset;
+		uint64_t subMeshTableSize;
+	};
+
+	// Chunk data: positions, normals, texcoords (if the mesh has them), indices
+	struct ChunkRecord
+	{
+		uint64_t offset;
+
+		uint32_t subMesh;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t reserved;
+
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	static size_t getChunkDataSize(uint64_t vertexCount, uint64_t indexCount, bool hasTexcoords)
+	{
+		size_t vertexSize = 2 * sizeof(glm::vec3) + (hasTexcoords ? sizeof(glm::vec2) : 0);
+		return (size_t)vertexCount * vertexSize + (size_t)indexCount * sizeof(GLushort);
+	}
+
+	std::string ChunkedMesh::getChunkedPath(const std::string& sourcePath)
+	{
+		return std::filesystem::path(sourcePath).replace_extension(".cgmc").string();
+	}
+
+	bool ChunkedMesh::open(const std::string& path)
+	{
+		close();
+
+		if (!m_file.open(path))
+		{
+			return false;
+		}
+
+		auto broken = [this, &path]()
+		{
+			std::cout << "Ignoring broken chunked mesh \"" << path << "\"\n";
+			close();
+			return false;
+		};
+
+		ChunkedMeshHeader header;
+		if (m_file.size() < sizeof(header))
+		{
+			return broken();
+		}
+		std::memcpy(&header, m_file.data(), sizeof(header));
+
+		if (std::memcmp(header.magic, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC)) != 0 || header.version != CHUNKED_VERSION)
+		{
+			std::cout << "\"" << path << "\" is not a chunked mesh of version " << CHUNKED_VERSION << "\n";
+			close();
+			return false;
+		}
+
+		if (header.chunkTableOffset > m_file.size() || header.chunkCount > (m_file.size() - header.chunkTableOffset) / sizeof(ChunkRecord))
+		{
+			return broken();
+		}
+
+		m_hasTexcoords = header.hasTexcoords != 0;
+		m_chunks.resize(header.chunkCount);
+		for (uint32_t c = 0; c < header.chunkCount; ++c)
+		{
+			ChunkRecord record;
+			std::memcpy(&record, m_file.data() + header.chunkTableOffset + c * sizeof(ChunkRecord), sizeof(record));
+
+			if (record.offset % CHUNK_ALIGNMENT != 0 || record.offset > m_file.size()
+				|| record.vertexCount > MAX_CHUNK_VERTICES || record.indexCount > MAX_CHUNK_TRIANGLES * 3
+				|| getChunkDataSize(record.vertexCount, record.indexCount, m_hasTexcoords) > m_file.size() - record.offset)
+			{
+				return broken();
+			}
+
+			const char* data = m_file.data() + record.offset;
+			Chunk& chunk = m_chunks[c];
+			chunk.subMesh = record.subMesh;
+			chunk.vertexCount = record.vertexCount;
+			chunk.indexCount = record.indexCount;
+			chunk.boundsMin = glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+			chunk.boundsMax = glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]);
+			chunk.positions = (const glm::vec3*)data;
+			chunk.normals = chunk.positions + chunk.vertexCount;
+			data = (const char*)(chunk.normals + chunk.vertexCount);
+			if (m_hasTexcoords)
+			{
+				chunk.texcoords = (const glm::vec2*)data;
+				data = (const char*)(chunk.texcoords + chunk.vertexCount);
+			}
+			chunk.indices = (const GLushort*)data;
+		}
+
+		if (header.subMeshTableOffset > m_file.size() || header.subMeshTableSize > m_file.size() - header.subMeshTableOffset
+			|| !MeshCache::readSubMeshes(m_file.data() + header.subMeshTableOffset, header.subMeshTableSize, &m_materials, &m_subMeshes))
+		{
+			return broken();
+		}
+
+		for (const SubMesh& subMesh : m_subMeshes)
+		{
+			if (subMesh.indexOffset > m_chunks.size() || subMesh.indexCount > m_chunks.size() - subMesh.indexOffset)
+			{
+				return broken();
+			}
+		}
+
+		m_vertexCount = header.vertexCount;
+		m_indexCount = header.indexCount;
+		m_boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+		m_boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+		return true;
+	}
+
+	void ChunkedMesh::close()
+	{
+		m_file.close();
+		m_hasTexcoords = false;
+		m_chunks.clear();
+		m_vertexCount = 0;
+		m_indexCount = 0;
+		m_materials.clear();
+		m_subMeshes.clear();
+	}
+
+	void ChunkedMesh::toMeshData(MeshData* meshData) const
+	{
+		meshData->clearAll();
+		meshData->vertices.reserve((size_t)m_vertexCount);
+		meshData->normals.reserve((size_t)m_vertexCount);
+		meshData->colors.reserve((size_t)m_vertexCount);
+		meshData->indices.reserve((size_t)m_indexCount);
+
+		// Submesh ranges in chunks become ranges in indices
+		std::vector<uint32_t> chunkIndexOffset(m_chunks.size() + 1, 0);
+
+		for (size_t c = 0; c < m_chunks.size(); ++c)
+		{
+			const Chunk& chunk = m_chunks[c];
+			GLuint base = (GLuint)meshData->vertices.size();
+			chunkIndexOffset[c] = (uint32_t)meshData->indices.size();
+
+			// Vertex colors for shaders without material uniforms, like OBJFile::load
+			glm::vec3 color(0.8f, 0.1f, 0.1f);
+			if (chunk.subMesh < m_subMeshes.size() && m_subMeshes[chunk.subMesh].material != SubMesh::NO_MATERIAL)
+			{
+				color = m_materials[m_subMeshes[chunk.subMesh].material].diffuse;
+			}
+
+			meshData->vertices.insert(meshData->vertices.end(), chunk.positions, chunk.positions + chunk.vertexCount);
+			meshData->normals.insert(meshData->normals.end(), chunk.normals, chunk.normals + chunk.vertexCount);
+			meshData->colors.insert(meshData->colors.end(), chunk.vertexCount, color);
+			if (m_hasTexcoords)
+			{
+				meshData->texcoords.insert(meshData->texcoords.end(), chunk.texcoords, chunk.texcoords + chunk.vertexCount);
+			}
+			for (size_t i = 0; i < chunk.indexCount; ++i)
+			{
+				meshData->indices.push_back(base + chunk.indices[i]);
+			}
+		}
+		chunkIndexOffset[m_chunks.size()] = (uint32_t)meshData->indices.size();
+
+		// Chunks of a single material all have the same color
+		meshData->collapseConstantAttributes();
+
+		meshData->materials = m_materials;
+		for (const SubMesh& chunkRange : m_subMeshes)
+		{
+			SubMesh subMesh = chunkRange;
+			subMesh.indexOffset = chunkIndexOffset[chunkRange.indexOffset];
+			subMesh.indexCount = chunkIndexOffset[chunkRange.indexOffset + chunkRange.indexCount] - subMesh.indexOffset;
+			meshData->subMeshes.push_back(subMesh);
+		}
+
+		// A mesh without groups or materials is drawn as a whole
+		if (meshData->subMeshes.size() == 1 && meshData->subMeshes[0].name.empty() && meshData->subMeshes[0].material == SubMesh::NO_MATERIAL)
+		{
+			meshData->subMeshes.clear();
+		}
+
+		meshData->updateIndexType();
+	}
+
+	ChunkedMeshWriter::~ChunkedMeshWriter()
+	{
+		// Not finished, nothing is moved into place
+		if (m_file.is_open())
+		{
+			m_file.close();
+			std::error_code ec;
+			std::filesystem::remove(m_tempPath, ec);
+		}
+	}
+
+	bool ChunkedMeshWriter::open(const std::string& path, bool hasTexcoords)
+	{
+		m_path = path;
+		m_tempPath = path + ".tmp";
+		m_hasTexcoords = hasTexcoords;
+		m_chunks.clear();
+
+		// Write to a temporary file first so a reader never sees a half written file
+		m_file.open(m_tempPath, std::ios::binary | std::ios::trunc);
+		if (!m_file.good())
+		{
+			std::cout << "could not write \"" << m_tempPath << "\"\n";
+			return false;
+		}
+
+		// The header is written again by finish()
+		ChunkedMeshHeader header = {};
+		m_file.write((const char*)&header, sizeof(header));
+		m_offset = sizeof(header);
+		align();
+		return m_file.good();
+	}
+
+	void ChunkedMeshWriter::align()
+	{
+		static const char padding[CHUNK_ALIGNMENT] = {};
+		uint64_t aligned = (m_offset + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+		m_file.write(padding, aligned - m_offset);
+		m_offset = aligned;
+	}
+
+	bool ChunkedMeshWriter::addChunk(uint32_t subMesh, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+		const std::vector<glm::vec2>& texcoords, const std::vector<GLushort>& indices)
+	{
+		size_t vertexCount = positions.size();
+		if (vertexCount == 0 || vertexCount > ChunkedMesh::MAX_CHUNK_VERTICES || normals.size() != vertexCount
+			|| (m_hasTexcoords && texcoords.size() != vertexCount) || indices.size() > ChunkedMesh::MAX_CHUNK_TRIANGLES * 3)
+		{
+			return false;
+		}
+
+		ChunkEntry entry;
+		entry.offset = m_offset;
+		entry.subMesh = subMesh;
+		entry.vertexCount = (uint32_t)vertexCount;
+		entry.indexCount = (uint32_t)indices.size();
+		entry.boundsMin = entry.boundsMax = positions[0];
+		for (const glm::vec3& p : positions)
+		{
+			entry.boundsMin = glm::min(entry.boundsMin, p);
+			entry.boundsMax = glm::max(entry.boundsMax, p);
+		}
+		m_chunks.push_back(entry);
+
+		m_file.write((const char*)positions.data(), vertexCount * sizeof(glm::vec3));
+		m_file.write((const char*)normals.data(), vertexCount * sizeof(glm::vec3));
+		if (m_hasTexcoords)
+		{
+			m_file.write((const char*)texcoords.data(), vertexCount * sizeof(glm::vec2));
+		}
+		m_file.write((const char*)indices.data(), indices.size() * sizeof(GLushort));
+		m_offset += getChunkDataSize(vertexCount, indices.size(), m_hasTexcoords);
+		align();
+
+		if (!m_file.good())
+		{
+			std::cout << "could not write \"" << m_tempPath << "\"\n";
+			return false;
+		}
+		return true;
+	}
+
+	bool ChunkedMeshWriter::finish(const std::vector<Material>& materials, const std::vector<SubMesh>& subMeshes)
+	{
+		if (!m_file.is_open())
+		{
+			return false;
+		}
+
+		// Sort by material, keep the order of the file within one material
+		std::vector<uint32_t> order(subMeshes.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&subMeshes](uint32_t a, uint32_t b) { return subMeshes[a].material < subMeshes[b].material; });
+
+		// The chunk table lists the chunks of one submesh back to back, submeshes without chunks are left out
+		std::vector<SubMesh> ranges;
+		std::vector<ChunkRecord> records;
+		records.reserve(m_chunks.size());
+
+		ChunkedMeshHeader header = {};
+		for (uint32_t id : order)
+		{
+			SubMesh range;
+			range.name = subMeshes[id].name;
+			range.material = subMeshes[id].material;
+			range.indexOffset = (uint32_t)records.size();
+
+			for (const ChunkEntry& entry : m_chunks)
+			{
+				if (entry.subMesh != id)
+				{
+					continue;
+				}
+
+				ChunkRecord record = {};
+				record.offset = entry.offset;
+				record.subMesh = (uint32_t)ranges.size();
+				record.vertexCount = entry.vertexCount;
+				record.indexCount = entry.indexCount;
+				for (int c = 0; c < 3; ++c)
+				{
+					record.boundsMin[c] = entry.boundsMin[c];
+					record.boundsMax[c] = entry.boundsMax[c];
+				}
+				records.push_back(record);
+
+				if (range.indexOffset == records.size() - 1)
+				{
+					range.boundsMin = entry.boundsMin;
+					range.boundsMax = entry.boundsMax;
+				}
+				range.boundsMin = glm::min(range.boundsMin, entry.boundsMin);
+				range.boundsMax = glm::max(range.boundsMax, entry.boundsMax);
+
+				header.vertexCount += entry.vertexCount;
+				header.indexCount += entry.indexCount;
+			}
+
+			range.indexCount = (uint32_t)records.size() - range.indexOffset;
+			if (range.indexCount > 0)
+			{
+				ranges.push_back(range);
+			}
+		}
+
+		if (records.size() != m_chunks.size())
+		{
+			std::cout << "chunks refer to submeshes that do not exist\n";
+			return false;
+		}
+
+		glm::vec3 min(0.0f);
+		glm::vec3 max(0.0f);
+		for (size_t r = 0; r < ranges.size(); ++r)
+		{
+			min = r == 0 ? ranges[r].boundsMin : glm::min(min, ranges[r].boundsMin);
+			max = r == 0 ? ranges[r].boundsMax : glm::max(max, ranges[r].boundsMax);
+		}
+
+		std::memcpy(header.magic, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC));
+		header.version = CHUNKED_VERSION;
+		header.hasTexcoords = m_hasTexcoords ? 1 : 0;
+		header.chunkCount = (uint32_t)records.size();
+		for (int c = 0; c < 3; ++c)
+		{
+			header.boundsMin[c] = min[c];
+			header.boundsMax[c] = max[c];
+		}
+		header.chunkTableOffset = m_offset;
+		header.subMeshTableOffset = m_offset + records.size() * sizeof(ChunkRecord);
+		header.subMeshTableSize = MeshCache::getSubMeshesSize(materials, ranges);
+
+		m_file.write((const char*)records.data(), records.size() * sizeof(ChunkRecord));
+		MeshCache::writeSubMeshes(m_file, materials, ranges);
+		m_file.seekp(0);
+		m_file.write((const char*)&header, sizeof(header));
+
+		bool written = m_file.good();
+		m_file.close();
+
+		std::error_code ec;
+		if (written)
+		{
+			std::filesystem::rename(m_tempPath, m_path, ec);
+		}
+		if (!written || ec)
+		{
+			std::filesystem::remove(m_tempPath, ec);
+			std::cout << "could not write \"" << m_path << "\"\n";
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,320 @@
+#include "CG/CookedMesh.h"
+#include "CG/MeshCache.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace cg
+{
+	// Increase whenever the layout of the file changes
+	static const uint32_t COOKED_VERSION = 4;
+	static const char COOKED_MAGIC[4] = { 'C', 'G', 'C', 'K' };
+
+	// Streams start at a multiple of this
+	static const uint64_t STREAM_ALIGNMENT = 16;
+
+	struct CookedStreamHeader
+	{
+		uint64_t offset;
+		uint64_t size;
+
+		uint32_t type;
+		uint32_t components;
+		uint32_t normalized;
+		uint32_t reserved;
+	};
+
+	struct CookedMeshHeader
+	{
+		char magic[4];
+		uint32_t version;
+
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t drawMode;
+		uint32_t indexType;
+
+		float boundsMin[3];
+		float boundsMax[3];
+		float sphereCenter[3];
+		float sphereRadius;
+
+		float positionOffset[3];
+		float positionScale[3];
+
+		// Of every vertex if the stream of the attribute is empty
+		float constantNormal[3];
+		float constantColor[3];
+
+		CookedStreamHeader streams[CookedMesh::STREAM_COUNT];
+
+		// Materials and submeshes, in the layout of MeshCache::writeSubMeshes
+		uint64_t subMeshTableOffset;
+		uint64_t subMeshTableSize;
+
+		// Files the mesh was cooked from, in the layout of MeshCache::writeDependencies, right after the submesh table
+		uint64_t sourceTableSize;
+	};
+
+	static uint64_t alignStream(uint64_t offset)
+	{
+		return (offset + STREAM_ALIGNMENT - 1) / STREAM_ALIGNMENT * STREAM_ALIGNMENT;
+	}
+
+	std::string CookedMesh::getCookedPath(const std::string& sourcePath)
+	{
+		return std::filesystem::path(sourcePath).replace_extension(".cgm").string();
+	}
+
+	bool CookedMesh::write(const std::string& path, const MeshData& meshData, const std::vector<std::string>& sources)
+	{
+		size_t vertexCount = meshData.vertices.size();
+
+		// Bounds
+		glm::vec3 min(0.0f);
+		glm::vec3 max(0.0f);
+		if (vertexCount > 0)
+		{
+			min = max = meshData.vertices[0];
+		}
+		for (const glm::vec3& v : meshData.vertices)
+		{
+			min = glm::min(min, v);
+			max = glm::max(max, v);
+		}
+
+		glm::vec3 center = (min + max) * 0.5f;
+		float radius = 0.0f;
+		for (const glm::vec3& v : meshData.vertices)
+		{
+			radius = std::max(radius, glm::length(v - center));
+		}
+
+		// Positions: 16 bit per axis over the bounding box, the fourth component pads the vertex to 8 bytes
+		glm::vec3 extent = max - min;
+		std::vector<uint16_t> positions(vertexCount * 4, 0);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				float t = extent[c] > 0.0f ? (meshData.vertices[i][c] - min[c]) / extent[c] : 0.0f;
+				positions[i * 4 + c] = packUnorm16(t);
+			}
+		}
+
+		std::vector<uint32_t> normals(meshData.normals.size());
+		for (size_t i = 0; i < normals.size(); ++i)
+		{
+			normals[i] = packNormal(meshData.normals[i]);
+		}
+
+		std::vector<uint8_t> colors(meshData.colors.size() * 4);
+		for (size_t i = 0; i < meshData.colors.size(); ++i)
+		{
+			colors[i * 4 + 0] = packUnorm8(meshData.colors[i].x);
+			colors[i * 4 + 1] = packUnorm8(meshData.colors[i].y);
+			colors[i * 4 + 2] = packUnorm8(meshData.colors[i].z);
+			colors[i * 4 + 3] = 255;
+		}
+
+		std::vector<GLushort> shortIndices;
+		const void* indexData = meshData.indices.data();
+		size_t indexSize = meshData.indices.size() * sizeof(GLuint);
+		if (meshData.indexType == GL_UNSIGNED_SHORT)
+		{
+			shortIndices.assign(meshData.indices.begin(), meshData.indices.end());
+			indexData = shortIndices.data();
+			indexSize = shortIndices.size() * sizeof(GLushort);
+		}
+
+		CookedMeshHeader header = {};
+		std::memcpy(header.magic, COOKED_MAGIC, sizeof(COOKED_MAGIC));
+		header.version = COOKED_VERSION;
+		header.vertexCount = (uint32_t)vertexCount;
+		header.indexCount = (uint32_t)meshData.indices.size();
+		header.drawMode = meshData.drawMode;
+		header.indexType = meshData.indexType;
+		for (int c = 0; c < 3; ++c)
+		{
+			header.boundsMin[c] = min[c];
+			header.boundsMax[c] = max[c];
+			header.sphereCenter[c] = center[c];
+			header.positionOffset[c] = min[c];
+			header.positionScale[c] = extent[c];
+			header.constantNormal[c] = meshData.constantNormal[c];
+			header.constantColor[c] = meshData.constantColor[c];
+		}
+		header.sphereRadius = radius;
+
+		struct StreamSource
+		{
+			const void* data;
+			size_t size;
+			VertexAttribFormat format;
+		};
+
+		StreamSource streamSources[STREAM_COUNT] =
+		{
+			{ positions.data(), positions.size() * sizeof(uint16_t), { 4, GL_UNSIGNED_SHORT, GL_TRUE } },
+			{ normals.data(), normals.size() * sizeof(uint32_t), { 4, GL_INT_2_10_10_10_REV, GL_TRUE } },
+			{ colors.data(), colors.size(), { 4, GL_UNSIGNED_BYTE, GL_TRUE } },
+			{ indexData, indexSize, { 1, meshData.indexType, GL_FALSE } },
+		};
+
+		uint64_t offset = alignStream(sizeof(header));
+		for (int s = 0; s < STREAM_COUNT; ++s)
+		{
+			CookedStreamHeader& stream = header.streams[s];
+			stream.offset = offset;
+			stream.size = streamSources[s].size;
+			stream.type = streamSources[s].format.type;
+			stream.components = streamSources[s].format.components;
+			stream.normalized = streamSources[s].format.normalized;
+			offset = alignStream(offset + stream.size);
+		}
+		header.subMeshTableOffset = offset;
+		header.subMeshTableSize = MeshCache::getSubMeshesSize(meshData.materials, meshData.subMeshes);
+		std::string directory = std::filesystem::path(path).parent_path().string();
+		header.sourceTableSize = MeshCache::getDependenciesSize(directory, sources);
+
+		// Write to a temporary file first so a reader never sees a half written file
+		std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.good())
+			{
+				std::cout << "could not write \"" << tempPath << "\"\n";
+				return false;
+			}
+
+			file.write((const char*)&header, sizeof(header));
+			uint64_t written = sizeof(header);
+
+			static const char padding[STREAM_ALIGNMENT] = {};
+			for (int s = 0; s < STREAM_COUNT; ++s)
+			{
+				file.write(padding, header.streams[s].offset - written);
+				file.write((const char*)streamSources[s].data, streamSources[s].size);
+				written = header.streams[s].offset + streamSources[s].size;
+			}
+			file.write(padding, header.subMeshTableOffset - written);
+			MeshCache::writeSubMeshes(file, meshData.materials, meshData.subMeshes);
+			MeshCache::writeDependencies(file, directory, sources);
+
+			if (!file.good())
+			{
+				file.close();
+				std::error_code ec;
+				std::filesystem::remove(tempPath, ec);
+				std::cout << "could not write \"" << tempPath << "\"\n";
+				return false;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tempPath, ec);
+			std::cout << "could not write \"" << path << "\"\n";
+			return false;
+		}
+		return true;
+	}
+
+	bool CookedMesh::open(const std::string& path)
+	{
+		close();
+
+		if (!m_file.open(path))
+		{
+			return false;
+		}
+
+		CookedMeshHeader header;
+		if (m_file.size() < sizeof(header))
+		{
+			std::cout << "Ignoring broken cooked mesh \"" << path << "\"\n";
+			close();
+			return false;
+		}
+		std::memcpy(&header, m_file.data(), sizeof(header));
+
+		if (std::memcmp(header.magic, COOKED_MAGIC, sizeof(COOKED_MAGIC)) != 0 || header.version != COOKED_VERSION)
+		{
+			std::cout << "\"" << path << "\" is not a cooked mesh of version " << COOKED_VERSION << "\n";
+			close();
+			return false;
+		}
+
+		for (int s = 0; s < STREAM_COUNT; ++s)
+		{
+			const CookedStreamHeader& stream = header.streams[s];
+			if (stream.offset > m_file.size() || stream.size > m_file.size() - stream.offset)
+			{
+				std::cout << "Ignoring broken cooked mesh \"" << path << "\"\n";
+				close();
+				return false;
+			}
+
+			m_streams[s].format.components = (GLint)stream.components;
+			m_streams[s].format.type = stream.type;
+			m_streams[s].format.normalized = stream.normalized ? GL_TRUE : GL_FALSE;
+			m_streams[s].data = m_file.data() + stream.offset;
+			m_streams[s].size = stream.size;
+		}
+
+		if (header.subMeshTableOffset > m_file.size() || header.subMeshTableSize > m_file.size() - header.subMeshTableOffset
+			|| header.sourceTableSize != m_file.size() - header.subMeshTableOffset - header.subMeshTableSize
+			|| !MeshCache::readSubMeshes(m_file.data() + header.subMeshTableOffset, header.subMeshTableSize, &m_materials, &m_subMeshes)
+			|| !MeshCache::readDependencies(m_file.data() + header.subMeshTableOffset + header.subMeshTableSize, header.sourceTableSize,
+				std::filesystem::path(path).parent_path().string(), &m_sources, &m_upToDate))
+		{
+			std::cout << "Ignoring broken cooked mesh \"" << path << "\"\n";
+			close();
+			return false;
+		}
+
+		m_vertexCount = header.vertexCount;
+		m_indexCount = header.indexCount;
+		m_indexType = header.indexType;
+		m_drawMode = header.drawMode;
+
+		m_boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+		m_boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+		m_sphereCenter = glm::vec3(header.sphereCenter[0], header.sphereCenter[1], header.sphereCenter[2]);
+		m_sphereRadius = header.sphereRadius;
+
+		m_positionOffset = glm::vec3(header.positionOffset[0], header.positionOffset[1], header.positionOffset[2]);
+		m_positionScale = glm::vec3(header.positionScale[0], header.positionScale[1], header.positionScale[2]);
+		m_constantNormal = glm::vec3(header.constantNormal[0], header.constantNormal[1], header.constantNormal[2]);
+		m_constantColor = glm::vec3(header.constantColor[0], header.constantColor[1], header.constantColor[2]);
+
+		return true;
+	}
+
+	void CookedMesh::close()
+	{
+		m_file.close();
+		for (StreamView& stream : m_streams)
+		{
+			stream = StreamView();
+		}
+		m_vertexCount = 0;
+		m_indexCount = 0;
+		m_materials.clear();
+		m_subMeshes.clear();
+		m_sources.clear();
+		m_upToDate = false;
+	}
+
+	glm::mat4 CookedMesh::getPositionTransform() const
+	{
+		return glm::scale(glm::translate(glm::mat4(1.0f), m_positionOffset), m_positionScale);
+	}
+}
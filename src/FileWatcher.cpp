@@ -0,0 +1,159 @@
+#include "CG/FileWatcher.h"
+
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace cg
+{
+#ifdef __linux__
+	static void addChanged(std::vector<std::string>* changed, const std::vector<std::string>& paths)
+	{
+		for (const std::string& path : paths)
+		{
+			if (std::find(changed->begin(), changed->end(), path) == changed->end())
+			{
+				changed->push_back(path);
+			}
+		}
+	}
+
+	FileWatcher::FileWatcher()
+	{
+		m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_fd < 0)
+		{
+			std::cout << "Could not start watching files, hot reload is disabled\n";
+		}
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+		if (m_fd >= 0)
+		{
+			// Removes all watches
+			::close(m_fd);
+		}
+	}
+
+	bool FileWatcher::watch(const std::string& path)
+	{
+		if (m_fd < 0)
+		{
+			return false;
+		}
+
+		std::error_code ec;
+		std::filesystem::path file = std::filesystem::absolute(path, ec).lexically_normal();
+		if (ec)
+		{
+			return false;
+		}
+		std::string directory = file.parent_path().string();
+
+		// Watching the same directory again returns the descriptor it already has
+		int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd < 0)
+		{
+			std::cout << "Could not watch \"" << directory << "\"\n";
+			return false;
+		}
+		m_directories[wd] = directory;
+
+		std::vector<std::string>& paths = m_files[file.string()];
+		if (std::find(paths.begin(), paths.end(), path) == paths.end())
+		{
+			paths.push_back(path);
+		}
+		return true;
+	}
+
+	std::vector<std::string> FileWatcher::poll()
+	{
+		std::vector<std::string> changed;
+		if (m_fd < 0)
+		{
+			return changed;
+		}
+
+		alignas(inotify_event) char buffer[4096];
+		while (true)
+		{
+			ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+			if (length <= 0)
+			{
+				// EAGAIN: no more events
+				break;
+			}
+
+			for (ssize_t offset = 0; offset < length; )
+			{
+				const inotify_event* event = (const inotify_event*)(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					// Events were lost, treat everything as changed
+					for (const auto& [file, paths] : m_files)
+					{
+						addChanged(&changed, paths);
+					}
+					continue;
+				}
+
+				if (event->mask & IN_IGNORED)
+				{
+					// The directory is gone
+					m_directories.erase(event->wd);
+					continue;
+				}
+
+				auto directory = m_directories.find(event->wd);
+				if (directory == m_directories.end() || event->len == 0)
+				{
+					continue;
+				}
+
+				auto file = m_files.find((std::filesystem::path(directory->second) / event->name).string());
+				if (file != m_files.end())
+				{
+					addChanged(&changed, file->second);
+				}
+			}
+		}
+
+		return changed;
+	}
+#else
+	FileWatcher::FileWatcher()
+	{
+
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+
+	}
+
+	bool FileWatcher::watch([[maybe_unused]] const std::string& path)
+	{
+		static bool reported = false;
+		if (!reported)
+		{
+			std::cout << "Watching files is not supported on this platform, hot reload is disabled\n";
+			reported = true;
+		}
+		return false;
+	}
+
+	std::vector<std::string> FileWatcher::poll()
+	{
+		return {};
+	}
+#endif
+}
@@ -0,0 +1,990 @@
+#include "CG/GLBFile.h"
+#include "CG/Object.h"
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <charconv>
+#include <string_view>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace cg
+{
+	static const uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+	static const uint32_t GLB_VERSION = 2;
+	static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+	static const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+	struct GLBHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t length;
+	};
+
+	struct GLBChunkHeader
+	{
+		uint32_t length;
+		uint32_t type;
+	};
+
+	// Just enough JSON for the glTF chunk
+	struct JSONValue
+	{
+		enum Type
+		{
+			NUL,
+			BOOLEAN,
+			NUMBER,
+			STRING,
+			ARRAY,
+			OBJECT
+		};
+
+		Type type = NUL;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<JSONValue> elements;
+		std::vector<std::pair<std::string, JSONValue>> members;
+
+		// nullptr if this is not an object or it does not have <key>
+		const JSONValue* find(std::string_view key) const
+		{
+			for (const auto& member : members)
+			{
+				if (member.first == key)
+				{
+					return &member.second;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	class JSONParser
+	{
+	public:
+		JSONParser(const char* begin, const char* end) : m_p(begin), m_end(end) {}
+
+		bool parse(JSONValue* value)
+		{
+			if (!parseValue(value, 0))
+			{
+				return false;
+			}
+			skipSpace();
+			return m_p == m_end;
+		}
+
+	private:
+		// Deeper nesting than any glTF file needs, keeps broken files from exhausting the stack
+		static const int MAX_DEPTH = 64;
+
+		void skipSpace()
+		{
+			while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r'))
+			{
+				++m_p;
+			}
+		}
+
+		bool consume(char c)
+		{
+			skipSpace();
+			if (m_p < m_end && *m_p == c)
+			{
+				++m_p;
+				return true;
+			}
+			return false;
+		}
+
+		bool parseLiteral(std::string_view literal)
+		{
+			if ((size_t)(m_end - m_p) < literal.size() || std::string_view(m_p, literal.size()) != literal)
+			{
+				return false;
+			}
+			m_p += literal.size();
+			return true;
+		}
+
+		bool parseValue(JSONValue* value, int depth)
+		{
+			skipSpace();
+			if (m_p == m_end || depth > MAX_DEPTH)
+			{
+				return false;
+			}
+
+			switch (*m_p)
+			{
+			case '{':
+				value->type = JSONValue::OBJECT;
+				return parseObject(value, depth);
+			case '[':
+				value->type = JSONValue::ARRAY;
+				return parseArray(value, depth);
+			case '"':
+				value->type = JSONValue::STRING;
+				return parseString(&value->string);
+			case 't':
+				value->type = JSONValue::BOOLEAN;
+				value->boolean = true;
+				return parseLiteral("true");
+			case 'f':
+				value->type = JSONValue::BOOLEAN;
+				return parseLiteral("false");
+			case 'n':
+				return parseLiteral("null");
+			default:
+			{
+				value->type = JSONValue::NUMBER;
+				std::from_chars_result result = std::from_chars(m_p, m_end, value->number);
+				if (result.ec != std::errc() || result.ptr == m_p)
+				{
+					return false;
+				}
+				m_p = result.ptr;
+				return true;
+			}
+			}
+		}
+
+		bool parseObject(JSONValue* value, int depth)
+		{
+			++m_p;
+			if (consume('}'))
+			{
+				return true;
+			}
+			do
+			{
+				std::string key;
+				skipSpace();
+				if (m_p == m_end || *m_p != '"' || !parseString(&key) || !consume(':'))
+				{
+					return false;
+				}
+				value->members.emplace_back(std::move(key), JSONValue());
+				if (!parseValue(&value->members.back().second, depth + 1))
+				{
+					return false;
+				}
+			} while (consume(','));
+			return consume('}');
+		}
+
+		bool parseArray(JSONValue* value, int depth)
+		{
+			++m_p;
+			if (consume(']'))
+			{
+				return true;
+			}
+			do
+			{
+				value->elements.emplace_back();
+				if (!parseValue(&value->elements.back(), depth + 1))
+				{
+					return false;
+				}
+			} while (consume(','));
+			return consume(']');
+		}
+
+		bool parseHex4(uint32_t* code)
+		{
+			if (m_end - m_p < 4)
+			{
+				return false;
+			}
+			std::from_chars_result result = std::from_chars(m_p, m_p + 4, *code, 16);
+			if (result.ptr != m_p + 4)
+			{
+				return false;
+			}
+			m_p += 4;
+			return true;
+		}
+
+		static void appendUTF8(uint32_t code, std::string* out)
+		{
+			if (code < 0x80)
+			{
+				out->push_back((char)code);
+			}
+			else if (code < 0x800)
+			{
+				out->push_back((char)(0xC0 | (code >> 6)));
+				out->push_back((char)(0x80 | (code & 0x3F)));
+			}
+			else if (code < 0x10000)
+			{
+				out->push_back((char)(0xE0 | (code >> 12)));
+				out->push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+				out->push_back((char)(0x80 | (code & 0x3F)));
+			}
+			else
+			{
+				out->push_back((char)(0xF0 | (code >> 18)));
+				out->push_back((char)(0x80 | ((code >> 12) & 0x3F)));
+				out->push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+				out->push_back((char)(0x80 | (code & 0x3F)));
+			}
+		}
+
+		bool parseString(std::string* out)
+		{
+			++m_p;
+			while (m_p < m_end)
+			{
+				char c = *m_p++;
+				if (c == '"')
+				{
+					return true;
+				}
+				if ((unsigned char)c < 0x20)
+				{
+					return false;
+				}
+				if (c != '\\')
+				{
+					out->push_back(c);
+					continue;
+				}
+
+				if (m_p == m_end)
+				{
+					return false;
+				}
+				switch (*m_p++)
+				{
+				case '"': out->push_back('"'); break;
+				case '\\': out->push_back('\\'); break;
+				case '/': out->push_back('/'); break;
+				case 'b': out->push_back('\b'); break;
+				case 'f': out->push_back('\f'); break;
+				case 'n': out->push_back('\n'); break;
+				case 'r': out->push_back('\r'); break;
+				case 't': out->push_back('\t'); break;
+				case 'u':
+				{
+					uint32_t code;
+					if (!parseHex4(&code))
+					{
+						return false;
+					}
+					// Characters outside the BMP are escaped as a surrogate pair
+					const char* next = m_p;
+					uint32_t low;
+					if (code >= 0xD800 && code < 0xDC00 && parseLiteral("\\u") && parseHex4(&low) && low >= 0xDC00 && low < 0xE000)
+					{
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					else
+					{
+						m_p = next;
+					}
+					appendUTF8(code, out);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			return false;
+		}
+
+	private:
+		const char* m_p;
+		const char* m_end;
+	};
+
+	static double getNumber(const JSONValue& object, std::string_view key, double fallback)
+	{
+		const JSONValue* value = object.find(key);
+		return value != nullptr && value->type == JSONValue::NUMBER ? value->number : fallback;
+	}
+
+	static std::string getString(const JSONValue& object, std::string_view key)
+	{
+		const JSONValue* value = object.find(key);
+		return value != nullptr && value->type == JSONValue::STRING ? value->string : std::string();
+	}
+
+	// Elements of the array <key>, empty if it is missing
+	static const std::vector<JSONValue>& getArray(const JSONValue& object, std::string_view key)
+	{
+		static const std::vector<JSONValue> empty;
+		const JSONValue* value = object.find(key);
+		return value != nullptr && value->type == JSONValue::ARRAY ? value->elements : empty;
+	}
+
+	// Reads the index <key> into an array of <count> elements. <index> is -1 if there is no <key>.
+	// Returns false if the index is not valid.
+	static bool getIndex(const JSONValue& object, std::string_view key, size_t count, int* index)
+	{
+		*index = -1;
+		const JSONValue* value = object.find(key);
+		if (value == nullptr)
+		{
+			return true;
+		}
+		if (value->type != JSONValue::NUMBER || value->number < 0.0 || value->number >= (double)count || value->number != std::floor(value->number))
+		{
+			return false;
+		}
+		*index = (int)value->number;
+		return true;
+	}
+
+	static bool getBool(const JSONValue& object, std::string_view key)
+	{
+		const JSONValue* value = object.find(key);
+		return value != nullptr && value->type == JSONValue::BOOLEAN && value->boolean;
+	}
+
+	// Reads the byte count or offset <key>, <size> keeps its value if there is no <key>.
+	// Returns false if it is not a non-negative integer.
+	static bool getSize(const JSONValue& object, std::string_view key, size_t* size)
+	{
+		const JSONValue* value = object.find(key);
+		if (value == nullptr)
+		{
+			return true;
+		}
+		if (value->type != JSONValue::NUMBER || value->number < 0.0 || value->number > 9007199254740992.0 || value->number != std::floor(value->number))
+		{
+			return false;
+		}
+		*size = (size_t)value->number;
+		return true;
+	}
+
+	// Reads the array <key> of <count> numbers into <out>.
+	// Returns false and leaves <out> alone unless it is an array of exactly <count> numbers.
+	static bool getNumbers(const JSONValue& object, std::string_view key, float* out, size_t count)
+	{
+		const std::vector<JSONValue>& elements = getArray(object, key);
+		if (elements.size() != count)
+		{
+			return false;
+		}
+		for (const JSONValue& element : elements)
+		{
+			if (element.type != JSONValue::NUMBER)
+			{
+				return false;
+			}
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			out[i] = (float)elements[i].number;
+		}
+		return true;
+	}
+
+	static size_t getComponentSize(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	// Value of one component as glVertexAttribPointer passes it to the shader
+	static float readComponent(const uint8_t* data, GLenum type, bool normalized)
+	{
+		switch (type)
+		{
+		case GL_BYTE:
+		{
+			int8_t v = (int8_t)data[0];
+			return normalized ? std::max(v / 127.0f, -1.0f) : v;
+		}
+		case GL_UNSIGNED_BYTE:
+			return normalized ? data[0] / 255.0f : data[0];
+		case GL_SHORT:
+		{
+			int16_t v;
+			std::memcpy(&v, data, sizeof(v));
+			return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+		}
+		case GL_UNSIGNED_SHORT:
+		{
+			uint16_t v;
+			std::memcpy(&v, data, sizeof(v));
+			return normalized ? v / 65535.0f : v;
+		}
+		default:
+		{
+			float v;
+			std::memcpy(&v, data, sizeof(v));
+			return v;
+		}
+		}
+	}
+
+	// glTF uses the GL enums for component types and draw modes
+	static bool isAttributeType(GLenum type)
+	{
+		return type == GL_BYTE || type == GL_UNSIGNED_BYTE || type == GL_SHORT || type == GL_UNSIGNED_SHORT || type == GL_FLOAT;
+	}
+
+	static bool isIndexType(GLenum type)
+	{
+		return type == GL_UNSIGNED_BYTE || type == GL_UNSIGNED_SHORT || type == GL_UNSIGNED_INT;
+	}
+
+	// Arrays of the JSON chunk the accessors refer to
+	struct GLBContext
+	{
+		const std::vector<JSONValue>* accessors = nullptr;
+		const std::vector<JSONValue>* bufferViews = nullptr;
+
+		// Buffer 0, the binary chunk
+		const uint8_t* bin = nullptr;
+		size_t binSize = 0;
+	};
+
+	// Resolves accessor <index> to its range in the binary chunk
+	static bool readAccessor(const GLBContext& context, int index, GLBFile::AccessorView* view, std::string* error)
+	{
+		const JSONValue& accessor = (*context.accessors)[index];
+		std::string name = "accessor " + std::to_string(index);
+
+		if (accessor.find("sparse") != nullptr)
+		{
+			*error = name + " is sparse, sparse accessors are not supported";
+			return false;
+		}
+
+		int bufferView;
+		if (!getIndex(accessor, "bufferView", context.bufferViews->size(), &bufferView) || bufferView < 0)
+		{
+			*error = name + " has no valid buffer view";
+			return false;
+		}
+
+		static const std::pair<std::string_view, int> TYPES[] = { { "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 } };
+		std::string type = getString(accessor, "type");
+		int components = 0;
+		for (const auto& t : TYPES)
+		{
+			components = t.first == type ? t.second : components;
+		}
+
+		GLenum componentType = (GLenum)getNumber(accessor, "componentType", 0.0);
+		size_t componentSize = getComponentSize(componentType);
+		size_t count = 0;
+		size_t byteOffset = 0;
+		if (components == 0 || componentSize == 0 || !getSize(accessor, "count", &count) || count == 0 || !getSize(accessor, "byteOffset", &byteOffset))
+		{
+			*error = name + " has an unsupported type or no elements";
+			return false;
+		}
+
+		const JSONValue& bufferViewValue = (*context.bufferViews)[bufferView];
+		size_t viewOffset = 0;
+		size_t viewLength = 0;
+		size_t byteStride = 0;
+		if (getNumber(bufferViewValue, "buffer", -1.0) != 0.0 || !getSize(bufferViewValue, "byteOffset", &viewOffset)
+			|| !getSize(bufferViewValue, "byteLength", &viewLength) || !getSize(bufferViewValue, "byteStride", &byteStride))
+		{
+			*error = "buffer view " + std::to_string(bufferView) + " is not a valid range of the binary chunk";
+			return false;
+		}
+
+		size_t elementSize = components * componentSize;
+		size_t stride = byteStride != 0 ? byteStride : elementSize;
+		if (stride < elementSize || stride > viewLength || count > viewLength || viewOffset > context.binSize || viewLength > context.binSize - viewOffset
+			|| byteOffset > viewLength || (count - 1) * stride + elementSize > viewLength - byteOffset)
+		{
+			*error = name + " lies outside of its buffer view";
+			return false;
+		}
+
+		// Required by glTF, the data is read through typed pointers
+		if ((viewOffset + byteOffset) % componentSize != 0 || stride % componentSize != 0)
+		{
+			*error = name + " is not aligned to its component size";
+			return false;
+		}
+
+		view->format.components = components;
+		view->format.type = componentType;
+		view->format.normalized = getBool(accessor, "normalized") ? GL_TRUE : GL_FALSE;
+		view->format.stride = stride == elementSize ? 0 : (GLsizei)stride;
+		view->data = context.bin + viewOffset + byteOffset;
+		view->size = (count - 1) * stride + elementSize;
+		view->count = count;
+		return true;
+	}
+
+	static size_t getMaxIndex(const GLBFile::AccessorView& index)
+	{
+		size_t max = 0;
+		for (size_t i = 0; i < index.count; ++i)
+		{
+			switch (index.format.type)
+			{
+			case GL_UNSIGNED_BYTE: max = std::max<size_t>(max, ((const uint8_t*)index.data)[i]); break;
+			case GL_UNSIGNED_SHORT: max = std::max<size_t>(max, ((const uint16_t*)index.data)[i]); break;
+			default: max = std::max<size_t>(max, ((const uint32_t*)index.data)[i]); break;
+			}
+		}
+		return max;
+	}
+
+	// Bounds of the positions as the shader sees them
+	static void calculateBounds(const GLBFile::AccessorView& view, const JSONValue& accessor, glm::vec3* min, glm::vec3* max)
+	{
+		// min and max are required for positions. It is not clear whether they are normalized for normalized accessors,
+		// those are measured instead.
+		float values[6];
+		if (!view.format.normalized && getNumbers(accessor, "min", values, 3) && getNumbers(accessor, "max", values + 3, 3))
+		{
+			*min = glm::vec3(values[0], values[1], values[2]);
+			*max = glm::vec3(values[3], values[4], values[5]);
+			return;
+		}
+
+		size_t componentSize = getComponentSize(view.format.type);
+		size_t stride = view.format.stride != 0 ? view.format.stride : 3 * componentSize;
+		for (size_t i = 0; i < view.count; ++i)
+		{
+			const uint8_t* element = (const uint8_t*)view.data + i * stride;
+			glm::vec3 p;
+			for (int c = 0; c < 3; ++c)
+			{
+				p[c] = readComponent(element + c * componentSize, view.format.type, view.format.normalized);
+			}
+			*min = i == 0 ? p : glm::min(*min, p);
+			*max = i == 0 ? p : glm::max(*max, p);
+		}
+	}
+
+	static bool readPrimitive(const GLBContext& context, const JSONValue& source, size_t materialCount, GLBFile::Primitive* primitive, std::string* error)
+	{
+		const JSONValue* attributes = source.find("attributes");
+		if (attributes == nullptr || attributes->type != JSONValue::OBJECT)
+		{
+			*error = "a primitive has no attributes";
+			return false;
+		}
+
+		int position;
+		int normal;
+		int color;
+		size_t accessorCount = context.accessors->size();
+		if (!getIndex(*attributes, "POSITION", accessorCount, &position) || position < 0
+			|| !getIndex(*attributes, "NORMAL", accessorCount, &normal) || !getIndex(*attributes, "COLOR_0", accessorCount, &color))
+		{
+			*error = "a primitive has no positions or an invalid attribute";
+			return false;
+		}
+
+		if (!readAccessor(context, position, &primitive->position, error)
+			|| (normal >= 0 && !readAccessor(context, normal, &primitive->normal, error))
+			|| (color >= 0 && !readAccessor(context, color, &primitive->color, error)))
+		{
+			return false;
+		}
+
+		size_t vertexCount = primitive->position.count;
+		const VertexAttribFormat& positionFormat = primitive->position.format;
+		const VertexAttribFormat& normalFormat = primitive->normal.format;
+		const VertexAttribFormat& colorFormat = primitive->color.format;
+		if (positionFormat.components != 3 || !isAttributeType(positionFormat.type)
+			|| (normal >= 0 && (normalFormat.components != 3 || !isAttributeType(normalFormat.type) || primitive->normal.count != vertexCount))
+			|| (color >= 0 && (colorFormat.components < 3 || !isAttributeType(colorFormat.type) || primitive->color.count != vertexCount)))
+		{
+			*error = "a primitive has attributes of an unsupported type or count";
+			return false;
+		}
+
+		int indices;
+		if (!getIndex(source, "indices", accessorCount, &indices))
+		{
+			*error = "a primitive has invalid indices";
+			return false;
+		}
+		if (indices >= 0)
+		{
+			if (!readAccessor(context, indices, &primitive->index, error))
+			{
+				return false;
+			}
+
+			const VertexAttribFormat& indexFormat = primitive->index.format;
+			if (indexFormat.components != 1 || !isIndexType(indexFormat.type) || indexFormat.stride != 0)
+			{
+				*error = "a primitive has indices of an unsupported type";
+				return false;
+			}
+
+			// An index past the vertices would make the GPU read outside of the vertex buffers
+			if (getMaxIndex(primitive->index) >= vertexCount)
+			{
+				*error = "a primitive has indices past its " + std::to_string(vertexCount) + " vertices";
+				return false;
+			}
+		}
+
+		// GL_POINTS to GL_TRIANGLE_FAN
+		double mode = getNumber(source, "mode", GL_TRIANGLES);
+		int material;
+		if (mode < 0.0 || mode > 6.0 || mode != std::floor(mode) || !getIndex(source, "material", materialCount, &material))
+		{
+			*error = "a primitive has an invalid mode or material";
+			return false;
+		}
+		primitive->drawMode = (GLenum)mode;
+		primitive->material = material < 0 ? SubMesh::NO_MATERIAL : (uint32_t)material;
+
+		calculateBounds(primitive->position, (*context.accessors)[position], &primitive->boundsMin, &primitive->boundsMax);
+		return true;
+	}
+
+	static Material readMaterial(const JSONValue& source)
+	{
+		float baseColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		float metallic = 1.0f;
+		float roughness = 1.0f;
+		const JSONValue* pbr = source.find("pbrMetallicRoughness");
+		if (pbr != nullptr)
+		{
+			getNumbers(*pbr, "baseColorFactor", baseColor, 4);
+			metallic = (float)getNumber(*pbr, "metallicFactor", 1.0);
+			roughness = (float)getNumber(*pbr, "roughnessFactor", 1.0);
+		}
+
+		// Nearest Phong parameters: metals reflect in their own color, and the roughness is turned into the
+		// Blinn-Phong exponent of a highlight of the same width
+		Material material;
+		material.name = getString(source, "name");
+		material.diffuse = glm::vec3(baseColor[0], baseColor[1], baseColor[2]);
+		material.ambient = material.diffuse * 0.1f;
+		material.specular = glm::mix(glm::vec3(0.04f), material.diffuse, std::clamp(metallic, 0.0f, 1.0f));
+		float alpha = std::clamp(roughness, 0.05f, 1.0f);
+		material.shininess = std::clamp(2.0f / (alpha * alpha * alpha * alpha) - 2.0f, 1.0f, 512.0f);
+		return material;
+	}
+
+	static bool readTransform(const JSONValue& node, glm::mat4* transform)
+	{
+		float values[16];
+		if (node.find("matrix") != nullptr)
+		{
+			if (!getNumbers(node, "matrix", values, 16))
+			{
+				return false;
+			}
+
+			// Column major, like glm
+			for (int column = 0; column < 4; ++column)
+			{
+				for (int row = 0; row < 4; ++row)
+				{
+					(*transform)[column][row] = values[column * 4 + row];
+				}
+			}
+			return true;
+		}
+
+		float translation[3] = { 0.0f, 0.0f, 0.0f };
+		float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // x, y, z, w
+		float scale[3] = { 1.0f, 1.0f, 1.0f };
+		if ((node.find("translation") != nullptr && !getNumbers(node, "translation", translation, 3))
+			|| (node.find("rotation") != nullptr && !getNumbers(node, "rotation", rotation, 4))
+			|| (node.find("scale") != nullptr && !getNumbers(node, "scale", scale, 3)))
+		{
+			return false;
+		}
+
+		*transform = glm::translate(glm::mat4(1.0f), glm::vec3(translation[0], translation[1], translation[2]))
+			* glm::mat4_cast(glm::quat(rotation[3], rotation[0], rotation[1], rotation[2]))
+			* glm::scale(glm::mat4(1.0f), glm::vec3(scale[0], scale[1], scale[2]));
+		return true;
+	}
+
+	bool GLBFile::open(const std::string& path)
+	{
+		close();
+
+		if (!m_file.open(path))
+		{
+			std::cout << "could not open \"" << path << "\"\n";
+			return false;
+		}
+
+		std::string error;
+		if (!read(&error))
+		{
+			std::cout << "Failed to load \"" << path << "\": " << error << "\n";
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void GLBFile::close()
+	{
+		m_file.close();
+		m_meshes.clear();
+		m_nodes.clear();
+		m_materials.clear();
+		m_rootNodes.clear();
+	}
+
+	bool GLBFile::read(std::string* error)
+	{
+		const char* data = m_file.data();
+		size_t size = m_file.size();
+
+		GLBHeader header;
+		if (size < sizeof(header))
+		{
+			*error = "not a binary glTF file";
+			return false;
+		}
+		std::memcpy(&header, data, sizeof(header));
+		if (header.magic != GLB_MAGIC || header.version != GLB_VERSION)
+		{
+			*error = "not a binary glTF 2.0 file";
+			return false;
+		}
+		if (header.length > size)
+		{
+			*error = "the file is truncated";
+			return false;
+		}
+		size = header.length;
+
+		// A JSON chunk and an optional binary chunk, unknown chunks are skipped
+		std::string_view json;
+		const uint8_t* bin = nullptr;
+		size_t binSize = 0;
+		size_t offset = sizeof(header);
+		while (size - offset >= sizeof(GLBChunkHeader))
+		{
+			GLBChunkHeader chunk;
+			std::memcpy(&chunk, data + offset, sizeof(chunk));
+			offset += sizeof(chunk);
+			if (chunk.length > size - offset)
+			{
+				*error = "the file is truncated";
+				return false;
+			}
+
+			if (chunk.type == GLB_CHUNK_JSON && json.empty())
+			{
+				json = std::string_view(data + offset, chunk.length);
+			}
+			else if (chunk.type == GLB_CHUNK_BIN && bin == nullptr)
+			{
+				bin = (const uint8_t*)data + offset;
+				binSize = chunk.length;
+			}
+			offset = std::min<size_t>(size, (offset + chunk.length + 3) & ~(size_t)3);
+		}
+
+		JSONValue root;
+		if (json.empty() || !JSONParser(json.data(), json.data() + json.size()).parse(&root) || root.type != JSONValue::OBJECT)
+		{
+			*error = "the JSON chunk is missing or broken";
+			return false;
+		}
+
+		const JSONValue* asset = root.find("asset");
+		if (asset == nullptr || getString(*asset, "version").rfind("2.", 0) != 0)
+		{
+			*error = "only glTF 2.x is supported";
+			return false;
+		}
+
+		for (const JSONValue& extension : getArray(root, "extensionsRequired"))
+		{
+			if (extension.string != "KHR_mesh_quantization")
+			{
+				*error = "the file requires the unsupported extension " + extension.string;
+				return false;
+			}
+		}
+
+		// Only the binary chunk can be a buffer, it may be padded
+		const std::vector<JSONValue>& buffers = getArray(root, "buffers");
+		size_t bufferLength = 0;
+		if (buffers.size() > 1 || (buffers.size() == 1 && (buffers[0].find("uri") != nullptr || !getSize(buffers[0], "byteLength", &bufferLength) || bufferLength > binSize)))
+		{
+			*error = "only the binary chunk is supported as buffer";
+			return false;
+		}
+
+		GLBContext context;
+		context.accessors = &getArray(root, "accessors");
+		context.bufferViews = &getArray(root, "bufferViews");
+		context.bin = bin;
+		context.binSize = bufferLength;
+
+		for (const JSONValue& material : getArray(root, "materials"))
+		{
+			m_materials.push_back(readMaterial(material));
+		}
+
+		const std::vector<JSONValue>& meshes = getArray(root, "meshes");
+		for (size_t m = 0; m < meshes.size(); ++m)
+		{
+			Mesh mesh;
+			mesh.name = getString(meshes[m], "name");
+			for (const JSONValue& source : getArray(meshes[m], "primitives"))
+			{
+				mesh.primitives.emplace_back();
+				if (!readPrimitive(context, source, m_materials.size(), &mesh.primitives.back(), error))
+				{
+					*error = "mesh " + std::to_string(m) + ": " + *error;
+					return false;
+				}
+			}
+			m_meshes.push_back(std::move(mesh));
+		}
+
+		const std::vector<JSONValue>& nodes = getArray(root, "nodes");
+		std::vector<bool> hasParent(nodes.size(), false);
+		for (size_t n = 0; n < nodes.size(); ++n)
+		{
+			Node node;
+			node.name = getString(nodes[n], "name");
+			if (!readTransform(nodes[n], &node.transform) || !getIndex(nodes[n], "mesh", meshes.size(), &node.mesh))
+			{
+				*error = "node " + std::to_string(n) + " has an invalid transform or mesh";
+				return false;
+			}
+
+			// Nodes form a tree, a node with two parents would be drawn twice.
+			// Roots have no parent, so a cycle can never be reached from them.
+			for (const JSONValue& childValue : getArray(nodes[n], "children"))
+			{
+				double child = childValue.type == JSONValue::NUMBER ? childValue.number : -1.0;
+				if (child < 0.0 || child >= (double)nodes.size() || child != std::floor(child) || hasParent[(size_t)child])
+				{
+					*error = "node " + std::to_string(n) + " has an invalid child";
+					return false;
+				}
+				hasParent[(size_t)child] = true;
+				node.children.push_back((size_t)child);
+			}
+			m_nodes.push_back(std::move(node));
+		}
+
+		// The default scene, or the first one. Without scenes every node without parent is a root.
+		const std::vector<JSONValue>& scenes = getArray(root, "scenes");
+		int scene;
+		if (!getIndex(root, "scene", scenes.size(), &scene))
+		{
+			*error = "the default scene is invalid";
+			return false;
+		}
+		if (scene < 0 && !scenes.empty())
+		{
+			scene = 0;
+		}
+
+		if (scene >= 0)
+		{
+			for (const JSONValue& nodeValue : getArray(scenes[scene], "nodes"))
+			{
+				double node = nodeValue.type == JSONValue::NUMBER ? nodeValue.number : -1.0;
+				if (node < 0.0 || node >= (double)nodes.size() || node != std::floor(node) || hasParent[(size_t)node])
+				{
+					*error = "scene " + std::to_string(scene) + " has an invalid root node";
+					return false;
+				}
+				m_rootNodes.push_back((size_t)node);
+			}
+		}
+		else
+		{
+			for (size_t n = 0; n < nodes.size(); ++n)
+			{
+				if (!hasParent[n])
+				{
+					m_rootNodes.push_back(n);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Object of <node> with the objects of its children
+	static std::shared_ptr<Object> createNodeObject(const GLBFile& file, size_t node, const std::vector<std::vector<std::shared_ptr<MeshGLInfo>>>& meshInfos, GLSLProgram* shader)
+	{
+		const GLBFile::Node& source = file.getNodes()[node];
+		std::string name = source.name.empty() ? "Node " + std::to_string(node) : source.name;
+
+		auto obj = std::make_shared<Object>(name);
+		obj->localTransform = source.transform;
+		obj->setColor(glm::vec3(1.0f));
+		obj->setShader(shader);
+
+		if (source.mesh >= 0)
+		{
+			const std::vector<std::shared_ptr<MeshGLInfo>>& primitives = meshInfos[source.mesh];
+			for (size_t p = 0; p < primitives.size(); ++p)
+			{
+				if (p == 0)
+				{
+					obj->setMeshInfo(primitives[p]);
+					continue;
+				}
+
+				auto primitive = std::make_shared<Object>(name + " primitive " + std::to_string(p));
+				primitive->setColor(glm::vec3(1.0f));
+				primitive->setShader(shader);
+				primitive->setMeshInfo(primitives[p]);
+				obj->addChild(primitive);
+			}
+		}
+
+		for (size_t child : source.children)
+		{
+			obj->addChild(createNodeObject(file, child, meshInfos, shader));
+		}
+		return obj;
+	}
+
+	std::shared_ptr<Object> GLBFile::createObjects(GLSLProgram* shader) const
+	{
+		// Meshes are uploaded once, even if several nodes use them
+		std::vector<std::vector<std::shared_ptr<MeshGLInfo>>> meshInfos(m_meshes.size());
+		for (size_t m = 0; m < m_meshes.size(); ++m)
+		{
+			for (size_t p = 0; p < m_meshes[m].primitives.size(); ++p)
+			{
+				meshInfos[m].push_back(MeshGLInfo::generate(*this, m, p));
+			}
+		}
+
+		auto root = std::make_shared<Object>("glTF scene");
+		for (size_t node : m_rootNodes)
+		{
+			root->addChild(createNodeObject(*this, node, meshInfos, shader));
+		}
+		return root;
+	}
+}
@@ -15,6 +15,7 @@ GLSLProgram::GLSLProgram(bool verbose)
 , linked(false)
 , logString("")
 , verbose(verbose)
+, revision(0)
 {
 }
 
@@ -194,6 +195,22 @@ bool GLSLProgram::isLinked(void) const
 	return linked;
 }
 
+unsigned int GLSLProgram::getRevision(void) const
+{
+	return revision;
+}
+
+void GLSLProgram::swap(GLSLProgram& other)
+{
+	std::swap(handle, other.handle);
+	std::swap(logString, other.logString);
+	std::swap(shaders, other.shaders);
+	std::swap(linked, other.linked);
+
+	revision++;
+	other.revision++;
+}
+
 void GLSLProgram::bindAttribLocation(GLuint location, const char* name)
 {
 	glBindAttribLocation(handle, location, name);
@@ -1,8 +1,14 @@
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
 #include "CG/GeometryUtil.h"
+#include "CG/MeshOptimizer.h"
+#include "CG/ThreadPool.h"
 
 namespace cg::GeometryUtil
 {
-    static void makeTriangles(cg::MeshData* model, glm::vec3 a, glm::vec3 b, glm::vec3 c, uint8_t n, glm::vec3 color)
+    static void makeTriangles(cg::MeshData* model, glm::vec3 a, glm::vec3 b, glm::vec3 c, uint8_t n)
     {
         if (n < 0)
         {
@@ -41,10 +47,10 @@ namespace cg::GeometryUtil
         uint32_t edgeDivInner;
 
         // Next index because there may already be vertices in <model>
-        GLushort nextIndex = model->vertices.size();
+        GLuint nextIndex = model->vertices.size();
 
-        GLushort nextTriUp[3] = { 0, 1, 2 + n };
-        GLushort nextTriDown[3] = { 3 + n, 2 + n, 1 };
+        GLuint nextTriUp[3] = { 0, 1, 2 + n };
+        GLuint nextTriDown[3] = { 3 + n, 2 + n, 1 };
 
         for (x = 0; x < 3; ++x)
         {
@@ -67,7 +73,6 @@ namespace cg::GeometryUtil
                 // Put vertices along the bridge
                 glm::vec3 vertex = ab_slide + currentLine * (x * edgeLengthInner);
                 model->vertices.push_back(vertex);
-                model->colors.push_back(color);
             }
         }
 
@@ -101,7 +106,7 @@ namespace cg::GeometryUtil
         }
     }
 
-	void generateSphereModel(cg::MeshData* model, uint8_t n, float radius, const glm::vec3& color)
+	void generateSphereModel(cg::MeshData* model, uint8_t n, float radius, const glm::vec3& color, bool optimize)
 	{
         if (n < 0)
         {
@@ -109,6 +114,7 @@ namespace cg::GeometryUtil
         }
 
         model->clearAll();
+        model->constantColor = color;
 
         using namespace glm;
 
@@ -117,56 +123,56 @@ namespace cg::GeometryUtil
             vec3(-radius, 0, -radius),
             vec3(0, 1, 0),
             vec3(radius, 0, -radius),
-            n, color);
+            n);
 
         // Top Back
         makeTriangles(model,
             vec3(-radius, 0, radius),
             vec3(0, 1, 0),
             vec3(radius, 0, radius),
-            n, color);
+            n);
 
         // Top Right
         makeTriangles(model,
             vec3(radius, 0, -radius),
             vec3(0, 1, 0),
             vec3(radius, 0, radius),
-            n, color);
+            n);
 
         // Top Left
         makeTriangles(model,
             vec3(-radius, 0, -radius),
             vec3(0, 1, 0),
             vec3(-radius, 0, radius),
-            n, color);
+            n);
 
         // Bottom Front
         makeTriangles(model,
             vec3(-radius, 0, -radius),
             vec3(0, -1, 0),
             vec3(radius, 0, -radius),
-            n, color);
+            n);
 
         // Bottom Back
         makeTriangles(model,
             vec3(-radius, 0, radius),
             vec3(0, -1, 0),
             vec3(radius, 0, radius),
-            n, color);
+            n);
 
         // Bottom Right
         makeTriangles(model,
             vec3(radius, 0, -radius),
             vec3(0, -1, 0),
             vec3(radius, 0, radius),
-            n, color);
+            n);
 
         // Bottom Left
         makeTriangles(model,
             vec3(-radius, 0, -radius),
             vec3(0, -1, 0),
             vec3(-radius, 0, radius),
-            n, color);
+            n);
 
         // Make octahedron into a sphere shape
         // by pushing vertices away from the center so that
@@ -180,8 +186,238 @@ namespace cg::GeometryUtil
         }
 
         model->drawMode = GL_TRIANGLES;
+        model->updateIndexType();
+
+        if (optimize)
+        {
+            cg::MeshOptimizer::optimize(model);
+        }
 	}
 
+    // Golden ratio, the corners of the icosahedron lie on three orthogonal golden rectangles
+    static const float PHI = 1.6180339887f;
+
+    static const glm::vec3 ICOSAHEDRON_CORNERS[12] =
+    {
+        { -1.0f,  PHI,  0.0f }, {  1.0f,  PHI,  0.0f }, { -1.0f, -PHI,  0.0f }, {  1.0f, -PHI,  0.0f },
+        {  0.0f, -1.0f,  PHI }, {  0.0f,  1.0f,  PHI }, {  0.0f, -1.0f, -PHI }, {  0.0f,  1.0f, -PHI },
+        {  PHI,  0.0f, -1.0f }, {  PHI,  0.0f,  1.0f }, { -PHI,  0.0f, -1.0f }, { -PHI,  0.0f,  1.0f }
+    };
+
+    // Counter-clockwise seen from outside
+    static const uint32_t ICOSAHEDRON_FACES[20][3] =
+    {
+        { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+        { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+        { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+        { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 }
+    };
+
+    static const uint32_t ICOSAHEDRON_EDGES = 30;
+
+    // Below this the faces are filled faster than the threads are started
+    static const uint32_t ICOSPHERE_PARALLEL_SUBDIVISIONS = 64;
+
+    // Where the vertices of an icosphere are: the 12 corners, then the inner vertices of every edge, then the inner vertices of every face
+    struct IcosphereLayout
+    {
+        uint32_t subdivisions = 0;
+
+        // Edge between two corners, and the corners of every edge, its vertices are counted from the first one
+        uint32_t edges[12][12] = {};
+        uint32_t edgeStart[ICOSAHEDRON_EDGES] = {};
+        uint32_t edgeEnd[ICOSAHEDRON_EDGES] = {};
+    };
+
+    // Great circle arc between two points of unit length, the angle is computed once for all points on it
+    struct UnitArc
+    {
+        glm::vec3 a;
+        glm::vec3 b;
+        float angle = 0.0f;
+        float sine = 0.0f;
+
+        UnitArc(const glm::vec3& a, const glm::vec3& b)
+            : a(a), b(b), angle(std::acos(std::clamp(glm::dot(a, b), -1.0f, 1.0f))), sine(std::sin(angle))
+        {
+        }
+
+        // Point at <t> of the arc, 0 is <a> and 1 is <b>
+        glm::vec3 at(float t) const
+        {
+            if (sine < 1e-6f)
+            {
+                return a;
+            }
+            return a * (std::sin((1.0f - t) * angle) / sine) + b * (std::sin(t * angle) / sine);
+        }
+    };
+
+    // Vertex <t> segments away from corner <from> on the edge to corner <to>, 0 < t < subdivisions
+    static GLuint getEdgeVertex(const IcosphereLayout& layout, uint32_t from, uint32_t to, uint32_t t)
+    {
+        uint32_t edge = layout.edges[from][to];
+        uint32_t inner = layout.subdivisions - 1;
+        return 12 + edge * inner + (layout.edgeStart[edge] == from ? t - 1 : inner - t);
+    }
+
+    // Vertex of <face> in row <i> (0 at its first corner, <subdivisions> on the opposite edge) and column <j> (0 to <i>)
+    static GLuint getFaceVertex(const IcosphereLayout& layout, uint32_t face, uint32_t i, uint32_t j)
+    {
+        const uint32_t* corners = ICOSAHEDRON_FACES[face];
+        uint32_t n = layout.subdivisions;
+        if (i == 0)
+        {
+            return corners[0];
+        }
+        if (i == n)
+        {
+            if (j == 0)
+            {
+                return corners[1];
+            }
+            return j == n ? corners[2] : getEdgeVertex(layout, corners[1], corners[2], j);
+        }
+        if (j == 0)
+        {
+            return getEdgeVertex(layout, corners[0], corners[1], i);
+        }
+        if (j == i)
+        {
+            return getEdgeVertex(layout, corners[0], corners[2], i);
+        }
+
+        uint32_t inner = n - 1;
+        return 12 + ICOSAHEDRON_EDGES * inner + face * (inner * (inner - 1) / 2) + (i - 1) * (i - 2) / 2 + (j - 1);
+    }
+
+    static void setSphereVertex(cg::MeshData* model, GLuint index, const glm::vec3& normal, float radius)
+    {
+        model->normals[index] = normal;
+        model->vertices[index] = normal * radius;
+    }
+
+    // Writes the inner vertices of <face> and its subdivisions^2 triangles, faces do not share anything they write
+    static void fillIcosphereFace(cg::MeshData* model, const IcosphereLayout& layout, uint32_t face, float radius)
+    {
+        uint32_t n = layout.subdivisions;
+        const uint32_t* corners = ICOSAHEDRON_FACES[face];
+        glm::vec3 a = glm::normalize(ICOSAHEDRON_CORNERS[corners[0]]);
+        glm::vec3 b = glm::normalize(ICOSAHEDRON_CORNERS[corners[1]]);
+        glm::vec3 c = glm::normalize(ICOSAHEDRON_CORNERS[corners[2]]);
+
+        // Every row is an arc between the two edges that meet in the first corner
+        UnitArc ab(a, b);
+        UnitArc ac(a, c);
+        for (uint32_t i = 2; i < n; ++i)
+        {
+            UnitArc row(ab.at((float)i / n), ac.at((float)i / n));
+            for (uint32_t j = 1; j < i; ++j)
+            {
+                setSphereVertex(model, getFaceVertex(layout, face, i, j), row.at((float)j / i), radius);
+            }
+        }
+
+        // Row by row, alternating between the triangles pointing away from the first corner and the ones pointing to it
+        GLuint* out = model->indices.data() + (size_t)face * n * n * 3;
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            for (uint32_t j = 0; j <= i; ++j)
+            {
+                *out++ = getFaceVertex(layout, face, i, j);
+                *out++ = getFaceVertex(layout, face, i + 1, j);
+                *out++ = getFaceVertex(layout, face, i + 1, j + 1);
+
+                if (j < i)
+                {
+                    *out++ = getFaceVertex(layout, face, i, j);
+                    *out++ = getFaceVertex(layout, face, i + 1, j + 1);
+                    *out++ = getFaceVertex(layout, face, i, j + 1);
+                }
+            }
+        }
+    }
+
+    bool generateIcosphereModel(cg::MeshData* model, uint32_t subdivisions, float radius, const glm::vec3& color, bool optimize, unsigned int threads)
+    {
+        if (subdivisions == 0 || subdivisions > MAX_ICOSPHERE_SUBDIVISIONS)
+        {
+            std::cout << "icosphere subdivisions must be between 1 and " << MAX_ICOSPHERE_SUBDIVISIONS << ", got " << subdivisions << "\n";
+            return false;
+        }
+
+        model->clearAll();
+        model->constantColor = color;
+
+        IcosphereLayout layout;
+        layout.subdivisions = subdivisions;
+        uint32_t edgeCount = 0;
+        for (const uint32_t* corners : ICOSAHEDRON_FACES)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                uint32_t from = corners[k];
+                uint32_t to = corners[(k + 1) % 3];
+                // Every edge belongs to two faces, which run along it in opposite directions
+                if (from < to)
+                {
+                    layout.edges[from][to] = layout.edges[to][from] = edgeCount;
+                    layout.edgeStart[edgeCount] = from;
+                    layout.edgeEnd[edgeCount++] = to;
+                }
+            }
+        }
+
+        size_t n = subdivisions;
+        model->vertices.resize(10 * n * n + 2);
+        model->normals.resize(model->vertices.size());
+        model->indices.resize(20 * n * n * 3);
+
+        for (uint32_t corner = 0; corner < 12; ++corner)
+        {
+            setSphereVertex(model, corner, glm::normalize(ICOSAHEDRON_CORNERS[corner]), radius);
+        }
+
+        // Edges are placed once, so both faces along an edge use the same vertices
+        for (uint32_t edge = 0; edge < ICOSAHEDRON_EDGES; ++edge)
+        {
+            uint32_t from = layout.edgeStart[edge];
+            uint32_t to = layout.edgeEnd[edge];
+            UnitArc arc(model->normals[from], model->normals[to]);
+            for (uint32_t t = 1; t < subdivisions; ++t)
+            {
+                setSphereVertex(model, getEdgeVertex(layout, from, to, t), arc.at((float)t / subdivisions), radius);
+            }
+        }
+
+        if (threads != 1 && subdivisions >= ICOSPHERE_PARALLEL_SUBDIVISIONS)
+        {
+            ThreadPool pool(threads);
+            for (uint32_t face = 0; face < 20; ++face)
+            {
+                pool.submit([model, &layout, face, radius]() { fillIcosphereFace(model, layout, face, radius); });
+            }
+
+            // The pool finishes all tasks before it is destroyed
+        }
+        else
+        {
+            for (uint32_t face = 0; face < 20; ++face)
+            {
+                fillIcosphereFace(model, layout, face, radius);
+            }
+        }
+
+        model->drawMode = GL_TRIANGLES;
+        model->updateIndexType();
+
+        if (optimize)
+        {
+            cg::MeshOptimizer::optimize(model);
+        }
+        return true;
+    }
+
 	void generateOriginModel(cg::MeshData* model)
 	{
         model->clearAll();
@@ -213,6 +449,7 @@ namespace cg::GeometryUtil
         };
 
         model->drawMode = GL_LINES;
+        model->updateIndexType();
 	}
 
     void generateLineModel(cg::MeshData* model, float length, const glm::vec3& dir, const glm::vec3& color, const glm::vec3& center)
@@ -227,9 +464,10 @@ namespace cg::GeometryUtil
             center - dir * 0.5f * length
         };
 
-        model->colors = { color, color };
+        model->constantColor = color;
 
         model->indices = { 0, 1 };
+        model->updateIndexType();
     }
 
     void generateNormalDisplayObj(cg::MeshData* model, const cg::MeshData* modelWithNormals, float normalLength, const glm::vec3& color)
@@ -238,22 +476,23 @@ namespace cg::GeometryUtil
 
         model->drawMode = GL_LINES;
 
-        if (modelWithNormals->normals.size() != modelWithNormals->vertices.size())
+        // Normals that collapseConstantAttributes folded into the constant are drawn as well
+        if (!modelWithNormals->normals.empty() && modelWithNormals->normals.size() != modelWithNormals->vertices.size())
         {
             return;
         }
 
-        for (size_t i = 0; i < modelWithNormals->normals.size(); ++i)
+        for (size_t i = 0; i < modelWithNormals->vertices.size(); ++i)
         {
             model->vertices.push_back(modelWithNormals->vertices[i]);
-            model->vertices.push_back(modelWithNormals->vertices[i] + modelWithNormals->normals[i] * normalLength);
+            model->vertices.push_back(modelWithNormals->vertices[i] + modelWithNormals->getNormal(i) * normalLength);
 
             model->indices.push_back(i * 2);
             model->indices.push_back(i * 2 + 1);
-
-            model->colors.push_back(color);
-            model->colors.push_back(color);
         }
+        model->constantColor = color;
+
+        model->updateIndexType();
     }
 
     void generateBox(cg::MeshData* model, const glm::vec3& min, const glm::vec3& max, const glm::vec3& color)
@@ -311,9 +550,8 @@ namespace cg::GeometryUtil
         model->indices.push_back(3);
         model->indices.push_back(7);
 
-        for (size_t i = 0; i < 8; ++i)
-        {
-            model->colors.push_back(color);
-        }
+        model->constantColor = color;
+
+        model->updateIndexType();
     }
 }
\ No newline at end of file
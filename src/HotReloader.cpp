@@ -0,0 +1,227 @@
+#include "CG/HotReloader.h"
+#include "CG/ShaderManager.h"
+#include "CG/OBJFile.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+namespace cg
+{
+	// One thread is plenty for a few small text files
+	static const unsigned int SHADER_READ_THREADS = 1;
+
+	static bool readFile(const std::string& path, std::string* content)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.good())
+		{
+			return false;
+		}
+
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		*content = stream.str();
+		return true;
+	}
+
+	HotReloader::HotReloader(AssetLoader& loader)
+		: m_loader(loader)
+		, m_pool(SHADER_READ_THREADS)
+	{
+
+	}
+
+	HotReloader::~HotReloader()
+	{
+
+	}
+
+	void HotReloader::watchOBJ(const std::string& path, std::shared_ptr<MeshGLInfo> meshInfo, float scale, ReloadCallback onReloaded,
+		const OBJLoadOptions& options, const std::vector<std::string>& materialLibraries)
+	{
+		auto dependencies = std::make_shared<Dependencies>();
+		dependencies->paths = materialLibraries;
+
+		std::shared_ptr<WatchedMesh> mesh = addMesh(path, std::move(meshInfo), [path, scale, options, dependencies](MeshData* mesh)
+		{
+			OBJLoadStats stats;
+			OBJLoadOptions loadOptions = options;
+			loadOptions.stats = &stats;
+			if (!OBJFile::load(path, mesh, scale, loadOptions))
+			{
+				return false;
+			}
+
+			// The file may name other libraries now
+			std::lock_guard<std::mutex> lock(dependencies->mutex);
+			dependencies->paths = std::move(stats.materialLibraries);
+			return true;
+		}, std::move(onReloaded));
+
+		if (mesh != nullptr)
+		{
+			mesh->dependencies = std::move(dependencies);
+			watchDependencies(mesh);
+		}
+	}
+
+	void HotReloader::watchMesh(const std::string& path, std::shared_ptr<MeshGLInfo> meshInfo, AssetLoader::LoadFunction load, ReloadCallback onReloaded)
+	{
+		addMesh(path, std::move(meshInfo), std::move(load), std::move(onReloaded));
+	}
+
+	std::shared_ptr<HotReloader::WatchedMesh> HotReloader::addMesh(const std::string& path, std::shared_ptr<MeshGLInfo> meshInfo, AssetLoader::LoadFunction load,
+		ReloadCallback onReloaded)
+	{
+		if (!m_watcher.watch(path))
+		{
+			return nullptr;
+		}
+
+		auto mesh = std::make_shared<WatchedMesh>();
+		mesh->meshInfo = meshInfo;
+		mesh->load = std::move(load);
+		mesh->onReloaded = std::move(onReloaded);
+		m_meshes.emplace(path, mesh);
+		return mesh;
+	}
+
+	void HotReloader::watchDependencies(const std::shared_ptr<WatchedMesh>& mesh)
+	{
+		std::vector<std::string> paths;
+		{
+			std::lock_guard<std::mutex> lock(mesh->dependencies->mutex);
+			paths = mesh->dependencies->paths;
+		}
+
+		// A change to a dependency reloads the mesh like a change to its own file
+		for (const std::string& path : paths)
+		{
+			std::vector<std::string>& watched = mesh->watchedDependencies;
+			if (std::find(watched.begin(), watched.end(), path) == watched.end() && m_watcher.watch(path))
+			{
+				watched.push_back(path);
+				m_meshes.emplace(path, mesh);
+			}
+		}
+	}
+
+	void HotReloader::watchShader(const std::string& name)
+	{
+		for (const auto& [path, type] : ShaderManager::getShaderFiles(name))
+		{
+			if (m_watcher.watch(path))
+			{
+				m_shaders.emplace(path, name);
+			}
+		}
+	}
+
+	void HotReloader::update()
+	{
+		std::vector<std::string> shaderNames;
+		for (const std::string& path : m_watcher.poll())
+		{
+			auto meshes = m_meshes.equal_range(path);
+			for (auto it = meshes.first; it != meshes.second; ++it)
+			{
+				reloadMesh(it->second);
+			}
+
+			// A shader that uses several of the changed files is only rebuilt once
+			auto shaders = m_shaders.equal_range(path);
+			for (auto it = shaders.first; it != shaders.second; ++it)
+			{
+				if (std::find(shaderNames.begin(), shaderNames.end(), it->second) == shaderNames.end())
+				{
+					shaderNames.push_back(it->second);
+				}
+			}
+		}
+
+		for (const std::string& name : shaderNames)
+		{
+			reloadShader(name);
+		}
+
+		// Link the shaders whose sources are there, keep the order in which the reads were started
+		size_t done = 0;
+		while (done < m_pendingShaders.size()
+			&& m_pendingShaders[done].sources.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			PendingShader& pending = m_pendingShaders[done];
+			std::vector<std::string> sources = pending.sources.get();
+			if (!sources.empty() && ShaderManager::reloadShader(pending.name, sources))
+			{
+				std::cout << "Reloaded shader \"" << pending.name << "\"\n";
+			}
+			else
+			{
+				std::cout << "Failed to reload shader \"" << pending.name << "\", keeping the old one\n";
+			}
+			done++;
+		}
+		m_pendingShaders.erase(m_pendingShaders.begin(), m_pendingShaders.begin() + done);
+	}
+
+	void HotReloader::reloadMesh(const std::shared_ptr<WatchedMesh>& mesh)
+	{
+		std::shared_ptr<MeshGLInfo> current = mesh->meshInfo.lock();
+		if (current == nullptr)
+		{
+			return;
+		}
+
+		// The reloaded mesh keeps the layout, e.g. stays quantized
+		unsigned int request = ++mesh->requested;
+		m_loader.loadMesh(mesh->load, [this, mesh, request](std::shared_ptr<const MeshData> meshData, std::shared_ptr<MeshGLInfo> meshInfo)
+		{
+			// A newer reload is on its way, or nobody uses the mesh anymore
+			std::shared_ptr<MeshGLInfo> target = mesh->meshInfo.lock();
+			if (request != mesh->requested || target == nullptr)
+			{
+				return;
+			}
+
+			// The old buffers go away with <meshInfo>
+			target->swap(*meshInfo);
+			if (mesh->dependencies != nullptr)
+			{
+				watchDependencies(mesh);
+			}
+			if (mesh->onReloaded)
+			{
+				mesh->onReloaded(meshData);
+			}
+		}, current->getVertexLayout());
+	}
+
+	void HotReloader::reloadShader(const std::string& name)
+	{
+		std::vector<std::string> paths;
+		for (const auto& [path, type] : ShaderManager::getShaderFiles(name))
+		{
+			paths.push_back(path);
+		}
+
+		PendingShader pending;
+		pending.name = name;
+		pending.sources = m_pool.submit([paths]()
+		{
+			std::vector<std::string> sources(paths.size());
+			for (size_t i = 0; i < paths.size(); ++i)
+			{
+				if (!readFile(paths[i], &sources[i]))
+				{
+					std::cout << "Could not read \"" << paths[i] << "\"\n";
+					return std::vector<std::string>();
+				}
+			}
+			return sources;
+		});
+		m_pendingShaders.push_back(std::move(pending));
+	}
+}
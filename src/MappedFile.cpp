@@ -0,0 +1,143 @@
+#include "CG/MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace cg
+{
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size))
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		m_fileHandle = file;
+		m_size = (size_t)size.QuadPart;
+		m_open = true;
+
+		if (m_size == 0)
+		{
+			// Empty files cannot be mapped
+			return true;
+		}
+
+		m_mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mappingHandle == nullptr)
+		{
+			close();
+			return false;
+		}
+
+		m_data = (const char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (m_data == nullptr)
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data != nullptr)
+		{
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mappingHandle != nullptr)
+		{
+			CloseHandle(m_mappingHandle);
+		}
+		if (m_fileHandle != nullptr)
+		{
+			CloseHandle(m_fileHandle);
+		}
+		m_data = nullptr;
+		m_mappingHandle = nullptr;
+		m_fileHandle = nullptr;
+		m_size = 0;
+		m_open = false;
+	}
+#else
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+		{
+			::close(fd);
+			return false;
+		}
+
+		m_size = (size_t)st.st_size;
+		m_open = true;
+
+		if (m_size == 0)
+		{
+			// Empty files cannot be mapped
+			::close(fd);
+			return true;
+		}
+
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		// The mapping keeps its own reference to the file
+		::close(fd);
+
+		if (data == MAP_FAILED)
+		{
+			m_size = 0;
+			m_open = false;
+			return false;
+		}
+
+		// We walk the file front to back exactly once
+		madvise(data, m_size, MADV_SEQUENTIAL);
+
+		m_data = (const char*)data;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data != nullptr)
+		{
+			munmap((void*)m_data, m_size);
+		}
+		m_data = nullptr;
+		m_size = 0;
+		m_open = false;
+	}
+#endif
+}
@@ -0,0 +1,194 @@
+#include "CG/MeshArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace cg
+{
+	MeshArena::~MeshArena()
+	{
+		release();
+	}
+
+	void MeshArena::reset()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		size_t size = m_peakConsumed + m_peakConsumed / 16;
+		bool merge = m_blocks != nullptr && m_blocks->next != nullptr;
+		if (merge)
+		{
+			for (Block* block = m_blocks; block != nullptr; )
+			{
+				Block* next = block->next;
+				::operator delete(block);
+				block = next;
+			}
+			m_blocks = nullptr;
+			m_capacity = 0;
+		}
+
+		m_used = 0;
+		m_allocations = 0;
+		m_heapAllocations = 0;
+		m_freeRangeCount = 0;
+		m_consumed = 0;
+		m_peakConsumed = 0;
+
+		if (merge)
+		{
+			// One block that fits everything the last load needed, with a little room for alignment
+			addBlock(size);
+		}
+		else if (m_blocks != nullptr)
+		{
+			m_top = (char*)(m_blocks + 1);
+		}
+	}
+
+	void MeshArena::release()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (Block* block = m_blocks; block != nullptr; )
+		{
+			Block* next = block->next;
+			::operator delete(block);
+			block = next;
+		}
+		m_blocks = nullptr;
+		m_top = nullptr;
+		m_end = nullptr;
+		m_capacity = 0;
+		m_used = 0;
+		m_allocations = 0;
+		m_heapAllocations = 0;
+		m_freeRangeCount = 0;
+		m_consumed = 0;
+		m_peakConsumed = 0;
+	}
+
+	void* MeshArena::do_allocate(size_t bytes, size_t alignment)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_used += bytes;
+		m_allocations++;
+
+		if (bytes >= MIN_FREE_SIZE)
+		{
+			if (void* p = allocateFreed(bytes, alignment))
+			{
+				return p;
+			}
+		}
+
+		uintptr_t top = ((uintptr_t)m_top + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		if (m_top == nullptr || top > (uintptr_t)m_end || bytes > (uintptr_t)m_end - top)
+		{
+			addBlock(bytes + alignment);
+			top = ((uintptr_t)m_top + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		}
+
+		m_consumed += top + bytes - (uintptr_t)m_top;
+		m_peakConsumed = std::max(m_peakConsumed, m_consumed);
+		m_top = (char*)(top + bytes);
+		return (void*)top;
+	}
+
+	void MeshArena::do_deallocate(void* p, size_t bytes, size_t)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_used -= bytes;
+		if ((char*)p + bytes == m_top)
+		{
+			m_consumed -= bytes;
+			m_top = (char*)p;
+		}
+		else if (bytes >= MIN_FREE_SIZE)
+		{
+			addFreed((char*)p, (char*)p + bytes);
+		}
+	}
+
+	void* MeshArena::allocateFreed(size_t bytes, size_t alignment)
+	{
+		// Best fit, so a large range is not cut up by a small allocation that another range could take
+		FreeRange* best = nullptr;
+		for (size_t i = 0; i < m_freeRangeCount; ++i)
+		{
+			FreeRange& range = m_freeRanges[i];
+			uintptr_t begin = ((uintptr_t)range.begin + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			if (begin <= (uintptr_t)range.end && bytes <= (uintptr_t)range.end - begin
+				&& (best == nullptr || range.end - range.begin < best->end - best->begin))
+			{
+				best = &range;
+			}
+		}
+		if (best == nullptr)
+		{
+			return nullptr;
+		}
+
+		char* p = (char*)(((uintptr_t)best->begin + alignment - 1) & ~(uintptr_t)(alignment - 1));
+		best->begin = p + bytes;
+		if ((size_t)(best->end - best->begin) < MIN_FREE_SIZE)
+		{
+			*best = m_freeRanges[--m_freeRangeCount];
+		}
+		return p;
+	}
+
+	void MeshArena::addFreed(char* begin, char* end)
+	{
+		// Joins neighbours, the buffers of one vector are often next to each other
+		for (size_t i = 0; i < m_freeRangeCount; )
+		{
+			FreeRange& range = m_freeRanges[i];
+			if (range.end == begin || range.begin == end)
+			{
+				begin = std::min(begin, range.begin);
+				end = std::max(end, range.end);
+				range = m_freeRanges[--m_freeRangeCount];
+				continue;
+			}
+			++i;
+		}
+
+		if (end == m_top)
+		{
+			m_consumed -= end - begin;
+			m_top = begin;
+			return;
+		}
+		if (m_freeRangeCount < MAX_FREE_RANGES)
+		{
+			m_freeRanges[m_freeRangeCount++] = { begin, end };
+			return;
+		}
+
+		// Full, forget the smallest range if this one is larger
+		FreeRange* smallest = std::min_element(m_freeRanges, m_freeRanges + MAX_FREE_RANGES,
+			[](const FreeRange& a, const FreeRange& b) { return a.end - a.begin < b.end - b.begin; });
+		if (smallest->end - smallest->begin < end - begin)
+		{
+			*smallest = { begin, end };
+		}
+	}
+
+	void MeshArena::addBlock(size_t bytes)
+	{
+		size_t size = std::max({ MIN_BLOCK_SIZE, bytes + sizeof(Block), m_blocks != nullptr ? m_blocks->size * 2 : 0 });
+
+		Block* block = (Block*)::operator new(size);
+		block->next = m_blocks;
+		block->size = size;
+		m_blocks = block;
+		m_top = (char*)(block + 1);
+		m_end = (char*)block + size;
+		m_capacity += size;
+		m_heapAllocations++;
+	}
+}
@@ -0,0 +1,637 @@
+#include "CG/MeshCache.h"
+#include "CG/MappedFile.h"
+#include "CG/MeshCodec.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <type_traits>
+#include <atomic>
+#include <thread>
+#include <sstream>
+
+namespace cg
+{
+	// Increase whenever the layout of the file or of MeshData changes, or the loaders order the mesh differently
+	static const uint32_t CACHE_VERSION = 9;
+	static const char CACHE_MAGIC[4] = { 'C', 'G', 'M', 'S' };
+
+	static_assert(std::is_trivially_copyable_v<Meshlet>, "meshlets are stored as raw bytes");
+
+	// Numbers the temporary files of MeshCache::write
+	static std::atomic<uint64_t> tempFileCounter(0);
+
+	struct MeshCacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		float scale;
+		uint32_t options;
+
+		uint32_t drawMode;
+		uint32_t indexType;
+
+		uint64_t vertexCount;
+		uint64_t colorCount;
+		uint64_t normalCount;
+		uint64_t indexCount;
+		uint64_t texcoordCount;
+
+		// Bytes of the material and submesh table at the end
+		uint64_t subMeshTableSize;
+
+		// 1 if the arrays are stored with MeshCodec, their sizes in the file are in <encodedSizes> then
+		uint32_t compressed;
+		uint32_t reserved;
+		uint64_t encodedSizes[5];
+
+		// Of every vertex while there are no colors or normals
+		float constantColor[3];
+		float constantNormal[3];
+
+		// MeshData::meshlets follow the arrays as they are, never compressed
+		uint64_t meshletCount;
+
+		// Bytes of the dependency table after the submesh table
+		uint64_t dependencyTableSize;
+	};
+
+	// Size of a dependency that did not exist when the cache was written
+	static const uint64_t MISSING_FILE_SIZE = ~0ull;
+
+	// Dependency table layout:
+	// uint32 count, per file: uint32 pathLength, path relative to the cache directory, uint64 size, int64 modification time
+	static const size_t DEPENDENCY_RECORD_SIZE = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int64_t);
+
+	template <typename T>
+	static size_t arraySize(uint64_t count)
+	{
+		return (size_t)count * sizeof(T);
+	}
+
+	// A count from the header that the file can hold, checked before arraySize so sums of them can not overflow
+	template <typename T>
+	static bool fitsInto(uint64_t count, size_t fileSize)
+	{
+		return count <= fileSize / sizeof(T);
+	}
+
+	std::string MeshCache::getCachePath(const std::string& sourcePath)
+	{
+		return sourcePath + ".cgmesh";
+	}
+
+	template <typename T>
+	static void writeValue(std::ostream& file, const T& value)
+	{
+		file.write((const char*)&value, sizeof(T));
+	}
+
+	static void writeName(std::ostream& file, const std::string& name)
+	{
+		writeValue(file, (uint32_t)name.size());
+		file.write(name.data(), name.size());
+	}
+
+	// Size and modification time of <path>, false if it can not be read
+	static bool getFileStamp(const std::string& path, uint64_t* size, int64_t* time)
+	{
+		std::error_code ec;
+		*size = std::filesystem::file_size(path, ec);
+		if (ec)
+		{
+			return false;
+		}
+
+		auto lastWrite = std::filesystem::last_write_time(path, ec);
+		if (ec)
+		{
+			return false;
+		}
+
+		*time = lastWrite.time_since_epoch().count();
+		return true;
+	}
+
+	bool MeshCache::makeKey(const std::string& sourcePath, float scale, MeshCacheKey* key)
+	{
+		if (!getFileStamp(sourcePath, &key->sourceSize, &key->sourceTime))
+		{
+			return false;
+		}
+
+		key->scale = scale;
+		return true;
+	}
+
+	// Stored relative to the file that holds the table, so it still works from another working directory
+	static std::string getStoredPath(const std::string& directory, const std::string& path)
+	{
+		std::filesystem::path relative = std::filesystem::path(path).lexically_relative(directory);
+		return relative.empty() ? path : relative.generic_string();
+	}
+
+	size_t MeshCache::getDependenciesSize(const std::string& directory, const std::vector<std::string>& paths)
+	{
+		size_t size = sizeof(uint32_t);
+		for (const std::string& path : paths)
+		{
+			size += DEPENDENCY_RECORD_SIZE + getStoredPath(directory, path).size();
+		}
+		return size;
+	}
+
+	void MeshCache::writeDependencies(std::ostream& file, const std::string& directory, const std::vector<std::string>& paths)
+	{
+		writeValue(file, (uint32_t)paths.size());
+		for (const std::string& path : paths)
+		{
+			uint64_t size;
+			int64_t time;
+			if (!getFileStamp(path, &size, &time))
+			{
+				size = MISSING_FILE_SIZE;
+				time = 0;
+			}
+			writeName(file, getStoredPath(directory, path));
+			writeValue(file, size);
+			writeValue(file, time);
+		}
+	}
+
+	bool MeshCache::readDependencies(const char* data, size_t size, const std::string& directory, std::vector<std::string>* paths, bool* upToDate)
+	{
+		const char* end = data + size;
+		auto readValue = [&data, end](auto* value)
+		{
+			if ((size_t)(end - data) < sizeof(*value))
+			{
+				return false;
+			}
+			std::memcpy(value, data, sizeof(*value));
+			data += sizeof(*value);
+			return true;
+		};
+
+		uint32_t count;
+		if (!readValue(&count) || count > size / DEPENDENCY_RECORD_SIZE)
+		{
+			return false;
+		}
+
+		*upToDate = true;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t length;
+			if (!readValue(&length) || (size_t)(end - data) < length)
+			{
+				return false;
+			}
+			std::filesystem::path stored(std::string(data, length));
+			data += length;
+
+			uint64_t storedSize;
+			int64_t storedTime;
+			if (!readValue(&storedSize) || !readValue(&storedTime))
+			{
+				return false;
+			}
+
+			std::string path = stored.is_absolute() ? stored.string() : (std::filesystem::path(directory) / stored).string();
+			uint64_t fileSize;
+			int64_t fileTime;
+			if (!getFileStamp(path, &fileSize, &fileTime))
+			{
+				fileSize = MISSING_FILE_SIZE;
+				fileTime = 0;
+			}
+			if (fileSize != storedSize || fileTime != storedTime)
+			{
+				*upToDate = false;
+			}
+			paths->push_back(path);
+		}
+		return data == end;
+	}
+
+	// The sizes of a damaged file can still add up. Everything the renderer relies on is checked again, like GLBFile does
+	// with the accessors of a glTF file, so a broken cache is never drawn.
+	static bool isConsistent(const MeshData& meshData)
+	{
+		if (meshData.drawMode != GL_TRIANGLES && meshData.drawMode != GL_LINES && meshData.drawMode != GL_TRIANGLE_STRIP)
+		{
+			return false;
+		}
+		if (meshData.indexType != GL_UNSIGNED_INT &&
+			(meshData.indexType != GL_UNSIGNED_SHORT || meshData.vertices.size() > MeshData::MAX_SHORT_INDEX_VERTICES))
+		{
+			return false;
+		}
+
+		// Per-vertex attributes or the constant, anything else would be read past its end
+		size_t vertexCount = meshData.vertices.size();
+		if ((!meshData.colors.empty() && meshData.colors.size() != vertexCount) ||
+			(!meshData.normals.empty() && meshData.normals.size() != vertexCount))
+		{
+			return false;
+		}
+
+		bool strips = meshData.drawMode == GL_TRIANGLE_STRIP;
+		for (GLuint index : meshData.indices)
+		{
+			if (index >= vertexCount && !(strips && index == MeshData::RESTART_INDEX))
+			{
+				return false;
+			}
+		}
+
+		uint64_t indexCount = meshData.indices.size();
+		for (const SubMesh& subMesh : meshData.subMeshes)
+		{
+			if ((uint64_t)subMesh.indexOffset + subMesh.indexCount > indexCount ||
+				(subMesh.material != SubMesh::NO_MATERIAL && subMesh.material >= meshData.materials.size()))
+			{
+				return false;
+			}
+		}
+		for (const Meshlet& meshlet : meshData.meshlets)
+		{
+			if ((uint64_t)meshlet.indexOffset + meshlet.indexCount > indexCount)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool MeshCache::read(const std::string& cachePath, const MeshCacheKey& key, MeshData* meshData, std::vector<std::string>* dependencies)
+	{
+		MappedFile file;
+		if (!file.open(cachePath) || file.size() < sizeof(MeshCacheHeader))
+		{
+			return false;
+		}
+
+		MeshCacheHeader header;
+		std::memcpy(&header, file.data(), sizeof(header));
+
+		if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION)
+		{
+			return false;
+		}
+
+		if (header.sourceSize != key.sourceSize || header.sourceTime != key.sourceTime || header.scale != key.scale || header.options != key.options)
+		{
+			return false;
+		}
+
+		size_t arraysSize;
+		if (header.compressed)
+		{
+			arraysSize = 0;
+			for (uint64_t encodedSize : header.encodedSizes)
+			{
+				// Checked one by one, so the sum can not overflow
+				if (encodedSize > file.size())
+				{
+					std::cout << "Ignoring broken mesh cache \"" << cachePath << "\"\n";
+					return false;
+				}
+				arraysSize += (size_t)encodedSize;
+			}
+		}
+		else
+		{
+			if (!fitsInto<glm::vec3>(header.vertexCount, file.size()) || !fitsInto<glm::vec3>(header.colorCount, file.size())
+				|| !fitsInto<glm::vec3>(header.normalCount, file.size()) || !fitsInto<GLuint>(header.indexCount, file.size())
+				|| !fitsInto<glm::vec2>(header.texcoordCount, file.size()))
+			{
+				std::cout << "Ignoring broken mesh cache \"" << cachePath << "\"\n";
+				return false;
+			}
+			arraysSize = arraySize<glm::vec3>(header.vertexCount)
+				+ arraySize<glm::vec3>(header.colorCount)
+				+ arraySize<glm::vec3>(header.normalCount)
+				+ arraySize<GLuint>(header.indexCount)
+				+ arraySize<glm::vec2>(header.texcoordCount);
+		}
+
+		if (!fitsInto<Meshlet>(header.meshletCount, file.size()))
+		{
+			std::cout << "Ignoring broken mesh cache \"" << cachePath << "\"\n";
+			return false;
+		}
+		arraysSize += arraySize<Meshlet>(header.meshletCount);
+
+		if (header.subMeshTableSize > file.size() || header.dependencyTableSize > file.size()
+			|| file.size() != sizeof(header) + arraysSize + header.subMeshTableSize + header.dependencyTableSize)
+		{
+			std::cout << "Ignoring broken mesh cache \"" << cachePath << "\"\n";
+			return false;
+		}
+
+		// Checked before the arrays are copied, an edited material library makes the whole cache outdated
+		std::vector<std::string> dependencyPaths;
+		bool upToDate = false;
+		const char* dependencyTable = file.data() + file.size() - header.dependencyTableSize;
+		if (!readDependencies(dependencyTable, header.dependencyTableSize, std::filesystem::path(cachePath).parent_path().string(), &dependencyPaths, &upToDate))
+		{
+			std::cout << "Ignoring broken mesh cache \"" << cachePath << "\"\n";
+			return false;
+		}
+		if (!upToDate)
+		{
+			return false;
+		}
+
+		const char* pos = file.data() + sizeof(header);
+		const uint64_t* encodedSize = header.encodedSizes;
+		auto readArray = [&pos, &encodedSize, &header](auto& vec, uint64_t count)
+		{
+			using T = typename std::remove_reference_t<decltype(vec)>::value_type;
+			if (!header.compressed)
+			{
+				vec.resize(count);
+				std::memcpy(vec.data(), pos, arraySize<T>(count));
+				pos += arraySize<T>(count);
+				return true;
+			}
+
+			const uint8_t* data = (const uint8_t*)pos;
+			size_t size = (size_t)*encodedSize++;
+			pos += size;
+
+			// Every index takes at least one byte, every 64 elements of a vertex stream at least one, so a broken count is not allocated
+			if (count > (uint64_t)size * 64)
+			{
+				return false;
+			}
+			vec.resize(count);
+			if constexpr (std::is_same_v<T, GLuint>)
+			{
+				return MeshCodec::decodeIndices(data, size, vec.data(), vec.size());
+			}
+			else
+			{
+				return MeshCodec::decodeVertices(data, size, vec.data(), vec.size(), sizeof(T));
+			}
+		};
+
+		meshData->clearAll();
+		bool arraysRead = readArray(meshData->vertices, header.vertexCount)
+			&& readArray(meshData->colors, header.colorCount)
+			&& readArray(meshData->normals, header.normalCount)
+			&& readArray(meshData->indices, header.indexCount)
+			&& readArray(meshData->texcoords, header.texcoordCount);
+
+		if (!arraysRead)
+		{
+			std::cout << "Ignoring broken mesh cache \"" << cachePath << "\"\n";
+			meshData->clearAll();
+			return false;
+		}
+
+		// Plain copies in both kinds of files
+		meshData->meshlets.resize(header.meshletCount);
+		std::memcpy(meshData->meshlets.data(), pos, arraySize<Meshlet>(header.meshletCount));
+		pos += arraySize<Meshlet>(header.meshletCount);
+
+		if (!readSubMeshes(pos, header.subMeshTableSize, &meshData->materials, &meshData->subMeshes))
+		{
+			std::cout << "Ignoring broken mesh cache \"" << cachePath << "\"\n";
+			meshData->clearAll();
+			return false;
+		}
+
+		meshData->drawMode = header.drawMode;
+		meshData->indexType = header.indexType;
+		meshData->constantColor = glm::vec3(header.constantColor[0], header.constantColor[1], header.constantColor[2]);
+		meshData->constantNormal = glm::vec3(header.constantNormal[0], header.constantNormal[1], header.constantNormal[2]);
+
+		if (!isConsistent(*meshData))
+		{
+			std::cout << "Ignoring broken mesh cache \"" << cachePath << "\"\n";
+			meshData->clearAll();
+			return false;
+		}
+
+		if (dependencies != nullptr)
+		{
+			*dependencies = std::move(dependencyPaths);
+		}
+		return true;
+	}
+
+	bool MeshCache::write(const std::string& cachePath, const MeshCacheKey& key, const MeshData& meshData, bool compress,
+		const std::vector<std::string>& dependencies)
+	{
+		MeshCacheHeader header = {};
+		std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header.version = CACHE_VERSION;
+		header.sourceSize = key.sourceSize;
+		header.sourceTime = key.sourceTime;
+		header.scale = key.scale;
+		header.options = key.options;
+		header.drawMode = meshData.drawMode;
+		header.indexType = meshData.indexType;
+		header.vertexCount = meshData.vertices.size();
+		header.colorCount = meshData.colors.size();
+		header.normalCount = meshData.normals.size();
+		for (int c = 0; c < 3; ++c)
+		{
+			header.constantColor[c] = meshData.constantColor[c];
+			header.constantNormal[c] = meshData.constantNormal[c];
+		}
+		header.indexCount = meshData.indices.size();
+		header.texcoordCount = meshData.texcoords.size();
+		header.subMeshTableSize = getSubMeshesSize(meshData.materials, meshData.subMeshes);
+		header.meshletCount = meshData.meshlets.size();
+		header.compressed = compress ? 1 : 0;
+
+		std::string directory = std::filesystem::path(cachePath).parent_path().string();
+		header.dependencyTableSize = getDependenciesSize(directory, dependencies);
+
+		// Encoded arrays in file order, the sizes go into the header
+		std::vector<uint8_t> encoded[5];
+		if (compress)
+		{
+			MeshCodec::encodeVertices(meshData.vertices.data(), meshData.vertices.size(), sizeof(glm::vec3), &encoded[0]);
+			MeshCodec::encodeVertices(meshData.colors.data(), meshData.colors.size(), sizeof(glm::vec3), &encoded[1]);
+			MeshCodec::encodeVertices(meshData.normals.data(), meshData.normals.size(), sizeof(glm::vec3), &encoded[2]);
+			MeshCodec::encodeIndices(meshData.indices.data(), meshData.indices.size(), &encoded[3]);
+			MeshCodec::encodeVertices(meshData.texcoords.data(), meshData.texcoords.size(), sizeof(glm::vec2), &encoded[4]);
+			for (size_t i = 0; i < 5; ++i)
+			{
+				header.encodedSizes[i] = encoded[i].size();
+			}
+		}
+
+		// Write to a temporary file first so a reader never sees a half written cache. Every writer gets its own file,
+		// two threads writing the same cache would otherwise truncate each other's file before it is renamed.
+		std::ostringstream tempName;
+		tempName << cachePath << '.' << std::hash<std::thread::id>()(std::this_thread::get_id()) << '.' << tempFileCounter++ << ".tmp";
+		std::string tempPath = tempName.str();
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.good())
+			{
+				return false;
+			}
+
+			auto writeArray = [&file](const auto& vec)
+			{
+				using T = typename std::remove_reference_t<decltype(vec)>::value_type;
+				file.write((const char*)vec.data(), arraySize<T>(vec.size()));
+			};
+
+			file.write((const char*)&header, sizeof(header));
+			if (compress)
+			{
+				for (const std::vector<uint8_t>& array : encoded)
+				{
+					writeArray(array);
+				}
+			}
+			else
+			{
+				writeArray(meshData.vertices);
+				writeArray(meshData.colors);
+				writeArray(meshData.normals);
+				writeArray(meshData.indices);
+				writeArray(meshData.texcoords);
+			}
+			writeArray(meshData.meshlets);
+			writeSubMeshes(file, meshData.materials, meshData.subMeshes);
+
+			writeDependencies(file, directory, dependencies);
+
+			if (!file.good())
+			{
+				file.close();
+				std::error_code ec;
+				std::filesystem::remove(tempPath, ec);
+				return false;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, cachePath, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+		return true;
+	}
+
+	// Table layout:
+	// uint32 materialCount, per material: uint32 nameLength, name, ambient, diffuse, specular, shininess (floats)
+	// uint32 subMeshCount, per submesh: uint32 nameLength, name, uint32 material, indexOffset, indexCount, boundsMin, boundsMax (floats)
+	static const size_t MATERIAL_RECORD_SIZE = sizeof(uint32_t) + 10 * sizeof(float);
+	static const size_t SUBMESH_RECORD_SIZE = 4 * sizeof(uint32_t) + 6 * sizeof(float);
+
+	size_t MeshCache::getSubMeshesSize(const std::vector<Material>& materials, const std::vector<SubMesh>& subMeshes)
+	{
+		size_t size = 2 * sizeof(uint32_t);
+		for (const Material& material : materials)
+		{
+			size += MATERIAL_RECORD_SIZE + material.name.size();
+		}
+		for (const SubMesh& subMesh : subMeshes)
+		{
+			size += SUBMESH_RECORD_SIZE + subMesh.name.size();
+		}
+		return size;
+	}
+
+	void MeshCache::writeSubMeshes(std::ostream& file, const std::vector<Material>& materials, const std::vector<SubMesh>& subMeshes)
+	{
+		writeValue(file, (uint32_t)materials.size());
+		for (const Material& material : materials)
+		{
+			writeName(file, material.name);
+			writeValue(file, material.ambient);
+			writeValue(file, material.diffuse);
+			writeValue(file, material.specular);
+			writeValue(file, material.shininess);
+		}
+
+		writeValue(file, (uint32_t)subMeshes.size());
+		for (const SubMesh& subMesh : subMeshes)
+		{
+			writeName(file, subMesh.name);
+			writeValue(file, subMesh.material);
+			writeValue(file, subMesh.indexOffset);
+			writeValue(file, subMesh.indexCount);
+			writeValue(file, subMesh.boundsMin);
+			writeValue(file, subMesh.boundsMax);
+		}
+	}
+
+	bool MeshCache::readSubMeshes(const char* data, size_t size, std::vector<Material>* materials, std::vector<SubMesh>* subMeshes)
+	{
+		const char* end = data + size;
+
+		// Every read checks the remaining size first
+		auto readValue = [&data, end](auto* value)
+		{
+			if ((size_t)(end - data) < sizeof(*value))
+			{
+				return false;
+			}
+			std::memcpy(value, data, sizeof(*value));
+			data += sizeof(*value);
+			return true;
+		};
+		auto readName = [&data, end, &readValue](std::string* name)
+		{
+			uint32_t length;
+			if (!readValue(&length) || (size_t)(end - data) < length)
+			{
+				return false;
+			}
+			name->assign(data, length);
+			data += length;
+			return true;
+		};
+
+		uint32_t materialCount;
+		if (!readValue(&materialCount) || materialCount > size / MATERIAL_RECORD_SIZE)
+		{
+			return false;
+		}
+		materials->resize(materialCount);
+		for (Material& material : *materials)
+		{
+			if (!readName(&material.name) || !readValue(&material.ambient) || !readValue(&material.diffuse) || !readValue(&material.specular) || !readValue(&material.shininess))
+			{
+				return false;
+			}
+		}
+
+		uint32_t subMeshCount;
+		if (!readValue(&subMeshCount) || subMeshCount > size / SUBMESH_RECORD_SIZE)
+		{
+			return false;
+		}
+		subMeshes->resize(subMeshCount);
+		for (SubMesh& subMesh : *subMeshes)
+		{
+			if (!readName(&subMesh.name) || !readValue(&subMesh.material) || !readValue(&subMesh.indexOffset) || !readValue(&subMesh.indexCount)
+				|| !readValue(&subMesh.boundsMin) || !readValue(&subMesh.boundsMax))
+			{
+				return false;
+			}
+			if (subMesh.material != SubMesh::NO_MATERIAL && subMesh.material >= materialCount)
+			{
+				return false;
+			}
+		}
+
+		return data == end;
+	}
+}
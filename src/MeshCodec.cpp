@@ -0,0 +1,461 @@
+#include "CG/MeshCodec.h"
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CG_MESH_CODEC_SSE2
+#endif
+
+namespace cg::MeshCodec
+{
+	// Bytes of a plane that share one bit width
+	static const size_t GROUP_SIZE = 16;
+
+	// Elements that are split into planes at once, small enough for the planes to stay in the cache
+	static const size_t BLOCK_SIZE = 1024;
+
+	// Largest supported element
+	static const size_t MAX_STRIDE = 64;
+
+	// Bits per byte of the four group modes, stored as 2 bit mode per group in front of the groups of a plane
+	static const unsigned int GROUP_BITS[4] = { 0, 2, 4, 8 };
+
+	// Maps small negative and positive differences to small unsigned numbers
+	static uint32_t zigzag(uint32_t value)
+	{
+		return (value << 1) ^ (uint32_t)((int32_t)value >> 31);
+	}
+
+	static uint32_t unzigzag(uint32_t value)
+	{
+		return (value >> 1) ^ (0u - (value & 1));
+	}
+
+#ifndef CG_MESH_CODEC_SSE2
+	// Tables that expand one packed byte into 4 bytes of 2 bits or 2 bytes of 4 bits
+	struct UnpackTables
+	{
+		uint8_t bits2[256][4];
+		uint8_t bits4[256][2];
+
+		UnpackTables()
+		{
+			for (int b = 0; b < 256; ++b)
+			{
+				for (int k = 0; k < 4; ++k)
+				{
+					bits2[b][k] = (uint8_t)((b >> (2 * k)) & 3);
+				}
+				bits4[b][0] = (uint8_t)(b & 15);
+				bits4[b][1] = (uint8_t)(b >> 4);
+			}
+		}
+	};
+
+	static const UnpackTables unpackTables;
+#endif
+
+	void encodeIndices(const GLuint* indices, size_t count, std::vector<uint8_t>* out)
+	{
+		uint32_t previous = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t value = zigzag(indices[i] - previous);
+			previous = indices[i];
+
+			while (value >= 0x80)
+			{
+				out->push_back((uint8_t)(value | 0x80));
+				value >>= 7;
+			}
+			out->push_back((uint8_t)value);
+		}
+	}
+
+	bool decodeIndices(const uint8_t* data, size_t size, GLuint* indices, size_t count)
+	{
+		const uint8_t* end = data + size;
+		uint32_t previous = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (data == end)
+			{
+				return false;
+			}
+
+			// Most differences fit into one byte
+			uint32_t value = *data++;
+			if (value >= 0x80)
+			{
+				value &= 0x7f;
+				for (int shift = 7; ; shift += 7)
+				{
+					if (data == end || shift > 28)
+					{
+						return false;
+					}
+					uint8_t byte = *data++;
+					value |= (uint32_t)(byte & 0x7f) << shift;
+					if (byte < 0x80)
+					{
+						break;
+					}
+				}
+			}
+
+			previous += unzigzag(value);
+			indices[i] = previous;
+		}
+		return data == end;
+	}
+
+	// Appends the 2 bit modes of all groups and then the packed groups. <size> is a multiple of GROUP_SIZE.
+	static void encodePlane(const uint8_t* plane, size_t size, std::vector<uint8_t>* out)
+	{
+		size_t groups = size / GROUP_SIZE;
+		size_t header = out->size();
+		out->resize(header + (groups + 3) / 4, 0);
+
+		for (size_t g = 0; g < groups; ++g)
+		{
+			const uint8_t* group = plane + g * GROUP_SIZE;
+
+			// The or of all bytes has the highest bit of the largest one
+			uint8_t any = 0;
+			for (size_t j = 0; j < GROUP_SIZE; ++j)
+			{
+				any |= group[j];
+			}
+			unsigned int mode = any == 0 ? 0 : (any < 4 ? 1 : (any < 16 ? 2 : 3));
+			(*out)[header + g / 4] |= (uint8_t)(mode << (2 * (g % 4)));
+
+			unsigned int bits = GROUP_BITS[mode];
+			if (bits == 8)
+			{
+				out->insert(out->end(), group, group + GROUP_SIZE);
+			}
+			else if (bits > 0)
+			{
+				unsigned int perByte = 8 / bits;
+				for (size_t j = 0; j < GROUP_SIZE; j += perByte)
+				{
+					uint8_t packed = 0;
+					for (unsigned int k = 0; k < perByte; ++k)
+					{
+						packed |= (uint8_t)(group[j + k] << (k * bits));
+					}
+					out->push_back(packed);
+				}
+			}
+		}
+	}
+
+#ifdef CG_MESH_CODEC_SSE2
+	// Expands 4 packed bytes into the 16 bytes of a group with 2 bits each, the lowest bits come first
+	static void unpack2(const uint8_t* data, uint8_t* group)
+	{
+		uint32_t packed;
+		std::memcpy(&packed, data, 4);
+		const __m128i mask = _mm_set1_epi8(3);
+		__m128i v = _mm_cvtsi32_si128((int)packed);
+
+		// 16 bit shifts, the bits moved in from the next byte are masked away
+		__m128i b0 = _mm_and_si128(v, mask);
+		__m128i b1 = _mm_and_si128(_mm_srli_epi16(v, 2), mask);
+		__m128i b2 = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+		__m128i b3 = _mm_and_si128(_mm_srli_epi16(v, 6), mask);
+		__m128i b01 = _mm_unpacklo_epi8(b0, b1);
+		__m128i b23 = _mm_unpacklo_epi8(b2, b3);
+		_mm_storeu_si128((__m128i*)group, _mm_unpacklo_epi16(b01, b23));
+	}
+
+	// Expands 8 packed bytes into the 16 bytes of a group with 4 bits each, the low nibble comes first
+	static void unpack4(const uint8_t* data, uint8_t* group)
+	{
+		const __m128i mask = _mm_set1_epi8(15);
+		__m128i v = _mm_loadl_epi64((const __m128i*)data);
+		__m128i lo = _mm_and_si128(v, mask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+		_mm_storeu_si128((__m128i*)group, _mm_unpacklo_epi8(lo, hi));
+	}
+#else
+	static void unpack2(const uint8_t* data, uint8_t* group)
+	{
+		for (size_t j = 0; j < 4; ++j)
+		{
+			std::memcpy(group + j * 4, unpackTables.bits2[data[j]], 4);
+		}
+	}
+
+	static void unpack4(const uint8_t* data, uint8_t* group)
+	{
+		for (size_t j = 0; j < 8; ++j)
+		{
+			std::memcpy(group + j * 2, unpackTables.bits4[data[j]], 2);
+		}
+	}
+#endif
+
+	// Returns the position after the plane or nullptr if the data ends too early
+	static const uint8_t* decodePlane(const uint8_t* data, const uint8_t* end, uint8_t* plane, size_t size)
+	{
+		size_t groups = size / GROUP_SIZE;
+		size_t headerSize = (groups + 3) / 4;
+		if ((size_t)(end - data) < headerSize)
+		{
+			return nullptr;
+		}
+		const uint8_t* header = data;
+		data += headerSize;
+
+		for (size_t g = 0; g < groups; ++g)
+		{
+			uint8_t* group = plane + g * GROUP_SIZE;
+			switch ((header[g / 4] >> (2 * (g % 4))) & 3)
+			{
+			case 0:
+				std::memset(group, 0, GROUP_SIZE);
+				break;
+			case 1:
+				if (end - data < 4)
+				{
+					return nullptr;
+				}
+				unpack2(data, group);
+				data += 4;
+				break;
+			case 2:
+				if (end - data < 8)
+				{
+					return nullptr;
+				}
+				unpack4(data, group);
+				data += 8;
+				break;
+			default:
+				if ((size_t)(end - data) < GROUP_SIZE)
+				{
+					return nullptr;
+				}
+				std::memcpy(group, data, GROUP_SIZE);
+				data += GROUP_SIZE;
+				break;
+			}
+		}
+		return data;
+	}
+
+	// Puts the 4 byte planes of one word back together, undoes the zigzag and adds up the differences.
+	// <n> is a multiple of GROUP_SIZE, the padding differences are zero and do not change the sum.
+	static uint32_t joinWord(const uint8_t* planes, uint32_t* values, size_t n, uint32_t previous)
+	{
+		const uint8_t* b0 = planes;
+		const uint8_t* b1 = planes + BLOCK_SIZE;
+		const uint8_t* b2 = planes + 2 * BLOCK_SIZE;
+		const uint8_t* b3 = planes + 3 * BLOCK_SIZE;
+
+#ifdef CG_MESH_CODEC_SSE2
+		const __m128i one = _mm_set1_epi32(1);
+		__m128i sum = _mm_set1_epi32((int)previous);
+		for (size_t i = 0; i < n; i += GROUP_SIZE)
+		{
+			// Transpose 4 x 16 bytes into 16 words
+			__m128i p0 = _mm_loadu_si128((const __m128i*)(b0 + i));
+			__m128i p1 = _mm_loadu_si128((const __m128i*)(b1 + i));
+			__m128i p2 = _mm_loadu_si128((const __m128i*)(b2 + i));
+			__m128i p3 = _mm_loadu_si128((const __m128i*)(b3 + i));
+			__m128i lo01 = _mm_unpacklo_epi8(p0, p1);
+			__m128i hi01 = _mm_unpackhi_epi8(p0, p1);
+			__m128i lo23 = _mm_unpacklo_epi8(p2, p3);
+			__m128i hi23 = _mm_unpackhi_epi8(p2, p3);
+
+			__m128i words[4] = {
+				_mm_unpacklo_epi16(lo01, lo23), _mm_unpackhi_epi16(lo01, lo23),
+				_mm_unpacklo_epi16(hi01, hi23), _mm_unpackhi_epi16(hi01, hi23)
+			};
+
+			for (int k = 0; k < 4; ++k)
+			{
+				__m128i v = words[k];
+				v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+
+				// Prefix sum of the 4 differences plus the last sum
+				v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+				v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+				sum = _mm_add_epi32(v, _mm_shuffle_epi32(sum, _MM_SHUFFLE(3, 3, 3, 3)));
+				_mm_storeu_si128((__m128i*)(values + i + k * 4), sum);
+			}
+		}
+		return (uint32_t)_mm_cvtsi128_si32(_mm_shuffle_epi32(sum, _MM_SHUFFLE(3, 3, 3, 3)));
+#else
+		uint32_t value = previous;
+		for (size_t i = 0; i < n; ++i)
+		{
+			value += unzigzag(b0[i] | (b1[i] << 8) | (b2[i] << 16) | ((uint32_t)b3[i] << 24));
+			values[i] = value;
+		}
+		return value;
+#endif
+	}
+
+	// Rebuilds <n> elements from the planes of a block. A fixed WORDS lets the compiler unroll the copy, 0 is used for all other sizes.
+	template <size_t WORDS>
+	static void joinPlanes(const uint8_t* planes, uint32_t* wordPlanes, uint8_t* out, size_t n, size_t padded, size_t words, uint32_t* previous)
+	{
+		if constexpr (WORDS != 0)
+		{
+			words = WORDS;
+		}
+
+		for (size_t w = 0; w < words; ++w)
+		{
+			previous[w] = joinWord(planes + w * 4 * BLOCK_SIZE, wordPlanes + w * BLOCK_SIZE, padded, previous[w]);
+		}
+
+		size_t i = 0;
+#ifdef CG_MESH_CODEC_SSE2
+		// Transposes 4 elements at once
+		if constexpr (WORDS >= 2 && WORDS <= 4)
+		{
+			const uint32_t* x = wordPlanes;
+			const uint32_t* y = wordPlanes + BLOCK_SIZE;
+			for (; i + 4 <= n; i += 4)
+			{
+				__m128i* target = (__m128i*)(out + i * WORDS * 4);
+				__m128i vx = _mm_loadu_si128((const __m128i*)(x + i));
+				__m128i vy = _mm_loadu_si128((const __m128i*)(y + i));
+				if constexpr (WORDS == 2)
+				{
+					_mm_storeu_si128(target, _mm_unpacklo_epi32(vx, vy));
+					_mm_storeu_si128(target + 1, _mm_unpackhi_epi32(vx, vy));
+				}
+				else if constexpr (WORDS == 3)
+				{
+					// The float shuffles only move bits
+					__m128 fz = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(wordPlanes + 2 * BLOCK_SIZE + i)));
+					__m128 xy01 = _mm_castsi128_ps(_mm_unpacklo_epi32(vx, vy));
+					__m128 xy23 = _mm_castsi128_ps(_mm_unpackhi_epi32(vx, vy));
+					__m128 z01 = _mm_shuffle_ps(fz, xy01, _MM_SHUFFLE(3, 2, 1, 0));
+					__m128 z23 = _mm_shuffle_ps(fz, xy23, _MM_SHUFFLE(3, 2, 3, 2));
+					_mm_storeu_si128(target, _mm_castps_si128(_mm_shuffle_ps(xy01, z01, _MM_SHUFFLE(2, 0, 1, 0))));
+					_mm_storeu_si128(target + 1, _mm_castps_si128(_mm_shuffle_ps(z01, xy23, _MM_SHUFFLE(1, 0, 1, 3))));
+					_mm_storeu_si128(target + 2, _mm_castps_si128(_mm_shuffle_ps(z23, z23, _MM_SHUFFLE(1, 3, 2, 0))));
+				}
+				else
+				{
+					__m128i vz = _mm_loadu_si128((const __m128i*)(wordPlanes + 2 * BLOCK_SIZE + i));
+					__m128i vw = _mm_loadu_si128((const __m128i*)(wordPlanes + 3 * BLOCK_SIZE + i));
+					__m128i xy01 = _mm_unpacklo_epi32(vx, vy);
+					__m128i xy23 = _mm_unpackhi_epi32(vx, vy);
+					__m128i zw01 = _mm_unpacklo_epi32(vz, vw);
+					__m128i zw23 = _mm_unpackhi_epi32(vz, vw);
+					_mm_storeu_si128(target, _mm_unpacklo_epi64(xy01, zw01));
+					_mm_storeu_si128(target + 1, _mm_unpackhi_epi64(xy01, zw01));
+					_mm_storeu_si128(target + 2, _mm_unpacklo_epi64(xy23, zw23));
+					_mm_storeu_si128(target + 3, _mm_unpackhi_epi64(xy23, zw23));
+				}
+			}
+		}
+#endif
+
+		for (; i < n; ++i)
+		{
+			for (size_t w = 0; w < words; ++w)
+			{
+				std::memcpy(out + (i * words + w) * 4, &wordPlanes[w * BLOCK_SIZE + i], 4);
+			}
+		}
+	}
+
+	static bool isSupportedStride(size_t stride)
+	{
+		return stride > 0 && stride % 4 == 0 && stride <= MAX_STRIDE;
+	}
+
+	bool encodeVertices(const void* vertices, size_t count, size_t stride, std::vector<uint8_t>* out)
+	{
+		if (!isSupportedStride(stride))
+		{
+			return false;
+		}
+
+		const uint8_t* source = (const uint8_t*)vertices;
+		size_t words = stride / 4;
+		uint32_t previous[MAX_STRIDE / 4] = {};
+		std::vector<uint8_t> planes(stride * BLOCK_SIZE);
+
+		for (size_t first = 0; first < count; first += BLOCK_SIZE)
+		{
+			size_t n = std::min(BLOCK_SIZE, count - first);
+			size_t padded = (n + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+
+			// The padding of the last group is zero so it costs nothing
+			std::fill(planes.begin(), planes.end(), (uint8_t)0);
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				const uint8_t* element = source + (first + i) * stride;
+				for (size_t w = 0; w < words; ++w)
+				{
+					uint32_t word;
+					std::memcpy(&word, element + w * 4, 4);
+					uint32_t delta = zigzag(word - previous[w]);
+					previous[w] = word;
+
+					for (size_t b = 0; b < 4; ++b)
+					{
+						planes[(w * 4 + b) * BLOCK_SIZE + i] = (uint8_t)(delta >> (8 * b));
+					}
+				}
+			}
+
+			for (size_t p = 0; p < stride; ++p)
+			{
+				encodePlane(&planes[p * BLOCK_SIZE], padded, out);
+			}
+		}
+		return true;
+	}
+
+	bool decodeVertices(const uint8_t* data, size_t size, void* vertices, size_t count, size_t stride)
+	{
+		if (!isSupportedStride(stride))
+		{
+			return false;
+		}
+
+		const uint8_t* end = data + size;
+		uint8_t* target = (uint8_t*)vertices;
+		size_t words = stride / 4;
+		uint32_t previous[MAX_STRIDE / 4] = {};
+		std::vector<uint8_t> planes(stride * BLOCK_SIZE);
+		std::vector<uint32_t> wordPlanes(words * BLOCK_SIZE);
+
+		for (size_t first = 0; first < count; first += BLOCK_SIZE)
+		{
+			size_t n = std::min(BLOCK_SIZE, count - first);
+			size_t padded = (n + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+
+			for (size_t p = 0; p < stride; ++p)
+			{
+				data = decodePlane(data, end, &planes[p * BLOCK_SIZE], padded);
+				if (data == nullptr)
+				{
+					return false;
+				}
+			}
+
+			uint8_t* out = target + first * stride;
+			switch (words)
+			{
+			case 2: joinPlanes<2>(planes.data(), wordPlanes.data(), out, n, padded, words, previous); break;
+			case 3: joinPlanes<3>(planes.data(), wordPlanes.data(), out, n, padded, words, previous); break;
+			case 4: joinPlanes<4>(planes.data(), wordPlanes.data(), out, n, padded, words, previous); break;
+			default: joinPlanes<0>(planes.data(), wordPlanes.data(), out, n, padded, words, previous); break;
+			}
+		}
+		return data == end;
+	}
+}
@@ -1,45 +1,393 @@
 #include "CG/MeshGLInfo.h"
+#include "CG/CookedMesh.h"
+#include "CG/GLBFile.h"
 
 #include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
 
 namespace cg
 {
 	MeshGLInfo::MeshGLInfo()
 	{
-		glGenBuffers(1, &m_positionBuffer);
-		glGenBuffers(1, &m_colorBuffer);
-		glGenBuffers(1, &m_normalBuffer);
-		glGenBuffers(1, &m_indexBuffer);
+
 	}
 
 	MeshGLInfo::~MeshGLInfo()
 	{
-		glDeleteBuffers(1, &m_indexBuffer);
-		glDeleteBuffers(1, &m_normalBuffer);
-		glDeleteBuffers(1, &m_colorBuffer);
-		glDeleteBuffers(1, &m_positionBuffer);
+		// Only the buffers that were created, prepared meshes that never got any may die on a thread without GL context
+		for (GLuint buffer : { m_indexBuffer, m_normalBuffer, m_colorBuffer, m_positionBuffer })
+		{
+			if (buffer != 0)
+			{
+				glDeleteBuffers(1, &buffer);
+			}
+		}
+	}
+
+	GLuint MeshGLInfo::genBuffer(BufferSlot slot)
+	{
+		GLuint* buffer = &m_positionBuffer;
+		switch (slot)
+		{
+		case BufferSlot::COLOR:
+			buffer = &m_colorBuffer;
+			break;
+		case BufferSlot::NORMAL:
+			buffer = &m_normalBuffer;
+			break;
+		case BufferSlot::INDEX:
+			buffer = &m_indexBuffer;
+			break;
+		default:
+			break;
+		}
+
+		if (*buffer == 0)
+		{
+			glGenBuffers(1, buffer);
+		}
+		return *buffer;
+	}
+
+	// Interleaves <meshData> into <Format> and takes the formats of its attributes
+	template <typename Format, typename Position, typename Normal, typename Color>
+	static std::vector<unsigned char> interleaveAs(const MeshData& meshData, const PositionQuantization& quantization, VertexAttribFormat formats[3])
+	{
+		formats[0] = Format::template getFormat<Position>();
+		formats[1] = Format::template getFormat<Normal>();
+		formats[2] = Format::template getFormat<Color>();
+		return Format::interleave(meshData, quantization);
+	}
+
+	// Interleaves the attributes <meshData> stores per vertex, constant ones are left out
+	template <typename Position, typename Normal, typename Color>
+	static std::vector<unsigned char> interleaveStored(const MeshData& meshData, const PositionQuantization& quantization, VertexAttribFormat formats[3])
+	{
+		bool normals = !meshData.normals.empty();
+		bool colors = !meshData.colors.empty();
+		if (normals && colors)
+		{
+			return interleaveAs<VertexFormat<Position, Normal, Color>, Position, Normal, Color>(meshData, quantization, formats);
+		}
+		if (normals)
+		{
+			return interleaveAs<VertexFormat<Position, Normal>, Position, Normal, Color>(meshData, quantization, formats);
+		}
+		if (colors)
+		{
+			return interleaveAs<VertexFormat<Position, Color>, Position, Normal, Color>(meshData, quantization, formats);
+		}
+		return interleaveAs<VertexFormat<Position>, Position, Normal, Color>(meshData, quantization, formats);
+	}
+
+	void MeshGLInfo::listBuffers(const MeshData& meshData, VertexLayout layout, std::vector<BufferUpload>* uploads)
+	{
+        m_layout = layout;
+        m_positionTransform = glm::mat4(1.0f);
+        m_normalConstant = meshData.normals.empty();
+        m_colorConstant = meshData.colors.empty();
+        m_constantNormal = meshData.constantNormal;
+        m_constantColor = meshData.constantColor;
+
+        uploads->clear();
+        if (layout != VertexLayout::SPLIT)
+        {
+            VertexAttribFormat formats[3];
+            std::vector<unsigned char> data;
+            if (layout == VertexLayout::QUANTIZED)
+            {
+                PositionQuantization quantization = PositionQuantization::fit(meshData);
+                m_positionTransform = quantization.getTransform();
+                data = interleaveStored<PosQ16, NormalQ10, Color4ub>(meshData, quantization, formats);
+            }
+            else
+            {
+                data = interleaveStored<Pos3f, Normal3f, Color3f>(meshData, PositionQuantization(), formats);
+            }
+            m_positionFormat = formats[0];
+            m_normalFormat = formats[1];
+            m_colorFormat = formats[2];
+
+            auto vertices = std::make_shared<std::vector<unsigned char>>(std::move(data));
+            uploads->push_back({ GL_ARRAY_BUFFER, BufferSlot::POSITION, 0, vertices->data(), vertices->size(), vertices });
+        }
+        else
+        {
+            m_positionFormat = VertexAttribFormat();
+            m_normalFormat = VertexAttribFormat();
+            m_colorFormat = VertexAttribFormat();
+
+            uploads->push_back({ GL_ARRAY_BUFFER, BufferSlot::POSITION, 0, meshData.vertices.data(), meshData.vertices.size() * sizeof(glm::vec3), nullptr });
+            if (!m_colorConstant)
+            {
+                uploads->push_back({ GL_ARRAY_BUFFER, BufferSlot::COLOR, 0, meshData.colors.data(), meshData.colors.size() * sizeof(glm::vec3), nullptr });
+            }
+            if (!m_normalConstant)
+            {
+                uploads->push_back({ GL_ARRAY_BUFFER, BufferSlot::NORMAL, 0, meshData.normals.data(), meshData.normals.size() * sizeof(glm::vec3), nullptr });
+            }
+        }
+
+        if (meshData.indexType == GL_UNSIGNED_SHORT)
+        {
+            // Narrow to 16-bit, the caller made sure all indices fit
+            auto shortIndices = std::make_shared<std::vector<GLushort>>(meshData.indices.begin(), meshData.indices.end());
+            uploads->push_back({ GL_ELEMENT_ARRAY_BUFFER, BufferSlot::INDEX, 0, shortIndices->data(), shortIndices->size() * sizeof(GLushort), shortIndices });
+        }
+        else
+        {
+            uploads->push_back({ GL_ELEMENT_ARRAY_BUFFER, BufferSlot::INDEX, 0, meshData.indices.data(), meshData.indices.size() * sizeof(GLuint), nullptr });
+        }
+
+        m_drawAmount = meshData.indices.size();
+        m_drawMode = meshData.drawMode;
+        m_indexType = meshData.indexType;
+        m_materials = meshData.materials;
+        m_subMeshes = meshData.subMeshes;
+        m_meshlets = meshData.meshlets;
+	}
+
+	// Bytes from one element of <format> to the next
+	static size_t getElementSize(const VertexAttribFormat& format)
+	{
+        if (format.stride != 0)
+        {
+            return format.stride;
+        }
+        switch (format.type)
+        {
+        case GL_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_2_10_10_10_REV:
+            return 4;
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return format.components;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return format.components * 2;
+        default:
+            return format.components * 4;
+        }
+	}
+
+	size_t MeshGLInfo::getVertexSize() const
+	{
+        if (m_layout != VertexLayout::SPLIT)
+        {
+            return m_positionFormat.stride;
+        }
+        return getElementSize(m_positionFormat) + (m_normalConstant ? 0 : getElementSize(m_normalFormat)) + (m_colorConstant ? 0 : getElementSize(m_colorFormat));
+	}
+
+	std::shared_ptr<MeshGLInfo> MeshGLInfo::generate(const MeshData& meshData, VertexLayout layout)
+	{
+        std::vector<BufferUpload> uploads;
+        std::shared_ptr<MeshGLInfo> info = prepare(meshData, &uploads, layout);
+
+        for (BufferUpload& upload : uploads)
+        {
+            upload.buffer = info->genBuffer(upload.slot);
+            glBindBuffer(upload.target, upload.buffer);
+            glBufferData(upload.target, upload.size, upload.data, GL_STATIC_DRAW);
+        }
+
+        return info;
 	}
 
-	std::shared_ptr<MeshGLInfo> MeshGLInfo::generate(const MeshData& meshData)
+	std::shared_ptr<MeshGLInfo> MeshGLInfo::prepare(const MeshData& meshData, std::vector<BufferUpload>* uploads, VertexLayout layout)
 	{
         std::shared_ptr<MeshGLInfo> info = std::make_shared<MeshGLInfo>();
+        info->listBuffers(meshData, layout, uploads);
+        return info;
+	}
 
+	void MeshGLInfo::createBuffers(std::vector<BufferUpload>* uploads)
+	{
+        for (BufferUpload& upload : *uploads)
+        {
+            upload.buffer = genBuffer(upload.slot);
+            glBindBuffer(upload.target, upload.buffer);
+            glBufferData(upload.target, upload.size, nullptr, GL_STATIC_DRAW);
+        }
+	}
 
-        glBindBuffer(GL_ARRAY_BUFFER, info->m_positionBuffer);
-        glBufferData(GL_ARRAY_BUFFER, meshData.vertices.size() * sizeof(glm::vec3), meshData.vertices.data(), GL_STATIC_DRAW);
+	std::shared_ptr<MeshGLInfo> MeshGLInfo::generate(const CookedMesh& cookedMesh, float scale)
+	{
+        std::shared_ptr<MeshGLInfo> info = std::make_shared<MeshGLInfo>();
 
-		glBindBuffer(GL_ARRAY_BUFFER, info->m_colorBuffer);
-		glBufferData(GL_ARRAY_BUFFER, meshData.colors.size() * sizeof(glm::vec3), meshData.colors.data(), GL_STATIC_DRAW);
+        const BufferSlot slots[CookedMesh::STREAM_COUNT] = { BufferSlot::POSITION, BufferSlot::NORMAL, BufferSlot::COLOR, BufferSlot::INDEX };
+        for (int s = 0; s < CookedMesh::STREAM_COUNT; ++s)
+        {
+            // Straight from the mapped file
+            CookedMesh::StreamView stream = cookedMesh.getStream((CookedMesh::Stream)s);
+            if (stream.size == 0 && s != CookedMesh::INDEX)
+            {
+                // Constant attribute
+                continue;
+            }
+            GLenum target = s == CookedMesh::INDEX ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+            glBindBuffer(target, info->genBuffer(slots[s]));
+            glBufferData(target, stream.size, stream.data, GL_STATIC_DRAW);
+        }
 
-		glBindBuffer(GL_ARRAY_BUFFER, info->m_normalBuffer);
-		glBufferData(GL_ARRAY_BUFFER, meshData.normals.size() * sizeof(glm::vec3), meshData.normals.data(), GL_STATIC_DRAW);
+        info->m_positionFormat = cookedMesh.getStream(CookedMesh::POSITION).format;
+        info->m_normalFormat = cookedMesh.getStream(CookedMesh::NORMAL).format;
+        info->m_colorFormat = cookedMesh.getStream(CookedMesh::COLOR).format;
+        info->m_normalConstant = cookedMesh.getStream(CookedMesh::NORMAL).size == 0;
+        info->m_colorConstant = cookedMesh.getStream(CookedMesh::COLOR).size == 0;
+        info->m_constantNormal = cookedMesh.getConstantNormal();
+        info->m_constantColor = cookedMesh.getConstantColor();
+        info->m_positionTransform = glm::scale(glm::mat4(1.0f), glm::vec3(scale)) * cookedMesh.getPositionTransform();
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, info->m_indexBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshData.indices.size() * sizeof(GLushort), meshData.indices.data(), GL_STATIC_DRAW);
+        info->m_drawAmount = cookedMesh.getIndexCount();
+        info->m_drawMode = cookedMesh.getDrawMode();
+        info->m_indexType = cookedMesh.getIndexType();
 
-		info->m_drawAmount = meshData.indices.size();
-		info->m_drawMode = meshData.drawMode;
+        info->m_materials = cookedMesh.getMaterials();
+        info->m_subMeshes = cookedMesh.getSubMeshes();
+        for (SubMesh& subMesh : info->m_subMeshes)
+        {
+            subMesh.boundsMin *= scale;
+            subMesh.boundsMax *= scale;
+        }
 
         return info;
 	}
-}
\ No newline at end of file
+
+	static void uploadBuffer(GLenum target, GLuint buffer, const void* data, size_t size)
+	{
+        glBindBuffer(target, buffer);
+        glBufferData(target, size, data, GL_STATIC_DRAW);
+	}
+
+	// Widens 8- or 16-bit glTF indices, a primitive without indices gets 0, 1, 2, ...
+	template <typename T>
+	static std::vector<T> widenIndices(const GLBFile::AccessorView& index, size_t vertexCount)
+	{
+        std::vector<T> indices(index.isEmpty() ? vertexCount : index.count);
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            if (index.isEmpty())
+            {
+                indices[i] = (T)i;
+            }
+            else if (index.format.type == GL_UNSIGNED_BYTE)
+            {
+                indices[i] = ((const uint8_t*)index.data)[i];
+            }
+            else
+            {
+                indices[i] = ((const uint16_t*)index.data)[i];
+            }
+        }
+        return indices;
+	}
+
+	std::shared_ptr<MeshGLInfo> MeshGLInfo::generate(const GLBFile& file, size_t mesh, size_t primitive)
+	{
+        std::shared_ptr<MeshGLInfo> info = std::make_shared<MeshGLInfo>();
+        const GLBFile::Primitive& source = file.getMeshes()[mesh].primitives[primitive];
+        size_t vertexCount = source.position.count;
+
+        Material material;
+        material.diffuse = glm::vec3(1.0f);
+        if (source.material != SubMesh::NO_MATERIAL)
+        {
+            material = file.getMaterials()[source.material];
+        }
+
+        uploadBuffer(GL_ARRAY_BUFFER, info->genBuffer(BufferSlot::POSITION), source.position.data, source.position.size);
+        info->m_positionFormat = source.position.format;
+
+        if (!source.normal.isEmpty())
+        {
+            uploadBuffer(GL_ARRAY_BUFFER, info->genBuffer(BufferSlot::NORMAL), source.normal.data, source.normal.size);
+            info->m_normalFormat = source.normal.format;
+        }
+        else
+        {
+            // Flat normals would need vertices that are not shared between triangles
+            info->m_normalConstant = true;
+            info->m_constantNormal = glm::vec3(0.0f, 0.0f, 1.0f);
+        }
+
+        if (!source.color.isEmpty())
+        {
+            uploadBuffer(GL_ARRAY_BUFFER, info->genBuffer(BufferSlot::COLOR), source.color.data, source.color.size);
+            info->m_colorFormat = source.color.format;
+        }
+        else
+        {
+            info->m_colorConstant = true;
+            info->m_constantColor = material.diffuse;
+        }
+
+        // 0xFFFF is kept free for primitive restart, see MeshData::MAX_SHORT_INDEX_VERTICES
+        bool shortIndices = vertexCount <= MeshData::MAX_SHORT_INDEX_VERTICES;
+        const GLBFile::AccessorView& index = source.index;
+        if (!index.isEmpty() && (index.format.type == GL_UNSIGNED_INT || (index.format.type == GL_UNSIGNED_SHORT && shortIndices)))
+        {
+            uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, info->genBuffer(BufferSlot::INDEX), index.data, index.size);
+            info->m_indexType = index.format.type;
+            info->m_drawAmount = (GLuint)index.count;
+        }
+        else if (shortIndices)
+        {
+            std::vector<GLushort> indices = widenIndices<GLushort>(index, vertexCount);
+            uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, info->genBuffer(BufferSlot::INDEX), indices.data(), indices.size() * sizeof(GLushort));
+            info->m_indexType = GL_UNSIGNED_SHORT;
+            info->m_drawAmount = (GLuint)indices.size();
+        }
+        else
+        {
+            std::vector<GLuint> indices = widenIndices<GLuint>(index, vertexCount);
+            uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, info->genBuffer(BufferSlot::INDEX), indices.data(), indices.size() * sizeof(GLuint));
+            info->m_indexType = GL_UNSIGNED_INT;
+            info->m_drawAmount = (GLuint)indices.size();
+        }
+
+        info->m_drawMode = source.drawMode;
+
+        // The whole primitive is one range, so the material is set by Scene like for OBJ files
+        SubMesh subMesh;
+        subMesh.name = file.getMeshes()[mesh].name;
+        subMesh.material = 0;
+        subMesh.indexCount = info->m_drawAmount;
+        subMesh.boundsMin = source.boundsMin;
+        subMesh.boundsMax = source.boundsMax;
+        info->m_materials.push_back(material);
+        info->m_subMeshes.push_back(subMesh);
+
+        return info;
+	}
+
+	void MeshGLInfo::swap(MeshGLInfo& other)
+	{
+        std::swap(m_positionBuffer, other.m_positionBuffer);
+        std::swap(m_colorBuffer, other.m_colorBuffer);
+        std::swap(m_normalBuffer, other.m_normalBuffer);
+        std::swap(m_indexBuffer, other.m_indexBuffer);
+
+        std::swap(m_drawMode, other.m_drawMode);
+        std::swap(m_indexType, other.m_indexType);
+        std::swap(m_layout, other.m_layout);
+        std::swap(m_normalConstant, other.m_normalConstant);
+        std::swap(m_colorConstant, other.m_colorConstant);
+        std::swap(m_constantNormal, other.m_constantNormal);
+        std::swap(m_constantColor, other.m_constantColor);
+
+        std::swap(m_positionFormat, other.m_positionFormat);
+        std::swap(m_colorFormat, other.m_colorFormat);
+        std::swap(m_normalFormat, other.m_normalFormat);
+        std::swap(m_positionTransform, other.m_positionTransform);
+
+        std::swap(m_materials, other.m_materials);
+        std::swap(m_subMeshes, other.m_subMeshes);
+        std::swap(m_meshlets, other.m_meshlets);
+        std::swap(m_drawAmount, other.m_drawAmount);
+
+        m_revision++;
+        other.m_revision++;
+	}
+}
@@ -0,0 +1,1003 @@
+#include "CG/MeshImporter.h"
+#include "CG/MappedFile.h"
+#include "CG/MeshArena.h"
+#include "CG/MeshletBuilder.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <bit>
+#include <charconv>
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+
+namespace cg
+{
+	// Binary STL: 80 byte header, triangle count, 50 bytes per triangle
+	static const size_t STL_HEADER_SIZE = 84;
+	static const size_t STL_TRIANGLE_SIZE = 50;
+
+	// Color of vertices without one, the same as for OBJ files
+	static const glm::vec3 DEFAULT_COLOR(0.8f, 0.1f, 0.1f);
+
+	// Cosine of the largest angle between two STL triangles that are still shaded as one smooth surface, about 40 degrees.
+	// Edges of CAD parts are usually 90 degrees, the facets of their curved surfaces far less than that.
+	static const float STL_CREASE_COS = 0.766f;
+
+	enum class PLYType : uint8_t
+	{
+		NONE,
+		INT8,
+		UINT8,
+		INT16,
+		UINT16,
+		INT32,
+		UINT32,
+		FLOAT32,
+		FLOAT64
+	};
+
+	struct PLYProperty
+	{
+		std::string name;
+		PLYType type = PLYType::NONE;
+
+		// Type of the element count of a list property, NONE for scalars
+		PLYType countType = PLYType::NONE;
+
+		// Offset in the element, only for elements without lists
+		size_t offset = 0;
+	};
+
+	struct PLYElement
+	{
+		std::string name;
+		size_t count = 0;
+		std::vector<PLYProperty> properties;
+
+		// Bytes per element, 0 if it has list properties and every element has its own size
+		size_t size = 0;
+
+		const PLYProperty* find(std::string_view property) const
+		{
+			for (const PLYProperty& p : properties)
+			{
+				if (p.name == property)
+				{
+					return &p;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	static size_t getTypeSize(PLYType type)
+	{
+		switch (type)
+		{
+		case PLYType::INT8:
+		case PLYType::UINT8:
+			return 1;
+		case PLYType::INT16:
+		case PLYType::UINT16:
+			return 2;
+		case PLYType::INT32:
+		case PLYType::UINT32:
+		case PLYType::FLOAT32:
+			return 4;
+		case PLYType::FLOAT64:
+			return 8;
+		default:
+			return 0;
+		}
+	}
+
+	static PLYType parsePLYType(std::string_view name)
+	{
+		static const std::pair<std::string_view, PLYType> TYPES[] =
+		{
+			{ "char", PLYType::INT8 }, { "int8", PLYType::INT8 },
+			{ "uchar", PLYType::UINT8 }, { "uint8", PLYType::UINT8 },
+			{ "short", PLYType::INT16 }, { "int16", PLYType::INT16 },
+			{ "ushort", PLYType::UINT16 }, { "uint16", PLYType::UINT16 },
+			{ "int", PLYType::INT32 }, { "int32", PLYType::INT32 },
+			{ "uint", PLYType::UINT32 }, { "uint32", PLYType::UINT32 },
+			{ "float", PLYType::FLOAT32 }, { "float32", PLYType::FLOAT32 },
+			{ "double", PLYType::FLOAT64 }, { "float64", PLYType::FLOAT64 },
+		};
+		for (const auto& type : TYPES)
+		{
+			if (type.first == name)
+			{
+				return type.second;
+			}
+		}
+		return PLYType::NONE;
+	}
+
+	// Value of type <T> at <p>, byte swapped if the file has the other byte order than this machine
+	template <typename T, bool SWAP>
+	static T loadValue(const uint8_t* p)
+	{
+		uint8_t bytes[sizeof(T)];
+		std::memcpy(bytes, p, sizeof(T));
+		if constexpr (SWAP)
+		{
+			for (size_t i = 0; i < sizeof(T) / 2; ++i)
+			{
+				std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+			}
+		}
+		T value;
+		std::memcpy(&value, bytes, sizeof(T));
+		return value;
+	}
+
+	template <bool SWAP>
+	static double loadPLYValue(const uint8_t* p, PLYType type)
+	{
+		switch (type)
+		{
+		case PLYType::INT8: return (int8_t)p[0];
+		case PLYType::UINT8: return p[0];
+		case PLYType::INT16: return loadValue<int16_t, SWAP>(p);
+		case PLYType::UINT16: return loadValue<uint16_t, SWAP>(p);
+		case PLYType::INT32: return loadValue<int32_t, SWAP>(p);
+		case PLYType::UINT32: return loadValue<uint32_t, SWAP>(p);
+		case PLYType::FLOAT32: return loadValue<float, SWAP>(p);
+		default: return loadValue<double, SWAP>(p);
+		}
+	}
+
+	static double loadPLYValue(const uint8_t* p, PLYType type, bool swap)
+	{
+		return swap ? loadPLYValue<true>(p, type) : loadPLYValue<false>(p, type);
+	}
+
+	// Largest value of an integer type, colors are normalized by it
+	static float getTypeMax(PLYType type)
+	{
+		switch (type)
+		{
+		case PLYType::INT8: return 127.0f;
+		case PLYType::UINT8: return 255.0f;
+		case PLYType::INT16: return 32767.0f;
+		case PLYType::UINT16: return 65535.0f;
+		case PLYType::INT32: return 2147483647.0f;
+		case PLYType::UINT32: return 4294967295.0f;
+		default: return 1.0f;
+		}
+	}
+
+	// One component of every vertex: <count> values of type <T>, <stride> bytes apart, into every third float of <out>.
+	// One loop per type and byte order, without branches the compiler can vectorize it.
+	template <typename T, bool SWAP>
+	static void gatherComponent(const uint8_t* data, size_t stride, size_t count, float factor, float* out)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			out[i * 3] = (float)loadValue<T, SWAP>(data + i * stride) * factor;
+		}
+	}
+
+	template <bool SWAP>
+	static void gatherComponent(const uint8_t* data, size_t stride, size_t count, PLYType type, float factor, float* out)
+	{
+		switch (type)
+		{
+		case PLYType::INT8: gatherComponent<int8_t, SWAP>(data, stride, count, factor, out); break;
+		case PLYType::UINT8: gatherComponent<uint8_t, SWAP>(data, stride, count, factor, out); break;
+		case PLYType::INT16: gatherComponent<int16_t, SWAP>(data, stride, count, factor, out); break;
+		case PLYType::UINT16: gatherComponent<uint16_t, SWAP>(data, stride, count, factor, out); break;
+		case PLYType::INT32: gatherComponent<int32_t, SWAP>(data, stride, count, factor, out); break;
+		case PLYType::UINT32: gatherComponent<uint32_t, SWAP>(data, stride, count, factor, out); break;
+		case PLYType::FLOAT32: gatherComponent<float, SWAP>(data, stride, count, factor, out); break;
+		default: gatherComponent<double, SWAP>(data, stride, count, factor, out); break;
+		}
+	}
+
+	// Reads the properties <names> of all vertices into <out>, false if the element does not have all three
+	static bool gatherVec3(const PLYElement& element, const uint8_t* data, const char* const names[3], bool swap, bool normalize, float scale, std::vector<glm::vec3>* out)
+	{
+		const PLYProperty* properties[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			properties[c] = element.find(names[c]);
+			if (properties[c] == nullptr || properties[c]->countType != PLYType::NONE)
+			{
+				return false;
+			}
+		}
+
+		out->resize(element.count);
+		if (element.count == 0)
+		{
+			return true;
+		}
+		for (int c = 0; c < 3; ++c)
+		{
+			const PLYProperty& property = *properties[c];
+			float factor = normalize ? scale / getTypeMax(property.type) : scale;
+			float* components = &(*out)[0][c];
+			if (swap)
+			{
+				gatherComponent<true>(data + property.offset, element.size, element.count, property.type, factor, components);
+			}
+			else
+			{
+				gatherComponent<false>(data + property.offset, element.size, element.count, property.type, factor, components);
+			}
+		}
+		return true;
+	}
+
+	// Splits a polygon into a triangle fan. Polygons with an index past the vertices are skipped.
+	static void addPolygon(const GLuint* polygon, size_t size, size_t vertexCount, std::vector<GLuint>* indices, size_t* skippedFaces)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			if (polygon[i] >= vertexCount)
+			{
+				(*skippedFaces)++;
+				return;
+			}
+		}
+		for (size_t i = 2; i < size; ++i)
+		{
+			indices->push_back(polygon[0]);
+			indices->push_back(polygon[i - 1]);
+			indices->push_back(polygon[i]);
+		}
+	}
+
+	// Faces whose only property is a list with a uchar count and 32-bit indices, what nearly every exporter writes.
+	// Returns the bytes read, 0 if the data ends early.
+	template <typename I, bool SWAP>
+	static size_t readFaceLists(const uint8_t* data, size_t size, size_t faceCount, size_t vertexCount, std::vector<GLuint>* indices, size_t* corners, size_t* skippedFaces)
+	{
+		const uint8_t* p = data;
+		const uint8_t* end = data + size;
+		GLuint polygon[256];
+		for (size_t f = 0; f < faceCount; ++f)
+		{
+			if (p == end)
+			{
+				return 0;
+			}
+			size_t n = *p++;
+			if ((size_t)(end - p) < n * sizeof(I))
+			{
+				return 0;
+			}
+
+			// Negative indices become huge and are skipped with their face
+			if (n == 3)
+			{
+				// Fixed size, otherwise the copy of the native byte order becomes a rep movs per face
+				GLuint a = (GLuint)loadValue<I, SWAP>(p);
+				GLuint b = (GLuint)loadValue<I, SWAP>(p + sizeof(I));
+				GLuint c = (GLuint)loadValue<I, SWAP>(p + 2 * sizeof(I));
+				if (a < vertexCount && b < vertexCount && c < vertexCount)
+				{
+					indices->push_back(a);
+					indices->push_back(b);
+					indices->push_back(c);
+				}
+				else
+				{
+					(*skippedFaces)++;
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < n; ++i)
+				{
+					polygon[i] = (GLuint)loadValue<I, SWAP>(p + i * sizeof(I));
+				}
+				addPolygon(polygon, n, vertexCount, indices, skippedFaces);
+			}
+			*corners += n;
+			p += n * sizeof(I);
+		}
+		return p - data;
+	}
+
+	// Fewest bytes an element with list properties can take, every list empty
+	static size_t getMinElementSize(const PLYElement& element)
+	{
+		size_t size = 0;
+		for (const PLYProperty& property : element.properties)
+		{
+			size += getTypeSize(property.countType != PLYType::NONE ? property.countType : property.type);
+		}
+		return size;
+	}
+
+	// Size of the element at <p> with list properties, 0 if it does not fit into <size> bytes.
+	// Fills <polygon> with the list <indexProperty> if it is set.
+	static size_t readElement(const PLYElement& element, const uint8_t* p, size_t size, bool swap, const PLYProperty* indexProperty, std::vector<GLuint>* polygon)
+	{
+		size_t offset = 0;
+		for (const PLYProperty& property : element.properties)
+		{
+			size_t typeSize = getTypeSize(property.type);
+			size_t count = 1;
+			if (property.countType != PLYType::NONE)
+			{
+				size_t countSize = getTypeSize(property.countType);
+				if (size - offset < countSize)
+				{
+					return 0;
+				}
+				double value = loadPLYValue(p + offset, property.countType, swap);
+				count = value > 0.0 ? (size_t)value : 0;
+				offset += countSize;
+			}
+			if (count > (size - offset) / typeSize)
+			{
+				return 0;
+			}
+
+			if (&property == indexProperty)
+			{
+				polygon->resize(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					double index = loadPLYValue(p + offset + i * typeSize, property.type, swap);
+					(*polygon)[i] = index >= 0.0 && index < 4294967295.0 ? (GLuint)index : ~0u;
+				}
+			}
+			offset += count * typeSize;
+		}
+		return offset;
+	}
+
+	// Splits the header into elements, <dataOffset> receives the start of the binary data
+	static bool parsePLYHeader(std::string_view text, std::vector<PLYElement>* elements, bool* bigEndian, size_t* dataOffset, std::string* error)
+	{
+		size_t position = 0;
+		bool formatSeen = false;
+		std::vector<std::string_view> words;
+		while (position < text.size())
+		{
+			size_t end = text.find('\n', position);
+			if (end == std::string_view::npos)
+			{
+				break;
+			}
+			std::string_view line = text.substr(position, end - position);
+			position = end + 1;
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+
+			words.clear();
+			for (size_t w = 0; w < line.size(); )
+			{
+				size_t next = line.find(' ', w);
+				next = next == std::string_view::npos ? line.size() : next;
+				if (next > w)
+				{
+					words.push_back(line.substr(w, next - w));
+				}
+				w = next + 1;
+			}
+			if (words.empty())
+			{
+				continue;
+			}
+
+			if (words[0] == "end_header")
+			{
+				if (!formatSeen)
+				{
+					break;
+				}
+				*dataOffset = position;
+				return true;
+			}
+			else if (words[0] == "format" && words.size() >= 2)
+			{
+				if (words[1] == "ascii")
+				{
+					*error = "ASCII PLY files are not supported, only binary ones";
+					return false;
+				}
+				if (words[1] != "binary_little_endian" && words[1] != "binary_big_endian")
+				{
+					break;
+				}
+				*bigEndian = words[1] == "binary_big_endian";
+				formatSeen = true;
+			}
+			else if (words[0] == "element" && words.size() == 3)
+			{
+				PLYElement element;
+				element.name = words[1];
+				auto [ptr, ec] = std::from_chars(words[2].data(), words[2].data() + words[2].size(), element.count);
+				if (ec != std::errc())
+				{
+					break;
+				}
+				elements->push_back(element);
+			}
+			else if (words[0] == "property" && !elements->empty())
+			{
+				PLYProperty property;
+				if (words.size() == 3)
+				{
+					property.type = parsePLYType(words[1]);
+				}
+				else if (words.size() == 5 && words[1] == "list")
+				{
+					property.countType = parsePLYType(words[2]);
+					property.type = parsePLYType(words[3]);
+					if (property.countType == PLYType::NONE || property.countType == PLYType::FLOAT32 || property.countType == PLYType::FLOAT64)
+					{
+						break;
+					}
+				}
+				if (property.type == PLYType::NONE)
+				{
+					break;
+				}
+				property.name = words.back();
+				elements->back().properties.push_back(property);
+			}
+			else if (words[0] != "ply" && words[0] != "comment" && words[0] != "obj_info")
+			{
+				break;
+			}
+		}
+
+		if (error->empty())
+		{
+			*error = "broken PLY header";
+		}
+		return false;
+	}
+
+	static void calculateNormals(MeshData* meshData)
+	{
+		meshData->normals.assign(meshData->vertices.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < meshData->indices.size(); i += 3)
+		{
+			GLuint a = meshData->indices[i];
+			GLuint b = meshData->indices[i + 1];
+			GLuint c = meshData->indices[i + 2];
+
+			// Not normalized, so larger triangles weigh more
+			glm::vec3 n = glm::cross(meshData->vertices[b] - meshData->vertices[a], meshData->vertices[c] - meshData->vertices[a]);
+			meshData->normals[a] += n;
+			meshData->normals[b] += n;
+			meshData->normals[c] += n;
+		}
+		for (glm::vec3& n : meshData->normals)
+		{
+			float length = glm::length(n);
+			n = length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+	}
+
+	static bool readPLY(const uint8_t* data, size_t size, float scale, MeshData* meshData, OBJLoadStats* stats)
+	{
+		std::vector<PLYElement> elements;
+		bool bigEndian = false;
+		size_t offset = 0;
+		if (!parsePLYHeader(std::string_view((const char*)data, size), &elements, &bigEndian, &offset, &stats->error))
+		{
+			return false;
+		}
+		bool swap = bigEndian != (std::endian::native == std::endian::big);
+
+		// Offsets of elements without lists, so their properties can be gathered with a stride
+		for (PLYElement& element : elements)
+		{
+			for (PLYProperty& property : element.properties)
+			{
+				if (property.countType != PLYType::NONE)
+				{
+					element.size = 0;
+					break;
+				}
+				property.offset = element.size;
+				element.size += getTypeSize(property.type);
+			}
+		}
+
+		const PLYElement* vertexElement = nullptr;
+		for (const PLYElement& element : elements)
+		{
+			vertexElement = element.name == "vertex" ? &element : vertexElement;
+		}
+		if (vertexElement == nullptr || vertexElement->size == 0)
+		{
+			stats->error = "the PLY file has no vertex element of fixed size";
+			return false;
+		}
+		size_t vertexCount = vertexElement->count;
+
+		static const char* const POSITION[3] = { "x", "y", "z" };
+		static const char* const NORMAL[3] = { "nx", "ny", "nz" };
+		static const char* const COLOR[3] = { "red", "green", "blue" };
+		static const char* const DIFFUSE_COLOR[3] = { "diffuse_red", "diffuse_green", "diffuse_blue" };
+
+		size_t corners = 0;
+		size_t skippedFaces = 0;
+		bool hasNormals = false;
+		bool hasColors = false;
+		const uint8_t* p = data + offset;
+		size_t remaining = size - offset;
+		for (const PLYElement& element : elements)
+		{
+			size_t elementBytes = 0;
+			if (&element == vertexElement)
+			{
+				if (element.count > remaining / element.size)
+				{
+					stats->error = "the PLY file is truncated";
+					return false;
+				}
+				if (!gatherVec3(element, p, POSITION, swap, false, scale, &meshData->vertices))
+				{
+					stats->error = "the PLY vertices have no x, y and z";
+					return false;
+				}
+				hasNormals = gatherVec3(element, p, NORMAL, swap, false, 1.0f, &meshData->normals);
+
+				// Integer colors are normalized, float ones are used as they are
+				const PLYProperty* red = element.find("red") != nullptr ? element.find("red") : element.find("diffuse_red");
+				bool normalize = red != nullptr && red->type != PLYType::FLOAT32 && red->type != PLYType::FLOAT64;
+				hasColors = gatherVec3(element, p, COLOR, swap, normalize, 1.0f, &meshData->colors)
+					|| gatherVec3(element, p, DIFFUSE_COLOR, swap, normalize, 1.0f, &meshData->colors);
+				elementBytes = element.count * element.size;
+			}
+			else if (element.name == "face")
+			{
+				const PLYProperty* list = element.find("vertex_indices");
+				list = list != nullptr ? list : element.find("vertex_index");
+				if (list == nullptr || list->countType == PLYType::NONE)
+				{
+					stats->error = "the PLY faces have no vertex_indices list";
+					return false;
+				}
+				// The count comes from the header, it has to fit into the bytes that follow before anything is reserved for it
+				if (element.count > remaining / getMinElementSize(element))
+				{
+					stats->error = "the PLY file is truncated";
+					return false;
+				}
+				stats->faces = element.count;
+				size_t triangleSize = getTypeSize(list->countType) + 3 * getTypeSize(list->type);
+				meshData->indices.reserve(std::min(element.count, remaining / triangleSize) * 3);
+
+				bool common = element.properties.size() == 1 && list->countType == PLYType::UINT8
+					&& (list->type == PLYType::INT32 || list->type == PLYType::UINT32);
+				if (common && list->type == PLYType::INT32)
+				{
+					elementBytes = swap ? readFaceLists<int32_t, true>(p, remaining, element.count, vertexCount, &meshData->indices, &corners, &skippedFaces)
+						: readFaceLists<int32_t, false>(p, remaining, element.count, vertexCount, &meshData->indices, &corners, &skippedFaces);
+				}
+				else if (common)
+				{
+					elementBytes = swap ? readFaceLists<uint32_t, true>(p, remaining, element.count, vertexCount, &meshData->indices, &corners, &skippedFaces)
+						: readFaceLists<uint32_t, false>(p, remaining, element.count, vertexCount, &meshData->indices, &corners, &skippedFaces);
+				}
+				else
+				{
+					std::vector<GLuint> polygon;
+					for (size_t f = 0; f < element.count; ++f)
+					{
+						size_t bytes = readElement(element, p + elementBytes, remaining - elementBytes, swap, list, &polygon);
+						if (bytes == 0)
+						{
+							elementBytes = 0;
+							break;
+						}
+						addPolygon(polygon.data(), polygon.size(), vertexCount, &meshData->indices, &skippedFaces);
+						corners += polygon.size();
+						elementBytes += bytes;
+					}
+				}
+				if (elementBytes == 0 && element.count > 0)
+				{
+					stats->error = "the PLY file is truncated";
+					return false;
+				}
+			}
+			else if (element.size != 0)
+			{
+				elementBytes = element.count <= remaining / element.size ? element.count * element.size : 0;
+			}
+			else
+			{
+				// Other elements with lists have to be walked to find their end
+				std::vector<GLuint> unused;
+				for (size_t e = 0; e < element.count; ++e)
+				{
+					size_t bytes = readElement(element, p + elementBytes, remaining - elementBytes, swap, nullptr, &unused);
+					if (bytes == 0)
+					{
+						elementBytes = 0;
+						break;
+					}
+					elementBytes += bytes;
+				}
+			}
+
+			if (elementBytes == 0 && element.count > 0)
+			{
+				stats->error = "the PLY file is truncated";
+				return false;
+			}
+			p += elementBytes;
+			remaining -= elementBytes;
+		}
+
+		if (!hasColors)
+		{
+			// Set once for the whole mesh, see MeshData::constantColor
+			meshData->colors.clear();
+			meshData->constantColor = DEFAULT_COLOR;
+		}
+		if (!hasNormals)
+		{
+			calculateNormals(meshData);
+		}
+
+		stats->positions = vertexCount;
+		stats->normals = hasNormals ? vertexCount : 0;
+		stats->corners = corners;
+		stats->vertices = vertexCount;
+
+		if (skippedFaces > 0)
+		{
+			std::cout << "skipped " << skippedFaces << " PLY faces with indices past the " << vertexCount << " vertices\n";
+		}
+		return true;
+	}
+
+	// Welds corners with exactly the same position into one vertex
+	class PositionWelder
+	{
+	public:
+		PositionWelder(size_t expectedVertices, std::vector<glm::vec3>* vertices, std::pmr::memory_resource* memory)
+			: m_slots(memory), m_vertices(vertices)
+		{
+			size_t capacity = 64;
+			while (capacity < expectedVertices * 2)
+			{
+				capacity *= 2;
+			}
+			m_slots.assign(capacity, EMPTY);
+			m_vertices->reserve(expectedVertices);
+		}
+
+		GLuint weld(const float* position)
+		{
+			// -0 and 0 are the same position
+			uint32_t key[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				float value = position[c] + 0.0f;
+				std::memcpy(&key[c], &value, sizeof(float));
+			}
+
+			size_t mask = m_slots.size() - 1;
+			for (size_t i = hash(key) & mask; ; i = (i + 1) & mask)
+			{
+				GLuint vertex = m_slots[i];
+				if (vertex == EMPTY)
+				{
+					m_slots[i] = (GLuint)m_vertices->size();
+					m_vertices->push_back(glm::vec3(position[0] + 0.0f, position[1] + 0.0f, position[2] + 0.0f));
+					if (m_vertices->size() * 2 > m_slots.size())
+					{
+						grow();
+					}
+					return (GLuint)m_vertices->size() - 1;
+				}
+				if (std::memcmp(&(*m_vertices)[vertex], key, sizeof(key)) == 0)
+				{
+					return vertex;
+				}
+			}
+		}
+
+	private:
+		static constexpr GLuint EMPTY = ~0u;
+
+		static size_t hash(const uint32_t key[3])
+		{
+			uint64_t h = ((uint64_t)key[0] << 32 | key[1]) * 0x9E3779B97F4A7C15ull;
+			h ^= (uint64_t)key[2] * 0xC2B2AE3D27D4EB4Full;
+			h ^= h >> 29;
+			h *= 0xBF58476D1CE4E5B9ull;
+			h ^= h >> 32;
+			return (size_t)h;
+		}
+
+		void grow()
+		{
+			std::pmr::vector<GLuint> slots(m_slots.size() * 2, EMPTY, m_slots.get_allocator());
+			size_t mask = slots.size() - 1;
+			for (GLuint vertex = 0; vertex < m_vertices->size(); ++vertex)
+			{
+				uint32_t key[3];
+				std::memcpy(key, &(*m_vertices)[vertex], sizeof(key));
+				size_t i = hash(key) & mask;
+				while (slots[i] != EMPTY)
+				{
+					i = (i + 1) & mask;
+				}
+				slots[i] = vertex;
+			}
+			m_slots.swap(slots);
+		}
+
+	private:
+		std::pmr::vector<GLuint> m_slots;
+		std::vector<glm::vec3>* m_vertices;
+	};
+
+	// Normals of a mesh whose vertices were welded by position only. Every corner gets the area weighted normal of the triangles
+	// around its vertex that are less than STL_CREASE_COS away from its own triangle, so hard edges stay hard. Vertices whose
+	// corners end up with different normals are split. Returns the number of vertices that were added.
+	static size_t calculateCreaseNormals(MeshData* meshData, std::pmr::memory_resource* memory)
+	{
+		size_t triangleCount = meshData->indices.size() / 3;
+		size_t vertexCount = meshData->vertices.size();
+
+		// Not normalized, so larger triangles weigh more
+		std::pmr::vector<glm::vec3> faceNormals(triangleCount, memory);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			const GLuint* corner = &meshData->indices[t * 3];
+			faceNormals[t] = glm::cross(meshData->vertices[corner[1]] - meshData->vertices[corner[0]], meshData->vertices[corner[2]] - meshData->vertices[corner[0]]);
+		}
+
+		// Triangles around every vertex
+		std::pmr::vector<uint32_t> firstTriangle(vertexCount + 1, 0, memory);
+		for (GLuint index : meshData->indices)
+		{
+			firstTriangle[index + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			firstTriangle[v + 1] += firstTriangle[v];
+		}
+		std::pmr::vector<uint32_t> vertexTriangles(meshData->indices.size(), memory);
+		std::pmr::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1, memory);
+		for (size_t i = 0; i < meshData->indices.size(); ++i)
+		{
+			vertexTriangles[fill[meshData->indices[i]]++] = (uint32_t)(i / 3);
+		}
+
+		meshData->normals.assign(vertexCount, glm::vec3(0.0f));
+
+		// Corners of one vertex on the same smooth surface sum up the same triangles in the same order, so their normals are equal
+		// bit for bit. Copies of a vertex are chained through <nextCopy>.
+		std::pmr::vector<GLuint> nextCopy(vertexCount, ~0u, memory);
+		std::pmr::vector<uint8_t> hasNormal(vertexCount, 0, memory);
+		for (size_t i = 0; i < meshData->indices.size(); ++i)
+		{
+			GLuint vertex = meshData->indices[i];
+			glm::vec3 own = faceNormals[i / 3];
+			float ownLength = glm::length(own);
+
+			glm::vec3 normal(0.0f);
+			for (uint32_t k = firstTriangle[vertex]; k < firstTriangle[vertex + 1]; ++k)
+			{
+				const glm::vec3& other = faceNormals[vertexTriangles[k]];
+				if (glm::dot(own, other) >= STL_CREASE_COS * ownLength * glm::length(other))
+				{
+					normal += other;
+				}
+			}
+			float length = glm::length(normal);
+			normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+
+			if (!hasNormal[vertex])
+			{
+				hasNormal[vertex] = 1;
+				meshData->normals[vertex] = normal;
+				continue;
+			}
+
+			GLuint copy = vertex;
+			while (meshData->normals[copy] != normal && nextCopy[copy] != ~0u)
+			{
+				copy = nextCopy[copy];
+			}
+			if (meshData->normals[copy] != normal)
+			{
+				nextCopy[copy] = (GLuint)meshData->vertices.size();
+				nextCopy.push_back(~0u);
+				copy = (GLuint)meshData->vertices.size();
+				meshData->vertices.push_back(meshData->vertices[vertex]);
+				meshData->normals.push_back(normal);
+			}
+			meshData->indices[i] = copy;
+		}
+
+		return meshData->vertices.size() - vertexCount;
+	}
+
+	static bool readSTL(const uint8_t* data, size_t size, float scale, MeshData* meshData, OBJLoadStats* stats, std::pmr::memory_resource* memory)
+	{
+		uint32_t triangleCount;
+		std::memcpy(&triangleCount, data + 80, sizeof(triangleCount));
+		if (size < STL_HEADER_SIZE + (uint64_t)triangleCount * STL_TRIANGLE_SIZE)
+		{
+			stats->error = "the STL file is truncated";
+			return false;
+		}
+
+		// Closed meshes have about half as many vertices as triangles
+		PositionWelder welder(triangleCount / 2, &meshData->vertices, memory);
+		meshData->indices.reserve((size_t)triangleCount * 3);
+
+		size_t degenerate = 0;
+		const uint8_t* triangle = data + STL_HEADER_SIZE;
+		for (uint32_t t = 0; t < triangleCount; ++t, triangle += STL_TRIANGLE_SIZE)
+		{
+			// The facet normal in front of the corners is often wrong, the normals are calculated from the corners instead
+			float corners[9];
+			std::memcpy(corners, triangle + 12, sizeof(corners));
+			for (float& c : corners)
+			{
+				c *= scale;
+			}
+
+			GLuint a = welder.weld(corners);
+			GLuint b = welder.weld(corners + 3);
+			GLuint c = welder.weld(corners + 6);
+
+			// Triangles that lost an edge to welding cover nothing
+			if (a == b || b == c || a == c)
+			{
+				degenerate++;
+				continue;
+			}
+			meshData->indices.push_back(a);
+			meshData->indices.push_back(b);
+			meshData->indices.push_back(c);
+		}
+
+		meshData->constantColor = DEFAULT_COLOR;
+		stats->splitVertices = calculateCreaseNormals(meshData, memory);
+
+		stats->positions = (size_t)triangleCount * 3;
+		stats->faces = triangleCount;
+		stats->corners = (size_t)triangleCount * 3;
+		stats->vertices = meshData->vertices.size();
+		stats->mergedCorners = stats->corners - stats->vertices;
+
+		if (degenerate > 0)
+		{
+			std::cout << "skipped " << degenerate << " degenerate STL triangles\n";
+		}
+		return true;
+	}
+
+	MeshFormat MeshImporter::detectFormat(const char* data, size_t size)
+	{
+		std::string_view start(data, std::min<size_t>(size, 5));
+		if (start.substr(0, 4) == "ply\n" || start == "ply\r\n")
+		{
+			return MeshFormat::PLY;
+		}
+		if (start.substr(0, 4) == "glTF")
+		{
+			return MeshFormat::GLB;
+		}
+
+		// Binary STL has no magic, but its size follows from the triangle count.
+		// Some binary files start with "solid" like ASCII STL, the size tells them apart.
+		if (size >= STL_HEADER_SIZE)
+		{
+			uint32_t triangleCount;
+			std::memcpy(&triangleCount, data + 80, sizeof(triangleCount));
+			if (size == STL_HEADER_SIZE + (uint64_t)triangleCount * STL_TRIANGLE_SIZE)
+			{
+				return MeshFormat::STL;
+			}
+		}
+		return MeshFormat::OBJ;
+	}
+
+	MeshFormat MeshImporter::detectFormat(const std::string& path)
+	{
+		MappedFile file;
+		if (!file.open(path))
+		{
+			return MeshFormat::UNKNOWN;
+		}
+		return detectFormat(file.data(), file.size());
+	}
+
+	const char* MeshImporter::getFormatName(MeshFormat format)
+	{
+		switch (format)
+		{
+		case MeshFormat::OBJ: return "OBJ";
+		case MeshFormat::PLY: return "PLY";
+		case MeshFormat::STL: return "STL";
+		case MeshFormat::GLB: return "glTF";
+		default: return "unknown";
+		}
+	}
+
+	bool MeshImporter::load(const std::string& path, MeshData* meshData, float scale, const OBJLoadOptions& options)
+	{
+		OBJLoadStats localStats;
+		OBJLoadStats* stats = options.stats != nullptr ? options.stats : &localStats;
+		*stats = OBJLoadStats();
+
+		MappedFile file;
+		if (!file.open(path))
+		{
+			stats->error = "could not open file \"" + path + "\"";
+			std::cout << stats->error + "\n";
+			return false;
+		}
+
+		MeshFormat format = detectFormat(file.data(), file.size());
+		if (format == MeshFormat::OBJ)
+		{
+			file.close();
+			return OBJFile::load(path, meshData, scale, options);
+		}
+
+		meshData->clearAll();
+
+		MeshArena localArena;
+		MeshArena* arena = options.arena != nullptr ? options.arena : &localArena;
+		arena->reset();
+
+		bool loaded = false;
+		if (format == MeshFormat::PLY)
+		{
+			loaded = readPLY((const uint8_t*)file.data(), file.size(), scale, meshData, stats);
+		}
+		else if (format == MeshFormat::STL)
+		{
+			loaded = readSTL((const uint8_t*)file.data(), file.size(), scale, meshData, stats, arena);
+		}
+		else
+		{
+			stats->error = "binary glTF files are loaded with GLBFile";
+		}
+
+		if (!loaded)
+		{
+			meshData->clearAll();
+			std::cout << "\"" + path + "\": " + stats->error + "\n";
+			return false;
+		}
+
+		meshData->updateIndexType();
+		if (options.optimize)
+		{
+			MeshOptimizer::optimize(meshData, &stats->cacheBefore, &stats->cacheAfter, MeshOptimizer::DEFAULT_CACHE_SIZE, options.overdrawThreshold, arena);
+			if (options.strips)
+			{
+				MeshOptimizer::convertToStrips(meshData, arena);
+			}
+			else if (options.meshlets)
+			{
+				MeshletBuilder::buildMeshlets(meshData, MeshletBuilder::DEFAULT_MAX_VERTICES, MeshletBuilder::DEFAULT_MAX_TRIANGLES, arena);
+			}
+
+			// Of the order that is drawn, after the last pass
+			stats->cacheAfter = MeshOptimizer::analyzeVertexCache(*meshData, MeshOptimizer::DEFAULT_CACHE_SIZE, arena);
+		}
+
+		stats->triangles = meshData->getTriangleCount();
+		stats->arenaAllocations = arena->getAllocationCount();
+		stats->heapAllocations = arena->getHeapAllocationCount();
+		return true;
+	}
+}
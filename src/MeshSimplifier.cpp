@@ -0,0 +1,536 @@
+#include "CG/MeshSimplifier.h"
+#include "CG/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace cg::MeshSimplifier
+{
+	// Vertex flags
+	static const uint8_t SEAM = 1;
+	static const uint8_t BORDER = 2;
+
+	// A triangle that turns further than this, as the cosine between its normals before and after a collapse, blocks it
+	static const float MIN_NORMAL_DOT = 0.25f;
+
+	// Collapses of one pass cost at most this much more than the cheapest ones that would be enough
+	static const double PASS_COST_SLACK = 1.5;
+
+	// Sum of the squared distances to a set of planes, weighted by the area of the triangles they come from.
+	// The symmetric 4x4 matrix of the plane equations is kept as its upper triangle.
+	struct Quadric
+	{
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+		double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+		double a22 = 0.0, a23 = 0.0;
+		double a33 = 0.0;
+		double weight = 0.0;
+
+		// The plane n.p + d = 0 with a unit normal
+		void addPlane(double nx, double ny, double nz, double d, double w)
+		{
+			a00 += w * nx * nx; a01 += w * nx * ny; a02 += w * nx * nz; a03 += w * nx * d;
+			a11 += w * ny * ny; a12 += w * ny * nz; a13 += w * ny * d;
+			a22 += w * nz * nz; a23 += w * nz * d;
+			a33 += w * d * d;
+			weight += w;
+		}
+
+		void add(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23;
+			a33 += q.a33;
+			weight += q.weight;
+		}
+
+		// Mean squared distance of <p> to the planes
+		double evaluate(const glm::vec3& p) const
+		{
+			if (weight <= 0.0)
+			{
+				return 0.0;
+			}
+			double x = p.x, y = p.y, z = p.z;
+			double e = a00 * x * x + a11 * y * y + a22 * z * z
+				+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (a03 * x + a13 * y + a23 * z) + a33;
+			return std::max(e, 0.0) / weight;
+		}
+	};
+
+	// Triangles that use each vertex, as one list with an offset per vertex
+	struct TriangleAdjacency
+	{
+		explicit TriangleAdjacency(std::pmr::memory_resource* memory)
+			: offsets(memory), triangles(memory)
+		{
+		}
+
+		std::pmr::vector<uint32_t> offsets;
+		std::pmr::vector<uint32_t> triangles;
+
+		void build(const std::pmr::vector<GLuint>& indices, size_t vertexCount)
+		{
+			offsets.assign(vertexCount + 1, 0);
+			for (GLuint index : indices)
+			{
+				offsets[index + 1]++;
+			}
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				offsets[v + 1] += offsets[v];
+			}
+
+			triangles.resize(indices.size());
+			std::pmr::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1, offsets.get_allocator());
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+			}
+		}
+	};
+
+	// Moves vertex <from> onto vertex <to>
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	static bool hasSameAttributes(const MeshData& mesh, size_t a, size_t b)
+	{
+		return (mesh.normals.empty() || mesh.normals[a] == mesh.normals[b])
+			&& (mesh.colors.empty() || mesh.colors[a] == mesh.colors[b])
+			&& (mesh.texcoords.empty() || mesh.texcoords[a] == mesh.texcoords[b]);
+	}
+
+	// Maps every vertex to the first one with the same position and attributes, and flags vertices that share their position
+	// with a vertex of different attributes as SEAM
+	static void findSeams(const MeshData& mesh, std::pmr::vector<uint32_t>& canonical, std::pmr::vector<uint8_t>& flags, std::pmr::memory_resource* memory)
+	{
+		std::pmr::vector<uint32_t> order(mesh.vertices.size(), memory);
+		for (uint32_t v = 0; v < order.size(); ++v)
+		{
+			order[v] = v;
+		}
+		auto less = [&mesh](uint32_t a, uint32_t b)
+		{
+			const glm::vec3& p = mesh.vertices[a];
+			const glm::vec3& q = mesh.vertices[b];
+			return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z != q.z ? p.z < q.z : a < b;
+		};
+		std::sort(order.begin(), order.end(), less);
+
+		for (size_t begin = 0; begin < order.size(); )
+		{
+			size_t end = begin + 1;
+			while (end < order.size() && mesh.vertices[order[end]] == mesh.vertices[order[begin]])
+			{
+				++end;
+			}
+
+			// Runs of one position are short, compare each vertex with the distinct ones before it
+			bool seam = false;
+			for (size_t i = begin; i < end; ++i)
+			{
+				uint32_t v = order[i];
+				canonical[v] = v;
+				for (size_t j = begin; j < i; ++j)
+				{
+					if (canonical[order[j]] == order[j] && hasSameAttributes(mesh, v, order[j]))
+					{
+						canonical[v] = order[j];
+						break;
+					}
+				}
+				seam |= canonical[v] != order[begin];
+			}
+			if (seam)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					flags[order[i]] |= SEAM;
+				}
+			}
+			begin = end;
+		}
+	}
+
+	// Flags both vertices of every edge that does not have exactly two triangles as BORDER
+	static void findBorders(const std::pmr::vector<GLuint>& indices, std::pmr::vector<uint8_t>& flags, std::pmr::memory_resource* memory)
+	{
+		std::pmr::vector<uint64_t> edges(memory);
+		edges.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint64_t a = indices[i + e];
+				uint64_t b = indices[i + (e + 1) % 3];
+				edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		for (size_t begin = 0; begin < edges.size(); )
+		{
+			size_t end = begin + 1;
+			while (end < edges.size() && edges[end] == edges[begin])
+			{
+				++end;
+			}
+			if (end - begin != 2)
+			{
+				flags[edges[begin] >> 32] |= BORDER;
+				flags[edges[begin] & 0xFFFFFFFF] |= BORDER;
+			}
+			begin = end;
+		}
+	}
+
+	static glm::vec3 getTriangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+
+	// Corners of triangle <t> after the collapses of the current pass, false if it has lost one
+	static bool getTriangle(const std::pmr::vector<GLuint>& indices, uint32_t t, const std::pmr::vector<uint32_t>& collapseTo, GLuint* triangle)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			triangle[c] = collapseTo[indices[t * 3 + c]];
+		}
+		return triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[2] != triangle[0];
+	}
+
+	// Checks the triangles around <collapse.from> for flips and the two vertices for a shared neighbour that is not part of
+	// a triangle on their edge, which would pinch the surface into a non-manifold one
+	static bool isCollapseValid(const Collapse& collapse, const std::pmr::vector<GLuint>& indices, const TriangleAdjacency& adjacency,
+		const std::pmr::vector<uint32_t>& collapseTo, const std::vector<glm::vec3>& positions, std::pmr::vector<uint32_t>& neighbours)
+	{
+		GLuint triangle[3];
+		const glm::vec3& target = positions[collapse.to];
+		neighbours.clear();
+		GLuint opposite[2] = { collapse.from, collapse.from };
+		size_t sharedTriangles = 0;
+
+		for (uint32_t o = adjacency.offsets[collapse.from]; o < adjacency.offsets[collapse.from + 1]; ++o)
+		{
+			if (!getTriangle(indices, adjacency.triangles[o], collapseTo, triangle))
+			{
+				continue;
+			}
+			if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+			{
+				// Removed by the collapse, an edge inside the surface has two of them
+				if (sharedTriangles < 2)
+				{
+					opposite[sharedTriangles] = triangle[0] + triangle[1] + triangle[2] - collapse.from - collapse.to;
+				}
+				sharedTriangles++;
+				continue;
+			}
+
+			glm::vec3 corners[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+			glm::vec3 before = getTriangleNormal(corners[0], corners[1], corners[2]);
+			for (int c = 0; c < 3; ++c)
+			{
+				if (triangle[c] == collapse.from)
+				{
+					corners[c] = target;
+				}
+				else
+				{
+					neighbours.push_back(triangle[c]);
+				}
+			}
+			glm::vec3 after = getTriangleNormal(corners[0], corners[1], corners[2]);
+			if (glm::dot(before, after) < MIN_NORMAL_DOT * glm::length(before) * glm::length(after))
+			{
+				return false;
+			}
+		}
+
+		// The third vertices of the shared triangles are neighbours of both, any other common neighbour is one too many
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+		for (uint32_t o = adjacency.offsets[collapse.to]; o < adjacency.offsets[collapse.to + 1]; ++o)
+		{
+			if (!getTriangle(indices, adjacency.triangles[o], collapseTo, triangle) ||
+				triangle[0] == collapse.from || triangle[1] == collapse.from || triangle[2] == collapse.from)
+			{
+				continue;
+			}
+			for (int c = 0; c < 3; ++c)
+			{
+				GLuint v = triangle[c];
+				if (v == collapse.to || v == opposite[0] || v == opposite[1])
+				{
+					continue;
+				}
+				if (std::binary_search(neighbours.begin(), neighbours.end(), v))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	float simplify(MeshData* mesh, size_t targetTriangles, float maxError, std::pmr::memory_resource* memory)
+	{
+		if (mesh->drawMode != GL_TRIANGLES || mesh->indices.size() / 3 <= targetTriangles)
+		{
+			return 0.0f;
+		}
+		size_t vertexCount = mesh->vertices.size();
+		const std::vector<glm::vec3>& positions = mesh->vertices;
+
+		std::pmr::vector<uint32_t> canonical(vertexCount, memory);
+		std::pmr::vector<uint8_t> flags(vertexCount, 0, memory);
+		findSeams(*mesh, canonical, flags, memory);
+
+		std::pmr::vector<GLuint> indices(memory);
+		indices.reserve(mesh->indices.size());
+		for (GLuint index : mesh->indices)
+		{
+			indices.push_back(canonical[index]);
+		}
+		findBorders(indices, flags, memory);
+
+		// Planes of the original triangles around every vertex
+		std::pmr::vector<Quadric> quadrics(vertexCount, memory);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			const glm::vec3& a = positions[indices[i]];
+			glm::vec3 n = getTriangleNormal(a, positions[indices[i + 1]], positions[indices[i + 2]]);
+			double length = glm::length(n);
+			if (length == 0.0)
+			{
+				continue;
+			}
+			double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+			double d = -(nx * a.x + ny * a.y + nz * a.z);
+			for (int c = 0; c < 3; ++c)
+			{
+				quadrics[indices[i + c]].addPlane(nx, ny, nz, d, length * 0.5);
+			}
+		}
+
+		// Original triangle of every triangle that is left, for the submesh ranges
+		std::pmr::vector<uint32_t> sourceTriangles(indices.size() / 3, memory);
+		for (uint32_t t = 0; t < sourceTriangles.size(); ++t)
+		{
+			sourceTriangles[t] = t;
+		}
+
+		double maxCost = (double)maxError * maxError;
+		double resultCost = 0.0;
+
+		TriangleAdjacency adjacency(memory);
+		std::pmr::vector<Collapse> candidates(memory);
+		std::pmr::vector<uint32_t> collapseTo(vertexCount, memory);
+		std::pmr::vector<uint8_t> touched(vertexCount, memory);
+		std::pmr::vector<uint32_t> neighbours(memory);
+
+		// Every pass collapses the cheapest edges whose vertices no earlier collapse of the pass has used
+		while (indices.size() / 3 > targetTriangles)
+		{
+			adjacency.build(indices, vertexCount);
+
+			// Each edge between two triangles is seen once in each direction, the one where it goes up is taken.
+			// Both ways of collapsing it are tried.
+			candidates.clear();
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					uint32_t a = indices[i + e];
+					uint32_t b = indices[i + (e + 1) % 3];
+					if (a > b)
+					{
+						continue;
+					}
+
+					// Only free vertices move, and never onto a seam where it would not be clear which vertex to take
+					Collapse best = { a, b, maxCost };
+					bool found = false;
+					for (const Collapse& c : { Collapse{ a, b, 0.0 }, Collapse{ b, a, 0.0 } })
+					{
+						if (flags[c.from] != 0 || (flags[c.to] & SEAM))
+						{
+							continue;
+						}
+						double cost = quadrics[c.from].evaluate(positions[c.to]);
+						if (cost <= best.cost)
+						{
+							best = { c.from, c.to, cost };
+							found = true;
+						}
+					}
+					if (found)
+					{
+						candidates.push_back(best);
+					}
+				}
+			}
+			if (candidates.empty())
+			{
+				break;
+			}
+			std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				collapseTo[v] = v;
+			}
+			std::fill(touched.begin(), touched.end(), 0);
+
+			// A collapse removes two triangles. Collapses that are blocked in this pass leave room for more expensive ones,
+			// those are capped so they wait for a later pass where the cheap ones are possible again.
+			size_t excess = indices.size() / 3 - targetTriangles;
+			size_t goal = std::max<size_t>(excess / 2, 1);
+			double passCost = goal < candidates.size() ? PASS_COST_SLACK * candidates[goal].cost : maxCost;
+
+			size_t removed = 0;
+			size_t collapses = 0;
+			for (const Collapse& collapse : candidates)
+			{
+				if (removed >= excess || (collapse.cost > passCost && collapses > 0))
+				{
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to] ||
+					!isCollapseValid(collapse, indices, adjacency, collapseTo, positions, neighbours))
+				{
+					continue;
+				}
+
+				GLuint triangle[3];
+				for (uint32_t o = adjacency.offsets[collapse.from]; o < adjacency.offsets[collapse.from + 1]; ++o)
+				{
+					if (getTriangle(indices, adjacency.triangles[o], collapseTo, triangle) &&
+						(triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to))
+					{
+						removed++;
+					}
+				}
+
+				// The adjacency stays right for vertices that have not been part of a collapse yet, their
+				// neighbours are looked up through collapseTo
+				collapseTo[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				resultCost = std::max(resultCost, collapse.cost);
+				collapses++;
+				touched[collapse.from] = touched[collapse.to] = 1;
+			}
+			if (collapses == 0)
+			{
+				break;
+			}
+
+			// Drop the triangles that lost a corner, the others keep their order
+			size_t kept = 0;
+			for (size_t t = 0; t < indices.size() / 3; ++t)
+			{
+				GLuint a = collapseTo[indices[t * 3]];
+				GLuint b = collapseTo[indices[t * 3 + 1]];
+				GLuint c = collapseTo[indices[t * 3 + 2]];
+				if (a == b || b == c || c == a)
+				{
+					continue;
+				}
+				indices[kept * 3] = a;
+				indices[kept * 3 + 1] = b;
+				indices[kept * 3 + 2] = c;
+				sourceTriangles[kept] = sourceTriangles[t];
+				kept++;
+			}
+			indices.resize(kept * 3);
+			sourceTriangles.resize(kept);
+		}
+
+		if (indices.size() == mesh->indices.size())
+		{
+			return 0.0f;
+		}
+
+		// Each range keeps the triangles that are left of it, ranges without any are removed
+		std::vector<SubMesh> subMeshes;
+		for (const SubMesh& subMesh : mesh->subMeshes)
+		{
+			auto begin = std::lower_bound(sourceTriangles.begin(), sourceTriangles.end(), subMesh.indexOffset / 3);
+			auto end = std::lower_bound(sourceTriangles.begin(), sourceTriangles.end(), (subMesh.indexOffset + subMesh.indexCount) / 3);
+			if (begin == end)
+			{
+				continue;
+			}
+			SubMesh simplified = subMesh;
+			simplified.indexOffset = (uint32_t)(begin - sourceTriangles.begin()) * 3;
+			simplified.indexCount = (uint32_t)(end - begin) * 3;
+			subMeshes.push_back(simplified);
+		}
+		mesh->subMeshes = std::move(subMeshes);
+		mesh->indices.assign(indices.begin(), indices.end());
+		mesh->meshlets.clear();
+
+		return (float)std::sqrt(resultCost);
+	}
+
+	// Half the diagonal of the bounding box, errors of buildLODChain are relative to it
+	static float getRadius(const MeshData& mesh)
+	{
+		if (mesh.vertices.empty())
+		{
+			return 0.0f;
+		}
+		glm::vec3 min = mesh.vertices[0];
+		glm::vec3 max = mesh.vertices[0];
+		for (const glm::vec3& v : mesh.vertices)
+		{
+			min = glm::min(min, v);
+			max = glm::max(max, v);
+		}
+		return glm::length(max - min) * 0.5f;
+	}
+
+	std::vector<LODLevel> buildLODChain(const MeshData& mesh, const LODOptions& options, std::pmr::memory_resource* memory)
+	{
+		std::vector<LODLevel> levels;
+		if (mesh.drawMode != GL_TRIANGLES)
+		{
+			return levels;
+		}
+
+		float maxError = options.maxError * getRadius(mesh);
+		size_t previous = mesh.indices.size() / 3;
+		for (unsigned int l = 0; l < options.maxLevels; ++l)
+		{
+			size_t target = (size_t)(previous * options.ratio);
+			if (target < options.minTriangles)
+			{
+				break;
+			}
+
+			LODLevel level;
+			level.mesh = mesh;
+			level.error = simplify(&level.mesh, target, maxError, memory);
+
+			// Stuck on the error bound or on vertices that cannot move, a further level would not be much cheaper to draw
+			size_t triangles = level.mesh.indices.size() / 3;
+			if (triangles > target + (previous - target) / 2)
+			{
+				break;
+			}
+
+			MeshOptimizer::optimize(&level.mesh, nullptr, nullptr, MeshOptimizer::DEFAULT_CACHE_SIZE, 0.0f, memory);
+			levels.push_back(std::move(level));
+			previous = triangles;
+		}
+		return levels;
+	}
+}
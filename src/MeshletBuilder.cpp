@@ -0,0 +1,400 @@
+#include "CG/MeshletBuilder.h"
+#include "CG/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace cg::MeshletBuilder
+{
+	static const uint32_t NO_TRIANGLE = ~0u;
+
+	// What a candidate triangle that is perpendicular to the normals of the meshlet costs, in new vertices
+	static const float CONE_WEIGHT = 1.0f;
+
+	// Candidates that score about the same are taken in the order they were found, which grows the meshlet evenly around its seed
+	static const float SCORE_TOLERANCE = 0.02f;
+
+	// Triangles that use each vertex, as one list with an offset per vertex
+	struct TriangleAdjacency
+	{
+		explicit TriangleAdjacency(std::pmr::memory_resource* memory)
+			: offsets(memory), triangles(memory)
+		{
+		}
+
+		std::pmr::vector<uint32_t> offsets;
+		std::pmr::vector<uint32_t> triangles;
+
+		void build(const std::pmr::vector<GLuint>& indices, size_t vertexCount)
+		{
+			offsets.assign(vertexCount + 1, 0);
+			for (GLuint index : indices)
+			{
+				offsets[index + 1]++;
+			}
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				offsets[v + 1] += offsets[v];
+			}
+
+			triangles.resize(indices.size());
+			std::pmr::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1, offsets.get_allocator());
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+			}
+		}
+	};
+
+	// Maps every vertex to the first one with the same position, so triangles that only share positions are neighbours too
+	static void weldPositions(const std::vector<glm::vec3>& positions, std::pmr::vector<uint32_t>& welded, std::pmr::memory_resource* memory)
+	{
+		std::pmr::vector<uint32_t> order(positions.size(), memory);
+		for (uint32_t v = 0; v < order.size(); ++v)
+		{
+			order[v] = v;
+		}
+		std::sort(order.begin(), order.end(), [&positions](uint32_t a, uint32_t b)
+		{
+			const glm::vec3& p = positions[a];
+			const glm::vec3& q = positions[b];
+			return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z != q.z ? p.z < q.z : a < b;
+		});
+
+		welded.resize(positions.size());
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			welded[order[i]] = i > 0 && positions[order[i]] == positions[order[i - 1]] ? welded[order[i - 1]] : order[i];
+		}
+	}
+
+	// True if every edge is shared by at least two triangles, corners with the same position count as one
+	static bool isClosed(const std::pmr::vector<GLuint>& weldedIndices, const TriangleAdjacency& adjacency)
+	{
+		for (size_t t = 0; t * 3 < weldedIndices.size(); ++t)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				GLuint a = weldedIndices[t * 3 + c];
+				GLuint b = weldedIndices[t * 3 + (c + 1) % 3];
+				if (a == b)
+				{
+					continue;
+				}
+
+				size_t sharing = 0;
+				for (uint32_t o = adjacency.offsets[a]; o < adjacency.offsets[a + 1] && sharing < 2; ++o)
+				{
+					const GLuint* other = &weldedIndices[adjacency.triangles[o] * 3];
+					sharing += other[0] == b || other[1] == b || other[2] == b ? 1 : 0;
+				}
+				if (sharing < 2)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Sphere around the corners of the triangles (Ritter 1990), a few percent larger than the smallest one
+	static void computeBoundingSphere(const GLuint* indices, size_t indexCount, const std::vector<glm::vec3>& positions, Meshlet* meshlet)
+	{
+		// Start with the corner furthest from the first one and the corner furthest from that
+		auto furthest = [&](const glm::vec3& from)
+		{
+			glm::vec3 result = from;
+			float maxDistance = -1.0f;
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				glm::vec3 d = positions[indices[i]] - from;
+				float distance = glm::dot(d, d);
+				if (distance > maxDistance)
+				{
+					maxDistance = distance;
+					result = positions[indices[i]];
+				}
+			}
+			return result;
+		};
+		glm::vec3 a = furthest(positions[indices[0]]);
+		glm::vec3 b = furthest(a);
+		glm::vec3 center = (a + b) * 0.5f;
+		float radius = glm::length(b - a) * 0.5f;
+
+		// Grow it over the corners that are still outside
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const glm::vec3& p = positions[indices[i]];
+			float distance = glm::length(p - center);
+			if (distance > radius)
+			{
+				float grownRadius = (radius + distance) * 0.5f;
+				center += (p - center) * ((grownRadius - radius) / distance);
+				radius = grownRadius;
+			}
+		}
+
+		meshlet->center = center;
+		meshlet->radius = radius;
+	}
+
+	// Cone around the unit triangle normals in <normals>, degenerate triangles have none
+	static void computeNormalCone(const glm::vec3* normals, size_t triangleCount, Meshlet* meshlet)
+	{
+		meshlet->coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		meshlet->coneCutoff = 1.0f;
+
+		glm::vec3 sum(0.0f);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			sum += normals[t];
+		}
+		float length = glm::length(sum);
+		if (length <= 0.0f)
+		{
+			return;
+		}
+		glm::vec3 axis = sum / length;
+
+		float minDot = 1.0f;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			if (normals[t] != glm::vec3(0.0f))
+			{
+				minDot = std::min(minDot, glm::dot(axis, normals[t]));
+			}
+		}
+
+		// Normals more than 90 degrees apart from the axis, some triangle faces the eye from anywhere
+		meshlet->coneAxis = axis;
+		if (minDot > 0.0f)
+		{
+			meshlet->coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	void buildMeshlets(MeshData* mesh, size_t maxVertices, size_t maxTriangles, std::pmr::memory_resource* memory)
+	{
+		mesh->meshlets.clear();
+		if (mesh->drawMode != GL_TRIANGLES || mesh->indices.size() < 3)
+		{
+			return;
+		}
+		maxVertices = std::max<size_t>(maxVertices, 3);
+		maxTriangles = std::max<size_t>(maxTriangles, 1);
+
+		std::vector<GLuint>& indices = mesh->indices;
+		const std::vector<glm::vec3>& positions = mesh->vertices;
+		size_t vertexCount = positions.size();
+		size_t triangleCount = indices.size() / 3;
+
+		std::pmr::vector<uint32_t> welded(memory);
+		weldPositions(positions, welded, memory);
+		std::pmr::vector<GLuint> weldedIndices(memory);
+		weldedIndices.reserve(triangleCount * 3);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+		{
+			weldedIndices.push_back(welded[indices[i]]);
+		}
+		TriangleAdjacency adjacency(memory);
+		adjacency.build(weldedIndices, vertexCount);
+
+		// Both sides of every triangle are drawn, the back of an open surface can be seen through its border.
+		// Only closed meshes hide the triangles that face away behind others, the meshlets of open ones get no cones.
+		bool closed = isClosed(weldedIndices, adjacency);
+
+		// The renderer does not cull by winding, what faces the eye is decided by the vertex normals. Triangles wound the other
+		// way, like half of the ones of GeometryUtil::generateSphereModel, are turned around so their cones do not point inwards.
+		std::pmr::vector<glm::vec3> normals(triangleCount, glm::vec3(0.0f), memory);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			const GLuint* triangle = &indices[t * 3];
+			const glm::vec3& a = positions[triangle[0]];
+			glm::vec3 n = glm::cross(positions[triangle[1]] - a, positions[triangle[2]] - a);
+			float length = glm::length(n);
+			if (length <= 0.0f)
+			{
+				continue;
+			}
+			if (!mesh->normals.empty() && glm::dot(n, mesh->normals[triangle[0]] + mesh->normals[triangle[1]] + mesh->normals[triangle[2]]) < 0.0f)
+			{
+				length = -length;
+			}
+			normals[t] = n / length;
+		}
+
+		// Ranges in triangles, the whole mesh if it has no submeshes
+		std::pmr::vector<std::pair<uint32_t, uint32_t>> ranges(memory);
+		for (const SubMesh& subMesh : mesh->subMeshes)
+		{
+			ranges.push_back({ subMesh.indexOffset / 3, (subMesh.indexOffset + subMesh.indexCount) / 3 });
+		}
+		if (mesh->subMeshes.empty())
+		{
+			ranges.push_back({ 0, (uint32_t)triangleCount });
+		}
+
+		// Meshlet that last took a vertex or a candidate triangle, plus one so 0 means none
+		std::pmr::vector<uint32_t> vertexMeshlet(vertexCount, 0, memory);
+		std::pmr::vector<uint32_t> candidateMeshlet(triangleCount, 0, memory);
+		std::pmr::vector<uint8_t> used(triangleCount, 0, memory);
+		std::pmr::vector<uint32_t> candidates(memory);
+
+		// Triangles of the current range in meshlet order, with their normals
+		std::pmr::vector<GLuint> rangeIndices(memory);
+		std::pmr::vector<glm::vec3> rangeNormals(memory);
+
+		std::vector<Meshlet>& meshlets = mesh->meshlets;
+		for (const auto& [first, last] : ranges)
+		{
+			rangeIndices.clear();
+			rangeNormals.clear();
+			size_t firstMeshlet = meshlets.size();
+
+			for (uint32_t seed = first; seed < last; ++seed)
+			{
+				if (used[seed])
+				{
+					continue;
+				}
+
+				Meshlet meshlet;
+				meshlet.indexOffset = first * 3 + (uint32_t)rangeIndices.size();
+				uint32_t id = (uint32_t)meshlets.size() + 1;
+				size_t meshletVertices = 0;
+				size_t meshletTriangles = 0;
+				glm::vec3 normalSum(0.0f);
+				candidates.clear();
+
+				for (uint32_t t = seed; t != NO_TRIANGLE; )
+				{
+					used[t] = 1;
+					for (int c = 0; c < 3; ++c)
+					{
+						GLuint v = indices[t * 3 + c];
+						if (vertexMeshlet[v] != id)
+						{
+							vertexMeshlet[v] = id;
+							meshletVertices++;
+						}
+						rangeIndices.push_back(v);
+					}
+					rangeNormals.push_back(normals[t]);
+					normalSum += normals[t];
+					if (++meshletTriangles == maxTriangles)
+					{
+						break;
+					}
+
+					// Neighbours of the new triangle in the same range
+					for (int c = 0; c < 3; ++c)
+					{
+						GLuint w = weldedIndices[t * 3 + c];
+						for (uint32_t o = adjacency.offsets[w]; o < adjacency.offsets[w + 1]; ++o)
+						{
+							uint32_t n = adjacency.triangles[o];
+							if (!used[n] && candidateMeshlet[n] != id && n >= first && n < last)
+							{
+								candidateMeshlet[n] = id;
+								candidates.push_back(n);
+							}
+						}
+					}
+
+					// Fewest new vertices first, then the one that widens the normal cone the least
+					float sumLength = glm::length(normalSum);
+					glm::vec3 direction = sumLength > 0.0f ? normalSum / sumLength : glm::vec3(0.0f);
+					float bestScore = std::numeric_limits<float>::max();
+					t = NO_TRIANGLE;
+					size_t kept = 0;
+					for (uint32_t candidate : candidates)
+					{
+						if (used[candidate])
+						{
+							continue;
+						}
+						candidates[kept++] = candidate;
+
+						size_t newVertices = 0;
+						for (int c = 0; c < 3; ++c)
+						{
+							newVertices += vertexMeshlet[indices[candidate * 3 + c]] != id ? 1 : 0;
+						}
+						if (meshletVertices + newVertices > maxVertices)
+						{
+							continue;
+						}
+						float score = (float)newVertices + CONE_WEIGHT * (1.0f - glm::dot(normals[candidate], direction));
+						if (score < bestScore - SCORE_TOLERANCE)
+						{
+							bestScore = score;
+							t = candidate;
+						}
+					}
+					candidates.resize(kept);
+				}
+
+				meshlet.indexCount = (uint32_t)meshletTriangles * 3;
+				meshlets.push_back(meshlet);
+			}
+
+			// Meshlets of the range get their bounds while its normals are still in meshlet order
+			std::copy(rangeIndices.begin(), rangeIndices.end(), indices.begin() + first * 3);
+			for (size_t m = firstMeshlet; m < meshlets.size(); ++m)
+			{
+				Meshlet& meshlet = meshlets[m];
+				computeBoundingSphere(&indices[meshlet.indexOffset], meshlet.indexCount, positions, &meshlet);
+				if (closed)
+				{
+					computeNormalCone(&rangeNormals[(meshlet.indexOffset - first * 3) / 3], meshlet.indexCount / 3, &meshlet);
+				}
+			}
+		}
+
+		// Submeshes are sorted by material, not necessarily by their place in the index buffer
+		std::sort(meshlets.begin(), meshlets.end(), [](const Meshlet& a, const Meshlet& b) { return a.indexOffset < b.indexOffset; });
+
+		// Growing the meshlets threw away the vertex cache and vertex fetch order
+		MeshOptimizer::optimizeMeshlets(mesh, MeshOptimizer::DEFAULT_CACHE_SIZE, memory);
+	}
+
+	void getFrustumPlanes(const glm::mat4& mvp, glm::vec4 planes[6])
+	{
+		// -w <= x, y, z <= w with the rows of <mvp> (Gribb, Hartmann 2001)
+		glm::vec4 rows[4];
+		for (int r = 0; r < 4; ++r)
+		{
+			rows[r] = glm::vec4(mvp[0][r], mvp[1][r], mvp[2][r], mvp[3][r]);
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			planes[axis * 2] = rows[3] + rows[axis];
+			planes[axis * 2 + 1] = rows[3] - rows[axis];
+		}
+		for (int p = 0; p < 6; ++p)
+		{
+			float length = glm::length(glm::vec3(planes[p]));
+			if (length > 0.0f)
+			{
+				planes[p] /= length;
+			}
+		}
+	}
+
+	bool isMeshletCulled(const Meshlet& meshlet, const glm::vec4 planes[6], const glm::vec3& eye)
+	{
+		for (int p = 0; p < 6; ++p)
+		{
+			if (glm::dot(glm::vec3(planes[p]), meshlet.center) + planes[p].w < -meshlet.radius)
+			{
+				return true;
+			}
+		}
+
+		glm::vec3 toCenter = meshlet.center - eye;
+		return glm::dot(toCenter, meshlet.coneAxis) > meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+	}
+}
@@ -1,234 +1,2035 @@
 #include "CG/OBJFile.h"
+#include "CG/MappedFile.h"
+#include "CG/MeshCache.h"
+#include "CG/ThreadPool.h"
+#include "CG/ExternalSorter.h"
+#include "CG/ChunkedMesh.h"
+#include "CG/MeshArena.h"
+#include "CG/MeshletBuilder.h"
 
-#include <fstream>
 #include <iostream>
+#include <fstream>
 #include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <string_view>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+#include <filesystem>
+#include <climits>
+#include <cmath>
+#include <memory_resource>
+
+namespace cg
+{
+	// Files are only split into chunks of at least this size
+	static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+	// Smallest memory limit of OBJFile::convert
+	static const size_t MIN_CONVERT_MEMORY = 16 << 20;
+
+	struct OBJCorner
+	{
+		enum Flags : unsigned char
+		{
+			HAS_TEXCOORD = 1 << 0,
+			HAS_NORMAL = 1 << 1,
+
+			// Index was negative in the file and is stored relative to the first element of the chunk
+			FV_RELATIVE = 1 << 2,
+			FVT_RELATIVE = 1 << 3,
+			FVN_RELATIVE = 1 << 4,
+
+			// Set on the first corner of a face that references an undefined vertex
+			INVALID_FACE = 1 << 5
+		};
+
+		int fv;
+		int fvt;
+		int fvn;
+		unsigned char flags;
+	};
+
+	// Group, object and material statements. They apply to all faces that follow, also in later chunks.
+	struct OBJStatement
+	{
+		enum Type
+		{
+			GROUP,              // "g" and "o"
+			MATERIAL,           // "usemtl"
+			MATERIAL_LIBRARY    // "mtllib"
+		};
+
+		Type type;
+
+		// Number of faces in the chunk before the statement
+		size_t face;
+
+		std::string_view name;
+	};
+
+	// Everything parsed from one line-aligned part of the file.
+	// Indices in <corners> are global once the chunk has been resolved.
+	struct OBJChunk
+	{
+		static const size_t NO_TRIANGLE = ~(size_t)0;
+
+		explicit OBJChunk(std::pmr::memory_resource* memory)
+			: vertices(memory), texcoords(memory), normals(memory), corners(memory), faceSizes(memory), statements(memory), statementTriangles(memory)
+		{
+		}
+
+		std::string_view text;
+
+		std::pmr::vector<glm::vec3> vertices;
+		std::pmr::vector<glm::vec2> texcoords;
+		std::pmr::vector<glm::vec3> normals;
+
+		// Corners of all faces back to back, <faceSizes> tells where one face ends
+		std::pmr::vector<OBJCorner> corners;
+		std::pmr::vector<unsigned int> faceSizes;
+
+		std::pmr::vector<OBJStatement> statements;
+
+		// Offsets of this chunk in the merged data (prefix sums over the chunks before)
+		size_t vertexBase = 0;
+		size_t texcoordBase = 0;
+		size_t normalBase = 0;
+
+		// Of the chunk's first valid face at or after every statement, NO_TRIANGLE if there is none
+		std::pmr::vector<size_t> statementTriangles;
+
+		// Offsets of this chunk in the welded data
+		size_t cornerBase = 0;
+		size_t triangleBase = 0;
+
+		// Of the faces that are not skipped
+		size_t triangleCount = 0;
+		size_t weldedCorners = 0;
+
+		size_t badTexcoordRefs = 0;
+		size_t badNormalRefs = 0;
+		size_t skippedFaces = 0;
+
+		// Position of the first line that could not be parsed, nullptr if there was none
+		const char* errorLine = nullptr;
+	};
+
+	// Unique combination of attributes, one per vertex of the loaded mesh
+	struct OBJVertexKey
+	{
+		static const unsigned int NONE = ~0u;
+
+		unsigned int fv;
+		unsigned int fvt;
+		unsigned int fvn;
+
+		bool operator==(const OBJVertexKey&) const = default;
+	};
+
+	// Maps the (position, texcoord, normal) indices of a face corner to a vertex of the mesh.
+	// Open addressing with linear probing, the table grows when it gets half full.
+	class OBJVertexWelder
+	{
+	public:
+		OBJVertexWelder(size_t expectedVertices, std::pmr::memory_resource* memory)
+			: m_slots(memory), m_vertices(memory)
+		{
+			size_t capacity = 64;
+			while (capacity < expectedVertices * 2)
+			{
+				capacity *= 2;
+			}
+			m_slots.resize(capacity);
+			m_vertices.reserve(expectedVertices);
+		}
+
+		// Returns the vertex for <key>, adds a new one if there is none yet
+		unsigned int weld(const OBJVertexKey& key)
+		{
+			size_t mask = m_slots.size() - 1;
+			for (size_t i = hash(key) & mask; ; i = (i + 1) & mask)
+			{
+				Slot& slot = m_slots[i];
+				if (slot.vertex == EMPTY)
+				{
+					slot.key = key;
+					slot.vertex = (unsigned int)m_vertices.size();
+					m_vertices.push_back(key);
+
+					if (m_vertices.size() * 2 > m_slots.size())
+					{
+						grow();
+					}
+					return (unsigned int)m_vertices.size() - 1;
+				}
+				if (slot.key == key)
+				{
+					return slot.vertex;
+				}
+			}
+		}
+
+		// Keys of all vertices in the order they were added, moved out of the welder
+		std::pmr::vector<OBJVertexKey> takeVertices() { return std::move(m_vertices); }
+
+	private:
+		static const unsigned int EMPTY = ~0u;
+
+		struct Slot
+		{
+			OBJVertexKey key;
+			unsigned int vertex = EMPTY;
+		};
+
+		static size_t hash(const OBJVertexKey& key)
+		{
+			uint64_t h = (uint64_t)key.fv * 0x9E3779B97F4A7C15ull;
+			h ^= ((uint64_t)key.fvt << 32 | key.fvn) * 0xC2B2AE3D27D4EB4Full;
+			h ^= h >> 29;
+			h *= 0xBF58476D1CE4E5B9ull;
+			h ^= h >> 32;
+			return (size_t)h;
+		}
+
+		void grow()
+		{
+			std::pmr::vector<Slot> slots(m_slots.size() * 2, m_slots.get_allocator());
+			size_t mask = slots.size() - 1;
+			for (const Slot& slot : m_slots)
+			{
+				if (slot.vertex == EMPTY)
+				{
+					continue;
+				}
+				size_t i = hash(slot.key) & mask;
+				while (slots[i].vertex != EMPTY)
+				{
+					i = (i + 1) & mask;
+				}
+				slots[i] = slot;
+			}
+			m_slots = std::move(slots);
+		}
+
+	private:
+		std::pmr::vector<Slot> m_slots;
+		std::pmr::vector<OBJVertexKey> m_vertices;
+	};
+
+	// Collects the group and material of every triangle while welding and turns them into submeshes sorted by material
+	class OBJSubMeshBuilder
+	{
+	public:
+		void setMaterialLibrary(std::vector<Material> library) { m_library = std::move(library); }
+
+		void setGroup(std::string_view name)
+		{
+			m_group = name;
+			m_current = NONE;
+		}
+
+		void setMaterial(std::string_view name)
+		{
+			m_material = findMaterial(name);
+			m_current = NONE;
+		}
+
+		// Called before the triangles of a face are written, <triangle> is the number of triangles written so far
+		void beginFace(size_t triangle)
+		{
+			uint32_t subMesh = getSubMesh();
+			if (m_runs.empty() || m_runs.back().subMesh != subMesh)
+			{
+				m_runs.push_back({ subMesh, triangle });
+			}
+		}
+
+		// Index into getSubMeshes() of the current group and material, adds the submesh on first use
+		uint32_t getSubMesh()
+		{
+			if (m_current == NONE)
+			{
+				m_current = findSubMesh();
+			}
+			return m_current;
+		}
+
+		// In the order of their first face, only the name and the material are set
+		const std::vector<SubMesh>& getSubMeshes() const { return m_subMeshes; }
+		const std::vector<Material>& getMaterials() const { return m_materials; }
+
+		// Materials used by the file that no material library defines
+		const std::vector<std::string>& getMissingMaterials() const { return m_missingMaterials; }
+
+		// Sorts the triangles of <meshData> by submesh and fills in the submeshes and materials.
+		// Meshes without any group or material are left as they are. The temporaries come from <memory>.
+		void build(MeshData* meshData, std::pmr::memory_resource* memory) const
+		{
+			if (m_subMeshes.empty() || (m_subMeshes.size() == 1 && m_subMeshes[0].name.empty() && m_subMeshes[0].material == SubMesh::NO_MATERIAL))
+			{
+				return;
+			}
+
+			// Sort by material, keep the file order within one material
+			std::pmr::vector<uint32_t> order(m_subMeshes.size(), memory);
+			for (uint32_t i = 0; i < order.size(); ++i)
+			{
+				order[i] = i;
+			}
+			std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return m_subMeshes[a].material < m_subMeshes[b].material; });
+
+			std::pmr::vector<GLuint> indices(memory);
+			indices.reserve(meshData->indices.size());
+			std::pmr::vector<bool> colored(meshData->vertices.size(), false, memory);
+			bool hasMaterials = std::any_of(m_subMeshes.begin(), m_subMeshes.end(), [](const SubMesh& subMesh) { return subMesh.material != SubMesh::NO_MATERIAL; });
+			if (hasMaterials && meshData->colors.empty())
+			{
+				meshData->colors.assign(meshData->vertices.size(), meshData->constantColor);
+			}
+
+			meshData->subMeshes.clear();
+			for (uint32_t id : order)
+			{
+				SubMesh subMesh = m_subMeshes[id];
+				subMesh.indexOffset = (uint32_t)indices.size();
+
+				// A submesh can be split into several runs if the file switches back and forth
+				for (size_t r = 0; r < m_runs.size(); ++r)
+				{
+					if (m_runs[r].subMesh != id)
+					{
+						continue;
+					}
+					size_t begin = m_runs[r].triangle * 3;
+					size_t end = r + 1 < m_runs.size() ? m_runs[r + 1].triangle * 3 : meshData->indices.size();
+					indices.insert(indices.end(), meshData->indices.begin() + begin, meshData->indices.begin() + end);
+				}
+
+				subMesh.indexCount = (uint32_t)indices.size() - subMesh.indexOffset;
+				if (subMesh.indexCount == 0)
+				{
+					continue;
+				}
+
+				subMesh.boundsMin = subMesh.boundsMax = meshData->vertices[indices[subMesh.indexOffset]];
+				for (size_t i = subMesh.indexOffset; i < indices.size(); ++i)
+				{
+					GLuint v = indices[i];
+					subMesh.boundsMin = glm::min(subMesh.boundsMin, meshData->vertices[v]);
+					subMesh.boundsMax = glm::max(subMesh.boundsMax, meshData->vertices[v]);
+
+					// Vertex colors for shaders without material uniforms, shared vertices keep their first material
+					if (subMesh.material != SubMesh::NO_MATERIAL && !colored[v])
+					{
+						meshData->colors[v] = m_materials[subMesh.material].diffuse;
+						colored[v] = true;
+					}
+				}
+
+				meshData->subMeshes.push_back(subMesh);
+			}
+
+			// Never more than before, so this does not allocate
+			meshData->indices.assign(indices.begin(), indices.end());
+			meshData->materials = m_materials;
+		}
+
+	private:
+		static const uint32_t NONE = ~0u;
+
+		// Index into <m_materials>, adds the material on first use.
+		// Materials that are not in the library are drawn like a mesh without material.
+		uint32_t findMaterial(std::string_view name)
+		{
+			for (uint32_t i = 0; i < m_materials.size(); ++i)
+			{
+				if (m_materials[i].name == name)
+				{
+					return i;
+				}
+			}
+
+			auto it = std::find_if(m_library.begin(), m_library.end(), [name](const Material& m) { return m.name == name; });
+			if (it == m_library.end())
+			{
+				if (std::find(m_missingMaterials.begin(), m_missingMaterials.end(), name) == m_missingMaterials.end())
+				{
+					m_missingMaterials.emplace_back(name);
+				}
+				return SubMesh::NO_MATERIAL;
+			}
+
+			m_materials.push_back(*it);
+			return (uint32_t)m_materials.size() - 1;
+		}
+
+		uint32_t findSubMesh()
+		{
+			for (uint32_t i = 0; i < m_subMeshes.size(); ++i)
+			{
+				if (m_subMeshes[i].material == m_material && m_subMeshes[i].name == m_group)
+				{
+					return i;
+				}
+			}
+
+			m_subMeshes.emplace_back();
+			m_subMeshes.back().name = m_group;
+			m_subMeshes.back().material = m_material;
+			return (uint32_t)m_subMeshes.size() - 1;
+		}
+
+		// Consecutive triangles of one submesh, starting at <triangle>
+		struct Run
+		{
+			uint32_t subMesh;
+			size_t triangle;
+		};
+
+		std::vector<Material> m_library;
+		std::vector<Material> m_materials;
+		std::vector<std::string> m_missingMaterials;
+
+		std::vector<SubMesh> m_subMeshes;
+		std::vector<Run> m_runs;
+
+		std::string m_group;
+		uint32_t m_material = SubMesh::NO_MATERIAL;
+		uint32_t m_current = NONE;
+	};
+
+	// Triangle corner of OBJFile::convert. <order> is the submesh in the upper 24 bits and the number of the corner
+	// in the file in the lower 40, so sorting by it gives the triangles of every submesh in file order.
+	struct OBJCornerRecord
+	{
+		OBJVertexKey key;
+		uint32_t padding;
+		uint64_t order;
+
+		// Equal keys end up next to each other and become one vertex
+		bool operator<(const OBJCornerRecord& other) const
+		{
+			if (key.fv != other.key.fv) return key.fv < other.key.fv;
+			if (key.fvt != other.key.fvt) return key.fvt < other.key.fvt;
+			if (key.fvn != other.key.fvn) return key.fvn < other.key.fvn;
+			return order < other.order;
+		}
+	};
+
+	static const int CORNER_ORDER_BITS = 40;
+
+	// Welded vertex of a corner, sorted back into file order
+	struct OBJIndexRecord
+	{
+		uint64_t order;
+		uint32_t vertex;
+		uint32_t padding;
+
+		bool operator<(const OBJIndexRecord& other) const { return order < other.order; }
+	};
+
+	// Vertex that uses texture coordinate or normal <element>, sorted by element to read the elements in file order
+	struct OBJAttributeRef
+	{
+		uint32_t element;
+		uint32_t vertex;
+
+		bool operator<(const OBJAttributeRef& other) const
+		{
+			return element != other.element ? element < other.element : vertex < other.vertex;
+		}
+	};
+
+	// Attribute of a vertex, sorted by vertex
+	template <typename V>
+	struct OBJVertexValue
+	{
+		uint32_t vertex;
+		V value;
+
+		bool operator<(const OBJVertexValue& other) const { return vertex < other.vertex; }
+	};
+
+	// Finished vertex, the temporary vertex file is an array of these
+	struct OBJVertexRecord
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 texcoord;
+	};
+
+	// Splits the triangles of OBJFile::convert into chunks of at most ChunkedMesh::MAX_CHUNK_VERTICES vertices.
+	// The vertices of a chunk are read from the vertex file, ids that are close together with one read.
+	class OBJChunkAssembler
+	{
+	public:
+		OBJChunkAssembler(const std::string& verticesPath, ChunkedMeshWriter* writer, bool hasTexcoords)
+			: m_vertices(verticesPath, std::ios::binary)
+			, m_writer(writer)
+			, m_hasTexcoords(hasTexcoords)
+			, m_slots(SLOT_COUNT)
+		{
+		}
+
+		bool isOpen() const { return m_vertices.is_open(); }
+
+		// Returns false if a chunk could not be written
+		bool addTriangle(uint32_t subMesh, const uint32_t (&vertices)[3])
+		{
+			size_t added = 0;
+			for (int c = 0; c < 3; ++c)
+			{
+				bool repeated = (c > 0 && vertices[c] == vertices[0]) || (c > 1 && vertices[c] == vertices[1]);
+				added += !repeated && findSlot(vertices[c]).chunk != m_chunk ? 1 : 0;
+			}
+
+			if (!m_indices.empty() && (subMesh != m_subMesh || m_global.size() + added > ChunkedMesh::MAX_CHUNK_VERTICES
+				|| m_indices.size() >= ChunkedMesh::MAX_CHUNK_TRIANGLES * 3))
+			{
+				if (!flush())
+				{
+					return false;
+				}
+			}
+
+			m_subMesh = subMesh;
+			for (uint32_t vertex : vertices)
+			{
+				Slot& slot = findSlot(vertex);
+				if (slot.chunk != m_chunk)
+				{
+					slot.vertex = vertex;
+					slot.chunk = m_chunk;
+					slot.local = (GLushort)m_global.size();
+					m_global.push_back(vertex);
+				}
+				m_indices.push_back(slot.local);
+			}
+			return true;
+		}
+
+		// Writes the current chunk
+		bool flush()
+		{
+			if (m_indices.empty())
+			{
+				return true;
+			}
+
+			if (!readVertices())
+			{
+				std::cout << "could not read the temporary vertex file\n";
+				return false;
+			}
+
+			bool written = m_writer->addChunk(m_subMesh, m_positions, m_normals, m_texcoords, m_indices);
+			m_chunk++;
+			m_global.clear();
+			m_indices.clear();
+			return written;
+		}
+
+	private:
+		OBJChunkAssembler(const OBJChunkAssembler&) = delete;
+		OBJChunkAssembler(OBJChunkAssembler&&) = delete;
+
+		OBJChunkAssembler& operator=(const OBJChunkAssembler&) = delete;
+		OBJChunkAssembler& operator=(OBJChunkAssembler&&) = delete;
+
+		// Local index of a vertex of the current chunk, slots of earlier chunks count as empty.
+		// Open addressing with linear probing, at most half of the slots are used.
+		struct Slot
+		{
+			uint32_t vertex = 0;
+			uint32_t chunk = ~0u;
+			GLushort local = 0;
+		};
+
+		static const size_t SLOT_COUNT = 1 << 17;
+		static_assert(SLOT_COUNT >= ChunkedMesh::MAX_CHUNK_VERTICES * 2, "the slot table must stay half empty");
+
+		Slot& findSlot(uint32_t vertex)
+		{
+			size_t i = (vertex * 0x9E3779B1u) >> 15;
+			while (m_slots[i].chunk == m_chunk && m_slots[i].vertex != vertex)
+			{
+				i = (i + 1) & (SLOT_COUNT - 1);
+			}
+			return m_slots[i];
+		}
+
+		// Gaps up to this many vertices are read instead of seeking over them
+		static const uint32_t MAX_READ_GAP = 16;
+		static const uint32_t MAX_READ_RECORDS = 4096;
+
+		bool readVertices()
+		{
+			size_t count = m_global.size();
+			m_positions.resize(count);
+			m_normals.resize(count);
+			m_texcoords.resize(m_hasTexcoords ? count : 0);
+
+			// (global, local) in file order
+			m_sorted.resize(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				m_sorted[i] = { m_global[i], (GLushort)i };
+			}
+			std::sort(m_sorted.begin(), m_sorted.end());
+
+			for (size_t first = 0; first < count; )
+			{
+				size_t last = first + 1;
+				while (last < count && m_sorted[last].first - m_sorted[last - 1].first <= MAX_READ_GAP
+					&& m_sorted[last].first - m_sorted[first].first < MAX_READ_RECORDS)
+				{
+					++last;
+				}
+
+				uint32_t begin = m_sorted[first].first;
+				size_t records = m_sorted[last - 1].first - begin + 1;
+				m_buffer.resize(records);
+				m_vertices.seekg((std::streamoff)begin * (std::streamoff)sizeof(OBJVertexRecord));
+				m_vertices.read((char*)m_buffer.data(), records * sizeof(OBJVertexRecord));
+				if (!m_vertices.good())
+				{
+					return false;
+				}
+
+				for (size_t i = first; i < last; ++i)
+				{
+					const OBJVertexRecord& vertex = m_buffer[m_sorted[i].first - begin];
+					GLushort local = m_sorted[i].second;
+					m_positions[local] = vertex.position;
+					m_normals[local] = vertex.normal;
+					if (m_hasTexcoords)
+					{
+						m_texcoords[local] = vertex.texcoord;
+					}
+				}
+				first = last;
+			}
+			return true;
+		}
+
+	private:
+		std::ifstream m_vertices;
+		ChunkedMeshWriter* m_writer;
+		bool m_hasTexcoords;
+
+		uint32_t m_subMesh = 0;
+		uint32_t m_chunk = 0;
+		std::vector<Slot> m_slots;
+		std::vector<uint32_t> m_global;
+		std::vector<GLushort> m_indices;
+
+		std::vector<std::pair<uint32_t, GLushort>> m_sorted;
+		std::vector<OBJVertexRecord> m_buffer;
+		std::vector<glm::vec3> m_positions;
+		std::vector<glm::vec3> m_normals;
+		std::vector<glm::vec2> m_texcoords;
+	};
+
+	static bool parseFile(const std::string& path, MeshData* meshData, float scale, const OBJLoadOptions& options, OBJLoadStats* stats);
+	static bool parseMTL(const std::string& path, std::vector<Material>* materials);
+	static void parseChunk(OBJChunk* chunk, float scale, bool loadTexcoords);
+	static void resolveChunk(OBJChunk* chunk, size_t vertexCount, size_t texcoordCount, size_t normalCount);
+
+	// Loads every file of a "mtllib" statement, material libraries are looked up next to the OBJ file
+	static void loadMaterialLibraries(const std::string& path, std::string_view names, std::vector<Material>* library, std::vector<std::string>* paths)
+	{
+		std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+		// One statement can name several files
+		while (!names.empty())
+		{
+			size_t end = names.find_first_of(" \t");
+			std::string mtlPath = (directory / std::string(names.substr(0, end))).string();
+			if (std::find(paths->begin(), paths->end(), mtlPath) == paths->end())
+			{
+				paths->push_back(mtlPath);
+			}
+			if (!parseMTL(mtlPath, library))
+			{
+				std::cout << path << ": could not open material library \"" << mtlPath << "\"\n";
+			}
+			names.remove_prefix(std::min(names.find_first_not_of(" \t", end), names.size()));
+		}
+	}
+
+	static OBJVertexKey makeVertexKey(const OBJCorner& corner)
+	{
+		OBJVertexKey key;
+		key.fv = corner.fv;
+		key.fvt = (corner.flags & OBJCorner::HAS_TEXCOORD) ? corner.fvt : OBJVertexKey::NONE;
+		key.fvn = (corner.flags & OBJCorner::HAS_NORMAL) ? corner.fvn : OBJVertexKey::NONE;
+		return key;
+	}
+
+	static void printWarnings(const std::string& path, size_t badTexcoordRefs, size_t texcoordCount, size_t badNormalRefs, size_t normalCount,
+		size_t skippedFaces, const OBJSubMeshBuilder& subMeshes)
+	{
+		if (badTexcoordRefs > 0)
+		{
+			std::cout << path << ": " << badTexcoordRefs << " texture coordinate indices are out of range (" << texcoordCount << " texture coordinates)\n";
+		}
+		if (badNormalRefs > 0)
+		{
+			std::cout << path << ": " << badNormalRefs << " normal indices are out of range (" << normalCount << " normals)\n";
+		}
+		if (skippedFaces > 0)
+		{
+			std::cout << path << ": skipped " << skippedFaces << " faces with less than 3 vertices or invalid vertex indices\n";
+		}
+		for (const std::string& name : subMeshes.getMissingMaterials())
+		{
+			std::cout << path << ": material \"" << name << "\" is not defined, using the object color\n";
+		}
+	}
+
+	// Runs fn(i) for every i in [0, count), one thread per item
+	template <typename Fn>
+	static void parallelFor(size_t count, Fn fn)
+	{
+		if (count == 1)
+		{
+			fn(0);
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		threads.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			threads.emplace_back(fn, i);
+		}
+		for (std::thread& t : threads)
+		{
+			t.join();
+		}
+	}
+
+	// Splits <text> into at most <count> parts that each end on a line break
+	static std::pmr::vector<OBJChunk> splitChunks(std::string_view text, size_t count, std::pmr::memory_resource* memory)
+	{
+		std::pmr::vector<OBJChunk> chunks(memory);
+		chunks.reserve(count);
+		size_t start = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			chunks.emplace_back(memory);
+			size_t end = text.size();
+			if (i + 1 < count)
+			{
+				end = text.find('\n', std::max(start, text.size() / count * (i + 1)));
+				end = end == std::string_view::npos ? text.size() : end + 1;
+			}
+			chunks[i].text = text.substr(start, end - start);
+			start = end;
+		}
+		return chunks;
+	}
+
+	// Concatenates one attribute of all chunks, moves instead of copying if there is only one chunk
+	template <typename T>
+	static void mergeChunks(std::pmr::vector<OBJChunk>& chunks, std::pmr::vector<T> OBJChunk::* member, size_t OBJChunk::* base, size_t count, std::pmr::vector<T>* out)
+	{
+		if (chunks.size() == 1)
+		{
+			*out = std::move(chunks[0].*member);
+			return;
+		}
+
+		out->resize(count);
+		parallelFor(chunks.size(), [&](size_t i)
+		{
+			const std::pmr::vector<T>& src = chunks[i].*member;
+			std::copy(src.begin(), src.end(), out->begin() + chunks[i].*base);
+		});
+	}
+
+	// Prints <message> and keeps it in <stats> so batch loads can report it per file
+	static void reportError(OBJLoadStats* stats, const std::string& message)
+	{
+		stats->error = message;
+
+		// One write so messages of files loaded at the same time do not interleave
+		std::cout << message + "\n";
+	}
+
+	bool OBJFile::load(const std::string& path, MeshData* meshData, float scale)
+	{
+		return load(path, meshData, scale, OBJLoadOptions());
+	}
+
+	bool OBJFile::load(const std::string& path, MeshData* meshData, float scale, const OBJLoadOptions& options)
+	{
+		OBJLoadStats localStats;
+		OBJLoadStats* stats = options.stats != nullptr ? options.stats : &localStats;
+		*stats = OBJLoadStats();
+
+		if (!options.useCache)
+		{
+			return parseFile(path, meshData, scale, options, stats);
+		}
+
+		MeshCacheKey key;
+		if (!MeshCache::makeKey(path, scale, &key))
+		{
+			reportError(stats, "could not open file \"" + path + "\"");
+			return false;
+		}
+		key.options = (options.loadTexcoords ? 1 : 0) | (options.optimize ? 2 : 0) | (options.optimize && options.strips ? 4 : 0)
+			| (options.optimize && options.meshlets ? 8 : 0);
+		if (options.optimize && options.overdrawThreshold > 0.0f)
+		{
+			// In hundredths, every threshold gives another order
+			key.options |= (uint32_t)std::lround(options.overdrawThreshold * 100.0f) << 8;
+		}
+
+		std::string cachePath = MeshCache::getCachePath(path);
+		if (MeshCache::read(cachePath, key, meshData, &stats->materialLibraries))
+		{
+			stats->fromCache = true;
+			stats->vertices = meshData->vertices.size();
+			stats->triangles = meshData->getTriangleCount();
+			return true;
+		}
+
+		if (!parseFile(path, meshData, scale, options, stats))
+		{
+			return false;
+		}
+
+		// The materials are part of the cache, so it is outdated once a material library changes.
+		// Uncompressed, MeshCodec decodes slower than the plain copy reads (see the mesh_cache benchmark).
+		if (!MeshCache::write(cachePath, key, *meshData, false, stats->materialLibraries))
+		{
+			std::cout << "could not write mesh cache \"" << cachePath << "\"\n";
+		}
+		return true;
+	}
+
+	std::vector<OBJLoadResult> OBJFile::loadAll(const std::vector<OBJLoadRequest>& requests, const OBJLoadOptions& options, unsigned int threads, const LoadCallback& onLoaded)
+	{
+		std::vector<OBJLoadResult> results(requests.size());
+		if (requests.empty())
+		{
+			return results;
+		}
+
+		if (threads == 0)
+		{
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		threads = (unsigned int)std::min<size_t>(threads, requests.size());
+
+		// Start with the largest files so the batch takes about as long as the largest file.
+		// A big file started last would run alone at the end.
+		std::vector<uintmax_t> sizes(requests.size(), 0);
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			std::error_code ec;
+			sizes[i] = std::filesystem::file_size(requests[i].path, ec);
+		}
+
+		std::vector<size_t> order(requests.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+		{
+			ThreadPool pool(threads);
+			for (size_t i : order)
+			{
+				pool.submit([&, i]()
+				{
+					OBJLoadOptions fileOptions = options;
+					fileOptions.stats = &results[i].stats;
+					fileOptions.arena = nullptr;
+
+					OBJLoadResult& result = results[i];
+					result.success = load(requests[i].path, &result.mesh, requests[i].scale, fileOptions);
+					if (onLoaded)
+					{
+						onLoaded(i, result);
+					}
+				});
+			}
+
+			// The pool finishes all tasks before it is destroyed
+		}
+
+		return results;
+	}
+
+	// Pairs every vertex of <refs> with its element of the attribute file <valuesPath>, the result is sorted by vertex
+	template <typename V>
+	static bool joinAttribute(ExternalSorter<OBJAttributeRef>& refs, const std::string& valuesPath, size_t bufferBytes, ExternalSorter<OBJVertexValue<V>>* out)
+	{
+		if (!refs.finish())
+		{
+			return false;
+		}
+
+		// <refs> are sorted by element, so the file is read once from front to back
+		RecordReader<V> values(valuesPath, bufferBytes);
+		V value{};
+		uint64_t read = 0;
+		bool written = true;
+
+		OBJAttributeRef ref;
+		while (refs.next(&ref))
+		{
+			for (; read <= ref.element; ++read)
+			{
+				if (!values.next(&value))
+				{
+					return false;
+				}
+			}
+			written &= out->push({ ref.vertex, value });
+		}
+		return written && out->finish();
+	}
+
+	bool OBJFile::convert(const std::string& path, const std::string& outputPath, float scale, const OBJConvertOptions& options)
+	{
+		OBJLoadStats localStats;
+		OBJLoadStats* stats = options.stats != nullptr ? options.stats : &localStats;
+		*stats = OBJLoadStats();
+
+		std::ifstream input(path, std::ios::binary);
+		if (!input.good())
+		{
+			reportError(stats, "could not open file \"" + path + "\"");
+			return false;
+		}
+
+		// Split of the memory: parsing a piece of text takes a few times its size,
+		// and at most four sorters hold memory at the same time.
+		size_t memoryLimit = std::max(options.memoryLimit, MIN_CONVERT_MEMORY);
+		size_t pieceSize = memoryLimit / 16;
+		size_t sorterMemory = memoryLimit / 6;
+		size_t streamBuffer = std::min<size_t>(1 << 20, memoryLimit / 64);
+
+		std::error_code ec;
+		std::filesystem::path tempDirectory = options.tempDirectory;
+		if (tempDirectory.empty())
+		{
+			tempDirectory = std::filesystem::temp_directory_path(ec);
+		}
+		std::string tempBase = (tempDirectory / (std::filesystem::path(outputPath).filename().string() + ".convert")).string();
+		auto tempError = [stats, &tempBase]()
+		{
+			reportError(stats, "could not write or read the temporary files \"" + tempBase + ".*\"");
+			return false;
+		};
+
+		// Elements in file order
+		TempFile positionsFile(tempBase + ".positions");
+		TempFile texcoordsFile(tempBase + ".texcoords");
+		TempFile normalsFile(tempBase + ".normals");
+
+		// Keys of the welded vertices and the finished vertices, in vertex order
+		TempFile vertexKeysFile(tempBase + ".keys");
+		TempFile verticesFile(tempBase + ".vertices");
+
+		OBJSubMeshBuilder subMeshes;
+		auto indices = std::make_unique<ExternalSorter<OBJIndexRecord>>(tempBase + ".indices", sorterMemory);
+		auto normalRefs = std::make_unique<ExternalSorter<OBJAttributeRef>>(tempBase + ".normalrefs", sorterMemory);
+		auto texcoordRefs = std::make_unique<ExternalSorter<OBJAttributeRef>>(tempBase + ".texcoordrefs", sorterMemory);
+
+		size_t positionCount = 0;
+		size_t texcoordCount = 0;
+		size_t normalCount = 0;
+		size_t badTexcoordRefs = 0;
+		size_t badNormalRefs = 0;
+		size_t skippedFaces = 0;
+		size_t vertexCount = 0;
+		size_t usedPositions = 0;
+		{
+			// Parse piece by piece, write the elements to their files and the triangle corners to the sorter
+			ExternalSorter<OBJCornerRecord> corners(tempBase + ".corners", sorterMemory);
+			{
+				RecordWriter<glm::vec3> positions(positionsFile.getPath(), streamBuffer);
+				RecordWriter<glm::vec2> texcoords(texcoordsFile.getPath(), streamBuffer);
+				RecordWriter<glm::vec3> normals(normalsFile.getPath(), streamBuffer);
+
+				std::vector<Material> library;
+				std::vector<char> text(pieceSize);
+				size_t carried = 0;
+				size_t lines = 0;
+				uint64_t cornerCount = 0;
+				bool written = true;
+
+				while (true)
+				{
+					input.read(text.data() + carried, text.size() - carried);
+					size_t size = carried + (size_t)input.gcount();
+					bool last = !input.good();
+					if (input.bad())
+					{
+						reportError(stats, "could not read file \"" + path + "\"");
+						return false;
+					}
+
+					// Only whole lines are parsed, the rest is carried over to the next piece
+					size_t end = size;
+					if (!last)
+					{
+						size_t lineBreak = std::string_view(text.data(), size).rfind('\n');
+						if (lineBreak == std::string_view::npos)
+						{
+							reportError(stats, path + ":" + std::to_string(lines + 1) + ": line is longer than the memory limit allows");
+							return false;
+						}
+						end = lineBreak + 1;
+					}
+
+					OBJChunk chunk(std::pmr::get_default_resource());
+					chunk.text = std::string_view(text.data(), end);
+					parseChunk(&chunk, scale, options.loadTexcoords);
+					if (chunk.errorLine != nullptr)
+					{
+						std::string_view line(chunk.errorLine, text.data() + end - chunk.errorLine);
+						line = line.substr(0, line.find_first_of("\r\n"));
+						size_t ln = lines + std::count((const char*)text.data(), chunk.errorLine, '\n') + 1;
+						reportError(stats, path + ":" + std::to_string(ln) + ": could not parse line \"" + std::string(line) + "\"");
+						return false;
+					}
+
+					// Negative indices are relative to the elements before the piece, forward references are invalid
+					chunk.vertexBase = positionCount;
+					chunk.texcoordBase = texcoordCount;
+					chunk.normalBase = normalCount;
+					positionCount += chunk.vertices.size();
+					texcoordCount += chunk.texcoords.size();
+					normalCount += chunk.normals.size();
+					if (std::max({ positionCount, texcoordCount, normalCount }) > (size_t)INT_MAX)
+					{
+						reportError(stats, path + ": more than " + std::to_string(INT_MAX) + " elements of one kind");
+						return false;
+					}
+					resolveChunk(&chunk, positionCount, texcoordCount, normalCount);
+
+					written &= positions.write(chunk.vertices.data(), chunk.vertices.size());
+					written &= texcoords.write(chunk.texcoords.data(), chunk.texcoords.size());
+					written &= normals.write(chunk.normals.data(), chunk.normals.size());
+
+					badTexcoordRefs += chunk.badTexcoordRefs;
+					badNormalRefs += chunk.badNormalRefs;
+					skippedFaces += chunk.skippedFaces;
+					stats->faces += chunk.faceSizes.size();
+					stats->triangles += chunk.triangleCount;
+
+					const OBJCorner* face = chunk.corners.data();
+					auto statement = chunk.statements.begin();
+					for (size_t f = 0; f <= chunk.faceSizes.size(); ++f)
+					{
+						for (; statement != chunk.statements.end() && statement->face == f; ++statement)
+						{
+							if (statement->type == OBJStatement::GROUP)
+							{
+								subMeshes.setGroup(statement->name);
+							}
+							else if (statement->type == OBJStatement::MATERIAL)
+							{
+								subMeshes.setMaterial(statement->name);
+							}
+							else
+							{
+								loadMaterialLibraries(path, statement->name, &library, &stats->materialLibraries);
+								subMeshes.setMaterialLibrary(library);
+							}
+						}
+
+						if (f == chunk.faceSizes.size())
+						{
+							break;
+						}
+
+						unsigned int faceSize = chunk.faceSizes[f];
+						if (faceSize >= 3 && !(face[0].flags & OBJCorner::INVALID_FACE))
+						{
+							uint64_t subMesh = subMeshes.getSubMesh();
+							if (subMesh >> (64 - CORNER_ORDER_BITS) != 0)
+							{
+								reportError(stats, path + ": too many groups and materials");
+								return false;
+							}
+
+							// Polygons are split into a triangle fan around the first corner
+							OBJCornerRecord record = {};
+							OBJVertexKey first = makeVertexKey(face[0]);
+							OBJVertexKey previous = makeVertexKey(face[1]);
+							for (unsigned int c = 2; c < faceSize; ++c)
+							{
+								OBJVertexKey key = makeVertexKey(face[c]);
+								for (const OBJVertexKey& corner : { first, previous, key })
+								{
+									record.key = corner;
+									record.order = subMesh << CORNER_ORDER_BITS | cornerCount++;
+									written &= corners.push(record);
+								}
+								previous = key;
+							}
+							stats->corners += faceSize;
+						}
+						face += faceSize;
+					}
+
+					lines += std::count(text.data(), text.data() + end, '\n');
+					carried = size - end;
+					std::memmove(text.data(), text.data() + end, carried);
+					if (last)
+					{
+						break;
+					}
+				}
+
+				if (!written || !positions.close() || !texcoords.close() || !normals.close())
+				{
+					return tempError();
+				}
+			}
+
+			// Weld: equal keys are next to each other after sorting, every run of them is one vertex.
+			// Vertices are numbered in position order, so the positions can be read front to back later.
+			if (!corners.finish())
+			{
+				return tempError();
+			}
+
+			RecordWriter<OBJVertexKey> vertexKeys(vertexKeysFile.getPath(), streamBuffer);
+			bool written = true;
+			OBJVertexKey previous = {};
+			OBJCornerRecord corner;
+			while (corners.next(&corner))
+			{
+				if (vertexCount == 0 || !(corner.key == previous))
+				{
+					if (vertexCount == UINT32_MAX)
+					{
+						reportError(stats, path + ": more than " + std::to_string(UINT32_MAX) + " vertices");
+						return false;
+					}
+
+					usedPositions += vertexCount == 0 || corner.key.fv != previous.fv ? 1 : 0;
+					written &= vertexKeys.write(corner.key);
+					if (corner.key.fvt != OBJVertexKey::NONE)
+					{
+						written &= texcoordRefs->push({ corner.key.fvt, (uint32_t)vertexCount });
+					}
+					if (corner.key.fvn != OBJVertexKey::NONE)
+					{
+						written &= normalRefs->push({ corner.key.fvn, (uint32_t)vertexCount });
+					}
+					previous = corner.key;
+					vertexCount++;
+				}
+				written &= indices->push({ corner.order, (uint32_t)vertexCount - 1, 0 });
+			}
+
+			// Frees the memory of the index sorter until the chunks are built
+			if (!written || !vertexKeys.close() || !indices->finish())
+			{
+				return tempError();
+			}
+		}
+
+		// Texture coordinates and normals of the vertices, sorted by vertex
+		auto vertexNormals = std::make_unique<ExternalSorter<OBJVertexValue<glm::vec3>>>(tempBase + ".vertexnormals", sorterMemory);
+		auto vertexTexcoords = std::make_unique<ExternalSorter<OBJVertexValue<glm::vec2>>>(tempBase + ".vertextexcoords", sorterMemory);
+		if (!joinAttribute(*normalRefs, normalsFile.getPath(), streamBuffer, vertexNormals.get()))
+		{
+			return tempError();
+		}
+		normalRefs.reset();
+		if (!joinAttribute(*texcoordRefs, texcoordsFile.getPath(), streamBuffer, vertexTexcoords.get()))
+		{
+			return tempError();
+		}
+		texcoordRefs.reset();
+
+		// Put the vertices together, all inputs are in vertex order or, for the positions, in file order
+		{
+			RecordReader<OBJVertexKey> vertexKeys(vertexKeysFile.getPath(), streamBuffer);
+			RecordReader<glm::vec3> positions(positionsFile.getPath(), streamBuffer);
+			RecordWriter<OBJVertexRecord> vertices(verticesFile.getPath(), streamBuffer);
+
+			OBJVertexValue<glm::vec3> normal;
+			OBJVertexValue<glm::vec2> texcoord;
+			bool hasNormal = vertexNormals->next(&normal);
+			bool hasTexcoord = vertexTexcoords->next(&texcoord);
+
+			glm::vec3 position(0.0f);
+			uint64_t positionsRead = 0;
+			bool written = true;
+
+			OBJVertexKey key;
+			for (uint32_t vertex = 0; vertexKeys.next(&key); ++vertex)
+			{
+				for (; positionsRead <= key.fv; ++positionsRead)
+				{
+					if (!positions.next(&position))
+					{
+						return tempError();
+					}
+				}
+
+				OBJVertexRecord record = { position, glm::vec3(0.0f), glm::vec2(0.0f) };
+				if (hasNormal && normal.vertex == vertex)
+				{
+					record.normal = normal.value;
+					hasNormal = vertexNormals->next(&normal);
+				}
+				if (hasTexcoord && texcoord.vertex == vertex)
+				{
+					record.texcoord = texcoord.value;
+					hasTexcoord = vertexTexcoords->next(&texcoord);
+				}
+				written &= vertices.write(record);
+			}
+
+			if (!written || !vertices.close() || vertexKeys.isBroken())
+			{
+				return tempError();
+			}
+		}
+		vertexNormals.reset();
+		vertexTexcoords.reset();
+
+		// Triangles in submesh and file order, cut into chunks
+		ChunkedMeshWriter writer;
+		if (!writer.open(outputPath, options.loadTexcoords))
+		{
+			reportError(stats, "could not write \"" + outputPath + "\"");
+			return false;
+		}
+		{
+			OBJChunkAssembler assembler(verticesFile.getPath(), &writer, options.loadTexcoords);
+			if (!assembler.isOpen())
+			{
+				return tempError();
+			}
+
+			OBJIndexRecord index;
+			uint32_t triangle[3];
+			int corner = 0;
+			while (indices->next(&index))
+			{
+				triangle[corner++] = index.vertex;
+				if (corner == 3)
+				{
+					if (!assembler.addTriangle((uint32_t)(index.order >> CORNER_ORDER_BITS), triangle))
+					{
+						reportError(stats, "could not write \"" + outputPath + "\"");
+						return false;
+					}
+					corner = 0;
+				}
+			}
+			if (!assembler.flush())
+			{
+				reportError(stats, "could not write \"" + outputPath + "\"");
+				return false;
+			}
+		}
+		indices.reset();
+
+		if (!writer.finish(subMeshes.getMaterials(), subMeshes.getSubMeshes()))
+		{
+			reportError(stats, "could not write \"" + outputPath + "\"");
+			return false;
+		}
+
+		stats->positions = positionCount;
+		stats->texcoords = texcoordCount;
+		stats->normals = normalCount;
+		stats->vertices = vertexCount;
+		stats->splitVertices = vertexCount - usedPositions;
+		stats->mergedCorners = stats->corners - vertexCount;
+		stats->unusedPositions = positionCount - usedPositions;
+		stats->subMeshes = subMeshes.getSubMeshes().size();
+		stats->materials = subMeshes.getMaterials().size();
+
+		printWarnings(path, badTexcoordRefs, texcoordCount, badNormalRefs, normalCount, skippedFaces, subMeshes);
+		return true;
+	}
+
+	// Calls fn(face, faceSize) for every face of <chunk> that is not skipped, in file order
+	template <typename Fn>
+	static void forEachValidFace(const OBJChunk& chunk, Fn fn)
+	{
+		const OBJCorner* face = chunk.corners.data();
+		for (unsigned int faceSize : chunk.faceSizes)
+		{
+			if (faceSize >= 3 && !(face[0].flags & OBJCorner::INVALID_FACE))
+			{
+				fn(face, faceSize);
+			}
+			face += faceSize;
+		}
+	}
+
+	// Splits a polygon into a triangle fan around its first corner, vertex(i) is called once per corner in order
+	template <typename Fn>
+	static GLuint* writeTriangleFan(GLuint* index, unsigned int faceSize, Fn vertex)
+	{
+		GLuint first = vertex(0);
+		GLuint previous = vertex(1);
+		for (unsigned int i = 2; i < faceSize; ++i)
+		{
+			GLuint current = vertex(i);
+			*index++ = first;
+			*index++ = previous;
+			*index++ = current;
+			previous = current;
+		}
+		return index;
+	}
 
-namespace cg
-{
-	#define ASSERT_NORMALS_IN_BOUNDS(face, normals) \
-		if (face.fvn >= normals.size()) { \
-			std::cout << "Normal index is out of range. (" << face.fvn << " >= " << normals.size() << ")\n"; \
-			continue; }
+	// Shard of the weld that owns all keys of position <fv>
+	static size_t getWeldShard(unsigned int fv, size_t shardCount)
+	{
+		uint64_t h = ((uint64_t)fv * 0x9E3779B97F4A7C15ull) >> 32;
+		return (size_t)((h * shardCount) >> 32);
+	}
 
-	struct OBJData
+	// Weld: every distinct (position, texcoord, normal) combination becomes one vertex and the faces are written to
+	// <indices> as triangle fans. Every thread welds the keys of one shard of the positions, then the vertices are
+	// numbered in the order of their first corner in the file, so the result does not depend on the number of threads.
+	// Returns the keys of the vertices, <usedPositions> gets the number of positions any face refers to.
+	static std::pmr::vector<OBJVertexKey> weldChunks(std::pmr::vector<OBJChunk>& chunks, size_t vertexCount, GLuint* indices, size_t* usedPositions,
+		std::pmr::memory_resource* memory)
 	{
-		struct OBJFace
+		size_t chunkCount = chunks.size();
+		size_t shardCount = chunks.size();
+
+		// A single welder going through the file numbers the vertices in order already
+		if (chunkCount == 1)
+		{
+			OBJVertexWelder welder(vertexCount, memory);
+			std::pmr::vector<unsigned char> positionUsed(vertexCount, 0, memory);
+			*usedPositions = 0;
+			GLuint* index = indices;
+			forEachValidFace(chunks[0], [&](const OBJCorner* face, unsigned int faceSize)
+			{
+				index = writeTriangleFan(index, faceSize, [&](unsigned int i)
+				{
+					OBJVertexKey key = makeVertexKey(face[i]);
+					if (!positionUsed[key.fv])
+					{
+						positionUsed[key.fv] = 1;
+						++*usedPositions;
+					}
+					return welder.weld(key);
+				});
+			});
+			return welder.takeVertices();
+		}
+
+		size_t cornerCount = 0;
+		size_t triangleCount = 0;
+		for (OBJChunk& chunk : chunks)
+		{
+			chunk.cornerBase = cornerCount;
+			chunk.triangleBase = triangleCount;
+			cornerCount += chunk.weldedCorners;
+			triangleCount += chunk.triangleCount;
+		}
+
+		// Corners of every shard in every chunk
+		std::pmr::vector<size_t> offsets(chunkCount * shardCount, 0, memory);
+		parallelFor(chunkCount, [&](size_t c)
+		{
+			size_t* counts = &offsets[c * shardCount];
+			forEachValidFace(chunks[c], [&](const OBJCorner* face, unsigned int faceSize)
+			{
+				for (unsigned int i = 0; i < faceSize; ++i)
+				{
+					counts[getWeldShard(face[i].fv, shardCount)]++;
+				}
+			});
+		});
+
+		// Sorted by shard, in file order within every shard
+		std::pmr::vector<size_t> shardBegin(shardCount + 1, memory);
+		size_t offset = 0;
+		for (size_t s = 0; s < shardCount; ++s)
+		{
+			shardBegin[s] = offset;
+			for (size_t c = 0; c < chunkCount; ++c)
+			{
+				size_t count = offsets[c * shardCount + s];
+				offsets[c * shardCount + s] = offset;
+				offset += count;
+			}
+		}
+		shardBegin[shardCount] = offset;
+
+		struct Entry
 		{
-			unsigned int fv;
-			unsigned int fvt;
-			unsigned int fvn;
+			OBJVertexKey key;
+			uint32_t corner;
 		};
 
-		std::vector<glm::vec3> vertices;
-		std::vector<glm::vec3> normals;
-		std::vector<std::vector<OBJFace>> faces;
-	};
+		std::pmr::vector<Entry> entries(cornerCount, memory);
+		parallelFor(chunkCount, [&](size_t c)
+		{
+			size_t* next = &offsets[c * shardCount];
+			uint32_t corner = (uint32_t)chunks[c].cornerBase;
+			forEachValidFace(chunks[c], [&](const OBJCorner* face, unsigned int faceSize)
+			{
+				for (unsigned int i = 0; i < faceSize; ++i)
+				{
+					OBJVertexKey key = makeVertexKey(face[i]);
+					entries[next[getWeldShard(key.fv, shardCount)]++] = { key, corner++ };
+				}
+			});
+		});
 
-	static bool parseLine(const std::string& line, OBJData* objData);
+		// The first corner of a key stands for its vertex until the vertices are numbered
+		std::pmr::vector<uint32_t> firstCorners(cornerCount, memory);
+		std::pmr::vector<unsigned char> positionUsed(vertexCount, 0, memory);
+		std::pmr::vector<size_t> shardPositions(shardCount, 0, memory);
+		parallelFor(shardCount, [&](size_t s)
+		{
+			OBJVertexWelder welder(vertexCount / shardCount, memory);
+			std::pmr::vector<uint32_t> vertexCorners(memory);
+			for (size_t e = shardBegin[s]; e < shardBegin[s + 1]; ++e)
+			{
+				const Entry& entry = entries[e];
+				unsigned int vertex = welder.weld(entry.key);
+				if (vertex == vertexCorners.size())
+				{
+					vertexCorners.push_back(entry.corner);
 
-	bool OBJFile::load(const std::string& path, MeshData* meshData, float scale)
+					// Only this shard sees the position
+					if (!positionUsed[entry.key.fv])
+					{
+						positionUsed[entry.key.fv] = 1;
+						shardPositions[s]++;
+					}
+				}
+				firstCorners[entry.corner] = vertexCorners[vertex];
+			}
+		});
+
+		*usedPositions = 0;
+		for (size_t count : shardPositions)
+		{
+			*usedPositions += count;
+		}
+
+		// Number the vertices in file order, a prefix sum over the first corners of every chunk
+		std::pmr::vector<size_t> vertexBase(chunkCount, 0, memory);
+		parallelFor(chunkCount, [&](size_t c)
+		{
+			size_t begin = chunks[c].cornerBase;
+			size_t end = begin + chunks[c].weldedCorners;
+			for (size_t corner = begin; corner < end; ++corner)
+			{
+				vertexBase[c] += firstCorners[corner] == corner;
+			}
+		});
+
+		size_t keyCount = 0;
+		for (size_t& base : vertexBase)
+		{
+			size_t count = base;
+			base = keyCount;
+			keyCount += count;
+		}
+
+		std::pmr::vector<uint32_t> cornerVertices(cornerCount, memory);
+		parallelFor(chunkCount, [&](size_t c)
+		{
+			uint32_t vertex = (uint32_t)vertexBase[c];
+			size_t begin = chunks[c].cornerBase;
+			size_t end = begin + chunks[c].weldedCorners;
+			for (size_t corner = begin; corner < end; ++corner)
+			{
+				if (firstCorners[corner] == corner)
+				{
+					cornerVertices[corner] = vertex++;
+				}
+			}
+		});
+
+		std::pmr::vector<OBJVertexKey> keys(keyCount, memory);
+		parallelFor(chunkCount, [&](size_t c)
+		{
+			GLuint* index = indices + chunks[c].triangleBase * 3;
+			uint32_t corner = (uint32_t)chunks[c].cornerBase;
+			forEachValidFace(chunks[c], [&](const OBJCorner* face, unsigned int faceSize)
+			{
+				index = writeTriangleFan(index, faceSize, [&](unsigned int i)
+				{
+					uint32_t firstCorner = firstCorners[corner++];
+					GLuint vertex = cornerVertices[firstCorner];
+					if (firstCorner == corner - 1)
+					{
+						keys[vertex] = makeVertexKey(face[i]);
+					}
+					return vertex;
+				});
+			});
+		});
+		return keys;
+	}
+
+	bool parseFile(const std::string& path, MeshData* meshData, float scale, const OBJLoadOptions& options, OBJLoadStats* stats)
 	{
 		meshData->clearAll();
 
-		std::fstream file(path);
-
-		if (!file.good())
+		MappedFile file;
+		if (!file.open(path))
 		{
-			std::cout << "could not open file \"" << path << "\"";
+			reportError(stats, "could not open file \"" + path + "\"");
 			return false;
 		}
 
-		std::string line;
+		size_t threadCount = options.threads == 0 ? std::thread::hardware_concurrency() : options.threads;
+		threadCount = std::clamp<size_t>(std::min(threadCount, file.size() / MIN_CHUNK_SIZE), 1, 256);
+
+		// All temporaries come from the arena, it outlives them
+		MeshArena localArena;
+		MeshArena* arena = options.arena != nullptr ? options.arena : &localArena;
+		arena->reset();
 
-		size_t ln = 0;
-		OBJData objData;
+		std::pmr::vector<OBJChunk> chunks = splitChunks(file.view(), threadCount, arena);
 
-		while (!file.eof())
+		// Parse every chunk on its own
+		parallelFor(chunks.size(), [&](size_t i) { parseChunk(&chunks[i], scale, options.loadTexcoords); });
+
+		for (const OBJChunk& chunk : chunks)
 		{
-			getline(file, line);
-			ln++;
-			//std::cout << ln << ": " << line << '\n';
-			if (!parseLine(line, &objData))
+			if (chunk.errorLine != nullptr)
 			{
-				file.close();
+				std::string_view line(chunk.errorLine, file.data() + file.size() - chunk.errorLine);
+				line = line.substr(0, line.find_first_of("\r\n"));
+				size_t ln = std::count(file.data(), chunk.errorLine, '\n') + 1;
+				reportError(stats, path + ":" + std::to_string(ln) + ": could not parse line \"" + std::string(line) + "\"");
 				return false;
 			}
 		}
 
-		file.close();
+		// Prefix sums give each chunk its place in the merged arrays
+		size_t vertexCount = 0;
+		size_t texcoordCount = 0;
+		size_t normalCount = 0;
+		for (OBJChunk& chunk : chunks)
+		{
+			chunk.vertexBase = vertexCount;
+			chunk.texcoordBase = texcoordCount;
+			chunk.normalBase = normalCount;
+			vertexCount += chunk.vertices.size();
+			texcoordCount += chunk.texcoords.size();
+			normalCount += chunk.normals.size();
+		}
+
+		// Turn chunk relative indices into global ones and count the triangles
+		parallelFor(chunks.size(), [&](size_t i) { resolveChunk(&chunks[i], vertexCount, texcoordCount, normalCount); });
 
-		meshData->vertices = objData.vertices;
-		for (size_t i = 0; i < meshData->vertices.size(); ++i)
+		size_t indexCount = 0;
+		size_t badTexcoordRefs = 0;
+		size_t badNormalRefs = 0;
+		size_t skippedFaces = 0;
+		for (const OBJChunk& chunk : chunks)
 		{
-			meshData->vertices[i] *= scale;
-			meshData->colors.emplace_back(0.8f, 0.1f, 0.1f);
+			indexCount += chunk.triangleCount * 3;
+			badTexcoordRefs += chunk.badTexcoordRefs;
+			badNormalRefs += chunk.badNormalRefs;
+			skippedFaces += chunk.skippedFaces;
+			stats->faces += chunk.faceSizes.size();
 		}
-		meshData->normals.resize(meshData->vertices.size());
 
-		for (size_t i = 0; i < objData.faces.size(); ++i)
+		// Merge
+		std::pmr::vector<glm::vec3> positions(arena);
+		std::pmr::vector<glm::vec2> texcoords(arena);
+		std::pmr::vector<glm::vec3> normals(arena);
+		mergeChunks(chunks, &OBJChunk::vertices, &OBJChunk::vertexBase, vertexCount, &positions);
+		mergeChunks(chunks, &OBJChunk::texcoords, &OBJChunk::texcoordBase, texcoordCount, &texcoords);
+		mergeChunks(chunks, &OBJChunk::normals, &OBJChunk::normalBase, normalCount, &normals);
+
+		std::vector<Material> library;
+		for (const OBJChunk& chunk : chunks)
 		{
-			auto& face = objData.faces[i];
-			if (face.size() > 4)
+			for (const OBJStatement& statement : chunk.statements)
 			{
-				std::cout << "Skipping face with more than 4 vertices\n";
-				continue;
+				if (statement.type == OBJStatement::MATERIAL_LIBRARY)
+				{
+					loadMaterialLibraries(path, statement.name, &library, &stats->materialLibraries);
+				}
 			}
-			else if (face.size() == 4)
-			{
-				meshData->indices.push_back(face[0].fv);
-				meshData->indices.push_back(face[1].fv);
-				meshData->indices.push_back(face[2].fv);
+		}
 
-				meshData->indices.push_back(face[0].fv);
-				meshData->indices.push_back(face[2].fv);
-				meshData->indices.push_back(face[3].fv);
+		OBJSubMeshBuilder subMeshes;
+		subMeshes.setMaterialLibrary(std::move(library));
 
-				ASSERT_NORMALS_IN_BOUNDS(face[0], objData.normals);
-				ASSERT_NORMALS_IN_BOUNDS(face[1], objData.normals);
-				ASSERT_NORMALS_IN_BOUNDS(face[2], objData.normals);
-				ASSERT_NORMALS_IN_BOUNDS(face[3], objData.normals);
+		meshData->indices.resize(indexCount);
+		size_t usedPositions = 0;
+		std::pmr::vector<OBJVertexKey> keys = weldChunks(chunks, vertexCount, meshData->indices.data(), &usedPositions, arena);
 
-				meshData->normals[face[0].fv] = objData.normals[face[0].fvn];
-				meshData->normals[face[1].fv] = objData.normals[face[1].fvn];
-				meshData->normals[face[2].fv] = objData.normals[face[2].fvn];
-				meshData->normals[face[3].fv] = objData.normals[face[3].fvn];
+		// Where the group or material changes, from the statements alone: a run starts at the first face after them
+		bool runPending = true;
+		size_t weldedCorners = 0;
+		for (const OBJChunk& chunk : chunks)
+		{
+			weldedCorners += chunk.weldedCorners;
+
+			// Faces before the first statement of the chunk
+			if (runPending && chunk.triangleCount > 0 && (chunk.statements.empty() || chunk.statementTriangles[0] != 0))
+			{
+				subMeshes.beginFace(chunk.triangleBase);
+				runPending = false;
 			}
-			else if (face.size() == 3)
+
+			for (size_t s = 0; s < chunk.statements.size(); ++s)
 			{
-				meshData->indices.push_back(face[0].fv);
-				meshData->indices.push_back(face[1].fv);
-				meshData->indices.push_back(face[2].fv);
+				const OBJStatement& statement = chunk.statements[s];
+				if (statement.type == OBJStatement::GROUP)
+				{
+					subMeshes.setGroup(statement.name);
+				}
+				else if (statement.type == OBJStatement::MATERIAL)
+				{
+					subMeshes.setMaterial(statement.name);
+				}
+
+				// The last of the statements before a face decides
+				size_t triangle = chunk.statementTriangles[s];
+				runPending = triangle == OBJChunk::NO_TRIANGLE || (s + 1 < chunk.statements.size() && chunk.statementTriangles[s + 1] == triangle);
+				if (!runPending)
+				{
+					subMeshes.beginFace(chunk.triangleBase + triangle);
+				}
+			}
+		}
 
-				ASSERT_NORMALS_IN_BOUNDS(face[0], objData.normals);
-				ASSERT_NORMALS_IN_BOUNDS(face[1], objData.normals);
-				ASSERT_NORMALS_IN_BOUNDS(face[2], objData.normals);
+		// Gather the attributes of the welded vertices
+		meshData->vertices.resize(keys.size());
+		meshData->normals.resize(keys.size());
+		// Without materials every vertex has MeshData::constantColor, the submeshes add per-vertex colors if needed
+		meshData->colors.clear();
+		meshData->updateIndexType();
+		if (options.loadTexcoords)
+		{
+			meshData->texcoords.resize(keys.size());
+		}
 
-				meshData->normals[face[0].fv] = objData.normals[face[0].fvn];
-				meshData->normals[face[1].fv] = objData.normals[face[1].fvn];
-				meshData->normals[face[2].fv] = objData.normals[face[2].fvn];
+		parallelFor(chunks.size(), [&](size_t t)
+		{
+			size_t begin = keys.size() * t / chunks.size();
+			size_t end = keys.size() * (t + 1) / chunks.size();
+			for (size_t i = begin; i < end; ++i)
+			{
+				const OBJVertexKey& key = keys[i];
+				meshData->vertices[i] = positions[key.fv];
+				meshData->normals[i] = key.fvn != OBJVertexKey::NONE ? normals[key.fvn] : glm::vec3(0.0f);
+				if (options.loadTexcoords)
+				{
+					meshData->texcoords[i] = key.fvt != OBJVertexKey::NONE ? texcoords[key.fvt] : glm::vec2(0.0f);
+				}
 			}
-			else
+		});
+
+		// Sort the triangles by material, needs the final vertices for the bounds
+		subMeshes.build(meshData, arena);
+
+		// A single material colors every vertex the same, a file without normals leaves them all 0
+		meshData->collapseConstantAttributes();
+
+		stats->positions = vertexCount;
+		stats->texcoords = texcoordCount;
+		stats->normals = normalCount;
+		stats->triangles = indexCount / 3;
+		stats->corners = weldedCorners;
+		stats->vertices = keys.size();
+		stats->splitVertices = keys.size() - usedPositions;
+		stats->mergedCorners = weldedCorners - keys.size();
+		stats->unusedPositions = vertexCount - usedPositions;
+		stats->subMeshes = meshData->subMeshes.size();
+		stats->materials = meshData->materials.size();
+		if (options.optimize)
+		{
+			MeshOptimizer::optimize(meshData, &stats->cacheBefore, &stats->cacheAfter, MeshOptimizer::DEFAULT_CACHE_SIZE, options.overdrawThreshold, arena);
+			if (options.strips)
 			{
-				std::cout << "Skipping face with less than 3 vertices\n";
-				continue;
+				MeshOptimizer::convertToStrips(meshData, arena);
+			}
+			else if (options.meshlets)
+			{
+				MeshletBuilder::buildMeshlets(meshData, MeshletBuilder::DEFAULT_MAX_VERTICES, MeshletBuilder::DEFAULT_MAX_TRIANGLES, arena);
 			}
+
+			// Of the order that is drawn, after the last pass
+			stats->cacheAfter = MeshOptimizer::analyzeVertexCache(*meshData, MeshOptimizer::DEFAULT_CACHE_SIZE, arena);
+		}
+
+		stats->arenaAllocations = arena->getAllocationCount();
+		stats->heapAllocations = arena->getHeapAllocationCount();
+
+		printWarnings(path, badTexcoordRefs, texcoordCount, badNormalRefs, normalCount, skippedFaces, subMeshes);
+		return true;
+	}
+
+	static void skipWhitespace(std::string_view& str)
+	{
+		size_t i = 0;
+		while (i < str.size() && (str[i] == ' ' || str[i] == '\t'))
+		{
+			++i;
 		}
+		str.remove_prefix(i);
+	}
+
+	static bool nextFloat(std::string_view& str, float* f)
+	{
+		skipWhitespace(str);
+
+		// from_chars does not accept a leading '+'
+		if (!str.empty() && str[0] == '+')
+		{
+			str.remove_prefix(1);
+		}
+
+		auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), *f);
+		if (ec != std::errc())
+		{
+			return false;
+		}
+		str.remove_prefix(ptr - str.data());
 		return true;
 	}
 
-	static float nextFloat(std::string& str)
+	static bool nextInt(std::string_view& str, int* i)
 	{
-		size_t idx = 0;
-		float f = std::stof(str, &idx);
-		str = str.substr(idx);
-		return f;
+		auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), *i);
+		if (ec != std::errc())
+		{
+			return false;
+		}
+		str.remove_prefix(ptr - str.data());
+		return true;
 	}
 
-	static float nextInt(std::string& str)
+	static bool nextVec3(std::string_view& str, glm::vec3* v)
 	{
-		size_t idx = 0;
-		int i = std::stoi(str, &idx);
-		str = str.substr(idx);
-		return i;
+		return nextFloat(str, &v->x) && nextFloat(str, &v->y) && nextFloat(str, &v->z);
 	}
 
-	static void skipWhitespace(std::string& str)
+	// Stores a 1-based OBJ index as 0-based index.
+	// Negative indices count back from the last element parsed so far,
+	// they are stored relative to the start of the chunk and marked with <relativeFlag>.
+	static bool storeIndex(int idx, size_t localCount, int* out, unsigned char* flags, unsigned char relativeFlag)
 	{
-		if (str.empty())
+		if (idx > 0)
 		{
-			return;
+			*out = idx - 1;
+			return true;
 		}
-		size_t i;
-		for (i = 0; i < str.size(); ++i)
+		if (idx < 0)
 		{
-			if (!(str[i] == ' ' && str[i] == '\t'))
+			*out = (int)localCount + idx;
+			*flags |= relativeFlag;
+			return true;
+		}
+		return false;
+	}
+
+	static bool parseFace(std::string_view l, OBJChunk* chunk, bool loadTexcoords)
+	{
+		unsigned int faceSize = 0;
+		while (true)
+		{
+			skipWhitespace(l);
+			if (l.empty())
 			{
 				break;
 			}
+
+			OBJCorner corner = {};
+
+			// x...
+			int fv, fvt, fvn;
+			if (!nextInt(l, &fv) || !storeIndex(fv, chunk->vertices.size(), &corner.fv, &corner.flags, OBJCorner::FV_RELATIVE))
+			{
+				return false;
+			}
+
+			if (!l.empty() && l[0] == '/')
+			{
+				// x/...
+				l.remove_prefix(1);
+				if (!l.empty() && l[0] != '/')
+				{
+					// x/x...
+					if (!nextInt(l, &fvt))
+					{
+						return false;
+					}
+					if (loadTexcoords)
+					{
+						if (!storeIndex(fvt, chunk->texcoords.size(), &corner.fvt, &corner.flags, OBJCorner::FVT_RELATIVE))
+						{
+							return false;
+						}
+						corner.flags |= OBJCorner::HAS_TEXCOORD;
+					}
+				}
+				if (!l.empty() && l[0] == '/')
+				{
+					// x//x or x/x/x
+					l.remove_prefix(1);
+					if (!nextInt(l, &fvn) || !storeIndex(fvn, chunk->normals.size(), &corner.fvn, &corner.flags, OBJCorner::FVN_RELATIVE))
+					{
+						return false;
+					}
+					corner.flags |= OBJCorner::HAS_NORMAL;
+				}
+			}
+
+			chunk->corners.push_back(corner);
+			faceSize++;
 		}
-		str = str.substr(i + 1);
+
+		chunk->faceSizes.push_back(faceSize);
+		return true;
 	}
 
-	static bool isNextWhitespace(std::string& str)
+	// Rest of a line without surrounding whitespace, names may contain spaces
+	static std::string_view trimName(std::string_view str)
 	{
-		return !str.empty() && !(str[0] == ' ' && str[0] == '\t');
+		skipWhitespace(str);
+		size_t end = str.find_last_not_of(" \t");
+		return end == std::string_view::npos ? std::string_view() : str.substr(0, end + 1);
 	}
 
-	static void skipOne(std::string& str)
+	// Checks for a keyword followed by whitespace and removes it from <line>
+	static bool nextKeyword(std::string_view& line, std::string_view keyword)
 	{
-		if (str.empty())
+		if (line.size() <= keyword.size() || !line.starts_with(keyword))
 		{
-			return;
+			return false;
+		}
+		char c = line[keyword.size()];
+		if (c != ' ' && c != '\t')
+		{
+			return false;
 		}
-		str = str.substr(1);
+		line.remove_prefix(keyword.size() + 1);
+		return true;
 	}
 
-	bool parseLine(const std::string& line, OBJData* objData)
+	static bool parseLine(std::string_view line, OBJChunk* chunk, float scale, bool loadTexcoords)
 	{
-		if (line.starts_with("#"))
+		skipWhitespace(line);
+
+		if (line.empty() || line[0] == '#')
 		{
 			return true;
 		}
 
-
-		if (line.starts_with("v "))
+		if (nextKeyword(line, "v"))
+		{
+			glm::vec3 v;
+			if (!nextVec3(line, &v))
+			{
+				return false;
+			}
+			chunk->vertices.push_back(v * scale);
+		}
+		else if (nextKeyword(line, "vn"))
+		{
+			glm::vec3 vn;
+			if (!nextVec3(line, &vn))
+			{
+				return false;
+			}
+			chunk->normals.push_back(vn);
+		}
+		else if (nextKeyword(line, "vt"))
 		{
-			std::string l = line.substr(2);
-			float vx = nextFloat(l);
-			float vy = nextFloat(l);
-			float vz = nextFloat(l);
+			if (!loadTexcoords)
+			{
+				return true;
+			}
 
-			objData->vertices.emplace_back(vx, vy, vz);
+			// The second coordinate is optional
+			glm::vec2 vt(0.0f);
+			if (!nextFloat(line, &vt.x))
+			{
+				return false;
+			}
+			nextFloat(line, &vt.y);
+			chunk->texcoords.push_back(vt);
+		}
+		else if (nextKeyword(line, "f"))
+		{
+			return parseFace(line, chunk, loadTexcoords);
+		}
+		else if (nextKeyword(line, "g") || nextKeyword(line, "o"))
+		{
+			chunk->statements.push_back({ OBJStatement::GROUP, chunk->faceSizes.size(), trimName(line) });
+		}
+		else if (nextKeyword(line, "usemtl"))
+		{
+			chunk->statements.push_back({ OBJStatement::MATERIAL, chunk->faceSizes.size(), trimName(line) });
+		}
+		else if (nextKeyword(line, "mtllib"))
+		{
+			chunk->statements.push_back({ OBJStatement::MATERIAL_LIBRARY, chunk->faceSizes.size(), trimName(line) });
 		}
 
-		if (line.starts_with("vn "))
+		return true;
+	}
+
+	bool parseMTL(const std::string& path, std::vector<Material>* materials)
+	{
+		MappedFile file;
+		if (!file.open(path))
 		{
-			std::string l = line.substr(3);
-			float vx = nextFloat(l);
-			float vy = nextFloat(l);
-			float vz = nextFloat(l);
-			objData->normals.emplace_back(vx, vy, vz);
+			return false;
 		}
 
-		if (line.starts_with("f "))
+		std::string_view text = file.view();
+		Material* material = nullptr;
+		while (!text.empty())
 		{
-			std::vector<OBJData::OBJFace> face;
-			face.reserve(4);
+			size_t end = text.find('\n');
+			std::string_view line = text.substr(0, end);
+			text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
 
-			std::string l = line.substr(2);
-			int fv, fvt, fvn;
-			while (!l.empty())
+			if (!line.empty() && line.back() == '\r')
 			{
-				// x...
-				fv = nextInt(l) - 1;
-				if (l[0] == '/')
-				{
-					// x/...
-					skipOne(l);
-					if (l[0] == '/')
-					{
-						// x//x
-						skipOne(l);
-						fvn = nextInt(l) - 1;
-					}
-					else
-					{
-						// x/x/x
-						fvt = nextInt(l) - 1;
-						skipOne(l);
-						fvn = nextInt(l) - 1;
-					}
-				}
-				skipWhitespace(l);
-				face.emplace_back(fv, fvt, fvn);
+				line.remove_suffix(1);
 			}
+			skipWhitespace(line);
 
-			objData->faces.push_back(face);
+			if (nextKeyword(line, "newmtl"))
+			{
+				materials->emplace_back();
+				material = &materials->back();
+				material->name = trimName(line);
+			}
+			else if (material == nullptr)
+			{
+				// Nothing to assign to before the first newmtl
+				continue;
+			}
+			else if (nextKeyword(line, "Ka"))
+			{
+				nextVec3(line, &material->ambient);
+			}
+			else if (nextKeyword(line, "Kd"))
+			{
+				nextVec3(line, &material->diffuse);
+			}
+			else if (nextKeyword(line, "Ks"))
+			{
+				nextVec3(line, &material->specular);
+			}
+			else if (nextKeyword(line, "Ns"))
+			{
+				nextFloat(line, &material->shininess);
+			}
 		}
+		return true;
+	}
+
+	void parseChunk(OBJChunk* chunk, float scale, bool loadTexcoords)
+	{
+		const char* pos = chunk->text.data();
+		const char* end = pos + chunk->text.size();
+
+		while (pos < end)
+		{
+			const char* lineEnd = (const char*)std::memchr(pos, '\n', end - pos);
+			if (lineEnd == nullptr)
+			{
+				lineEnd = end;
+			}
+
+			std::string_view line(pos, lineEnd - pos);
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+
+			if (!parseLine(line, chunk, scale, loadTexcoords))
+			{
+				chunk->errorLine = pos;
+				return;
+			}
 
-		//std::cout << line << '\n';
+			pos = lineEnd + 1;
+		}
+	}
 
+	// Makes a stored index global and checks that it is in [0, count)
+	static bool resolveIndex(int* idx, bool relative, size_t base, size_t count)
+	{
+		long long global = relative ? (long long)base + *idx : *idx;
+		if (global < 0 || (size_t)global >= count)
+		{
+			return false;
+		}
+		*idx = (int)global;
 		return true;
 	}
-}
\ No newline at end of file
+
+	void resolveChunk(OBJChunk* chunk, size_t vertexCount, size_t texcoordCount, size_t normalCount)
+	{
+		chunk->statementTriangles.assign(chunk->statements.size(), OBJChunk::NO_TRIANGLE);
+		size_t statement = 0;
+
+		OBJCorner* face = chunk->corners.data();
+		for (size_t f = 0; f < chunk->faceSizes.size(); ++f)
+		{
+			unsigned int faceSize = chunk->faceSizes[f];
+			bool valid = faceSize >= 3;
+			for (unsigned int c = 0; c < faceSize; ++c)
+			{
+				OBJCorner& corner = face[c];
+				valid &= resolveIndex(&corner.fv, corner.flags & OBJCorner::FV_RELATIVE, chunk->vertexBase, vertexCount);
+
+				if ((corner.flags & OBJCorner::HAS_TEXCOORD) &&
+					!resolveIndex(&corner.fvt, corner.flags & OBJCorner::FVT_RELATIVE, chunk->texcoordBase, texcoordCount))
+				{
+					corner.flags &= ~OBJCorner::HAS_TEXCOORD;
+					chunk->badTexcoordRefs++;
+				}
+
+				if ((corner.flags & OBJCorner::HAS_NORMAL) &&
+					!resolveIndex(&corner.fvn, corner.flags & OBJCorner::FVN_RELATIVE, chunk->normalBase, normalCount))
+				{
+					corner.flags &= ~OBJCorner::HAS_NORMAL;
+					chunk->badNormalRefs++;
+				}
+			}
+
+			if (valid)
+			{
+				for (; statement < chunk->statements.size() && chunk->statements[statement].face <= f; ++statement)
+				{
+					chunk->statementTriangles[statement] = chunk->triangleCount;
+				}
+				chunk->triangleCount += faceSize - 2;
+				chunk->weldedCorners += faceSize;
+			}
+			else
+			{
+				if (faceSize > 0)
+				{
+					face[0].flags |= OBJCorner::INVALID_FACE;
+				}
+				chunk->skippedFaces++;
+			}
+			face += faceSize;
+		}
+	}
+}
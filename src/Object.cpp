@@ -26,26 +26,79 @@ namespace cg
 
 	void Object::setMesh(const MeshData& mesh)
 	{
-		m_meshInfo = MeshGLInfo::generate(mesh);
-		updateVAO();
+		setMeshInfo(MeshGLInfo::generate(mesh));
 		//updateNormalsModel(m_normalsDisplayObj, &mesh);
 	}
 
+	void Object::setMeshInfo(std::shared_ptr<MeshGLInfo> meshInfo)
+	{
+		m_meshInfo = meshInfo;
+		m_lods.clear();
+		updateVAO();
+	}
+
+	void Object::setLODs(std::vector<LOD> lods)
+	{
+		m_lods = std::move(lods);
+		updateVAO();
+	}
+
+	// Builds <vao> for drawing <meshInfo> with <shader>
+	static void buildVAO(VertexArrayObject* vao, const MeshGLInfo& meshInfo, GLSLProgram* shader)
+	{
+		vao->deleteVAO();
+		vao->generateVAO();
+
+		// The formats carry stride and offsets, so this works for every layout
+		vao->bindShaderAttrib(meshInfo.getPositionBufferID(), shader, "position", meshInfo.getPositionFormat());
+		if (meshInfo.isColorConstant())
+		{
+			vao->setConstantAttrib(shader, "color", meshInfo.getConstantColor());
+		}
+		else
+		{
+			vao->bindShaderAttrib(meshInfo.getColorBufferID(), shader, "color", meshInfo.getColorFormat());
+		}
+		if (meshInfo.isNormalConstant())
+		{
+			vao->setConstantAttrib(shader, "normal", meshInfo.getConstantNormal());
+		}
+		else
+		{
+			vao->bindShaderAttrib(meshInfo.getNormalBufferID(), shader, "normal", meshInfo.getNormalFormat());
+		}
+		vao->bindIndexBuffer(meshInfo.getIndexBufferID());
+	}
+
 	void Object::updateVAO()
 	{
+		m_lodVAOs.clear();
+		m_selectedLOD = 0;
 		if (m_meshInfo == nullptr || m_shader == nullptr)
 		{
 			m_vao.deleteVAO();
 			return;
 		}
 
-		m_vao.deleteVAO();
-		m_vao.generateVAO();
+		buildVAO(&m_vao, *m_meshInfo, m_shader);
+		for (const LOD& lod : m_lods)
+		{
+			m_lodVAOs.push_back(std::make_unique<VertexArrayObject>());
+			buildVAO(m_lodVAOs.back().get(), *lod.meshInfo, m_shader);
+		}
+
+		m_meshRevision = m_meshInfo->getRevision();
+		m_shaderRevision = m_shader->getRevision();
+	}
+
+	bool Object::isVAOOutdated() const
+	{
+		if (m_meshInfo == nullptr || m_shader == nullptr)
+		{
+			return false;
+		}
 
-		m_vao.bindShaderAttribVec3f(m_meshInfo->getPositionBufferID(), m_shader, "position");
-		m_vao.bindShaderAttribVec3f(m_meshInfo->getColorBufferID(), m_shader, "color");
-		m_vao.bindShaderAttribVec3f(m_meshInfo->getNormalBufferID(), m_shader, "normal");
-		m_vao.bindIndexBuffer(m_meshInfo->getIndexBufferID());
+		return m_meshInfo->getRevision() != m_meshRevision || m_shader->getRevision() != m_shaderRevision;
 	}
 
 	void Object::rotateAroundOrigin(float deg, const glm::vec3& axis)
@@ -2,9 +2,12 @@
 
 #include "CG/GLSLProgram.h"
 #include "CG/VertexArrayObject.h"
+#include "CG/MeshletBuilder.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
+#include <algorithm>
+#include <limits>
 
 namespace cg
 {
@@ -19,8 +22,131 @@ namespace cg
 		}
 	}
 
-	void drawWithTransform(const std::shared_ptr<Object>& obj, glm::mat4x4 transform, VertexArrayObject& vao, const glm::mat4x4& proj, const glm::mat4x4& view, const glm::vec4& lightVec)
+	// True if the box lies completely outside one plane of the view frustum of <mvp>
+	static bool isBoxOutsideFrustum(const glm::mat4& mvp, const glm::vec3& min, const glm::vec3& max)
 	{
+		glm::vec4 corners[8];
+		for (int i = 0; i < 8; ++i)
+		{
+			glm::vec3 p((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+			corners[i] = mvp * glm::vec4(p, 1.0f);
+		}
+
+		// Clip space planes: -w <= x, y, z <= w
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			bool allBelow = true;
+			bool allAbove = true;
+			for (const glm::vec4& c : corners)
+			{
+				allBelow &= c[axis] < -c.w;
+				allAbove &= c[axis] > c.w;
+			}
+			if (allBelow || allAbove)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Coarsest LOD of <obj> whose error stays below one unit of <lodScale> at the depth of its origin.
+	// <lodScale> maps a size at view depth 1 to threshold units on screen, <mv> takes the mesh to view space.
+	static size_t selectLOD(const Object& obj, const glm::mat4& mv, float lodScale)
+	{
+		float depth = -(mv * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)).z;
+		if (obj.getLODCount() == 1 || depth <= 0.0f)
+		{
+			return 0;
+		}
+
+		// Errors are in model units, the largest axis scale makes them view units
+		glm::mat3 linear(mv);
+		float scale = std::max({ glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]) });
+		size_t level = 0;
+		while (level + 1 < obj.getLODCount() && obj.getLODError(level + 1) * scale * lodScale <= depth)
+		{
+			++level;
+		}
+		return level;
+	}
+
+	// Triangles drawn by <indexCount> indices, an upper bound for strips with restarts
+	static size_t countTriangles(GLenum drawMode, size_t indexCount)
+	{
+		if (drawMode == GL_TRIANGLES)
+		{
+			return indexCount / 3;
+		}
+		if (drawMode == GL_TRIANGLE_STRIP && indexCount > 2)
+		{
+			return indexCount - 2;
+		}
+		return 0;
+	}
+
+	// Draws the indices [indexOffset, indexOffset + indexCount) of <obj>. With <planes> and <eye> in model space, only the
+	// meshlets of the range that are neither outside the frustum nor facing away are drawn, with one glMultiDrawElements
+	// where neighbouring meshlets share a range.
+	static void drawRange(const Object& obj, uint32_t indexOffset, uint32_t indexCount, const glm::vec4* planes, const glm::vec3& eye, size_t* drawnTriangles)
+	{
+		size_t indexSize = obj.getIndexType() == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		const std::vector<Meshlet>& meshlets = obj.getMeshlets();
+		if (planes == nullptr || meshlets.empty())
+		{
+			glDrawElements(obj.getDrawMode(), indexCount, obj.getIndexType(), (const void*)(indexOffset * indexSize));
+			*drawnTriangles += countTriangles(obj.getDrawMode(), indexCount);
+			return;
+		}
+
+		// Only used on the render thread, kept so a frame does not allocate
+		static std::vector<GLsizei> counts;
+		static std::vector<const void*> offsets;
+		counts.clear();
+		offsets.clear();
+
+		uint32_t end = indexOffset + indexCount;
+		uint32_t lastEnd = 0;
+		auto first = std::lower_bound(meshlets.begin(), meshlets.end(), indexOffset,
+			[](const Meshlet& meshlet, uint32_t offset) { return meshlet.indexOffset < offset; });
+		for (auto meshlet = first; meshlet != meshlets.end() && meshlet->indexOffset < end; ++meshlet)
+		{
+			if (MeshletBuilder::isMeshletCulled(*meshlet, planes, eye))
+			{
+				continue;
+			}
+			if (!counts.empty() && meshlet->indexOffset == lastEnd)
+			{
+				counts.back() += meshlet->indexCount;
+			}
+			else
+			{
+				counts.push_back(meshlet->indexCount);
+				offsets.push_back((const void*)(meshlet->indexOffset * indexSize));
+			}
+			lastEnd = meshlet->indexOffset + meshlet->indexCount;
+			*drawnTriangles += meshlet->indexCount / 3;
+		}
+
+		if (!counts.empty())
+		{
+			glMultiDrawElements(obj.getDrawMode(), counts.data(), obj.getIndexType(), offsets.data(), (GLsizei)counts.size());
+		}
+	}
+
+	static void setMaterial(GLSLProgram* shader, const Material& material)
+	{
+		shader->setUniform("surfKa", material.ambient);
+		shader->setUniform("surfKd", material.diffuse);
+		shader->setUniform("surfKs", material.specular);
+		shader->setUniform("surfShininess", material.shininess);
+	}
+
+	void drawWithTransform(const std::shared_ptr<Object>& obj, glm::mat4x4 transform, const glm::mat4x4& proj, const glm::mat4x4& view, const glm::vec4& lightVec,
+		float lodScale, bool meshletCulling, size_t* drawnTriangles)
+	{
+		transform = transform * obj->localTransform;
+
 		// Translation
 		transform = glm::translate(transform, obj->position);
 		// Rotation
@@ -32,9 +158,21 @@ namespace cg
 		{
 			// Recursively draw children by continuing with the current model matrix
 			// In order to transform them relative to their parent
-			drawWithTransform(childObj, transform, childObj->getVAO(), proj, view, lightVec);
+			drawWithTransform(childObj, transform, proj, view, lightVec, lodScale, meshletCulling, drawnTriangles);
 		}
 
+		// Only objects that use a reloaded mesh or shader get a new VAO
+		if (obj->isVAOOutdated())
+		{
+			obj->updateVAO();
+		}
+
+		transform = glm::scale(transform, obj->scale);
+
+		// Before the position transform of quantized meshes, the LODs have their own
+		obj->selectLOD(selectLOD(*obj, view * transform, lodScale));
+
+		VertexArrayObject& vao = obj->getVAO();
 		if (vao.getVAO() == 0)
 		{
 			// Doesn't have a VAO, cannot be rendered
@@ -42,9 +180,24 @@ namespace cg
 			return;
 		}
 
-		transform = glm::scale(transform, obj->scale);
-
 		glm::mat3 nm = glm::inverseTranspose(glm::mat3(transform));
+
+		// Submesh bounds are in model space
+		glm::mat4 cullMatrix = proj * view * transform;
+
+		// So are the meshlets, they are culled against the planes of <cullMatrix> and the eye in model space
+		glm::vec4 meshletPlanes[6];
+		glm::vec3 eye(0.0f);
+		bool cullMeshlets = meshletCulling && !obj->getMeshlets().empty();
+		if (cullMeshlets)
+		{
+			MeshletBuilder::getFrustumPlanes(cullMatrix, meshletPlanes);
+			eye = glm::vec3(glm::inverse(view * transform)[3]);
+		}
+		const glm::vec4* planes = cullMeshlets ? meshletPlanes : nullptr;
+
+		// Quantized positions are mapped back to model space, normals are stored separately and do not need it
+		transform = transform * obj->getPositionTransform();
 		glm::mat4 mv = view * transform;
 
 		// MVP
@@ -57,10 +210,11 @@ namespace cg
 		// Gouraud
 		shader->setUniform("light", lightVec);
 		shader->setUniform("lightI", float(1.0f));
-		shader->setUniform("surfKa", glm::vec3(0.1f, 0.1f, 0.1f));
-		shader->setUniform("surfKd", glm::vec3(obj->getColor()));
-		shader->setUniform("surfKs", glm::vec3(1, 1, 1));
-		shader->setUniform("surfShininess", float(8.0f));
+
+		// Used for everything without a material
+		Material objectMaterial;
+		objectMaterial.diffuse = obj->getColor();
+		setMaterial(shader, objectMaterial);
 
 		// Shaded
 		shader->setUniform("mvp", mvp);
@@ -71,7 +225,48 @@ namespace cg
 		shader->setUniform("projectionMatrix", proj);
 
 		glBindVertexArray(vao.getVAO());
-		glDrawElements(obj->getDrawMode(), obj->getIndexBufferSize(), GL_UNSIGNED_SHORT, 0);
+		vao.applyConstantAttribs();
+
+		// The strips of one draw call are separated by the restart index. Strips from glTF files never contain it.
+		bool primitiveRestart = obj->getDrawMode() == GL_TRIANGLE_STRIP;
+		if (primitiveRestart)
+		{
+			glEnable(GL_PRIMITIVE_RESTART);
+			glPrimitiveRestartIndex(obj->getRestartIndex());
+		}
+
+		const std::vector<SubMesh>& subMeshes = obj->getSubMeshes();
+		if (subMeshes.empty())
+		{
+			drawRange(*obj, 0, obj->getIndexBufferSize(), planes, eye, drawnTriangles);
+		}
+		else
+		{
+			// Ranges are sorted by material, so the material uniforms only change between groups of ranges
+			const std::vector<Material>& materials = obj->getMaterials();
+			uint32_t currentMaterial = SubMesh::NO_MATERIAL;
+
+			for (const SubMesh& subMesh : subMeshes)
+			{
+				if (isBoxOutsideFrustum(cullMatrix, subMesh.boundsMin, subMesh.boundsMax))
+				{
+					continue;
+				}
+
+				if (subMesh.material != currentMaterial)
+				{
+					setMaterial(shader, subMesh.material == SubMesh::NO_MATERIAL ? objectMaterial : materials[subMesh.material]);
+					currentMaterial = subMesh.material;
+				}
+
+				drawRange(*obj, subMesh.indexOffset, subMesh.indexCount, planes, eye, drawnTriangles);
+			}
+		}
+
+		if (primitiveRestart)
+		{
+			glDisable(GL_PRIMITIVE_RESTART);
+		}
 		glBindVertexArray(0);
 	}
 
@@ -82,9 +277,15 @@ namespace cg
 
 		auto light = getUseViewLight() ? glm::vec4(0, 0, 0, 1) : glm::vec4(getGlobalDirectionalLight(), 0.0f);
 
+		// A size s at view depth d covers s * proj[1][1] / d * height / 2 pixels. A threshold of 0 keeps every object at full detail.
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		float lodScale = m_lodThreshold > 0.0f ? proj[1][1] * 0.5f * viewport[3] / m_lodThreshold : std::numeric_limits<float>::max();
+
+		m_drawnTriangles = 0;
 		for(const std::shared_ptr<Object>& obj : m_objects)
 		{ 
-			drawWithTransform(obj, glm::mat4x4(1.0f), obj->getVAO(), proj, view, light);
+			drawWithTransform(obj, glm::mat4x4(1.0f), proj, view, light, lodScale, m_meshletCulling, &m_drawnTriangles);
 		}
 	}
 }
\ No newline at end of file
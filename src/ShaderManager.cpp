@@ -5,11 +5,13 @@ namespace cg
 #define VERBOSE_SHADER false
 
     static std::unordered_map<std::string, GLSLProgram> programs;
+    static std::unordered_map<std::string, ShaderManager::ShaderFiles> programFiles;
 
 	bool ShaderManager::loadShader(const std::string& name, std::initializer_list<std::pair<std::string, GLSLShader::GLSLShaderType>> list)
 	{
         // Put an empty program into the map
 		GLSLProgram& program = programs.emplace(std::piecewise_construct, std::make_tuple(name), std::make_tuple(VERBOSE_SHADER)).first->second;
+        programFiles[name] = ShaderFiles(list);
 
         for (const auto& [path, type] : list)
         {
@@ -38,4 +40,49 @@ namespace cg
     {
         return programs[name].getHandle();
     }
+
+    std::vector<std::string> ShaderManager::getShaderNames()
+    {
+        std::vector<std::string> names;
+        for (const auto& [name, files] : programFiles)
+        {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    const ShaderManager::ShaderFiles& ShaderManager::getShaderFiles(const std::string& name)
+    {
+        return programFiles[name];
+    }
+
+    bool ShaderManager::reloadShader(const std::string& name, const std::vector<std::string>& sources)
+    {
+        const ShaderFiles& files = programFiles[name];
+        if (sources.size() != files.size())
+        {
+            return false;
+        }
+
+        // Compile into a new program so the old one keeps working if anything fails
+        GLSLProgram program(VERBOSE_SHADER);
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            if (!program.compileShaderFromString(sources[i], files[i].second))
+            {
+                std::cerr << files[i].first << ": " << program.log();
+                return false;
+            }
+        }
+
+        if (!program.link())
+        {
+            std::cerr << name << ": " << program.log();
+            return false;
+        }
+
+        // The old program is deleted with <program>
+        programs[name].swap(program);
+        return true;
+    }
 }
\ No newline at end of file
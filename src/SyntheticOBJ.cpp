@@ -0,0 +1,260 @@
+#include "CG/SyntheticOBJ.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <charconv>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+namespace cg::SyntheticOBJ
+{
+	// Increase whenever the generated files change, old files are not reused then
+	static const int GENERATOR_VERSION = 1;
+
+	// Text is collected up to this size before it is written
+	static const size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+	// Buffered text output with std::to_chars, much faster than formatting through the stream
+	class OBJWriter
+	{
+	public:
+		explicit OBJWriter(std::ofstream& file) : m_file(file)
+		{
+			m_buffer.reserve(WRITE_BUFFER_SIZE + 256);
+		}
+
+		~OBJWriter()
+		{
+			flush();
+		}
+
+		void text(const char* s)
+		{
+			m_buffer += s;
+		}
+
+		void number(float value)
+		{
+			char digits[32];
+			auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, 5);
+			m_buffer.append(digits, result.ptr);
+		}
+
+		void number(size_t value)
+		{
+			char digits[32];
+			auto result = std::to_chars(digits, digits + sizeof(digits), value);
+			m_buffer.append(digits, result.ptr);
+		}
+
+		void endLine()
+		{
+			m_buffer += '\n';
+			if (m_buffer.size() >= WRITE_BUFFER_SIZE)
+			{
+				flush();
+			}
+		}
+
+		void flush()
+		{
+			m_file.write(m_buffer.data(), m_buffer.size());
+			m_buffer.clear();
+		}
+
+	private:
+		std::ofstream& m_file;
+		std::string m_buffer;
+	};
+
+	// std::uniform_real_distribution differs between standard libraries, this does not
+	static float random01(std::mt19937& rng)
+	{
+		return (rng() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	const char* getShapeName(FaceShape shape)
+	{
+		return shape == FaceShape::QUADS ? "quads" : "triangles";
+	}
+
+	const char* getFormName(VertexForm form)
+	{
+		switch (form)
+		{
+		case VertexForm::POSITION: return "v";
+		case VertexForm::POSITION_NORMAL: return "v//vn";
+		case VertexForm::POSITION_TEXCOORD_NORMAL: return "v/vt/vn";
+		}
+		return "";
+	}
+
+	std::string getFileName(const Options& options)
+	{
+		// "/" cannot be part of a file name: "v//vn" -> "v-vn"
+		std::string form;
+		for (const char* c = getFormName(options.form); *c != '\0'; ++c)
+		{
+			if (*c != '/')
+			{
+				form += *c;
+			}
+			else if (form.back() != '-')
+			{
+				form += '-';
+			}
+		}
+
+		return "synthetic" + std::to_string(GENERATOR_VERSION) + "_" + getShapeName(options.shape) + "_" + form + "_"
+			+ std::to_string(options.faces) + "_s" + std::to_string(options.seed) + ".obj";
+	}
+
+	bool write(const std::string& path, const Options& options)
+	{
+		// Grid of cells, every cell is one quad or two triangles. The last row is only partly filled.
+		size_t cells = options.shape == FaceShape::QUADS ? options.faces : (options.faces + 1) / 2;
+		size_t columns = std::max<size_t>(1, (size_t)std::ceil(std::sqrt((double)cells)));
+		size_t rows = std::max<size_t>(1, (cells + columns - 1) / columns);
+		size_t vertexColumns = columns + 1;
+		size_t vertexCount = vertexColumns * (rows + 1);
+
+		// Write to a temporary file first so an interrupted run never leaves a file that looks complete
+		std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.good())
+			{
+				std::cout << "could not write \"" << tempPath << "\"\n";
+				return false;
+			}
+
+			OBJWriter out(file);
+			out.text("# synthetic mesh, ");
+			out.number(options.faces);
+			out.text(" faces");
+			out.endLine();
+
+			// Positions: a height field with some noise, so the numbers do not repeat
+			std::mt19937 rng(options.seed);
+			float cellSize = 1.0f / (float)columns;
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				float x = (v % vertexColumns) * cellSize;
+				float z = (v / vertexColumns) * cellSize;
+				float y = 0.05f * std::sin(x * 17.0f) * std::cos(z * 13.0f) + 0.002f * random01(rng);
+
+				out.text("v ");
+				out.number(x - 0.5f);
+				out.text(" ");
+				out.number(y);
+				out.text(" ");
+				out.number(z - 0.5f);
+				out.endLine();
+			}
+
+			if (options.form == VertexForm::POSITION_TEXCOORD_NORMAL)
+			{
+				for (size_t v = 0; v < vertexCount; ++v)
+				{
+					out.text("vt ");
+					out.number((v % vertexColumns) / (float)columns);
+					out.text(" ");
+					out.number((v / vertexColumns) / (float)rows);
+					out.endLine();
+				}
+			}
+
+			if (options.form != VertexForm::POSITION)
+			{
+				for (size_t v = 0; v < vertexCount; ++v)
+				{
+					// Tilted a bit away from straight up, unit length
+					float nx = 0.2f * (random01(rng) - 0.5f);
+					float nz = 0.2f * (random01(rng) - 0.5f);
+					float ny = std::sqrt(1.0f - nx * nx - nz * nz);
+
+					out.text("vn ");
+					out.number(nx);
+					out.text(" ");
+					out.number(ny);
+					out.text(" ");
+					out.number(nz);
+					out.endLine();
+				}
+			}
+
+			// Every corner uses the same number for all of its elements
+			auto corner = [&out, &options](size_t index)
+			{
+				out.text(" ");
+				out.number(index);
+				if (options.form == VertexForm::POSITION_NORMAL)
+				{
+					out.text("//");
+					out.number(index);
+				}
+				else if (options.form == VertexForm::POSITION_TEXCOORD_NORMAL)
+				{
+					out.text("/");
+					out.number(index);
+					out.text("/");
+					out.number(index);
+				}
+			};
+
+			size_t written = 0;
+			for (size_t cell = 0; cell < cells && written < options.faces; ++cell)
+			{
+				// OBJ indices start at 1
+				size_t a = (cell / columns) * vertexColumns + cell % columns + 1;
+				size_t b = a + 1;
+				size_t c = a + vertexColumns + 1;
+				size_t d = a + vertexColumns;
+
+				if (options.shape == FaceShape::QUADS)
+				{
+					out.text("f");
+					corner(a); corner(b); corner(c); corner(d);
+					out.endLine();
+					written++;
+					continue;
+				}
+
+				out.text("f");
+				corner(a); corner(b); corner(c);
+				out.endLine();
+				written++;
+
+				if (written < options.faces)
+				{
+					out.text("f");
+					corner(a); corner(c); corner(d);
+					out.endLine();
+					written++;
+				}
+			}
+
+			out.flush();
+			if (!file.good())
+			{
+				file.close();
+				std::error_code ec;
+				std::filesystem::remove(tempPath, ec);
+				std::cout << "could not write \"" << tempPath << "\"\n";
+				return false;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tempPath, ec);
+			std::cout << "could not write \"" << path << "\"\n";
+			return false;
+		}
+		return true;
+	}
+}
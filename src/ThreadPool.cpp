@@ -0,0 +1,65 @@
+#include "CG/ThreadPool.h"
+
+#include <algorithm>
+
+namespace cg
+{
+	ThreadPool::ThreadPool(unsigned int threads)
+	{
+		if (threads == 0)
+		{
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		m_threads.reserve(threads);
+		for (unsigned int i = 0; i < threads; ++i)
+		{
+			m_threads.emplace_back(&ThreadPool::workerMain, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_condition.notify_all();
+
+		for (std::thread& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	void ThreadPool::enqueue(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.push_back(std::move(task));
+		}
+		m_condition.notify_one();
+	}
+
+	void ThreadPool::workerMain()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+
+				if (m_tasks.empty())
+				{
+					// Stopped and nothing left to do
+					return;
+				}
+
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+			task();
+		}
+	}
+}
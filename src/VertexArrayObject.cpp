@@ -36,9 +36,15 @@ namespace cg
 			glDeleteVertexArrays(1, &m_vao);
 			m_vao = 0;
 		}
+		m_constantAttribs.clear();
 	}
 
 	bool VertexArrayObject::bindShaderAttribVec3f(GLuint buffer, GLSLProgram* shader, const std::string& attribName)
+	{
+		return bindShaderAttrib(buffer, shader, attribName, VertexAttribFormat());
+	}
+
+	bool VertexArrayObject::bindShaderAttrib(GLuint buffer, GLSLProgram* shader, const std::string& attribName, const VertexAttribFormat& format)
 	{
 		GLint location;
 		glBindVertexArray(m_vao);
@@ -53,7 +59,7 @@ namespace cg
 			return false;
 		}
 		glEnableVertexAttribArray(location);
-		glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, 0, 0);
+		glVertexAttribPointer(location, format.components, format.type, format.normalized, format.stride, (const void*)format.offset);
 
 		glBindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -69,4 +75,29 @@ namespace cg
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		return true;
 	}
+
+	bool VertexArrayObject::setConstantAttrib(GLSLProgram* shader, const std::string& attribName, const glm::vec3& value)
+	{
+		GLint location = glGetAttribLocation(shader->getHandle(), attribName.c_str());
+		if (location == -1)
+		{
+			return false;
+		}
+
+		// The array stays disabled, so the generic value is read for every vertex
+		glBindVertexArray(m_vao);
+		glDisableVertexAttribArray(location);
+		glBindVertexArray(0);
+
+		m_constantAttribs.emplace_back(location, value);
+		return true;
+	}
+
+	void VertexArrayObject::applyConstantAttribs() const
+	{
+		for (const auto& [location, value] : m_constantAttribs)
+		{
+			glVertexAttrib3f(location, value.x, value.y, value.z);
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,1622 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstdlib>
+#include <charconv>
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "CG/OBJFile.h"
+#include "CG/MeshImporter.h"
+#include "CG/MeshArena.h"
+#include "CG/MeshCache.h"
+#include "CG/GeometryUtil.h"
+#include "CG/MeshOptimizer.h"
+#include "CG/MeshSimplifier.h"
+#include "CG/MeshletBuilder.h"
+#include "CG/MeshGLInfo.h"
+#include "CG/GLSLProgram.h"
+#include "CG/VertexArrayObject.h"
+#include "CG/Window.h"
+#include "CG/SyntheticOBJ.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif !defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+/*
+ Benchmarks of the mesh load path. Synthetic OBJ files are generated from a seed into the data
+ directory and reused by later runs. Results are printed and written as JSON, so two runs can be diffed.
+
+ USAGE
+ cg_bench [options]
+ --faces 10000,1000000  face counts of the synthetic files, up to 50000000 (about 4 GB per file)
+ --threads 1,0          thread counts for OBJFile::load and icosphere, 0 uses all hardware threads
+ --repeat 3             runs per benchmark, the median is reported
+ --seed 1               seed of the synthetic files
+ --only obj_load,...    run only these benchmarks: obj_load, obj_convert, import_arena, mesh_cache, mesh_import, sphere, icosphere,
+                        normals_display, gl_generate, vertex_layout, vertex_cache, overdraw, strips, lod, meshlets
+ --no-gl                skip everything that needs an OpenGL context
+ --data bench_data      directory of the synthetic files
+ --models Testobjs      directory of the OBJ files of vertex_cache, overdraw, strips, lod and meshlets
+ --out cg_bench.json    result file
+ */
+
+// Every allocation through operator new is counted, over-aligned allocations are not
+static std::atomic<size_t> allocationCount(0);
+static std::atomic<size_t> allocationBytes(0);
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size > 0 ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+// Version of the result file layout
+static const int RESULT_VERSION = 1;
+
+// Memory limit of OBJFile::convert, the peak RSS of obj_convert should stay below it
+static const size_t CONVERT_MEMORY_LIMIT = (size_t)64 << 20;
+
+// Subdivisions of GeometryUtil::generateSphereModel, it takes an uint8_t
+static const uint8_t SPHERE_SUBDIVISIONS[] = { 15, 63, 255 };
+
+// Subdivisions of GeometryUtil::generateIcosphereModel, the first three give about as many triangles as SPHERE_SUBDIVISIONS
+static const uint32_t ICOSPHERE_SUBDIVISIONS[] = { 10, 40, 162, 512 };
+
+#ifndef GL_VERTEX_SHADER_INVOCATIONS_ARB
+// ARB_pipeline_statistics_query, core since OpenGL 4.6, the loader only goes up to 4.3
+#define GL_VERTEX_SHADER_INVOCATIONS_ARB 0x82F0
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+#endif
+
+// ACMR thresholds of MeshOptimizer::optimizeOverdraw
+static const float OVERDRAW_THRESHOLDS[] = { 1.05f, 1.25f };
+
+// Size of the render target that counts fragment shader invocations
+static const int OVERDRAW_TARGET_SIZE = 512;
+
+struct BenchOptions
+{
+    std::vector<size_t> faces = { 10000, 100000, 1000000 };
+    std::vector<unsigned int> threads = { 1, 0 };
+    unsigned int repeat = 3;
+    uint32_t seed = 1;
+    std::vector<std::string> only;
+    bool useGL = true;
+    std::string dataDir = "bench_data";
+    std::string modelDir = "Testobjs";
+    std::string outPath = "cg_bench.json";
+};
+
+struct Measurement
+{
+    // Median and fastest of all runs
+    double seconds = 0.0;
+    double minSeconds = 0.0;
+
+    // Of the last run
+    size_t allocations = 0;
+    size_t allocatedBytes = 0;
+
+    // Largest of all runs, in bytes
+    size_t peakRSS = 0;
+};
+
+struct BenchResult
+{
+    std::string name;
+
+    // Parameters of the run, the values are already JSON
+    std::vector<std::pair<std::string, std::string>> params;
+
+    // Bytes read or uploaded, 0 if there are none
+    uint64_t bytes = 0;
+    uint64_t faces = 0;
+
+    // Measured besides the time, e.g. the cache miss ratio of an index order
+    std::vector<std::pair<std::string, double>> metrics;
+
+    Measurement measurement;
+};
+
+static void printUsage()
+{
+    std::cout << "usage: cg_bench [--faces N,...] [--threads N,...] [--repeat N] [--seed N] [--only NAME,...] [--no-gl] [--data DIR] [--models DIR] [--out FILE]\n";
+}
+
+// Resets the peak resident set size, so the next reading belongs to one benchmark.
+// Returns false if only the peak of the whole process is available.
+static bool resetPeakRSS()
+{
+#ifdef __linux__
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return clearRefs.good();
+#else
+    return false;
+#endif
+}
+
+// Peak resident set size in bytes, 0 if it is not known
+static size_t getPeakRSS()
+{
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+        {
+            return (size_t)std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+        }
+    }
+    return 0;
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+/*
+ Runs <run> <repeat> times. Whatever <run> returns is destroyed after the clock stopped,
+ so freeing the result is not part of the time.
+ */
+template <typename Run>
+static Measurement measure(unsigned int repeat, Run run)
+{
+    Measurement measurement;
+    std::vector<double> times;
+    times.reserve(repeat);
+
+    for (unsigned int r = 0; r < repeat; ++r)
+    {
+        resetPeakRSS();
+        size_t allocationsBefore = allocationCount.load();
+        size_t bytesBefore = allocationBytes.load();
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        measurement.allocations = allocationCount.load() - allocationsBefore;
+        measurement.allocatedBytes = allocationBytes.load() - bytesBefore;
+        measurement.peakRSS = std::max(measurement.peakRSS, getPeakRSS());
+        times.push_back(elapsed.count());
+    }
+
+    std::sort(times.begin(), times.end());
+    measurement.seconds = times[times.size() / 2];
+    measurement.minSeconds = times.front();
+    return measurement;
+}
+
+static std::string jsonString(const std::string& s)
+{
+    std::string result = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+static double perSecond(double amount, double seconds)
+{
+    return seconds > 0.0 ? amount / seconds : 0.0;
+}
+
+static void printResult(const BenchResult& result)
+{
+    const Measurement& m = result.measurement;
+
+    std::ostringstream msg;
+    msg << result.name;
+    for (const auto& [key, value] : result.params)
+    {
+        msg << ' ' << key << '=' << value;
+    }
+    msg << ": " << m.seconds * 1000.0 << " ms";
+    if (result.bytes > 0)
+    {
+        msg << ", " << perSecond(result.bytes / 1e6, m.seconds) << " MB/s";
+    }
+    msg << ", " << perSecond(result.faces / 1e6, m.seconds) << " M faces/s"
+        << ", peak " << m.peakRSS / (1024 * 1024) << " MB"
+        << ", " << m.allocations << " allocations";
+    for (const auto& [key, value] : result.metrics)
+    {
+        msg << ", " << key << ' ' << value;
+    }
+    msg << '\n';
+    std::cout << msg.str();
+}
+
+static bool writeResults(const std::string& path, const BenchOptions& options, bool peakPerBenchmark, const std::vector<BenchResult>& results)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.good())
+    {
+        std::cout << "could not write \"" << path << "\"\n";
+        return false;
+    }
+
+    file << "{\n"
+        << "  \"version\": " << RESULT_VERSION << ",\n"
+        << "  \"seed\": " << options.seed << ",\n"
+        << "  \"repeat\": " << options.repeat << ",\n"
+        << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+        << "  \"peak_rss_per_benchmark\": " << (peakPerBenchmark ? "true" : "false") << ",\n"
+        << "  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& result = results[i];
+        const Measurement& m = result.measurement;
+
+        file << "    { \"benchmark\": " << jsonString(result.name);
+        for (const auto& [key, value] : result.params)
+        {
+            file << ", " << jsonString(key) << ": " << value;
+        }
+        file << ", \"bytes\": " << result.bytes
+            << ", \"faces\": " << result.faces
+            << ", \"seconds\": " << m.seconds
+            << ", \"min_seconds\": " << m.minSeconds
+            << ", \"mb_per_s\": " << perSecond(result.bytes / 1e6, m.seconds)
+            << ", \"faces_per_s\": " << perSecond((double)result.faces, m.seconds)
+            << ", \"peak_rss_bytes\": " << m.peakRSS
+            << ", \"allocations\": " << m.allocations
+            << ", \"allocated_bytes\": " << m.allocatedBytes;
+        for (const auto& [key, value] : result.metrics)
+        {
+            file << ", " << jsonString(key) << ": " << value;
+        }
+        file << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    file << "  ]\n}\n";
+    return file.good();
+}
+
+// Path of the synthetic file for <options>, generated if it is not there yet
+static bool getSyntheticFile(const std::string& dataDir, const cg::SyntheticOBJ::Options& options, std::string* path)
+{
+    *path = (std::filesystem::path(dataDir) / cg::SyntheticOBJ::getFileName(options)).string();
+    if (std::filesystem::exists(*path))
+    {
+        return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dataDir, ec);
+
+    std::cout << "Generating " << *path << "\n";
+    return cg::SyntheticOBJ::write(*path, options);
+}
+
+static bool isEnabled(const BenchOptions& options, const std::string& name)
+{
+    return options.only.empty() || std::find(options.only.begin(), options.only.end(), name) != options.only.end();
+}
+
+template <typename T>
+static bool parseList(const std::string& arg, std::vector<T>* values)
+{
+    values->clear();
+    std::istringstream stream(arg);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        T value;
+        auto result = std::from_chars(item.data(), item.data() + item.size(), value);
+        if (result.ec != std::errc() || result.ptr != item.data() + item.size())
+        {
+            return false;
+        }
+        values->push_back(value);
+    }
+    return !values->empty();
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions* options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--no-gl")
+        {
+            options->useGL = false;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        std::string value = argv[++i];
+
+        std::vector<unsigned int> single;
+        if (arg == "--faces")
+        {
+            if (!parseList(value, &options->faces)) return false;
+        }
+        else if (arg == "--threads")
+        {
+            if (!parseList(value, &options->threads)) return false;
+        }
+        else if (arg == "--repeat")
+        {
+            if (!parseList(value, &single) || single.size() != 1 || single[0] == 0) return false;
+            options->repeat = single[0];
+        }
+        else if (arg == "--seed")
+        {
+            if (!parseList(value, &single) || single.size() != 1) return false;
+            options->seed = single[0];
+        }
+        else if (arg == "--only")
+        {
+            std::istringstream stream(value);
+            std::string name;
+            while (std::getline(stream, name, ','))
+            {
+                options->only.push_back(name);
+            }
+        }
+        else if (arg == "--data")
+        {
+            options->dataDir = value;
+        }
+        else if (arg == "--models")
+        {
+            options->modelDir = value;
+        }
+        else if (arg == "--out")
+        {
+            options->outPath = value;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void benchOBJLoad(const BenchOptions& options, size_t faces, std::vector<BenchResult>* results)
+{
+    using namespace cg::SyntheticOBJ;
+
+    for (FaceShape shape : { FaceShape::TRIANGLES, FaceShape::QUADS })
+    {
+        for (VertexForm form : { VertexForm::POSITION, VertexForm::POSITION_NORMAL, VertexForm::POSITION_TEXCOORD_NORMAL })
+        {
+            Options synthetic;
+            synthetic.faces = faces;
+            synthetic.shape = shape;
+            synthetic.form = form;
+            synthetic.seed = options.seed;
+
+            std::string path;
+            if (!getSyntheticFile(options.dataDir, synthetic, &path))
+            {
+                continue;
+            }
+            uint64_t fileSize = std::filesystem::file_size(path);
+
+            for (unsigned int threads : options.threads)
+            {
+                // Always parse, the cache would measure something else
+                cg::OBJLoadOptions loadOptions;
+                loadOptions.threads = threads;
+                loadOptions.useCache = false;
+                loadOptions.loadTexcoords = form == VertexForm::POSITION_TEXCOORD_NORMAL;
+
+                BenchResult result;
+                result.name = "obj_load";
+                result.params = {
+                    { "scale", std::to_string(faces) },
+                    { "shape", jsonString(getShapeName(shape)) },
+                    { "form", jsonString(getFormName(form)) },
+                    { "threads", std::to_string(threads) }
+                };
+                result.bytes = fileSize;
+                result.faces = faces;
+                result.measurement = measure(options.repeat, [&]()
+                {
+                    auto mesh = std::make_unique<cg::MeshData>();
+                    if (!cg::OBJFile::load(path, mesh.get(), 1.0f, loadOptions))
+                    {
+                        std::cout << "failed to load " << path << "\n";
+                    }
+                    return mesh;
+                });
+
+                printResult(result);
+                results->push_back(result);
+            }
+        }
+    }
+}
+
+// Out-of-core conversion into a ChunkedMesh with a fixed memory limit, the temporary files go into the data directory
+static void benchOBJConvert(const BenchOptions& options, size_t faces, const std::string& path, std::vector<BenchResult>* results)
+{
+    std::string outputPath = path + ".cgmc";
+    cg::OBJConvertOptions convertOptions;
+    convertOptions.memoryLimit = CONVERT_MEMORY_LIMIT;
+    convertOptions.tempDirectory = options.dataDir;
+
+    BenchResult result;
+    result.name = "obj_convert";
+    result.params = {
+        { "scale", std::to_string(faces) },
+        { "memory_limit_bytes", std::to_string(CONVERT_MEMORY_LIMIT) }
+    };
+    result.bytes = std::filesystem::file_size(path);
+    result.faces = faces;
+    result.measurement = measure(options.repeat, [&]()
+    {
+        auto stats = std::make_unique<cg::OBJLoadStats>();
+        cg::OBJConvertOptions runOptions = convertOptions;
+        runOptions.stats = stats.get();
+        if (!cg::OBJFile::convert(path, outputPath, 1.0f, runOptions))
+        {
+            std::cout << "failed to convert " << path << "\n";
+        }
+        return stats;
+    });
+
+    std::error_code ec;
+    std::filesystem::remove(outputPath, ec);
+
+    printResult(result);
+    results->push_back(result);
+}
+
+// Reads the mesh from a raw and from a compressed cache file. The files are in the page cache after the first run,
+// so this is the decode speed, <bytes> is the file size.
+static void benchMeshCache(const BenchOptions& options, size_t faces, const std::string& path, const cg::MeshData& mesh, std::vector<BenchResult>* results)
+{
+    cg::MeshCacheKey key;
+    if (!cg::MeshCache::makeKey(path, 1.0f, &key))
+    {
+        return;
+    }
+
+    for (bool compress : { false, true })
+    {
+        std::string cachePath = path + (compress ? ".compressed.cgmesh" : ".raw.cgmesh");
+        if (!cg::MeshCache::write(cachePath, key, mesh, compress))
+        {
+            std::cout << "could not write \"" << cachePath << "\"\n";
+            continue;
+        }
+
+        BenchResult result;
+        result.name = "mesh_cache";
+        result.params = {
+            { "scale", std::to_string(faces) },
+            { "compressed", compress ? "true" : "false" }
+        };
+        result.bytes = std::filesystem::file_size(cachePath);
+        result.faces = mesh.indices.size() / 3;
+        result.measurement = measure(options.repeat, [&]()
+        {
+            auto cached = std::make_unique<cg::MeshData>();
+            if (!cg::MeshCache::read(cachePath, key, cached.get()))
+            {
+                std::cout << "failed to read " << cachePath << "\n";
+            }
+            return cached;
+        });
+
+        printResult(result);
+        results->push_back(result);
+    }
+}
+
+// Appends <value> to <out> in the given byte order
+template <typename T>
+static void appendValue(std::string* out, T value, bool bigEndian)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if (bigEndian != (std::endian::native == std::endian::big))
+    {
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+    out->append(bytes, sizeof(T));
+}
+
+// Binary PLY with float positions and normals and triangles as lists of int, like scanners write them
+static bool writePLY(const std::string& path, const cg::MeshData& mesh, bool bigEndian)
+{
+    std::ostringstream header;
+    header << "ply\nformat " << (bigEndian ? "binary_big_endian" : "binary_little_endian") << " 1.0\n"
+        << "element vertex " << mesh.vertices.size() << "\n"
+        << "property float x\nproperty float y\nproperty float z\n"
+        << "property float nx\nproperty float ny\nproperty float nz\n"
+        << "element face " << mesh.indices.size() / 3 << "\n"
+        << "property list uchar int vertex_indices\nend_header\n";
+
+    std::string data = header.str();
+    data.reserve(data.size() + mesh.vertices.size() * 24 + mesh.indices.size() / 3 * 13);
+    for (size_t i = 0; i < mesh.vertices.size(); ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            appendValue(&data, mesh.vertices[i][c], bigEndian);
+        }
+        for (int c = 0; c < 3; ++c)
+        {
+            appendValue(&data, mesh.normals[i][c], bigEndian);
+        }
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        data.push_back(3);
+        for (int c = 0; c < 3; ++c)
+        {
+            appendValue(&data, (int32_t)mesh.indices[i + c], bigEndian);
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+    return file.good();
+}
+
+static bool writeSTL(const std::string& path, const cg::MeshData& mesh)
+{
+    std::string data(80, ' ');
+    appendValue(&data, (uint32_t)(mesh.indices.size() / 3), false);
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        // Facet normal, then the corners
+        for (int c = 0; c < 3; ++c)
+        {
+            appendValue(&data, mesh.normals[mesh.indices[i]][c], false);
+        }
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                appendValue(&data, mesh.vertices[mesh.indices[i + corner]][c], false);
+            }
+        }
+        appendValue(&data, (uint16_t)0, false);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+    return file.good();
+}
+
+// Loads the same file again and again, as an editor or the cooker does.
+// "per_load": every load has its own arena and MeshData, "shared": one arena for all loads,
+// "shared_reuse": one arena and one MeshData, after the first load nothing should go to the heap.
+static void benchImportArena(const BenchOptions& options, size_t faces, const std::string& path, std::vector<BenchResult>* results)
+{
+    uint64_t fileSize = std::filesystem::file_size(path);
+
+    for (const char* mode : { "per_load", "shared", "shared_reuse" })
+    {
+        cg::MeshArena arena;
+        cg::MeshData reused;
+        cg::OBJLoadStats stats;
+
+        cg::OBJLoadOptions loadOptions;
+        loadOptions.useCache = false;
+        loadOptions.stats = &stats;
+        loadOptions.arena = std::string(mode) != "per_load" ? &arena : nullptr;
+        bool reuse = std::string(mode) == "shared_reuse";
+
+        auto load = [&]()
+        {
+            auto mesh = std::make_unique<cg::MeshData>();
+            if (!cg::OBJFile::load(path, reuse ? &reused : mesh.get(), 1.0f, loadOptions))
+            {
+                std::cout << "failed to load " << path << "\n";
+            }
+            return mesh;
+        };
+
+        // Untimed, fills the arena and the reused mesh. The second load merges the blocks of the arena into one.
+        load();
+        load();
+
+        BenchResult result;
+        result.name = "import_arena";
+        result.params = {
+            { "scale", std::to_string(faces) },
+            { "mode", jsonString(mode) }
+        };
+        result.bytes = fileSize;
+        result.faces = faces;
+        result.measurement = measure(options.repeat, load);
+
+        printResult(result);
+        std::cout << "    " << stats.arenaAllocations << " arena allocations, " << stats.heapAllocations << " of them from the heap, "
+            << arena.getCapacity() / (1 << 20) << " MB shared arena\n";
+        results->push_back(result);
+    }
+}
+
+// Loads the mesh from binary PLY in both byte orders and from STL, which has to be welded.
+// Compare with obj_load of the same scale, that is the text route the scans took before.
+static void benchMeshImport(const BenchOptions& options, size_t faces, const std::string& path, const cg::MeshData& mesh, std::vector<BenchResult>* results)
+{
+    struct ImportFile
+    {
+        const char* format;
+        std::string path;
+    };
+
+    std::vector<ImportFile> files =
+    {
+        { "ply_le", path + ".le.ply" },
+        { "ply_be", path + ".be.ply" },
+        { "stl", path + ".stl" },
+    };
+
+    for (const ImportFile& file : files)
+    {
+        std::string format = file.format;
+        bool written = format == "stl" ? writeSTL(file.path, mesh) : writePLY(file.path, mesh, format == "ply_be");
+        if (!written)
+        {
+            std::cout << "could not write \"" << file.path << "\"\n";
+            continue;
+        }
+
+        BenchResult result;
+        result.name = "mesh_import";
+        result.params = {
+            { "scale", std::to_string(faces) },
+            { "format", jsonString(format) }
+        };
+        result.bytes = std::filesystem::file_size(file.path);
+        result.faces = mesh.indices.size() / 3;
+        result.measurement = measure(options.repeat, [&]()
+        {
+            auto imported = std::make_unique<cg::MeshData>();
+            if (!cg::MeshImporter::load(file.path, imported.get()))
+            {
+                std::cout << "failed to load " << file.path << "\n";
+            }
+            return imported;
+        });
+
+        std::error_code ec;
+        std::filesystem::remove(file.path, ec);
+
+        printResult(result);
+        results->push_back(result);
+    }
+}
+
+// Vertices and the shape of the triangles of a generated sphere: smallest area over largest area, and the smallest and average
+// quality 4 * sqrt(3) * area / (sum of the squared edge lengths), which is 1 for an equilateral triangle
+static std::vector<std::pair<std::string, double>> getSphereMetrics(const cg::MeshData& mesh)
+{
+    double minArea = std::numeric_limits<double>::max();
+    double maxArea = 0.0;
+    double minQuality = std::numeric_limits<double>::max();
+    double qualitySum = 0.0;
+    size_t triangles = mesh.indices.size() / 3;
+    for (size_t t = 0; t < triangles; ++t)
+    {
+        const glm::vec3& a = mesh.vertices[mesh.indices[t * 3]];
+        const glm::vec3& b = mesh.vertices[mesh.indices[t * 3 + 1]];
+        const glm::vec3& c = mesh.vertices[mesh.indices[t * 3 + 2]];
+        double area = glm::length(glm::cross(b - a, c - a)) * 0.5;
+        double edges = glm::dot(b - a, b - a) + glm::dot(c - b, c - b) + glm::dot(a - c, a - c);
+        double quality = edges > 0.0 ? 4.0 * std::sqrt(3.0) * area / edges : 0.0;
+
+        minArea = std::min(minArea, area);
+        maxArea = std::max(maxArea, area);
+        minQuality = std::min(minQuality, quality);
+        qualitySum += quality;
+    }
+
+    return {
+        { "vertices", (double)mesh.vertices.size() },
+        { "area_ratio", maxArea > 0.0 ? minArea / maxArea : 0.0 },
+        { "min_quality", triangles > 0 ? minQuality : 0.0 },
+        { "avg_quality", triangles > 0 ? qualitySum / triangles : 0.0 }
+    };
+}
+
+static void benchSphere(const BenchOptions& options, std::vector<BenchResult>* results)
+{
+    for (uint8_t subdivisions : SPHERE_SUBDIVISIONS)
+    {
+        // Once untimed for the number of faces
+        cg::MeshData mesh;
+        cg::GeometryUtil::generateSphereModel(&mesh, subdivisions, 1.0f);
+
+        BenchResult result;
+        result.name = "sphere";
+        result.params = { { "subdivisions", std::to_string(subdivisions) } };
+        result.faces = mesh.indices.size() / 3;
+        result.metrics = getSphereMetrics(mesh);
+        result.measurement = measure(options.repeat, [subdivisions]()
+        {
+            auto sphere = std::make_unique<cg::MeshData>();
+            cg::GeometryUtil::generateSphereModel(sphere.get(), subdivisions, 1.0f);
+            return sphere;
+        });
+
+        printResult(result);
+        results->push_back(result);
+    }
+}
+
+// Same metrics as the sphere benchmark, for every thread count of <options>
+static void benchIcosphere(const BenchOptions& options, std::vector<BenchResult>* results)
+{
+    for (uint32_t subdivisions : ICOSPHERE_SUBDIVISIONS)
+    {
+        cg::MeshData mesh;
+        cg::GeometryUtil::generateIcosphereModel(&mesh, subdivisions, 1.0f);
+        std::vector<std::pair<std::string, double>> metrics = getSphereMetrics(mesh);
+
+        for (unsigned int threads : options.threads)
+        {
+            BenchResult result;
+            result.name = "icosphere";
+            result.params = {
+                { "subdivisions", std::to_string(subdivisions) },
+                { "threads", std::to_string(threads) }
+            };
+            result.faces = mesh.indices.size() / 3;
+            result.metrics = metrics;
+            result.measurement = measure(options.repeat, [subdivisions, threads]()
+            {
+                auto sphere = std::make_unique<cg::MeshData>();
+                cg::GeometryUtil::generateIcosphereModel(sphere.get(), subdivisions, 1.0f, { 1.0f, 1.0f, 0.0f }, false, threads);
+                return sphere;
+            });
+
+            printResult(result);
+            results->push_back(result);
+        }
+    }
+}
+
+static void benchNormalsDisplay(const BenchOptions& options, size_t faces, const cg::MeshData& mesh, std::vector<BenchResult>* results)
+{
+    BenchResult result;
+    result.name = "normals_display";
+    result.params = { { "scale", std::to_string(faces) } };
+    result.faces = mesh.indices.size() / 3;
+    result.measurement = measure(options.repeat, [&mesh]()
+    {
+        auto normals = std::make_unique<cg::MeshData>();
+        cg::GeometryUtil::generateNormalDisplayObj(normals.get(), &mesh);
+        return normals;
+    });
+
+    printResult(result);
+    results->push_back(result);
+}
+
+static void benchGLGenerate(const BenchOptions& options, size_t faces, const cg::MeshData& mesh, std::vector<BenchResult>* results)
+{
+    BenchResult result;
+    result.name = "gl_generate";
+    result.params = { { "scale", std::to_string(faces) } };
+    result.bytes = (mesh.vertices.size() + mesh.colors.size() + mesh.normals.size()) * sizeof(glm::vec3) + mesh.indices.size() * mesh.getIndexSize();
+    result.faces = mesh.indices.size() / 3;
+    result.measurement = measure(options.repeat, [&mesh]()
+    {
+        // Wait for the driver, otherwise only the copy into its memory is measured
+        std::shared_ptr<cg::MeshGLInfo> info = cg::MeshGLInfo::generate(mesh);
+        glFinish();
+        return info;
+    });
+
+    printResult(result);
+    results->push_back(result);
+}
+
+// Draws of one vertex_layout run, enough that the time of a draw is more than the time of glFinish
+static const int LAYOUT_DRAWS = 20;
+
+// Draws <mesh> with every vertex layout, once reading all attributes and once only the positions like a depth pass.
+// Nothing is rasterized, so the time is that of the vertex fetch and the vertex shader.
+static void benchVertexLayout(const BenchOptions& options, size_t faces, const cg::MeshData& mesh, std::vector<BenchResult>* results)
+{
+    const char* fragment = "#version 330 core\nout vec4 fragColor;\nvoid main() { fragColor = vec4(1.0); }\n";
+    cg::GLSLProgram fullProgram;
+    fullProgram.compileShaderFromString("#version 330 core\nin vec3 position;\nin vec3 normal;\nin vec3 color;\nout vec3 shade;\n"
+        "void main() { shade = color * max(normal.z, 0.0); gl_Position = vec4(position, 1.0); }\n", cg::GLSLShader::VERTEX);
+    fullProgram.compileShaderFromString(fragment, cg::GLSLShader::FRAGMENT);
+    cg::GLSLProgram depthProgram;
+    depthProgram.compileShaderFromString("#version 330 core\nin vec3 position;\nvoid main() { gl_Position = vec4(position, 1.0); }\n", cg::GLSLShader::VERTEX);
+    depthProgram.compileShaderFromString(fragment, cg::GLSLShader::FRAGMENT);
+    if (!fullProgram.link() || !depthProgram.link())
+    {
+        return;
+    }
+
+    const std::pair<cg::VertexLayout, const char*> layouts[] = {
+        { cg::VertexLayout::INTERLEAVED, "interleaved" },
+        { cg::VertexLayout::SPLIT, "split" },
+        { cg::VertexLayout::QUANTIZED, "quantized" }
+    };
+    for (const auto& [layout, layoutName] : layouts)
+    {
+        std::shared_ptr<cg::MeshGLInfo> info = cg::MeshGLInfo::generate(mesh, layout);
+
+        for (cg::GLSLProgram* program : { &fullProgram, &depthProgram })
+        {
+            cg::VertexArrayObject vao;
+            vao.generateVAO();
+            vao.bindShaderAttrib(info->getPositionBufferID(), program, "position", info->getPositionFormat());
+            if (program == &fullProgram && info->isNormalConstant())
+            {
+                vao.setConstantAttrib(program, "normal", info->getConstantNormal());
+            }
+            else if (program == &fullProgram)
+            {
+                vao.bindShaderAttrib(info->getNormalBufferID(), program, "normal", info->getNormalFormat());
+            }
+            if (program == &fullProgram && info->isColorConstant())
+            {
+                vao.setConstantAttrib(program, "color", info->getConstantColor());
+            }
+            else if (program == &fullProgram)
+            {
+                vao.bindShaderAttrib(info->getColorBufferID(), program, "color", info->getColorFormat());
+            }
+            vao.bindIndexBuffer(info->getIndexBufferID());
+
+            BenchResult result;
+            result.name = "vertex_layout";
+            result.params = {
+                { "scale", std::to_string(faces) },
+                { "layout", jsonString(layoutName) },
+                { "pass", program == &fullProgram ? "\"full\"" : "\"depth\"" }
+            };
+            result.faces = mesh.indices.size() / 3 * LAYOUT_DRAWS;
+            result.metrics = { { "vertex_bytes", (double)info->getVertexSize() } };
+
+            program->use();
+            glBindVertexArray(vao.getVAO());
+            vao.applyConstantAttribs();
+            glEnable(GL_RASTERIZER_DISCARD);
+            result.measurement = measure(options.repeat, [&info]()
+            {
+                for (int d = 0; d < LAYOUT_DRAWS; ++d)
+                {
+                    glDrawElements(info->getDrawMode(), info->getIndexBufferSize(), info->getIndexType(), 0);
+                }
+                glFinish();
+                return info;
+            });
+            glDisable(GL_RASTERIZER_DISCARD);
+            glBindVertexArray(0);
+
+            printResult(result);
+            results->push_back(result);
+        }
+    }
+}
+
+static bool hasExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        if (std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Draws <mesh> once without rasterization and returns how often the vertex shader ran
+static uint64_t countVertexShaderInvocations(const cg::MeshData& mesh, cg::GLSLProgram* program)
+{
+    std::shared_ptr<cg::MeshGLInfo> info = cg::MeshGLInfo::generate(mesh);
+    cg::VertexArrayObject vao;
+    vao.generateVAO();
+    vao.bindShaderAttrib(info->getPositionBufferID(), program, "position", info->getPositionFormat());
+    vao.bindIndexBuffer(info->getIndexBufferID());
+
+    GLuint query;
+    glGenQueries(1, &query);
+    program->use();
+    glBindVertexArray(vao.getVAO());
+    glEnable(GL_RASTERIZER_DISCARD);
+    bool strips = info->getDrawMode() == GL_TRIANGLE_STRIP;
+    if (strips)
+    {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(info->getRestartIndex());
+    }
+
+    glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, query);
+    glDrawElements(info->getDrawMode(), info->getIndexBufferSize(), info->getIndexType(), 0);
+    glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+
+    if (strips)
+    {
+        glDisable(GL_PRIMITIVE_RESTART);
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(0);
+
+    GLuint64 invocations = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &invocations);
+    glDeleteQueries(1, &query);
+    return invocations;
+}
+
+// The OBJ files of the model directory in the file order, and the generated spheres
+static std::vector<std::pair<std::string, cg::MeshData>> loadModels(const BenchOptions& options)
+{
+    std::vector<std::pair<std::string, cg::MeshData>> meshes;
+
+    std::error_code ec;
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(options.modelDir, ec))
+    {
+        if (entry.path().extension() == ".obj")
+        {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    for (const std::filesystem::path& path : paths)
+    {
+        cg::MeshData mesh;
+        cg::OBJLoadOptions loadOptions;
+        loadOptions.useCache = false;
+        if (cg::OBJFile::load(path.string(), &mesh, 1.0f, loadOptions))
+        {
+            meshes.emplace_back(path.filename().string(), std::move(mesh));
+        }
+    }
+
+    for (uint8_t subdivisions : SPHERE_SUBDIVISIONS)
+    {
+        cg::MeshData sphere;
+        cg::GeometryUtil::generateSphereModel(&sphere, subdivisions, 1.0f);
+        meshes.emplace_back("sphere" + std::to_string(subdivisions), std::move(sphere));
+    }
+    return meshes;
+}
+
+// Times MeshOptimizer::optimize on the models and on generated spheres and reports the simulated cache before and after.
+// With <countInvocations> both orders are also drawn and the vertex shader invocations of the GPU are counted.
+static void benchVertexCache(const BenchOptions& options, const std::vector<std::pair<std::string, cg::MeshData>>& meshes, bool countInvocations,
+    std::vector<BenchResult>* results)
+{
+    // Only the position is read, so the count does not depend on the other attributes
+    std::unique_ptr<cg::GLSLProgram> program;
+    if (countInvocations)
+    {
+        program = std::make_unique<cg::GLSLProgram>();
+        program->compileShaderFromString("#version 330 core\nin vec3 position;\nvoid main() { gl_Position = vec4(position, 1.0); }\n", cg::GLSLShader::VERTEX);
+        if (!program->link())
+        {
+            countInvocations = false;
+        }
+    }
+
+    for (const auto& [name, mesh] : meshes)
+    {
+        BenchResult result;
+        result.name = "vertex_cache";
+        result.params = { { "mesh", jsonString(name) } };
+        result.faces = mesh.indices.size() / 3;
+
+        // The copy of the mesh is part of the time
+        result.measurement = measure(options.repeat, [&mesh]()
+        {
+            auto copy = std::make_unique<cg::MeshData>(mesh);
+            cg::MeshOptimizer::optimize(copy.get());
+            return copy;
+        });
+
+        cg::MeshData optimized = mesh;
+        cg::MeshOptimizer::VertexCacheStats before, after;
+        cg::MeshOptimizer::optimize(&optimized, &before, &after);
+
+        result.metrics = {
+            { "acmr_before", before.acmr },
+            { "acmr_after", after.acmr },
+            { "atvr_before", before.atvr },
+            { "atvr_after", after.atvr }
+        };
+        if (countInvocations)
+        {
+            result.metrics.push_back({ "vs_invocations_before", (double)countVertexShaderInvocations(mesh, program.get()) });
+            result.metrics.push_back({ "vs_invocations_after", (double)countVertexShaderInvocations(optimized, program.get()) });
+        }
+
+        printResult(result);
+        results->push_back(result);
+    }
+}
+
+// Draws <mesh> with depth test from the six axis directions, filling the render target, and returns how often the
+// fragment shader ran. Nothing is culled, like in the viewer.
+static uint64_t countFragmentShaderInvocations(const cg::MeshData& mesh, cg::GLSLProgram* program)
+{
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(-std::numeric_limits<float>::max());
+    for (const glm::vec3& v : mesh.vertices)
+    {
+        min = glm::min(min, v);
+        max = glm::max(max, v);
+    }
+    glm::vec3 center = (min + max) * 0.5f;
+    float radius = std::max(glm::length(max - min) * 0.5f, 1e-6f);
+
+    GLuint framebuffer, renderbuffers[2];
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, OVERDRAW_TARGET_SIZE, OVERDRAW_TARGET_SIZE);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, OVERDRAW_TARGET_SIZE, OVERDRAW_TARGET_SIZE);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glViewport(0, 0, OVERDRAW_TARGET_SIZE, OVERDRAW_TARGET_SIZE);
+
+    std::shared_ptr<cg::MeshGLInfo> info = cg::MeshGLInfo::generate(mesh);
+    cg::VertexArrayObject vao;
+    vao.generateVAO();
+    vao.bindShaderAttrib(info->getPositionBufferID(), program, "position", info->getPositionFormat());
+    vao.bindIndexBuffer(info->getIndexBufferID());
+
+    GLuint query;
+    glGenQueries(1, &query);
+    program->use();
+    glBindVertexArray(vao.getVAO());
+    glEnable(GL_DEPTH_TEST);
+
+    glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, query);
+    glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        for (float side : { 1.0f, -1.0f })
+        {
+            glm::vec3 direction(0.0f);
+            direction[axis] = side;
+            glm::vec3 up(0.0f);
+            up[(axis + 1) % 3] = 1.0f;
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            program->setUniform("mvp", projection * glm::lookAt(center + direction * (2.0f * radius), center, up));
+            glDrawElements(info->getDrawMode(), info->getIndexBufferSize(), info->getIndexType(), 0);
+        }
+    }
+    glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLuint64 invocations = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &invocations);
+    glDeleteQueries(1, &query);
+    glDeleteRenderbuffers(2, renderbuffers);
+    glDeleteFramebuffers(1, &framebuffer);
+    return invocations;
+}
+
+// Times MeshOptimizer::optimizeOverdraw on the vertex cache order of the models and reports the overdraw of a software
+// rasterizer and the ACMR before and after. With <countInvocations> the fragment shader invocations of the GPU are counted as well.
+static void benchOverdraw(const BenchOptions& options, const std::vector<std::pair<std::string, cg::MeshData>>& meshes, bool countInvocations,
+    std::vector<BenchResult>* results)
+{
+    std::unique_ptr<cg::GLSLProgram> program;
+    if (countInvocations)
+    {
+        program = std::make_unique<cg::GLSLProgram>();
+        program->compileShaderFromString("#version 330 core\nuniform mat4 mvp;\nin vec3 position;\nvoid main() { gl_Position = mvp * vec4(position, 1.0); }\n",
+            cg::GLSLShader::VERTEX);
+        program->compileShaderFromString("#version 330 core\nout vec4 color;\nvoid main() { color = vec4(1.0); }\n", cg::GLSLShader::FRAGMENT);
+        if (!program->link())
+        {
+            countInvocations = false;
+        }
+    }
+
+    for (const auto& [name, mesh] : meshes)
+    {
+        // What the import does without the overdraw sort
+        cg::MeshData cacheOrder = mesh;
+        cg::MeshOptimizer::optimizeVertexCache(&cacheOrder);
+        cg::MeshOptimizer::VertexCacheStats cacheBefore = cg::MeshOptimizer::analyzeVertexCache(cacheOrder);
+        cg::MeshOptimizer::OverdrawStats overdrawBefore = cg::MeshOptimizer::analyzeOverdraw(cacheOrder);
+        uint64_t invocationsBefore = countInvocations ? countFragmentShaderInvocations(cacheOrder, program.get()) : 0;
+
+        for (float threshold : OVERDRAW_THRESHOLDS)
+        {
+            BenchResult result;
+            result.name = "overdraw";
+            result.params = {
+                { "mesh", jsonString(name) },
+                { "threshold", std::to_string(threshold) }
+            };
+            result.faces = mesh.indices.size() / 3;
+
+            // The copy of the mesh is part of the time
+            result.measurement = measure(options.repeat, [&cacheOrder, threshold]()
+            {
+                auto copy = std::make_unique<cg::MeshData>(cacheOrder);
+                cg::MeshOptimizer::optimizeOverdraw(copy.get(), threshold);
+                return copy;
+            });
+
+            cg::MeshData sorted = cacheOrder;
+            cg::MeshOptimizer::optimizeOverdraw(&sorted, threshold);
+            result.metrics = {
+                { "acmr_before", cacheBefore.acmr },
+                { "acmr_after", cg::MeshOptimizer::analyzeVertexCache(sorted).acmr },
+                { "overdraw_before", overdrawBefore.overdraw },
+                { "overdraw_after", cg::MeshOptimizer::analyzeOverdraw(sorted).overdraw }
+            };
+            if (countInvocations)
+            {
+                result.metrics.push_back({ "fs_invocations_before", (double)invocationsBefore });
+                result.metrics.push_back({ "fs_invocations_after", (double)countFragmentShaderInvocations(sorted, program.get()) });
+            }
+
+            printResult(result);
+            results->push_back(result);
+        }
+    }
+}
+
+// Times MeshOptimizer::convertToStrips on the optimized models and reports the size of the index buffer and the ACMR of the
+// triangle list and of the strips. With <countInvocations> the vertex shader invocations of the GPU are counted as well.
+static void benchStrips(const BenchOptions& options, const std::vector<std::pair<std::string, cg::MeshData>>& meshes, bool countInvocations,
+    std::vector<BenchResult>* results)
+{
+    std::unique_ptr<cg::GLSLProgram> program;
+    if (countInvocations)
+    {
+        program = std::make_unique<cg::GLSLProgram>();
+        program->compileShaderFromString("#version 330 core\nin vec3 position;\nvoid main() { gl_Position = vec4(position, 1.0); }\n", cg::GLSLShader::VERTEX);
+        if (!program->link())
+        {
+            countInvocations = false;
+        }
+    }
+
+    for (const auto& [name, mesh] : meshes)
+    {
+        // What the import does without strips
+        cg::MeshData list = mesh;
+        cg::MeshOptimizer::optimize(&list, nullptr, nullptr);
+        list.updateIndexType();
+
+        BenchResult result;
+        result.name = "strips";
+        result.params = { { "mesh", jsonString(name) } };
+        result.faces = list.indices.size() / 3;
+
+        // The copy of the mesh is part of the time
+        result.measurement = measure(options.repeat, [&list]()
+        {
+            auto copy = std::make_unique<cg::MeshData>(list);
+            cg::MeshOptimizer::convertToStrips(copy.get());
+            return copy;
+        });
+
+        cg::MeshData strips = list;
+        cg::MeshOptimizer::convertToStrips(&strips);
+        result.metrics = {
+            { "indices_before", (double)list.indices.size() },
+            { "indices_after", (double)strips.indices.size() },
+            { "index_bytes_before", (double)(list.indices.size() * list.getIndexSize()) },
+            { "index_bytes_after", (double)(strips.indices.size() * strips.getIndexSize()) },
+            { "acmr_before", cg::MeshOptimizer::analyzeVertexCache(list).acmr },
+            { "acmr_after", cg::MeshOptimizer::analyzeVertexCache(strips).acmr }
+        };
+        if (countInvocations)
+        {
+            result.metrics.push_back({ "vs_invocations_before", (double)countVertexShaderInvocations(list, program.get()) });
+            result.metrics.push_back({ "vs_invocations_after", (double)countVertexShaderInvocations(strips, program.get()) });
+        }
+
+        printResult(result);
+        results->push_back(result);
+    }
+}
+
+// View of the lod benchmark: the default projection of the viewer, 60 degrees high over 480 pixels
+static const float LOD_VIEW_HEIGHT = 480.0f;
+static const float LOD_VIEW_FOV = 60.0f;
+
+// Distances of the lod benchmark in bounding radii of the mesh
+static const float LOD_DISTANCES[] = { 2.0f, 8.0f, 32.0f };
+
+// Times MeshSimplifier::buildLODChain on the models and reports the triangles and the error of every level, and the triangles
+// drawn at a few distances when the level is picked like Scene does with a threshold of one pixel
+static void benchLOD(const BenchOptions& options, const std::vector<std::pair<std::string, cg::MeshData>>& meshes, std::vector<BenchResult>* results)
+{
+    for (const auto& [name, mesh] : meshes)
+    {
+        BenchResult result;
+        result.name = "lod";
+        result.params = { { "mesh", jsonString(name) } };
+        result.faces = mesh.indices.size() / 3;
+        result.measurement = measure(options.repeat, [&mesh]()
+        {
+            return std::make_unique<std::vector<cg::MeshSimplifier::LODLevel>>(cg::MeshSimplifier::buildLODChain(mesh));
+        });
+
+        std::vector<cg::MeshSimplifier::LODLevel> levels = cg::MeshSimplifier::buildLODChain(mesh);
+        result.metrics.push_back({ "levels", (double)levels.size() });
+        for (size_t l = 0; l < levels.size(); ++l)
+        {
+            std::string level = "lod" + std::to_string(l + 1);
+            result.metrics.push_back({ level + "_triangles", (double)(levels[l].mesh.indices.size() / 3) });
+            result.metrics.push_back({ level + "_error", levels[l].error });
+        }
+
+        glm::vec3 min = mesh.vertices.empty() ? glm::vec3(0.0f) : mesh.vertices[0];
+        glm::vec3 max = min;
+        for (const glm::vec3& v : mesh.vertices)
+        {
+            min = glm::min(min, v);
+            max = glm::max(max, v);
+        }
+        float radius = glm::length(max - min) * 0.5f;
+
+        // Pixels per model unit at depth 1
+        float pixelScale = LOD_VIEW_HEIGHT * 0.5f / std::tan(glm::radians(LOD_VIEW_FOV) * 0.5f);
+        for (float distance : LOD_DISTANCES)
+        {
+            size_t triangles = mesh.indices.size() / 3;
+            for (const cg::MeshSimplifier::LODLevel& level : levels)
+            {
+                if (level.error * pixelScale > distance * radius)
+                {
+                    break;
+                }
+                triangles = level.mesh.indices.size() / 3;
+            }
+            result.metrics.push_back({ "triangles_at_" + std::to_string((int)distance) + "r", (double)triangles });
+        }
+
+        printResult(result);
+        results->push_back(result);
+    }
+}
+
+// Triangles Scene submits for <mesh> with meshlet culling, seen from <eye> towards <target> with the lod benchmark's view
+static size_t countMeshletTriangles(const cg::MeshData& mesh, const glm::vec3& eye, const glm::vec3& target, float radius)
+{
+    glm::vec3 up = std::abs(glm::normalize(target - eye).y) > 0.9f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 proj = glm::perspective(glm::radians(LOD_VIEW_FOV), 4.0f / 3.0f, radius * 0.01f, radius * 100.0f);
+    glm::vec4 planes[6];
+    cg::MeshletBuilder::getFrustumPlanes(proj * glm::lookAt(eye, target, up), planes);
+
+    size_t triangles = 0;
+    for (const cg::Meshlet& meshlet : mesh.meshlets)
+    {
+        if (!cg::MeshletBuilder::isMeshletCulled(meshlet, planes, eye))
+        {
+            triangles += meshlet.indexCount / 3;
+        }
+    }
+    return triangles;
+}
+
+// Distances of the meshlets benchmark in bounding radii, the whole mesh is in view from the first one
+static const float MESHLET_DISTANCE = 2.5f;
+static const float MESHLET_NEAR_DISTANCE = 1.25f;
+
+// Times MeshletBuilder::buildMeshlets on the optimized models and reports the size of the meshlets and the triangles that are
+// left after culling them: from the front, averaged over the six axis directions, and from so close that part of the mesh is
+// off screen. Without meshlets every triangle is submitted from all of them.
+static void benchMeshlets(const BenchOptions& options, const std::vector<std::pair<std::string, cg::MeshData>>& meshes, std::vector<BenchResult>* results)
+{
+    for (const auto& [name, mesh] : meshes)
+    {
+        // What the import does before it builds the meshlets
+        cg::MeshData optimized = mesh;
+        cg::MeshOptimizer::optimize(&optimized, nullptr, nullptr);
+
+        BenchResult result;
+        result.name = "meshlets";
+        result.params = { { "mesh", jsonString(name) } };
+        result.faces = optimized.indices.size() / 3;
+
+        // The copy of the mesh is part of the time
+        result.measurement = measure(options.repeat, [&optimized]()
+        {
+            auto copy = std::make_unique<cg::MeshData>(optimized);
+            cg::MeshletBuilder::buildMeshlets(copy.get());
+            return copy;
+        });
+
+        cg::MeshletBuilder::buildMeshlets(&optimized);
+        const std::vector<cg::Meshlet>& meshlets = optimized.meshlets;
+        std::vector<size_t> vertexMeshlet(optimized.vertices.size(), 0);
+        size_t vertices = 0;
+        size_t cones = 0;
+        for (size_t m = 0; m < meshlets.size(); ++m)
+        {
+            for (uint32_t i = meshlets[m].indexOffset; i < meshlets[m].indexOffset + meshlets[m].indexCount; ++i)
+            {
+                if (vertexMeshlet[optimized.indices[i]] != m + 1)
+                {
+                    vertexMeshlet[optimized.indices[i]] = m + 1;
+                    vertices++;
+                }
+            }
+            cones += meshlets[m].coneCutoff < 1.0f ? 1 : 0;
+        }
+        size_t count = std::max<size_t>(meshlets.size(), 1);
+        result.metrics = {
+            { "meshlets", (double)meshlets.size() },
+            { "avg_triangles", (double)result.faces / count },
+            { "avg_vertices", (double)vertices / count },
+            { "cone_cullable", (double)cones / count }
+        };
+
+        glm::vec3 min = optimized.vertices.empty() ? glm::vec3(0.0f) : optimized.vertices[0];
+        glm::vec3 max = min;
+        for (const glm::vec3& v : optimized.vertices)
+        {
+            min = glm::min(min, v);
+            max = glm::max(max, v);
+        }
+        glm::vec3 center = (min + max) * 0.5f;
+        float radius = std::max(glm::length(max - min) * 0.5f, 1e-6f);
+
+        const glm::vec3 directions[] = { { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 } };
+        size_t around = 0;
+        for (const glm::vec3& direction : directions)
+        {
+            around += countMeshletTriangles(optimized, center + direction * (radius * MESHLET_DISTANCE), center, radius);
+        }
+        result.metrics.push_back({ "triangles_front", (double)countMeshletTriangles(optimized, center + directions[0] * (radius * MESHLET_DISTANCE), center, radius) });
+        result.metrics.push_back({ "triangles_around", (double)around / 6.0 });
+        result.metrics.push_back({ "triangles_near", (double)countMeshletTriangles(optimized, center + directions[0] * (radius * MESHLET_NEAR_DISTANCE), center, radius) });
+
+        printResult(result);
+        results->push_back(result);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    // Hidden window, only needed for its context
+    std::unique_ptr<cg::Window> window;
+    if (options.useGL && (isEnabled(options, "gl_generate") || isEnabled(options, "vertex_layout") || isEnabled(options, "vertex_cache") || isEnabled(options, "overdraw")
+        || isEnabled(options, "strips")))
+    {
+        window = std::make_unique<cg::Window>(64, 64);
+        if (window->getError())
+        {
+            std::cout << "No OpenGL context, gl_generate, vertex_layout and the shader invocations of vertex_cache, overdraw and strips are skipped\n";
+            window.reset();
+        }
+        else
+        {
+            glfwHideWindow(window->getHandle());
+        }
+    }
+
+    bool peakPerBenchmark = resetPeakRSS();
+    if (!peakPerBenchmark)
+    {
+        std::cout << "The peak RSS can not be reset on this platform, it is the peak of the whole process\n";
+    }
+
+    std::vector<BenchResult> results;
+    for (size_t faces : options.faces)
+    {
+        if (isEnabled(options, "obj_load"))
+        {
+            benchOBJLoad(options, faces, &results);
+        }
+
+        bool objConvert = isEnabled(options, "obj_convert");
+        bool importArena = isEnabled(options, "import_arena");
+        bool meshCache = isEnabled(options, "mesh_cache");
+        bool meshImport = isEnabled(options, "mesh_import");
+        bool normalsDisplay = isEnabled(options, "normals_display");
+        bool glGenerate = window != nullptr && isEnabled(options, "gl_generate");
+        bool vertexLayout = window != nullptr && isEnabled(options, "vertex_layout");
+        if (!objConvert && !importArena && !meshCache && !meshImport && !normalsDisplay && !glGenerate && !vertexLayout)
+        {
+            continue;
+        }
+
+        // Triangles with normals as the input of the other benchmarks
+        cg::SyntheticOBJ::Options synthetic;
+        synthetic.faces = faces;
+        synthetic.seed = options.seed;
+
+        std::string path;
+        if (!getSyntheticFile(options.dataDir, synthetic, &path))
+        {
+            continue;
+        }
+
+        // Before the mesh is loaded, so its memory is not part of the peak
+        if (objConvert)
+        {
+            benchOBJConvert(options, faces, path, &results);
+        }
+        if (importArena)
+        {
+            benchImportArena(options, faces, path, &results);
+        }
+        if (!meshCache && !meshImport && !normalsDisplay && !glGenerate && !vertexLayout)
+        {
+            continue;
+        }
+
+        cg::MeshData mesh;
+        cg::OBJLoadOptions loadOptions;
+        loadOptions.threads = 0;
+        loadOptions.useCache = false;
+        if (!cg::OBJFile::load(path, &mesh, 1.0f, loadOptions))
+        {
+            continue;
+        }
+
+        if (meshCache)
+        {
+            benchMeshCache(options, faces, path, mesh, &results);
+        }
+        if (meshImport)
+        {
+            benchMeshImport(options, faces, path, mesh, &results);
+        }
+        if (normalsDisplay)
+        {
+            benchNormalsDisplay(options, faces, mesh, &results);
+        }
+        if (glGenerate)
+        {
+            benchGLGenerate(options, faces, mesh, &results);
+        }
+        if (vertexLayout)
+        {
+            benchVertexLayout(options, faces, mesh, &results);
+        }
+    }
+
+    if (isEnabled(options, "sphere"))
+    {
+        benchSphere(options, &results);
+    }
+
+    if (isEnabled(options, "icosphere"))
+    {
+        benchIcosphere(options, &results);
+    }
+
+    bool vertexCache = isEnabled(options, "vertex_cache");
+    bool overdraw = isEnabled(options, "overdraw");
+    bool strips = isEnabled(options, "strips");
+    bool lod = isEnabled(options, "lod");
+    bool meshlets = isEnabled(options, "meshlets");
+    if (vertexCache || overdraw || strips || lod || meshlets)
+    {
+        bool pipelineStatistics = window != nullptr && hasExtension("GL_ARB_pipeline_statistics_query");
+        if (window != nullptr && !pipelineStatistics)
+        {
+            std::cout << "GL_ARB_pipeline_statistics_query is not supported, the shader invocations are not counted\n";
+        }
+
+        std::vector<std::pair<std::string, cg::MeshData>> models = loadModels(options);
+        if (vertexCache)
+        {
+            benchVertexCache(options, models, pipelineStatistics, &results);
+        }
+        if (overdraw)
+        {
+            benchOverdraw(options, models, pipelineStatistics, &results);
+        }
+        if (strips)
+        {
+            benchStrips(options, models, pipelineStatistics, &results);
+        }
+        if (lod)
+        {
+            benchLOD(options, models, &results);
+        }
+        if (meshlets)
+        {
+            benchMeshlets(options, models, &results);
+        }
+    }
+
+    if (!writeResults(options.outPath, options, peakPerBenchmark, results))
+    {
+        return 2;
+    }
+    std::cout << "Wrote " << results.size() << " results to " << options.outPath << "\n";
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include <cstdlib>
+
+#include "CG/OBJFile.h"
+#include "CG/MeshImporter.h"
+#include "CG/MeshOptimizer.h"
+#include "CG/MeshArena.h"
+#include "CG/CookedMesh.h"
+#include "CG/ChunkedMesh.h"
+
+/*
+ Offline asset cooker. Turns OBJ, binary PLY and binary STL files into GPU ready ".cgm" files (see CookedMesh).
+
+ USAGE
+ cg_cook <file.obj>...           // writes file.cgm next to every input
+ cg_cook <file.obj> -o <out.cgm> // single input with explicit output
+
+ --strips                        // draws the mesh as triangle strips with primitive restart, smaller index buffer
+ --chunked                       // writes file.cgmc (see ChunkedMesh) for OBJ files larger than memory
+ --memory-limit MB               // memory of --chunked, 256 MB by default
+ --temp DIR                      // temporary files of --chunked, the system directory by default
+ */
+
+struct CookOptions
+{
+    bool chunked = false;
+    bool strips = false;
+    cg::OBJConvertOptions convert;
+};
+
+static void printUsage()
+{
+    std::cout << "usage: cg_cook [--strips] [--chunked] [--memory-limit MB] [--temp DIR] <file.obj>... | cg_cook <file.obj> -o <out>\n";
+}
+
+static bool cookChunked(const std::string& input, const std::string& output, const CookOptions& options)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    cg::OBJLoadStats stats;
+    cg::OBJConvertOptions convert = options.convert;
+    convert.stats = &stats;
+    if (!cg::OBJFile::convert(input, output, 1.0f, convert))
+    {
+        return false;
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    cg::ChunkedMesh mesh;
+    if (!mesh.open(output))
+    {
+        return false;
+    }
+
+    std::error_code ec;
+    uintmax_t inputSize = std::filesystem::file_size(input, ec);
+    uintmax_t outputSize = std::filesystem::file_size(output, ec);
+
+    std::cout << input << " -> " << output << ": "
+        << stats.vertices << " vertices, " << stats.triangles << " triangles in " << mesh.getChunkCount() << " chunks, "
+        << inputSize << " -> " << outputSize << " bytes in " << elapsed.count() << " ms\n";
+    return true;
+}
+
+// <arena> holds the temporaries of the load and the optimization, it is shared by all files
+static bool cook(const std::string& input, const std::string& output, const CookOptions& cookOptions, cg::MeshArena* arena)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Parsed and welded by the runtime loader, never from its cache
+    cg::MeshData mesh;
+    cg::OBJLoadStats loadStats;
+    cg::OBJLoadOptions options;
+    options.stats = &loadStats;
+    options.threads = 0;
+    options.useCache = false;
+    options.arena = arena;
+    if (!cg::MeshImporter::load(input, &mesh, 1.0f, options))
+    {
+        return false;
+    }
+
+    // The temporaries of the load are gone
+    arena->reset();
+    cg::MeshOptimizer::VertexCacheStats before, after;
+    cg::MeshOptimizer::optimize(&mesh, &before, &after, cg::MeshOptimizer::DEFAULT_CACHE_SIZE, cg::MeshOptimizer::DEFAULT_OVERDRAW_THRESHOLD, arena);
+    size_t listIndices = mesh.indices.size();
+    if (cookOptions.strips)
+    {
+        cg::MeshOptimizer::convertToStrips(&mesh, arena);
+    }
+
+    // The viewer loads the input again once it or one of its materials is newer than the cooked file
+    std::vector<std::string> sources = { input };
+    sources.insert(sources.end(), loadStats.materialLibraries.begin(), loadStats.materialLibraries.end());
+    if (!cg::CookedMesh::write(output, mesh, sources))
+    {
+        return false;
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::error_code ec;
+    uintmax_t inputSize = std::filesystem::file_size(input, ec);
+    uintmax_t outputSize = std::filesystem::file_size(output, ec);
+
+    std::cout << input << " -> " << output << ": "
+        << mesh.vertices.size() << " vertices, " << mesh.getTriangleCount() << " triangles, "
+        << listIndices << " -> " << mesh.indices.size() << " indices, "
+        << inputSize << " -> " << outputSize << " bytes in " << elapsed.count() << " ms, "
+        << "ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << "\n";
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> inputs;
+    std::string output;
+    CookOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--chunked")
+        {
+            options.chunked = true;
+        }
+        else if (arg == "--strips")
+        {
+            options.strips = true;
+        }
+        else if (arg == "-o" || arg == "--memory-limit" || arg == "--temp")
+        {
+            if (i + 1 >= argc)
+            {
+                printUsage();
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "-o")
+            {
+                output = value;
+            }
+            else if (arg == "--temp")
+            {
+                options.convert.tempDirectory = value;
+            }
+            else
+            {
+                options.convert.memoryLimit = (size_t)std::strtoull(value.c_str(), nullptr, 10) << 20;
+            }
+        }
+        else
+        {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty() || (!output.empty() && inputs.size() != 1))
+    {
+        printUsage();
+        return 1;
+    }
+
+    cg::MeshArena arena;
+    int failed = 0;
+    for (const std::string& input : inputs)
+    {
+        bool cooked;
+        if (options.chunked)
+        {
+            cooked = cookChunked(input, output.empty() ? cg::ChunkedMesh::getChunkedPath(input) : output, options);
+        }
+        else
+        {
+            cooked = cook(input, output.empty() ? cg::CookedMesh::getCookedPath(input) : output, options, &arena);
+        }
+
+        if (!cooked)
+        {
+            std::cout << "failed to cook " << input << '\n';
+            failed++;
+        }
+    }
+
+    return failed == 0 ? 0 : 2;
+}
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <sstream>
 #include <tuple>
+#include <chrono>
+#include <future>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -10,8 +13,14 @@
 #include "CG/Scene.h"
 #include "CG/GeometryUtil.h"
 #include "CG/Window.h"
+#include "CG/AssetLoader.h"
+#include "CG/HotReloader.h"
 
 #include "CG/OBJFile.h"
+#include "CG/CookedMesh.h"
+#include "CG/GLBFile.h"
+#include "CG/MeshSimplifier.h"
+#include "CG/MeshletBuilder.h"
 
 // Standard window width
 static const int WINDOW_WIDTH = 640;
@@ -21,6 +30,9 @@ static const int WINDOW_HEIGHT = 480;
 static float zNear = 0.1f;
 static float zFar = 100.0f;
 
+// Time per frame that may be spent on uploading loaded models
+static const double UPLOAD_BUDGET_MS = 2.0;
+
 static cg::Scene scene;
 
 static std::shared_ptr<cg::Object> origin;
@@ -52,55 +64,342 @@ static const char* shaderSwitch[] = {"default", "phong", "gouraud"};
 static const unsigned int shaderSwitchAmount = 3;
 static unsigned int currentShaderIndex = 0;
 
-static std::vector<cg::MeshData> objMeshes;
+static cg::AssetLoader assetLoader;
+
+// Picks up changes to the loaded models and shaders while the program runs
+static cg::HotReloader hotReloader(assetLoader);
+
+struct LoadedModel
+{
+    std::shared_ptr<cg::MeshGLInfo> meshInfo;
+    std::shared_ptr<cg::MeshGLInfo> normalsInfo;
+
+    // Set once every level is uploaded, cooked models have none until their source is reloaded
+    std::vector<cg::Object::LOD> lods;
+
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    // Loaded from a ".cgm" file made by cg_cook, it has no normals display until its source is reloaded
+    bool cooked = false;
+
+    bool isReady() const { return meshInfo != nullptr && (normalsInfo != nullptr || cooked); }
+};
+
+// Filled by the upload callbacks while the models stream in
+static std::vector<LoadedModel> objModels;
+
+// Model shown by <sphere>, NO_MODEL while it shows the sun
+static const size_t NO_MODEL = ~(size_t)0;
+static size_t shownModel = NO_MODEL;
+
+// Background batch load of the models, waits for the load on exit
+static std::future<void> objLoading;
+
+static void calculateBounds(const cg::MeshData& mesh, glm::vec3* min, glm::vec3* max)
+{
+    *min = glm::vec3(0.0f);
+    *max = glm::vec3(0.0f);
+    if (!mesh.vertices.empty())
+    {
+        *min = *max = mesh.vertices[0];
+    }
+    for (const auto& vert : mesh.vertices)
+    {
+        *min = glm::min(*min, vert);
+        *max = glm::max(*max, vert);
+    }
+}
+
+// Models are uploaded quantized like cooked ones, 16 instead of 36 bytes per vertex. Reloads keep the layout.
+static const cg::VertexLayout MODEL_VERTEX_LAYOUT = cg::VertexLayout::QUANTIZED;
+
+/*
+ Builds the LOD chain of <mesh> and queues its levels for upload, can be called from any thread.
+ <onUploaded> gets the whole chain on the render thread once the last level is uploaded, or an empty one if there are no levels.
+ */
+static void uploadLODs(const cg::MeshData& mesh, std::function<void(std::vector<cg::Object::LOD>)> onUploaded)
+{
+    std::vector<cg::MeshSimplifier::LODLevel> levels = cg::MeshSimplifier::buildLODChain(mesh);
+    if (levels.empty())
+    {
+        // Through the queue, so the chain of a previous version of the mesh is cleared on the render thread
+        assetLoader.queueUpload(nullptr, [onUploaded](std::shared_ptr<const cg::MeshData>, std::shared_ptr<cg::MeshGLInfo>)
+        {
+            onUploaded({});
+        });
+        return;
+    }
+
+    auto lods = std::make_shared<std::vector<cg::Object::LOD>>(levels.size());
+    auto remaining = std::make_shared<size_t>(levels.size());
+    for (size_t l = 0; l < levels.size(); ++l)
+    {
+        (*lods)[l].error = levels[l].error;
+        cg::MeshletBuilder::buildMeshlets(&levels[l].mesh);
+        auto levelMesh = std::make_shared<cg::MeshData>(std::move(levels[l].mesh));
+        assetLoader.queueUpload(levelMesh, [l, lods, remaining, onUploaded](std::shared_ptr<const cg::MeshData>, std::shared_ptr<cg::MeshGLInfo> info)
+        {
+            (*lods)[l].meshInfo = info;
+            if (--*remaining == 0)
+            {
+                onUploaded(std::move(*lods));
+            }
+        }, MODEL_VERTEX_LAYOUT);
+    }
+}
+
+// Stores the LODs of model <i> and hands them to <sphere> if it shows the model
+static void setModelLODs(size_t i, std::vector<cg::Object::LOD> lods)
+{
+    objModels[i].lods = std::move(lods);
+    if (shownModel == i)
+    {
+        sphere->setLODs(objModels[i].lods);
+    }
+}
+
+/*
+ Called on the render thread after model <i> has been reloaded. The bounds and the normals display
+ are recalculated on a worker thread and swapped in once they are uploaded.
+ */
+static void onModelReloaded(size_t i, std::shared_ptr<const cg::MeshData> mesh)
+{
+    std::cout << "Reloaded model " << i << ": " << mesh->vertices.size() << " vertices, " << mesh->getTriangleCount() << " triangles\n";
+
+    auto bounds = std::make_shared<std::pair<glm::vec3, glm::vec3>>();
+    assetLoader.loadMesh([i, mesh, bounds](cg::MeshData* normals)
+    {
+        calculateBounds(*mesh, &bounds->first, &bounds->second);
+        cg::GeometryUtil::generateNormalDisplayObj(normals, mesh.get());
+
+        // The old levels are drawn until the new ones are uploaded
+        uploadLODs(*mesh, [i](std::vector<cg::Object::LOD> lods)
+        {
+            setModelLODs(i, std::move(lods));
+        });
+        return true;
+    }, [i, bounds](std::shared_ptr<const cg::MeshData>, std::shared_ptr<cg::MeshGLInfo> info)
+    {
+        if (objModels[i].normalsInfo != nullptr)
+        {
+            objModels[i].normalsInfo->swap(*info);
+        }
+        else
+        {
+            objModels[i].normalsInfo = info;
+        }
+        objModels[i].boundsMin = bounds->first;
+        objModels[i].boundsMax = bounds->second;
+    });
+}
+
+// Models are drawn every frame, so the vertex cache order is worth the extra load time.
+// The phong shader lights every fragment, so they are sorted against overdraw as well. Meshlets let the parts of a model
+// that face away or are off screen be skipped. Reloads use the same options.
+static cg::OBJLoadOptions getModelLoadOptions()
+{
+    cg::OBJLoadOptions options;
+    options.optimize = true;
+    options.overdrawThreshold = cg::MeshOptimizer::DEFAULT_OVERDRAW_THRESHOLD;
+    options.meshlets = true;
+    return options;
+}
 
-static bool loadOBJs()
+/*
+ Uploads the cooked version of model <i> if cg_cook made one and its sources have not changed since. It is mapped and
+ uploaded right away, changes to the sources are loaded from the OBJ like for models that have not been cooked.
+ */
+static bool loadCookedModel(size_t i, const cg::OBJLoadRequest& request)
 {
-    std::string files[] =
-    {
-        "Testobjs/bigguy.obj",
-        "Testobjs/chess_king.obj",
-        "Testobjs/kship3.obj",
-        "Testobjs/kship3_mitNormalenTest.obj",
-        "Testobjs/sonne.obj",
-        "Testobjs/stanford_bunny_closed_withnormals.obj",
-        "Testobjs/suzanne.obj",
+    cg::CookedMesh cooked;
+    if (!cooked.open(cg::CookedMesh::getCookedPath(request.path)))
+    {
+        return false;
+    }
+    if (!cooked.isUpToDate())
+    {
+        std::cout << "Cooked model " << request.path << " is outdated, loading the source instead\n";
+        return false;
+    }
+
+    LoadedModel* model = &objModels[i];
+    model->meshInfo = cg::MeshGLInfo::generate(cooked, request.scale);
+    model->boundsMin = cooked.getBoundsMin() * request.scale;
+    model->boundsMax = cooked.getBoundsMax() * request.scale;
+    model->cooked = true;
+
+    // The first source is the OBJ file, the others are its material libraries
+    std::vector<std::string> materialLibraries;
+    if (!cooked.getSources().empty())
+    {
+        materialLibraries.assign(cooked.getSources().begin() + 1, cooked.getSources().end());
+    }
+    hotReloader.watchOBJ(request.path, model->meshInfo, request.scale, [i](std::shared_ptr<const cg::MeshData> mesh)
+    {
+        onModelReloaded(i, mesh);
+    }, getModelLoadOptions(), materialLibraries);
+
+    std::cout << "Loaded cooked model " << request.path << ": " << cooked.getVertexCount() << " vertices, " << cooked.getIndexCount() << " indices\n";
+    return true;
+}
+
+/*
+ Starts loading all models in the background. They can be selected once they are uploaded.
+ Models that have been cooked by cg_cook are loaded right away instead.
+ */
+static void loadOBJs()
+{
+    std::vector<cg::OBJLoadRequest> models =
+    {
+        { "Testobjs/bigguy.obj", 0.1f },
+        { "Testobjs/chess_king.obj", 0.25f },
+        { "Testobjs/kship3.obj", 0.25f },
+        { "Testobjs/kship3_mitNormalenTest.obj", 0.25f },
+        { "Testobjs/sonne.obj", 1.0f },
+        { "Testobjs/stanford_bunny_closed_withnormals.obj", 0.15f },
+        { "Testobjs/suzanne.obj", 0.75f },
     };
 
-    float scale[] =
+    objModels.resize(models.size());
+
+    // Everything that has not been cooked is parsed, <modelIndex> maps the requests back to the models
+    std::vector<cg::OBJLoadRequest> requests;
+    std::vector<size_t> modelIndex;
+    for (size_t i = 0; i < models.size(); ++i)
     {
-        0.1f,
-        0.25f,
-        0.25f,
-        0.25f,
-        1.0f,
-        0.15f,
-        0.75f
+        if (!loadCookedModel(i, models[i]))
+        {
+            requests.push_back(models[i]);
+            modelIndex.push_back(i);
+        }
+    }
+
+    if (requests.empty())
+    {
+        return;
+    }
+
+    // Runs on a worker thread of the batch as soon as one file is done
+    auto onLoaded = [modelIndex, requests](size_t r, cg::OBJLoadResult& result)
+    {
+        if (!result.success)
+        {
+            return;
+        }
+        size_t i = modelIndex[r];
+
+        const cg::OBJLoadStats& stats = result.stats;
+        std::ostringstream msg;
+        msg << "Loaded model " << i << (stats.fromCache ? " (cached)" : "") << ": " << stats.vertices << " vertices, " << stats.triangles << " triangles";
+        if (!stats.fromCache)
+        {
+            // Vertex welding
+            msg << ", " << stats.positions << " positions, " << stats.splitVertices << " split, "
+                << stats.mergedCorners << " of " << stats.corners << " corners merged, " << stats.unusedPositions << " unused";
+
+            // Simulated post-transform cache
+            msg << ", ACMR " << stats.cacheBefore.acmr << " -> " << stats.cacheAfter.acmr;
+        }
+        msg << '\n';
+        std::cout << msg.str();
+
+        auto mesh = std::make_shared<cg::MeshData>(std::move(result.mesh));
+
+        // Calculate Bounding Box
+        glm::vec3 min;
+        glm::vec3 max;
+        calculateBounds(*mesh, &min, &max);
+
+        // Create normals display object for the model, it is uploaded on its own
+        auto normals = std::make_shared<cg::MeshData>();
+        cg::GeometryUtil::generateNormalDisplayObj(normals.get(), mesh.get());
+
+        const cg::OBJLoadRequest& request = requests[r];
+        std::vector<std::string> materialLibraries = stats.materialLibraries;
+        assetLoader.queueUpload(mesh, [i, min, max, request, materialLibraries](std::shared_ptr<const cg::MeshData>, std::shared_ptr<cg::MeshGLInfo> info)
+        {
+            std::cout << "Uploaded model " << i << ": " << info->getVertexSize() << " bytes per vertex\n";
+            objModels[i].meshInfo = info;
+            objModels[i].boundsMin = min;
+            objModels[i].boundsMax = max;
+
+            // Changes to the file or its materials are swapped into <info>, so every object that shows the model is updated
+            hotReloader.watchOBJ(request.path, info, request.scale, [i](std::shared_ptr<const cg::MeshData> mesh)
+            {
+                onModelReloaded(i, mesh);
+            }, getModelLoadOptions(), materialLibraries);
+        }, MODEL_VERTEX_LAYOUT);
+        assetLoader.queueUpload(normals, [i](std::shared_ptr<const cg::MeshData>, std::shared_ptr<cg::MeshGLInfo> info)
+        {
+            objModels[i].normalsInfo = info;
+        });
+
+        uploadLODs(*mesh, [i](std::vector<cg::Object::LOD> lods)
+        {
+            setModelLODs(i, std::move(lods));
+        });
     };
 
-    const int length = sizeof(files) / sizeof(std::string);
-    for (size_t i = 0; i < length; ++i)
+    std::cout << "Loading " << requests.size() << " models\n";
+    objLoading = std::async(std::launch::async, [requests, onLoaded]()
     {
-        std::cout << "Loading " << files[i] << '\n';
-        objMeshes.push_back({});
-        if (!cg::OBJFile::load(files[i], &objMeshes[i], scale[i]))
+        auto start = std::chrono::steady_clock::now();
+        std::vector<cg::OBJLoadResult> results = cg::OBJFile::loadAll(requests, getModelLoadOptions(), 0, onLoaded);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::ostringstream msg;
+        size_t failed = 0;
+        for (size_t i = 0; i < results.size(); ++i)
         {
-            return false;
+            if (!results[i].success)
+            {
+                msg << "Failed to load " << requests[i].path << ": " << results[i].stats.error << '\n';
+                failed++;
+            }
         }
+        msg << "Loaded " << results.size() - failed << " of " << results.size() << " models in " << elapsed.count() << " ms\n";
+        std::cout << msg.str();
+    });
+}
+
+/*
+ Adds the binary glTF files given on the command line to the scene, each one with its node hierarchy.
+ */
+static void loadGLBs(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        cg::GLBFile file;
+        if (!file.open(argv[i]))
+        {
+            continue;
+        }
+
+        // The buffers are uploaded straight from the mapping, the file is not needed afterwards
+        scene.addObject(file.createObjects(cg::ShaderManager::getShader("phong")));
+        std::cout << "Loaded " << argv[i] << ": " << file.getMeshes().size() << " meshes, " << file.getNodes().size() << " nodes\n";
     }
-    return true;
 }
 
-static std::tuple<std::shared_ptr<cg::Object>, std::shared_ptr<cg::Object>> createSphereObj(uint8_t sd, float r, const glm::vec3& c, const std::string& shader, const std::string& dbgName = "")
+static std::tuple<std::shared_ptr<cg::Object>, std::shared_ptr<cg::Object>> createSphereObj(uint32_t sd, float r, const glm::vec3& c, const std::string& shader, const std::string& dbgName = "")
 {
     cg::MeshData mesh;
     auto obj = std::make_shared<cg::Object>(dbgName);
 
-    cg::GeometryUtil::generateSphereModel(&mesh, sd, r, c);
+    cg::GeometryUtil::generateIcosphereModel(&mesh, sd, r, c, true);
     obj->setMesh(mesh);
     obj->setShader(cg::ShaderManager::getShader(shader));
     obj->setColor(c);
 
+    // Far away moons need far fewer triangles
+    std::vector<cg::Object::LOD> lods;
+    for (const cg::MeshSimplifier::LODLevel& level : cg::MeshSimplifier::buildLODChain(mesh))
+    {
+        lods.push_back({ cg::MeshGLInfo::generate(level.mesh), level.error });
+    }
+    obj->setLODs(std::move(lods));
+
     cg::MeshData meshNormalObj;
     cg::GeometryUtil::generateNormalDisplayObj(&meshNormalObj, &mesh);
 
@@ -153,6 +452,11 @@ bool createScene()
         { "shader/shadedGouraud.frag", cg::GLSLShader::GLSLShaderType::FRAGMENT }
     })) return false;
 
+    for (const std::string& name : cg::ShaderManager::getShaderNames())
+    {
+        hotReloader.watchShader(name);
+    }
+
     // Origin symbol
     cg::MeshData mesh;
     cg::GeometryUtil::generateOriginModel(&mesh);
@@ -169,21 +473,21 @@ bool createScene()
 
 
     // Sphere model
-    std::tie(sphere, normalsSphere) = createSphereObj(12, 0.75f, {1.0f, 1.0f, 0.0f}, "phong", "Sun");
+    std::tie(sphere, normalsSphere) = createSphereObj(8, 0.75f, {1.0f, 1.0f, 0.0f}, "phong", "Sun");
 
     centerRotationAnchor = std::make_shared<cg::Object>();
 
 
     // Planet model
-    std::tie(planet, normalsPlanet) = createSphereObj(8, 0.4f, { 0.8f, 0.2f, 0.2f }, "phong", "Planet");
+    std::tie(planet, normalsPlanet) = createSphereObj(6, 0.4f, { 0.8f, 0.2f, 0.2f }, "phong", "Planet");
     planet->position.x = 2.5f;
 
 
     // Moons
-    std::tie(moon1, normalsMoon1) = createSphereObj(6, 0.25f, { 0.2f, 0.2f, 0.8f }, "phong", "Moon 1");
+    std::tie(moon1, normalsMoon1) = createSphereObj(5, 0.25f, { 0.2f, 0.2f, 0.8f }, "phong", "Moon 1");
     moon1->position.y = 1.0f;
 
-    std::tie(moon2, normalsMoon2) = createSphereObj(6, 0.25f, { 0.2f, 0.2f, 0.8f }, "phong", "Moon 2");
+    std::tie(moon2, normalsMoon2) = createSphereObj(5, 0.25f, { 0.2f, 0.2f, 0.8f }, "phong", "Moon 2");
     moon2->position.y = -1.0f;
 
     moonsRotationAnchor = std::make_shared<cg::Object>();
@@ -251,6 +555,24 @@ static void toggleBoundingBox()
     }
 }
 
+static void toggleLODs()
+{
+    // The threshold that is not in use, 0 draws everything at full detail
+    static float otherThreshold = 0.0f;
+
+    float threshold = scene.getLODThreshold();
+    scene.setLODThreshold(otherThreshold);
+    otherThreshold = threshold;
+
+    std::cout << "LODs " << (scene.getLODThreshold() > 0.0f ? "on" : "off") << ", " << scene.getDrawnTriangles() << " triangles in the last frame\n";
+}
+
+static void toggleMeshletCulling()
+{
+    scene.setMeshletCulling(!scene.getMeshletCulling());
+    std::cout << "Meshlet culling " << (scene.getMeshletCulling() ? "on" : "off") << ", " << scene.getDrawnTriangles() << " triangles in the last frame\n";
+}
+
 static void toggleWireframe()
 {
     static bool wireframe = false;
@@ -275,33 +597,30 @@ static void switchNextModel()
 {
     static unsigned int currentOBJ = 0;
 
-    currentOBJ = (currentOBJ + 1) % objMeshes.size();
-
-    sphere->setMesh(objMeshes[currentOBJ]);
-
-
-    // Create normals display object for new model
-    cg::MeshData mesh;
-    cg::GeometryUtil::generateNormalDisplayObj(&mesh, &objMeshes[currentOBJ]);
-
-    normalsSphere->setMesh(mesh);
-
-    glm::vec3 min(0, 0, 0);
-    glm::vec3 max(0, 0, 0);
-
-    // Calculate Bounding Box
-    for (const auto& vert : objMeshes[currentOBJ].vertices)
+    // Skip models that are still loading (or failed to load)
+    unsigned int next = currentOBJ;
+    do
     {
-        min.x = glm::min(min.x, vert.x);
-        min.y = glm::min(min.y, vert.y);
-        min.z = glm::min(min.z, vert.z);
+        next = (next + 1) % objModels.size();
+    } while (next != currentOBJ && !objModels[next].isReady());
 
-        max.x = glm::max(max.x, vert.x);
-        max.y = glm::max(max.y, vert.y);
-        max.z = glm::max(max.z, vert.z);
+    if (!objModels[next].isReady())
+    {
+        std::cout << "No model loaded yet\n";
+        return;
     }
+    currentOBJ = next;
+
+    const LoadedModel& model = objModels[currentOBJ];
+    sphere->setMeshInfo(model.meshInfo);
+    sphere->setLODs(model.lods);
+    shownModel = currentOBJ;
 
-    cg::GeometryUtil::generateBox(&mesh, min, max);
+    // Normals display object for new model, cooked models have none
+    normalsSphere->setMeshInfo(model.normalsInfo);
+
+    cg::MeshData mesh;
+    cg::GeometryUtil::generateBox(&mesh, model.boundsMin, model.boundsMax);
     box->setMesh(mesh);
 
     // Reset rotation
@@ -336,6 +655,8 @@ void charCallback(unsigned int keycode)
     case 'h': switchNextShader(); break;
     case 'm': switchNextModel(); break;
     case 'b': toggleBoundingBox(); break;
+    case 'o': toggleLODs(); break;
+    case 'c': toggleMeshletCulling(); break;
     }
 }
 
@@ -416,10 +737,7 @@ int main(int argc, char** argv)
     }
 #endif
 
-    if (!loadOBJs())
-    {
-        return -3;
-    }
+    loadOBJs();
 
     bool result = createScene();
     if (!result)
@@ -427,6 +745,8 @@ int main(int argc, char** argv)
         return -2;
     }
 
+    loadGLBs(argc, argv);
+
     window.setCharTypedCallback(charCallback);
     window.setWindowResizedCallback(updateViewport);
 
@@ -442,6 +762,10 @@ int main(int argc, char** argv)
         
         updateLogic();
 
+        // Reload changed files, stream in models that finished loading
+        hotReloader.update();
+        assetLoader.processUploads(UPLOAD_BUDGET_MS);
+
         scene.renderScene();
         window.swapBuffers();
     }